@@ -0,0 +1,1196 @@
+#include "dvr.h"
+#include "dvr_cluster.h"
+#include "dvr_log.h"
+#include "dvr_meshopt.h"
+#include "dvr_quantize.h"
+#include "dvr_utils.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+
+static void get_executable_path(char* path, usize max_len) {
+#ifdef _WIN32
+    memset(path, 0, max_len);
+    GetModuleFileNameA(NULL, path, max_len);
+#else
+    memset(path, 0, max_len);
+    isize ret = readlink("/proc/self/exe", path, max_len);
+    if (ret == -1) {
+        DVRLOG_ERROR("readlink failed");
+        return;
+    }
+#endif
+}
+
+static void get_executable_directory(char* path, usize max_len) {
+    get_executable_path(path, max_len);
+    usize last_slash = 0;
+    usize path_len = strnlen(path, max_len);
+    for (usize i = 0; i < path_len; i++) {
+        if (path[i] == '/') {
+            last_slash = i;
+        }
+    }
+    path[last_slash] = '\0';
+}
+
+static void set_executable_directory(const char* path) {
+#ifdef _WIN32
+    SetCurrentDirectoryA(path);
+#else
+    chdir(path);
+#endif
+}
+
+// BENCHMARK HARNESS
+
+#define BENCH_MAX_RESULTS 32
+
+typedef struct bench_result {
+    const char* name;
+    u32 iterations;
+    f64 total_s;
+    f64 min_s;
+    f64 max_s;
+    u64 bytes_per_iteration;
+    // GPU counts of the last iteration, for benchmarks drawing geometry
+    bool has_pipeline_statistics;
+    dvr_pipeline_statistics pipeline_statistics;
+} bench_result;
+
+typedef struct bench_state {
+    bench_result results[BENCH_MAX_RESULTS];
+    u32 num_results;
+
+    dvr_shader_module vert_shader;
+    dvr_shader_module frag_shader;
+    dvr_descriptor_set_layout descriptor_set_layout;
+    dvr_buffer uniform_buffer;
+    dvr_image image;
+    dvr_sampler sampler;
+} bench_state;
+
+static bench_state g_bench_state;
+
+static f64 bench_now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (f64)t.tv_sec + (f64)t.tv_nsec / 1.0e9;
+}
+
+static bench_result* bench_begin(const char* name, u64 bytes_per_iteration) {
+    bench_result* r = &g_bench_state.results[g_bench_state.num_results++];
+    *r = (bench_result){
+        .name = name,
+        .min_s = DBL_MAX,
+        .bytes_per_iteration = bytes_per_iteration,
+    };
+
+    DVRLOG_INFO("running %s", name);
+    return r;
+}
+
+static void bench_record(bench_result* r, f64 start) {
+    f64 dt = bench_now() - start;
+    r->iterations++;
+    r->total_s += dt;
+    if (dt < r->min_s) {
+        r->min_s = dt;
+    }
+    if (dt > r->max_s) {
+        r->max_s = dt;
+    }
+}
+
+// BENCHMARKS
+
+#define BENCH_CREATE_ITERATIONS 1000
+#define BENCH_UPLOAD_ITERATIONS 20
+#define BENCH_PIPELINE_ITERATIONS 20
+#define BENCH_FRAME_ITERATIONS 1000
+#define BENCH_FRAME_WARMUP 16
+#define BENCH_MESH_ITERATIONS 100
+#define BENCH_MESH_OPTIMIZE_ITERATIONS 10
+#define BENCH_MESH_GRID 256
+
+static DVR_RESULT(dvr_none) bench_buffer_create_destroy(void) {
+    bench_result* r = bench_begin("buffer_create_destroy", 0);
+
+    for (u32 i = 0; i < BENCH_CREATE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_buffer)
+        buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+            .usage = DVR_BUFFER_USAGE_VERTEX,
+            .data = (dvr_range){ .size = 64 * 1024 },
+            .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+        });
+        DVR_BUBBLE_INTO(dvr_none, buffer_res);
+        dvr_destroy_buffer(DVR_UNWRAP(buffer_res));
+        bench_record(r, start);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_image_create_destroy(void) {
+    bench_result* r = bench_begin("image_create_destroy", 0);
+
+    for (u32 i = 0; i < BENCH_CREATE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_image)
+        image_res = dvr_create_image(&(dvr_image_desc){
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+            .width = 256,
+            .height = 256,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        });
+        DVR_BUBBLE_INTO(dvr_none, image_res);
+        dvr_destroy_image(DVR_UNWRAP(image_res));
+        bench_record(r, start);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static dvr_sampler_desc bench_sampler_desc(void) {
+    return (dvr_sampler_desc){
+        .min_filter = VK_FILTER_LINEAR,
+        .mag_filter = VK_FILTER_LINEAR,
+        .mipmap_mode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .address_mode_u = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .address_mode_v = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .address_mode_w = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .anisotropy_enable = false,
+        .max_anisotropy = 1.0f,
+        .compare_op = VK_COMPARE_OP_ALWAYS,
+        .max_lod = VK_LOD_CLAMP_NONE,
+        .border_color = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,
+    };
+}
+
+static DVR_RESULT(dvr_none) bench_sampler_create_destroy(void) {
+    bench_result* r = bench_begin("sampler_create_destroy", 0);
+
+    dvr_sampler_desc desc = bench_sampler_desc();
+    for (u32 i = 0; i < BENCH_CREATE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_sampler) sampler_res = dvr_create_sampler(&desc);
+        DVR_BUBBLE_INTO(dvr_none, sampler_res);
+        dvr_destroy_sampler(DVR_UNWRAP(sampler_res));
+        bench_record(r, start);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_static_buffer_upload(const char* name, usize size) {
+    bench_result* r = bench_begin(name, size);
+
+    u8* data = malloc(size);
+    for (usize i = 0; i < size; i++) {
+        data[i] = (u8)i;
+    }
+
+    for (u32 i = 0; i < BENCH_UPLOAD_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_buffer)
+        buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+            .usage = DVR_BUFFER_USAGE_STORAGE | DVR_BUFFER_USAGE_TRANSFER_DST,
+            .data = (dvr_range){ .base = data, .size = size },
+            .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+        });
+        if (!buffer_res.is_ok) {
+            free(data);
+        }
+        DVR_BUBBLE_INTO(dvr_none, buffer_res);
+        bench_record(r, start);
+
+        dvr_destroy_buffer(DVR_UNWRAP(buffer_res));
+    }
+
+    free(data);
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_image_upload(const char* name, u32 size, bool mipmaps) {
+    usize byte_size = (usize)size * size * 4;
+    bench_result* r = bench_begin(name, byte_size);
+
+    u8* data = malloc(byte_size);
+    for (usize i = 0; i < byte_size; i++) {
+        data[i] = (u8)(i * 7);
+    }
+
+    for (u32 i = 0; i < BENCH_UPLOAD_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_image)
+        image_res = dvr_create_image(&(dvr_image_desc){
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+            .width = size,
+            .height = size,
+            .data = (dvr_range){ .base = data, .size = byte_size },
+            .generate_mipmaps = mipmaps,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        });
+        if (!image_res.is_ok) {
+            free(data);
+        }
+        DVR_BUBBLE_INTO(dvr_none, image_res);
+        bench_record(r, start);
+
+        dvr_destroy_image(DVR_UNWRAP(image_res));
+    }
+
+    free(data);
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_descriptor_set_create(void) {
+    bench_result* r = bench_begin("descriptor_set_create_destroy", 0);
+
+    for (u32 i = 0; i < BENCH_CREATE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_descriptor_set)
+        set_res = dvr_create_descriptor_set(&(dvr_descriptor_set_desc){
+            .layout = g_bench_state.descriptor_set_layout,
+            .num_bindings = 2,
+            .bindings =
+                (dvr_descriptor_set_binding_desc[]){
+                    {
+                        .binding = 0,
+                        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                        .buffer = {
+                            .buffer = g_bench_state.uniform_buffer,
+                            .offset = 0,
+                            .size = 16,
+                        },
+                    },
+                    {
+                        .binding = 1,
+                        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                        .image = {
+                            .image = g_bench_state.image,
+                            .sampler = g_bench_state.sampler,
+                            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        },
+                    },
+                },
+        });
+        DVR_BUBBLE_INTO(dvr_none, set_res);
+        dvr_destroy_descriptor_set(DVR_UNWRAP(set_res));
+        bench_record(r, start);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_pipeline) bench_create_pipeline(
+    dvr_shader_module vert_shader,
+    dvr_shader_module frag_shader,
+    u32 num_desc_set_layouts,
+    dvr_vertex_input_state_desc vertex_input
+) {
+    return dvr_create_pipeline(&(dvr_pipeline_desc){
+        .render_pass = dvr_swapchain_render_pass(),
+        .subpass = 0,
+        .layout = {
+            .num_desc_set_layouts = num_desc_set_layouts,
+            .desc_set_layouts = &g_bench_state.descriptor_set_layout,
+        },
+        .num_stages = 2,
+        .stages = (dvr_pipeline_stage_desc[]){
+            {
+                .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                .entry_point = "main",
+                .shader_module = vert_shader,
+            },
+            {
+                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .entry_point = "main",
+                .shader_module = frag_shader,
+            },
+        },
+        .vertex_input = vertex_input,
+        .scissor = {
+            .offset = { 0, 0 },
+            .extent = { BENCH_WIDTH, BENCH_HEIGHT },
+        },
+        .viewport = {
+            .x = 0,
+            .y = 0,
+            .width = BENCH_WIDTH,
+            .height = BENCH_HEIGHT,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        },
+        .color_blend = {
+            .blend_enable = false,
+            .num_attachments = 1,
+        },
+        .multisample = {
+            .rasterization_samples = dvr_swapchain_samples(),
+        },
+        .depth_stencil = {
+            .depth_test_enable = true,
+            .depth_write_enable = true,
+            .depth_compare_op = VK_COMPARE_OP_LESS,
+        },
+        .rasterization = {
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .polygon_mode = VK_POLYGON_MODE_FILL,
+            .cull_mode = VK_CULL_MODE_NONE,
+            .front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .line_width = 1.0f,
+        },
+    });
+}
+
+static DVR_RESULT(dvr_none) bench_pipeline_create(void) {
+    bench_result* cold = bench_begin("pipeline_create_cold", 0);
+
+    for (u32 i = 0; i < BENCH_PIPELINE_ITERATIONS; i++) {
+        DVR_RESULT(dvr_none) reset_res = dvr_reset_pipeline_cache();
+        DVR_BUBBLE(reset_res);
+
+        f64 start = bench_now();
+        DVR_RESULT(dvr_pipeline) pipeline_res = bench_create_pipeline(
+            g_bench_state.vert_shader,
+            g_bench_state.frag_shader,
+            1,
+            (dvr_vertex_input_state_desc){}
+        );
+        DVR_BUBBLE_INTO(dvr_none, pipeline_res);
+        bench_record(cold, start);
+
+        dvr_destroy_pipeline(DVR_UNWRAP(pipeline_res));
+    }
+
+    // the last cold iteration left the cache warm
+    bench_result* cached = bench_begin("pipeline_create_cached", 0);
+
+    for (u32 i = 0; i < BENCH_PIPELINE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        DVR_RESULT(dvr_pipeline) pipeline_res = bench_create_pipeline(
+            g_bench_state.vert_shader,
+            g_bench_state.frag_shader,
+            1,
+            (dvr_vertex_input_state_desc){}
+        );
+        DVR_BUBBLE_INTO(dvr_none, pipeline_res);
+        bench_record(cached, start);
+
+        dvr_destroy_pipeline(DVR_UNWRAP(pipeline_res));
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_empty_frame(void) {
+    DVR_RESULT(dvr_none) res;
+
+    for (u32 i = 0; i < BENCH_FRAME_WARMUP; i++) {
+        res = dvr_begin_frame();
+        DVR_BUBBLE(res);
+        dvr_begin_swapchain_render_pass();
+        dvr_end_render_pass();
+        res = dvr_end_frame();
+        DVR_BUBBLE(res);
+    }
+
+    bench_result* r = bench_begin("empty_frame", 0);
+
+    for (u32 i = 0; i < BENCH_FRAME_ITERATIONS; i++) {
+        f64 start = bench_now();
+        res = dvr_begin_frame();
+        DVR_BUBBLE(res);
+        dvr_begin_swapchain_render_pass();
+        dvr_end_render_pass();
+        res = dvr_end_frame();
+        DVR_BUBBLE(res);
+        bench_record(r, start);
+    }
+
+    dvr_wait_idle();
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_frame_mipmaps(const char* name, u32 size) {
+    DVR_RESULT(dvr_image)
+    image_res = dvr_create_image(&(dvr_image_desc){
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+        .width = size,
+        .height = size,
+        .render_target = true,
+        .generate_mipmaps = true,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    });
+    DVR_BUBBLE_INTO(dvr_none, image_res);
+    dvr_image image = DVR_UNWRAP(image_res);
+
+    bench_result* r = bench_begin(name, 0);
+
+    DVR_RESULT(dvr_none) res;
+    for (u32 i = 0; i < BENCH_FRAME_ITERATIONS; i++) {
+        f64 start = bench_now();
+        res = dvr_begin_frame();
+        DVR_BUBBLE(res);
+        res = dvr_generate_mipmaps(image);
+        DVR_BUBBLE(res);
+        dvr_begin_swapchain_render_pass();
+        dvr_end_render_pass();
+        res = dvr_end_frame();
+        DVR_BUBBLE(res);
+        bench_record(r, start);
+    }
+
+    dvr_wait_idle();
+    dvr_destroy_image(image);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+#define BENCH_POST_PROCESS_PASSES 4
+
+/// A post-processing chain ping-ponging between two intermediate targets, acquired from the
+/// render target pool every frame like a renderer would.
+static DVR_RESULT(dvr_none) bench_frame_post_process(void) {
+    DVR_RESULT(dvr_render_pass)
+    pass_res = dvr_create_render_pass(&(dvr_render_pass_desc){
+        .num_color_attachments = 1,
+        .color_attachments[0] =
+            (dvr_render_pass_attachment_desc){
+                .enable = true,
+                .format = VK_FORMAT_R8G8B8A8_UNORM,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            },
+    });
+    DVR_BUBBLE_INTO(dvr_none, pass_res);
+    dvr_render_pass pass = DVR_UNWRAP(pass_res);
+
+    dvr_image_desc target_desc = {
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+        .width = BENCH_WIDTH,
+        .height = BENCH_HEIGHT,
+        .render_target = true,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    };
+    VkClearValue clear = { .color = { .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } } };
+
+    bench_result* r = bench_begin("frame_post_process_pooled", 0);
+
+    DVR_RESULT(dvr_none) res;
+    for (u32 i = 0; i < BENCH_FRAME_WARMUP + BENCH_FRAME_ITERATIONS; i++) {
+        f64 start = bench_now();
+        res = dvr_begin_frame();
+        DVR_BUBBLE(res);
+
+        dvr_image targets[2];
+        for (u32 j = 0; j < 2; j++) {
+            DVR_RESULT(dvr_image) target_res = dvr_acquire_render_target(&target_desc);
+            DVR_BUBBLE_INTO(dvr_none, target_res);
+            targets[j] = DVR_UNWRAP(target_res);
+        }
+
+        for (u32 j = 0; j < BENCH_POST_PROCESS_PASSES; j++) {
+            DVR_RESULT(dvr_framebuffer)
+            framebuffer_res = dvr_acquire_framebuffer(&(dvr_framebuffer_desc){
+                .render_pass = pass,
+                .num_attachments = 1,
+                .attachments = &targets[j % 2],
+                .width = BENCH_WIDTH,
+                .height = BENCH_HEIGHT,
+            });
+            DVR_BUBBLE_INTO(dvr_none, framebuffer_res);
+
+            dvr_begin_render_pass(pass, DVR_UNWRAP(framebuffer_res), &clear, 1);
+            dvr_end_render_pass();
+        }
+
+        dvr_begin_swapchain_render_pass();
+        dvr_end_render_pass();
+        res = dvr_end_frame();
+        DVR_BUBBLE(res);
+
+        // the first frames allocate the targets
+        if (i >= BENCH_FRAME_WARMUP) {
+            bench_record(r, start);
+        }
+    }
+
+    dvr_wait_idle();
+    dvr_destroy_render_pass(pass);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_shader_module) bench_load_shader(const char* path);
+
+/// Regular grid covering the screen, with its triangles and vertices shuffled like an
+/// unprocessed asset.
+typedef struct bench_mesh {
+    f32* positions;
+    usize vertex_count;
+    u32* indices;
+    usize index_count;
+} bench_mesh;
+
+static u32 bench_random(u32* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static bench_mesh bench_generate_mesh(void) {
+    const u32 n = BENCH_MESH_GRID;
+    bench_mesh mesh = {
+        .vertex_count = (usize)(n + 1) * (n + 1),
+        .index_count = (usize)n * n * 6,
+    };
+    mesh.positions = malloc(mesh.vertex_count * 3 * sizeof(f32));
+    mesh.indices = malloc(mesh.index_count * sizeof(u32));
+
+    u32 seed = 1;
+    u32* vertex_order = malloc(mesh.vertex_count * sizeof(u32));
+    for (u32 i = 0; i < mesh.vertex_count; i++) {
+        vertex_order[i] = i;
+    }
+    for (usize i = mesh.vertex_count - 1; i > 0; i--) {
+        usize j = bench_random(&seed) % (i + 1);
+        u32 tmp = vertex_order[i];
+        vertex_order[i] = vertex_order[j];
+        vertex_order[j] = tmp;
+    }
+
+    for (u32 y = 0; y <= n; y++) {
+        for (u32 x = 0; x <= n; x++) {
+            f32* p = &mesh.positions[vertex_order[y * (n + 1) + x] * 3];
+            p[0] = (f32)x / (f32)n * 2.0f - 1.0f;
+            p[1] = (f32)y / (f32)n * 2.0f - 1.0f;
+            p[2] = 0.5f;
+        }
+    }
+
+    usize index = 0;
+    for (u32 y = 0; y < n; y++) {
+        for (u32 x = 0; x < n; x++) {
+            u32 a = vertex_order[y * (n + 1) + x];
+            u32 b = vertex_order[y * (n + 1) + x + 1];
+            u32 c = vertex_order[(y + 1) * (n + 1) + x];
+            u32 d = vertex_order[(y + 1) * (n + 1) + x + 1];
+            u32 quad[6] = { a, b, c, b, d, c };
+            memcpy(&mesh.indices[index], quad, sizeof(quad));
+            index += 6;
+        }
+    }
+
+    usize triangle_count = mesh.index_count / 3;
+    for (usize i = triangle_count - 1; i > 0; i--) {
+        usize j = bench_random(&seed) % (i + 1);
+        u32 tmp[3];
+        memcpy(tmp, &mesh.indices[i * 3], sizeof(tmp));
+        memcpy(&mesh.indices[i * 3], &mesh.indices[j * 3], sizeof(tmp));
+        memcpy(&mesh.indices[j * 3], tmp, sizeof(tmp));
+    }
+
+    free(vertex_order);
+    return mesh;
+}
+
+static void bench_record_pipeline_statistics(bench_result* r, const bench_mesh* mesh) {
+    DVR_RESULT(dvr_pipeline_statistics) statistics_res = dvr_get_pipeline_statistics();
+    if (statistics_res.is_ok) {
+        r->has_pipeline_statistics = true;
+        r->pipeline_statistics = DVR_UNWRAP(statistics_res);
+        DVRLOG_INFO(
+            "%s: %llu vertex shader invocations for %zu vertices, %llu of %zu triangles",
+            r->name,
+            (unsigned long long)r->pipeline_statistics.vertex_shader_invocations,
+            mesh->vertex_count,
+            (unsigned long long)r->pipeline_statistics.input_assembly_primitives,
+            mesh->index_count / 3
+        );
+    } else {
+        DVRLOG_WARNING("%s: no pipeline statistics, %s", r->name, statistics_res.error.message);
+    }
+}
+
+static DVR_RESULT(dvr_none) bench_mesh_draw(
+    const char* name,
+    dvr_pipeline pipeline,
+    const bench_mesh* mesh,
+    dvr_range vertices
+) {
+    DVR_RESULT(dvr_buffer)
+    vertex_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .usage = DVR_BUFFER_USAGE_VERTEX,
+        .data = vertices,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_BUBBLE_INTO(dvr_none, vertex_buffer_res);
+    dvr_buffer vertex_buffer = DVR_UNWRAP(vertex_buffer_res);
+
+    DVR_RESULT(dvr_buffer)
+    index_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .usage = DVR_BUFFER_USAGE_INDEX,
+        .data = (dvr_range){ .base = mesh->indices, .size = mesh->index_count * sizeof(u32) },
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_BUBBLE_INTO(dvr_none, index_buffer_res);
+    dvr_buffer index_buffer = DVR_UNWRAP(index_buffer_res);
+
+    bench_result* r = bench_begin(name, 0);
+
+    DVR_RESULT(dvr_none) res;
+    for (u32 i = 0; i < BENCH_MESH_ITERATIONS; i++) {
+        f64 start = bench_now();
+        res = dvr_begin_frame();
+        DVR_BUBBLE(res);
+        dvr_begin_pipeline_statistics();
+        dvr_begin_swapchain_render_pass();
+        dvr_bind_pipeline(pipeline);
+        dvr_bind_vertex_buffer(vertex_buffer, 0);
+        dvr_bind_index_buffer(index_buffer, VK_INDEX_TYPE_UINT32);
+        dvr_draw_indexed((u32)mesh->index_count, 1, 0, 0, 0);
+        dvr_end_render_pass();
+        dvr_end_pipeline_statistics();
+        res = dvr_end_frame();
+        DVR_BUBBLE(res);
+        bench_record(r, start);
+    }
+
+    dvr_wait_idle();
+    bench_record_pipeline_statistics(r, mesh);
+
+    dvr_destroy_buffer(vertex_buffer);
+    dvr_destroy_buffer(index_buffer);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static dvr_range bench_mesh_positions(const bench_mesh* mesh) {
+    return (dvr_range){
+        .base = mesh->positions,
+        .size = mesh->vertex_count * 3 * sizeof(f32),
+    };
+}
+
+static DVR_RESULT(dvr_pipeline) bench_create_mesh_pipeline(
+    dvr_shader_module vert_shader,
+    dvr_shader_module frag_shader,
+    VkFormat position_format,
+    u32 stride
+) {
+    return bench_create_pipeline(
+        vert_shader,
+        frag_shader,
+        0,
+        (dvr_vertex_input_state_desc){
+            .num_bindings = 1,
+            .bindings =
+                &(VkVertexInputBindingDescription){
+                    .binding = 0,
+                    .stride = stride,
+                    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+                },
+            .num_attributes = 1,
+            .attributes =
+                &(VkVertexInputAttributeDescription){
+                    .location = 0,
+                    .binding = 0,
+                    .format = position_format,
+                },
+        }
+    );
+}
+
+typedef struct bench_cluster_draw {
+    dvr_pipeline pipeline;
+    dvr_buffer vertex_buffer;
+    const dvr_cluster_mesh* mesh;
+    const dvr_cluster_view* view;
+} bench_cluster_draw;
+
+static void bench_cluster_cull_pass(void* user_data) {
+    bench_cluster_draw* draw = user_data;
+    dvr_cull_clusters(draw->mesh, draw->view);
+}
+
+static void bench_cluster_draw_pass(void* user_data) {
+    bench_cluster_draw* draw = user_data;
+    dvr_begin_swapchain_render_pass();
+    dvr_bind_pipeline(draw->pipeline);
+    dvr_bind_vertex_buffer(draw->vertex_buffer, 0);
+    dvr_draw_clusters(draw->mesh);
+    dvr_end_render_pass();
+}
+
+/// Culls the meshlets of the grid as if the view was moved half a screen to the side, the
+/// vertex shader ignores the view so the primitive count shows what the culling saved.
+static DVR_RESULT(dvr_none) bench_mesh_draw_clustered(
+    const char* name,
+    dvr_pipeline pipeline,
+    const bench_mesh* mesh
+) {
+    DVR_RESULT(dvr_none) res = dvr_cluster_setup();
+    DVR_BUBBLE(res);
+
+    DVR_RESULT(dvr_buffer)
+    vertex_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .usage = DVR_BUFFER_USAGE_VERTEX,
+        .data = bench_mesh_positions(mesh),
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_BUBBLE_INTO(dvr_none, vertex_buffer_res);
+    dvr_buffer vertex_buffer = DVR_UNWRAP(vertex_buffer_res);
+
+    DVR_RESULT(dvr_cluster_mesh)
+    cluster_mesh_res = dvr_create_cluster_mesh(&(dvr_cluster_mesh_desc){
+        .indices = mesh->indices,
+        .index_count = mesh->index_count,
+        .positions = mesh->positions,
+        .vertex_count = mesh->vertex_count,
+        .position_stride = 3 * sizeof(f32),
+    });
+    DVR_BUBBLE_INTO(dvr_none, cluster_mesh_res);
+    dvr_cluster_mesh cluster_mesh = DVR_UNWRAP(cluster_mesh_res);
+    DVRLOG_INFO("%s: %u meshlets", name, cluster_mesh.num_meshlets);
+
+    dvr_cluster_view view = {
+        .model_view_proj = {
+            { 1.0f, 0.0f, 0.0f, 0.0f },
+            { 0.0f, 1.0f, 0.0f, 0.0f },
+            { 0.0f, 0.0f, 1.0f, 0.0f },
+            { 1.0f, 0.0f, 0.0f, 1.0f },
+        },
+    };
+    bench_cluster_draw draw = {
+        .pipeline = pipeline,
+        .vertex_buffer = vertex_buffer,
+        .mesh = &cluster_mesh,
+        .view = &view,
+    };
+
+    bench_result* r = bench_begin(name, 0);
+
+    for (u32 i = 0; i < BENCH_MESH_ITERATIONS; i++) {
+        f64 start = bench_now();
+        res = dvr_begin_frame();
+        DVR_BUBBLE(res);
+        dvr_begin_pipeline_statistics();
+
+        dvr_render_graph_begin();
+        dvr_render_graph_resource index_buffer =
+            dvr_render_graph_import_buffer(cluster_mesh.index_buffer);
+        dvr_render_graph_resource draw_buffer =
+            dvr_render_graph_import_buffer(cluster_mesh.draw_buffer);
+        dvr_render_graph_add_pass(&(dvr_render_graph_pass_desc){
+            .name = "cull clusters",
+            .type = DVR_RENDER_GRAPH_PASS_COMPUTE,
+            .num_uses = 2,
+            .uses =
+                (dvr_render_graph_use[]){
+                    { .resource = index_buffer, .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_WRITE },
+                    {
+                        .resource = draw_buffer,
+                        .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_READ_WRITE,
+                    },
+                },
+            .execute = bench_cluster_cull_pass,
+            .user_data = &draw,
+        });
+        dvr_render_graph_add_pass(&(dvr_render_graph_pass_desc){
+            .name = "draw clusters",
+            .type = DVR_RENDER_GRAPH_PASS_GRAPHICS,
+            .num_uses = 2,
+            .uses =
+                (dvr_render_graph_use[]){
+                    { .resource = index_buffer, .access = DVR_RENDER_GRAPH_ACCESS_INDEX_BUFFER },
+                    { .resource = draw_buffer, .access = DVR_RENDER_GRAPH_ACCESS_INDIRECT_BUFFER },
+                },
+            .side_effects = true,
+            .execute = bench_cluster_draw_pass,
+            .user_data = &draw,
+        });
+        res = dvr_render_graph_execute();
+        DVR_BUBBLE(res);
+
+        dvr_end_pipeline_statistics();
+        res = dvr_end_frame();
+        DVR_BUBBLE(res);
+        bench_record(r, start);
+    }
+
+    dvr_wait_idle();
+    bench_record_pipeline_statistics(r, mesh);
+
+    dvr_destroy_cluster_mesh(&cluster_mesh);
+    dvr_destroy_buffer(vertex_buffer);
+    dvr_cluster_shutdown();
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) bench_mesh_optimization(void) {
+    DVR_RESULT(dvr_shader_module) vert_res = bench_load_shader("bench_mesh_vs.spv");
+    DVR_BUBBLE_INTO(dvr_none, vert_res);
+    dvr_shader_module vert_shader = DVR_UNWRAP(vert_res);
+
+    DVR_RESULT(dvr_shader_module) frag_res = bench_load_shader("bench_mesh_fs.spv");
+    DVR_BUBBLE_INTO(dvr_none, frag_res);
+    dvr_shader_module frag_shader = DVR_UNWRAP(frag_res);
+
+    DVR_RESULT(dvr_pipeline)
+    pipeline_res = bench_create_mesh_pipeline(
+        vert_shader,
+        frag_shader,
+        VK_FORMAT_R32G32B32_SFLOAT,
+        3 * sizeof(f32)
+    );
+    DVR_BUBBLE_INTO(dvr_none, pipeline_res);
+    dvr_pipeline pipeline = DVR_UNWRAP(pipeline_res);
+
+    // the grid lies inside [-1, 1], snorm16 needs no dequantization transform
+    pipeline_res = bench_create_mesh_pipeline(
+        vert_shader,
+        frag_shader,
+        VK_FORMAT_R16G16B16A16_SNORM,
+        4 * sizeof(i16)
+    );
+    DVR_BUBBLE_INTO(dvr_none, pipeline_res);
+    dvr_pipeline quantized_pipeline = DVR_UNWRAP(pipeline_res);
+
+    bench_mesh mesh = bench_generate_mesh();
+    u32* indices = malloc(mesh.index_count * sizeof(u32));
+
+    bench_result* r = bench_begin("mesh_simplify_half", 0);
+    for (u32 i = 0; i < BENCH_MESH_OPTIMIZE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        dvr_simplify(
+            indices,
+            mesh.indices,
+            mesh.index_count,
+            mesh.positions,
+            mesh.vertex_count,
+            3 * sizeof(f32),
+            mesh.index_count / 2,
+            FLT_MAX,
+            NULL
+        );
+        bench_record(r, start);
+    }
+
+    r = bench_begin("mesh_optimize_vertex_cache", 0);
+    for (u32 i = 0; i < BENCH_MESH_OPTIMIZE_ITERATIONS; i++) {
+        f64 start = bench_now();
+        dvr_optimize_vertex_cache(indices, mesh.indices, mesh.index_count, mesh.vertex_count);
+        bench_record(r, start);
+    }
+
+    DVR_RESULT(dvr_none) res =
+        bench_mesh_draw("mesh_draw_unoptimized", pipeline, &mesh, bench_mesh_positions(&mesh));
+    DVR_BUBBLE(res);
+
+    memcpy(mesh.indices, indices, mesh.index_count * sizeof(u32));
+    res = bench_mesh_draw("mesh_draw_vertex_cache", pipeline, &mesh, bench_mesh_positions(&mesh));
+    DVR_BUBBLE(res);
+
+    dvr_optimize_overdraw(
+        mesh.indices,
+        mesh.indices,
+        mesh.index_count,
+        mesh.positions,
+        mesh.vertex_count,
+        3 * sizeof(f32),
+        DVR_OVERDRAW_THRESHOLD
+    );
+    u32* remap = malloc(mesh.vertex_count * sizeof(u32));
+    usize used = dvr_optimize_vertex_fetch_remap(
+        remap,
+        mesh.indices,
+        mesh.index_count,
+        mesh.vertex_count
+    );
+    f32* positions = malloc(used * 3 * sizeof(f32));
+    dvr_remap_vertex_buffer(positions, mesh.positions, mesh.vertex_count, 3 * sizeof(f32), remap);
+    dvr_remap_index_buffer(mesh.indices, mesh.indices, mesh.index_count, remap);
+    free(mesh.positions);
+    mesh.positions = positions;
+    mesh.vertex_count = used;
+    res = bench_mesh_draw("mesh_draw_optimized", pipeline, &mesh, bench_mesh_positions(&mesh));
+    DVR_BUBBLE(res);
+
+    res = bench_mesh_draw_clustered("mesh_draw_clustered", pipeline, &mesh);
+    DVR_BUBBLE(res);
+
+    i16* quantized = malloc(mesh.vertex_count * 4 * sizeof(i16));
+    for (usize i = 0; i < mesh.vertex_count; i++) {
+        for (u32 j = 0; j < 3; j++) {
+            quantized[i * 4 + j] = dvr_quantize_snorm16(mesh.positions[i * 3 + j]);
+        }
+        quantized[i * 4 + 3] = INT16_MAX;
+    }
+    res = bench_mesh_draw(
+        "mesh_draw_quantized",
+        quantized_pipeline,
+        &mesh,
+        (dvr_range){ .base = quantized, .size = mesh.vertex_count * 4 * sizeof(i16) }
+    );
+    DVR_BUBBLE(res);
+
+    free(quantized);
+    free(remap);
+    free(indices);
+    free(mesh.positions);
+    free(mesh.indices);
+    dvr_destroy_pipeline(pipeline);
+    dvr_destroy_pipeline(quantized_pipeline);
+    dvr_destroy_shader_module(vert_shader);
+    dvr_destroy_shader_module(frag_shader);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+// SETUP
+
+static DVR_RESULT(dvr_shader_module) bench_load_shader(const char* path) {
+    DVR_RESULT(dvr_range) spv_res = dvr_read_file(path);
+    DVR_BUBBLE_INTO(dvr_shader_module, spv_res);
+
+    dvr_range spv = DVR_UNWRAP(spv_res);
+    DVR_RESULT(dvr_shader_module)
+    module_res = dvr_create_shader_module(&(dvr_shader_module_desc){
+        .code = spv,
+    });
+    dvr_free_file(spv);
+
+    return module_res;
+}
+
+static DVR_RESULT(dvr_none) bench_setup(void) {
+    DVR_RESULT(dvr_shader_module) module_res = bench_load_shader("bench_vs.spv");
+    DVR_BUBBLE_INTO(dvr_none, module_res);
+    g_bench_state.vert_shader = DVR_UNWRAP(module_res);
+
+    module_res = bench_load_shader("bench_fs.spv");
+    DVR_BUBBLE_INTO(dvr_none, module_res);
+    g_bench_state.frag_shader = DVR_UNWRAP(module_res);
+
+    DVR_RESULT(dvr_descriptor_set_layout)
+    layout_res = dvr_create_descriptor_set_layout(&(dvr_descriptor_set_layout_desc){
+        .num_bindings = 2,
+        .bindings =
+            (dvr_descriptor_set_layout_binding_desc[]){
+                {
+                    .binding = 0,
+                    .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                    .count = 1,
+                    .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                },
+                {
+                    .binding = 1,
+                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .count = 1,
+                    .stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                },
+            },
+    });
+    DVR_BUBBLE_INTO(dvr_none, layout_res);
+    g_bench_state.descriptor_set_layout = DVR_UNWRAP(layout_res);
+
+    f32 color[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
+    DVR_RESULT(dvr_buffer)
+    buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .usage = DVR_BUFFER_USAGE_UNIFORM,
+        .data = DVR_RANGE(color),
+        .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+    });
+    DVR_BUBBLE_INTO(dvr_none, buffer_res);
+    g_bench_state.uniform_buffer = DVR_UNWRAP(buffer_res);
+
+    u32 pixel = 0xffffffff;
+    DVR_RESULT(dvr_image)
+    image_res = dvr_create_image(&(dvr_image_desc){
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+        .width = 1,
+        .height = 1,
+        .data = DVR_RANGE(pixel),
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    });
+    DVR_BUBBLE_INTO(dvr_none, image_res);
+    g_bench_state.image = DVR_UNWRAP(image_res);
+
+    dvr_sampler_desc sampler_desc = bench_sampler_desc();
+    DVR_RESULT(dvr_sampler) sampler_res = dvr_create_sampler(&sampler_desc);
+    DVR_BUBBLE_INTO(dvr_none, sampler_res);
+    g_bench_state.sampler = DVR_UNWRAP(sampler_res);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static void bench_shutdown(void) {
+    dvr_wait_idle();
+
+    dvr_destroy_sampler(g_bench_state.sampler);
+    dvr_destroy_image(g_bench_state.image);
+    dvr_destroy_buffer(g_bench_state.uniform_buffer);
+    dvr_destroy_descriptor_set_layout(g_bench_state.descriptor_set_layout);
+    dvr_destroy_shader_module(g_bench_state.vert_shader);
+    dvr_destroy_shader_module(g_bench_state.frag_shader);
+}
+
+static void bench_write_json(FILE* out) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(dvr_physical_device(), &props);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": \"%s\",\n", PROJECT_VERSION);
+    fprintf(out, "  \"commit\": \"%s\",\n", PROJECT_COMMIT_HASH);
+    fprintf(out, "  \"device\": \"%s\",\n", props.deviceName);
+    fprintf(out, "  \"results\": [\n");
+    for (u32 i = 0; i < g_bench_state.num_results; i++) {
+        bench_result* r = &g_bench_state.results[i];
+        f64 mean_s = r->iterations > 0 ? r->total_s / (f64)r->iterations : 0.0;
+
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"name\": \"%s\",\n", r->name);
+        fprintf(out, "      \"iterations\": %u,\n", r->iterations);
+        fprintf(out, "      \"total_ms\": %.6f,\n", r->total_s * 1.0e3);
+        fprintf(out, "      \"mean_us\": %.3f,\n", mean_s * 1.0e6);
+        fprintf(out, "      \"min_us\": %.3f,\n", r->min_s * 1.0e6);
+        fprintf(out, "      \"max_us\": %.3f", r->max_s * 1.0e6);
+        if (r->bytes_per_iteration > 0 && r->total_s > 0.0) {
+            f64 bytes = (f64)r->bytes_per_iteration * (f64)r->iterations;
+            fprintf(out, ",\n      \"bytes\": %llu,\n", (unsigned long long)r->bytes_per_iteration);
+            fprintf(out, "      \"mib_per_s\": %.3f", bytes / r->total_s / (1024.0 * 1024.0));
+        }
+        if (r->has_pipeline_statistics) {
+            dvr_pipeline_statistics* stats = &r->pipeline_statistics;
+            fprintf(
+                out,
+                ",\n      \"vs_invocations\": %llu,\n",
+                (unsigned long long)stats->vertex_shader_invocations
+            );
+            fprintf(
+                out,
+                "      \"fs_invocations\": %llu,\n",
+                (unsigned long long)stats->fragment_shader_invocations
+            );
+            fprintf(
+                out,
+                "      \"primitives\": %llu",
+                (unsigned long long)stats->input_assembly_primitives
+            );
+        }
+        fprintf(out, "\n    }%s\n", i + 1 < g_bench_state.num_results ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+/// usage: benchmarks [output.json]
+/// results are written to stdout when no output path is given
+int main(int argc, char** argv) {
+    // resolve the output path before changing directory
+    FILE* out = stdout;
+    if (argc > 1) {
+        out = fopen(argv[1], "w");
+        if (out == NULL) {
+            fprintf(stderr, "failed to open %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    char executable_directory[1024];
+    get_executable_directory(executable_directory, sizeof(executable_directory));
+    set_executable_directory(executable_directory);
+
+    DVR_RESULT(dvr_none)
+    result = dvr_setup(&(dvr_setup_desc){
+        .app_name = "dvr benchmarks",
+        .initial_width = BENCH_WIDTH,
+        .initial_height = BENCH_HEIGHT,
+        .headless = true,
+    });
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_setup();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_buffer_create_destroy();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_image_create_destroy();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_sampler_create_destroy();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_static_buffer_upload("static_buffer_upload_1mib", 1024 * 1024);
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_static_buffer_upload("static_buffer_upload_64mib", 64 * 1024 * 1024);
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_image_upload("image_upload_1024", 1024, false);
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_image_upload("image_upload_mipmaps_1024", 1024, true);
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_descriptor_set_create();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_pipeline_create();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_empty_frame();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_frame_mipmaps("frame_mipmaps_1024", 1024);
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_frame_post_process();
+    DVR_EXIT_ON_ERROR(result);
+
+    result = bench_mesh_optimization();
+    DVR_EXIT_ON_ERROR(result);
+
+    bench_write_json(out);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    bench_shutdown();
+
+    dvr_shutdown();
+
+    return 0;
+}
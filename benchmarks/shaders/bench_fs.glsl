@@ -0,0 +1,14 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout(location = 0) out vec4 fragColor;
+
+layout(binding = 0) uniform Params
+{
+    vec4 color;
+} params;
+
+void main()
+{
+    fragColor = params.color;
+}
@@ -0,0 +1,9 @@
+#version 450
+#pragma shader_stage(fragment)
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = vec4(1.0, 0.0, 1.0, 1.0);
+}
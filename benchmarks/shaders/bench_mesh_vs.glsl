@@ -0,0 +1,9 @@
+#version 450
+#pragma shader_stage(vertex)
+
+layout(location = 0) in vec3 iPosition;
+
+void main()
+{
+    gl_Position = vec4(iPosition, 1.0);
+}
@@ -1,16 +1,13 @@
 #include "dvr.h"
+#include "dvr_archive.h"
+#include "dvr_instancing.h"
+#include "dvr_loader.h"
+#include "dvr_mesh.h"
 #include "dvr_utils.h"
 
 #include <cglm/cglm.h>
 
 #include <stb/stb_ds.h>
-#include <stb/stb_image.h>
-
-#include <assimp/cimport.h>
-#include <assimp/scene.h>
-#include <assimp/anim.h>
-#include <assimp/defs.h>
-#include <assimp/postprocess.h>
 
 #define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
 #include <cimgui.h>
@@ -129,21 +126,39 @@ int main(void) {
 // APP CODE
 
 #define FRAMETIME_SAMPLES 2000
+#define APP_FOV_Y ((f32)GLM_PI_4)
+// rooms are laid out on a square grid of up to this many per side
+#define APP_MAX_INSTANCE_GRID 32
+#define APP_MAX_INSTANCES (APP_MAX_INSTANCE_GRID * APP_MAX_INSTANCE_GRID)
+#define APP_INSTANCE_SPACING 2.5f
 
 typedef struct app_state {
+    dvr_archive archive;
+
+    dvr_load texture_load;
     dvr_image texture;
+    bool texture_ready;
     dvr_sampler sampler;
 
-    dvr_buffer vertex_buffer;
-    dvr_buffer index_buffer;
-    u32 index_count;
+    dvr_mesh mesh;
     dvr_buffer uniform_buffer;
+    dvr_instance_buffer instance_buffer;
 
     dvr_descriptor_set_layout descriptor_set_layout;
     dvr_descriptor_set descriptor_set;
 
     dvr_pipeline pipeline;
 
+    /// Screen space error the LOD selection accepts, in pixels.
+    f32 lod_pixel_error;
+    u32 triangles_drawn;
+    u32 draws;
+    i32 instance_grid;
+    mat4 instance_models[APP_MAX_INSTANCES];
+    u32 instance_lods[APP_MAX_INSTANCES];
+    // instances of one submesh sharing a LOD, pushed together
+    mat4 instance_batch[APP_MAX_INSTANCES];
+
     f64 start_time;
     f64 total_time;
     f64 delta_time;
@@ -155,84 +170,63 @@ typedef struct app_state {
 
 static app_state g_app_state;
 
-typedef struct vertex {
-    vec3 pos;
-    vec3 color;
-    vec2 uv;
-} vertex;
-
-static const VkVertexInputBindingDescription k_vertex_binding_description = {
-    .binding = 0,
-    .stride = sizeof(vertex),
-    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-};
-
-static const VkVertexInputAttributeDescription k_vertex_attribute_descriptions[] = {
-    {
-        .location = 0,
-        .binding = 0,
-        .format = VK_FORMAT_R32G32B32_SFLOAT,
-        .offset = offsetof(vertex, pos),
-    },
-    {
-        .location = 1,
-        .binding = 0,
-        .format = VK_FORMAT_R32G32B32_SFLOAT,
-        .offset = offsetof(vertex, color),
-    },
-    {
-        .location = 2,
-        .binding = 0,
-        .format = VK_FORMAT_R32G32_SFLOAT,
-        .offset = offsetof(vertex, uv),
-    },
-};
-
 typedef struct app_view_uniform {
     mat4 model;
     mat4 view;
     mat4 proj;
 } app_view_uniform;
 
-static DVR_RESULT(dvr_none) app_setup(void) {
-    DVR_RESULT(dvr_range) texture_data_res = dvr_read_file("viking_room.png");
-    DVR_BUBBLE_INTO(dvr_none, texture_data_res);
-
-    dvr_range texture_data_range = DVR_UNWRAP(texture_data_res);
-
-    i32 width, height, channels;
-    u8* texture_data = stbi_load_from_memory(
-        texture_data_range.base,
-        (i32)texture_data_range.size,
-        &width,
-        &height,
-        &channels,
-        STBI_rgb_alpha
-    );
-
-    DVR_RESULT(dvr_image)
-    texture_res = dvr_create_image(&(dvr_image_desc){
-        .render_target = false,
-        .data =
-            (dvr_range){
-                .base = texture_data,
-                .size = (usize)(width * height * 4),
+static DVR_RESULT(dvr_none) app_create_descriptor_set(void) {
+    DVR_RESULT(dvr_descriptor_set)
+    descriptor_set_res = dvr_create_descriptor_set(&(dvr_descriptor_set_desc){
+        .layout = g_app_state.descriptor_set_layout,
+        .num_bindings = 2,
+        .bindings =
+            (dvr_descriptor_set_binding_desc[]){
+                (dvr_descriptor_set_binding_desc){
+                    .binding = 0,
+                    .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                    .buffer = {
+                        .buffer = g_app_state.uniform_buffer,
+                        .offset = 0,
+                        .size = sizeof(app_view_uniform),
+                    },
+                },
+                (dvr_descriptor_set_binding_desc){
+                    .binding = 1,
+                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .image = {
+                        .image = g_app_state.texture,
+                        .sampler = g_app_state.sampler,
+                    },
+                },
             },
-        .generate_mipmaps = true,
-        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
-        .width = (u32)width,
-        .height = (u32)height,
-        .format = VK_FORMAT_R8G8B8A8_UNORM,
-        .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
     });
+    DVR_BUBBLE_INTO(dvr_none, descriptor_set_res);
+    g_app_state.descriptor_set = DVR_UNWRAP(descriptor_set_res);
 
-    stbi_image_free(texture_data);
-
-    dvr_free_file(texture_data_range);
+    return DVR_OK(dvr_none, DVR_NONE);
+}
 
-    DVR_BUBBLE_INTO(dvr_none, texture_res);
-    g_app_state.texture = DVR_UNWRAP(texture_res);
+static DVR_RESULT(dvr_none) app_setup(void) {
+    // every asset is packed into one archive at build time
+    DVR_RESULT(dvr_archive) archive_res = dvr_open_archive("model.dvra");
+    DVR_BUBBLE_INTO(dvr_none, archive_res);
+    g_app_state.archive = DVR_UNWRAP(archive_res);
+    dvr_archive* archive = &g_app_state.archive;
+
+    DVR_RESULT(dvr_none) loader_res = dvr_loader_setup(&(dvr_loader_desc){});
+    DVR_BUBBLE(loader_res);
+
+    // cooked at build time by dvr_texcook, streamed in while the rest of the scene is set up
+    DVR_RESULT(dvr_load)
+    texture_load_res = dvr_load_async(&(dvr_load_desc){
+        .kind = DVR_LOAD_KIND_TEXTURE,
+        .path = "viking_room.dvrt",
+        .archive = archive,
+    });
+    DVR_BUBBLE_INTO(dvr_none, texture_load_res);
+    g_app_state.texture_load = DVR_UNWRAP(texture_load_res);
 
     DVR_RESULT(dvr_sampler)
     sampler_res = dvr_create_sampler(&(dvr_sampler_desc){
@@ -255,78 +249,30 @@ static DVR_RESULT(dvr_none) app_setup(void) {
     DVR_BUBBLE_INTO(dvr_none, sampler_res);
     g_app_state.sampler = DVR_UNWRAP(sampler_res);
 
-    const struct aiScene* scene = aiImportFile(
-        "viking_room.obj",
-        aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_FlipUVs |
-            aiProcess_JoinIdenticalVertices
-    );
-
-    if (!scene) {
-        DVRLOG_ERROR("Failed to load scene");
-        return DVR_ERROR(dvr_none, "Failed to load scene");
-    }
-
-    u32 total_vertices = 0;
-    u32 total_indices = 0;
-    for (u32 i = 0; i < scene->mNumMeshes; i++) {
-        total_vertices += scene->mMeshes[i]->mNumVertices;
-        total_indices += scene->mMeshes[i]->mNumFaces * 3;
-    }
-
-    vertex* vertices = malloc(total_vertices * sizeof(vertex));
-    u32* indices = malloc(total_indices * sizeof(u32));
-
-    for (u32 i = 0; i < scene->mNumMeshes; i++) {
-        const struct aiMesh* mesh = scene->mMeshes[i];
-        for (u32 j = 0; j < mesh->mNumVertices; j++) {
-            vec3 pos = { mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z };
-            vec3 color = { 1.0f, 1.0f, 1.0f };
-            vec2 uv = { 0.0f, 0.0f };
-            if (mesh->mTextureCoords[0]) {
-                uv[0] = mesh->mTextureCoords[0][j].x;
-                uv[1] = mesh->mTextureCoords[0][j].y;
-            }
-            glm_vec3_copy(pos, vertices[j].pos);
-            glm_vec3_copy(color, vertices[j].color);
-            glm_vec2_copy(uv, vertices[j].uv);
-        }
-        for (u32 j = 0; j < mesh->mNumFaces; j++) {
-            const struct aiFace* face = &mesh->mFaces[j];
-            for (u32 k = 0; k < face->mNumIndices; k++) {
-                indices[j * face->mNumIndices + k] = face->mIndices[k];
-            }
-        }
-    }
-
-    DVR_RESULT(dvr_buffer)
-    vertex_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
-        .data =
-            (dvr_range){
-                .base = (u8*)vertices,
-                .size = total_vertices * sizeof(vertex),
-            },
-        .usage = DVR_BUFFER_USAGE_VERTEX,
-        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    // cooked at build time by dvr_meshcook, the streams are copied into buffers as they are
+    DVR_RESULT(dvr_range) mesh_data_res = dvr_archive_read(archive, "viking_room.dvrm");
+    DVR_BUBBLE_INTO(dvr_none, mesh_data_res);
+    dvr_range mesh_data = DVR_UNWRAP(mesh_data_res);
+    DVR_RESULT(dvr_mesh) mesh_res = dvr_load_mesh_from_memory(mesh_data);
+    dvr_free_file(mesh_data);
+    DVR_BUBBLE_INTO(dvr_none, mesh_res);
+    g_app_state.mesh = DVR_UNWRAP(mesh_res);
+
+    // every copy of the room is drawn in one call per submesh and LOD, with its model matrix
+    // streamed through a per instance binding after the mesh streams
+    dvr_vertex_input vertex_input = {};
+    dvr_vertex_input_append(&vertex_input, dvr_mesh_vertex_input(&g_app_state.mesh));
+    u32 instance_binding = dvr_vertex_input_add_instance_binding(&vertex_input, sizeof(mat4));
+    dvr_vertex_input_add_mat4(&vertex_input, instance_binding, 4, 0);
+
+    DVR_RESULT(dvr_instance_buffer)
+    instance_buffer_res = dvr_create_instance_buffer(&(dvr_instance_buffer_desc){
+        .stride = sizeof(mat4),
+        .capacity = APP_MAX_INSTANCES * g_app_state.mesh.num_submeshes,
+        .binding = instance_binding,
     });
-
-    DVR_RESULT(dvr_buffer)
-    index_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
-        .data =
-            (dvr_range){
-                .base = (u8*)indices,
-                .size = total_indices * sizeof(u32),
-            },
-        .usage = DVR_BUFFER_USAGE_INDEX,
-        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
-    });
-    free(vertices);
-    free(indices);
-
-    DVR_BUBBLE_INTO(dvr_none, vertex_buffer_res);
-    DVR_BUBBLE_INTO(dvr_none, index_buffer_res);
-    g_app_state.vertex_buffer = DVR_UNWRAP(vertex_buffer_res);
-    g_app_state.index_buffer = DVR_UNWRAP(index_buffer_res);
-    g_app_state.index_count = total_indices;
+    DVR_BUBBLE_INTO(dvr_none, instance_buffer_res);
+    g_app_state.instance_buffer = DVR_UNWRAP(instance_buffer_res);
 
     DVR_RESULT(dvr_buffer)
     uniform_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
@@ -365,38 +311,10 @@ static DVR_RESULT(dvr_none) app_setup(void) {
     DVR_BUBBLE_INTO(dvr_none, descriptor_set_layout_res);
     g_app_state.descriptor_set_layout = DVR_UNWRAP(descriptor_set_layout_res);
 
-    DVR_RESULT(dvr_descriptor_set)
-    descriptor_set_res = dvr_create_descriptor_set(&(dvr_descriptor_set_desc){
-        .layout = g_app_state.descriptor_set_layout,
-        .num_bindings = 2,
-        .bindings =
-            (dvr_descriptor_set_binding_desc[]){
-                (dvr_descriptor_set_binding_desc){
-                    .binding = 0,
-                    .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    .buffer = {
-                        .buffer = g_app_state.uniform_buffer,
-                        .offset = 0,
-                        .size = sizeof(app_view_uniform),
-                    },
-                },
-                (dvr_descriptor_set_binding_desc){
-                    .binding = 1,
-                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    .image = {
-                        .image = g_app_state.texture,
-                        .sampler = g_app_state.sampler,
-                    },
-                },
-            },
-    });
-    DVR_BUBBLE_INTO(dvr_none, descriptor_set_res);
-    g_app_state.descriptor_set = DVR_UNWRAP(descriptor_set_res);
-
-    DVR_RESULT(dvr_range) vert_spv_res = dvr_read_file("default_vs.spv");
+    DVR_RESULT(dvr_range) vert_spv_res = dvr_archive_read(archive, "default_vs.spv");
     DVR_BUBBLE_INTO(dvr_none, vert_spv_res);
 
-    DVR_RESULT(dvr_range) frag_spv_res = dvr_read_file("default_fs.spv");
+    DVR_RESULT(dvr_range) frag_spv_res = dvr_archive_read(archive, "default_fs.spv");
     DVR_BUBBLE_INTO(dvr_none, frag_spv_res);
 
     dvr_range vert_spv_range = DVR_UNWRAP(vert_spv_res);
@@ -463,17 +381,12 @@ static DVR_RESULT(dvr_none) app_setup(void) {
             .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
         },
         .multisample = {
-            .rasterization_samples = dvr_max_msaa_samples(),
+            .rasterization_samples = dvr_swapchain_samples(),
             .sample_shading_enable = false,
             .alpha_to_one_enable = false,
             .alpha_to_coverage_enable = false,
         },
-        .vertex_input = {
-            .num_bindings = 1,
-            .bindings = (VkVertexInputBindingDescription*)&k_vertex_binding_description,
-            .num_attributes = sizeof(k_vertex_attribute_descriptions) / sizeof(VkVertexInputAttributeDescription),
-            .attributes = (VkVertexInputAttributeDescription*)k_vertex_attribute_descriptions,
-        },
+        .vertex_input = dvr_vertex_input_desc(&vertex_input),
         .depth_stencil = {
             .depth_test_enable = true,
             .depth_write_enable = true,
@@ -505,6 +418,8 @@ static DVR_RESULT(dvr_none) app_setup(void) {
     g_app_state.delta_time = 0.0;
     g_app_state.frame_time_index = 0;
     g_app_state.frame_count = 0;
+    g_app_state.lod_pixel_error = 1.0f;
+    g_app_state.instance_grid = 1;
 
     return DVR_OK(dvr_none, DVR_NONE);
 }
@@ -523,12 +438,29 @@ static void app_update(void) {
 }
 
 static void app_draw(void) {
+    dvr_loader_update();
+    if (!g_app_state.texture_ready) {
+        dvr_load_state state = dvr_load_get_state(g_app_state.texture_load);
+        if (state == DVR_LOAD_STATE_READY) {
+            g_app_state.texture = dvr_load_get_image(g_app_state.texture_load);
+            DVR_RESULT(dvr_none) descriptor_set_res = app_create_descriptor_set();
+            DVR_EXIT_ON_ERROR(descriptor_set_res);
+            g_app_state.texture_ready = true;
+        } else if (state == DVR_LOAD_STATE_FAILED) {
+            DVRLOG_ERROR(
+                "failed to load texture: %s",
+                dvr_load_get_error(g_app_state.texture_load)
+            );
+            dvr_close();
+        }
+    }
+
     dvr_begin_swapchain_render_pass();
 
     dvr_bind_pipeline(g_app_state.pipeline);
 
-    dvr_bind_vertex_buffer(g_app_state.vertex_buffer, 0);
-    dvr_bind_index_buffer(g_app_state.index_buffer, VK_INDEX_TYPE_UINT32);
+    dvr_bind_mesh(&g_app_state.mesh);
+    dvr_bind_instance_buffer(&g_app_state.instance_buffer);
 
     app_view_uniform view_uniform = {
         .model = GLM_MAT4_IDENTITY_INIT,
@@ -537,23 +469,97 @@ static void app_draw(void) {
     };
     u32 width, height;
     dvr_get_window_size(&width, &height);
-    glm_perspective((f32)GLM_PI_4, (f32)width / (f32)height, 0.1f, 100.0f, view_uniform.proj);
+    glm_perspective(APP_FOV_Y, (f32)width / (f32)height, 0.1f, 100.0f, view_uniform.proj);
     // vulkan has +y down, glm has +y up, so we need to correct the y axis
     view_uniform.proj[1][1] *= -1.0f;
-
-    f32 x = sinf((f32)g_app_state.total_time) * 2.0f;
-    f32 z = cosf((f32)g_app_state.total_time) * 2.0f;
+    // the cooked positions are unorm16, the model matrix maps them back into mesh space
+    dvr_mesh_position_transform(&g_app_state.mesh, view_uniform.model);
+
+    // back off as the grid grows so it stays in view
+    u32 grid = (u32)g_app_state.instance_grid;
+    f32 orbit = 2.0f + APP_INSTANCE_SPACING * (f32)(grid - 1);
+    f32 x = sinf((f32)g_app_state.total_time) * orbit;
+    f32 z = cosf((f32)g_app_state.total_time) * orbit;
+    vec3 eye = { x, 0.83f * orbit, z };
     glm_lookat(
-        (vec3){ x, 1.66f, z },
+        eye,
         (vec3){ 0.0f, 0.2f, 0.0f },
         (vec3){ 0.0f, 1.0f, 0.0f },
         view_uniform.view
     );
 
     dvr_write_buffer(g_app_state.uniform_buffer, DVR_RANGE(view_uniform), 0);
-    dvr_bind_descriptor_set(g_app_state.pipeline, g_app_state.descriptor_set);
 
-    vkCmdDrawIndexed(dvr_command_buffer(), g_app_state.index_count, 1, 0, 0, 0);
+    // the room shows up once its texture finished streaming in
+    if (g_app_state.texture_ready) {
+        dvr_bind_descriptor_set(g_app_state.pipeline, g_app_state.descriptor_set);
+
+        u32 num_instances = grid * grid;
+        f32 grid_offset = APP_INSTANCE_SPACING * (f32)(grid - 1) * 0.5f;
+        for (u32 i = 0; i < num_instances; i++) {
+            vec3 offset = {
+                APP_INSTANCE_SPACING * (f32)(i % grid) - grid_offset,
+                0.0f,
+                APP_INSTANCE_SPACING * (f32)(i / grid) - grid_offset,
+            };
+            glm_translate_make(g_app_state.instance_models[i], offset);
+        }
+
+        // distance to the bounding sphere of each submesh picks its LOD, instances sharing a
+        // LOD are drawn together
+        const dvr_mesh* mesh = &g_app_state.mesh;
+        f32 pixel_scale = dvr_lod_pixel_scale(APP_FOV_Y, (f32)height);
+        g_app_state.triangles_drawn = 0;
+        g_app_state.draws = 0;
+        for (u32 i = 0; i < mesh->num_submeshes; i++) {
+            const dvr_dvrm_submesh* submesh = &mesh->submeshes[i];
+            vec3 bounds_min, bounds_max, center;
+            memcpy(bounds_min, submesh->bounds_min, sizeof(bounds_min));
+            memcpy(bounds_max, submesh->bounds_max, sizeof(bounds_max));
+            glm_vec3_center(bounds_min, bounds_max, center);
+            f32 radius = glm_vec3_distance(bounds_min, center);
+
+            for (u32 j = 0; j < num_instances; j++) {
+                vec3 instance_center;
+                glm_vec3_add(center, g_app_state.instance_models[j][3], instance_center);
+                f32 distance = glm_vec3_distance(eye, instance_center) - radius;
+                g_app_state.instance_lods[j] = dvr_select_mesh_lod(
+                    mesh,
+                    i,
+                    distance,
+                    pixel_scale,
+                    g_app_state.lod_pixel_error
+                );
+            }
+
+            for (u32 lod = 0; lod < submesh->num_lods; lod++) {
+                u32 count = 0;
+                for (u32 j = 0; j < num_instances; j++) {
+                    if (g_app_state.instance_lods[j] == lod) {
+                        glm_mat4_copy(
+                            g_app_state.instance_models[j],
+                            g_app_state.instance_batch[count++]
+                        );
+                    }
+                }
+                if (count == 0) {
+                    continue;
+                }
+
+                DVR_RESULT(dvr_instance_range)
+                range_res = dvr_push_instances(
+                    &g_app_state.instance_buffer,
+                    g_app_state.instance_batch,
+                    count
+                );
+                DVR_EXIT_ON_ERROR(range_res);
+                dvr_draw_instanced(mesh, i, lod, DVR_UNWRAP(range_res));
+                g_app_state.triangles_drawn +=
+                    count * (mesh->lods[submesh->first_lod + lod].index_count / 3);
+                g_app_state.draws++;
+            }
+        }
+    }
 
     dvr_imgui_render();
 
@@ -576,21 +582,32 @@ static void app_draw_imgui(void) {
 
     igText("Frame Time: %.3f ms (avg %d samples)", avg_frametime * 1000.0f, FRAMETIME_SAMPLES);
     igText("FPS: %.1f", 1.0f / avg_frametime);
+    igSliderFloat("LOD pixel error", &g_app_state.lod_pixel_error, 0.0f, 32.0f, "%.1f", 1.0f);
+    igSliderInt("Instance grid", &g_app_state.instance_grid, 1, APP_MAX_INSTANCE_GRID, "%d", 0);
+    igText("Triangles: %u", g_app_state.triangles_drawn);
+    igText("Draws: %u", g_app_state.draws);
 
     igEnd();
 
     dvr_imgui_info();
+    dvr_imgui_frame_stats();
 }
 
 static void app_shutdown(void) {
     dvr_wait_idle();
 
-    dvr_destroy_image(g_app_state.texture);
+    dvr_release_load(g_app_state.texture_load);
+    dvr_loader_shutdown();
+    dvr_close_archive(&g_app_state.archive);
+
+    if (g_app_state.texture_ready) {
+        dvr_destroy_image(g_app_state.texture);
+        dvr_destroy_descriptor_set(g_app_state.descriptor_set);
+    }
     dvr_destroy_sampler(g_app_state.sampler);
-    dvr_destroy_buffer(g_app_state.vertex_buffer);
-    dvr_destroy_buffer(g_app_state.index_buffer);
+    dvr_destroy_mesh(&g_app_state.mesh);
     dvr_destroy_buffer(g_app_state.uniform_buffer);
-    dvr_destroy_descriptor_set(g_app_state.descriptor_set);
+    dvr_destroy_instance_buffer(&g_app_state.instance_buffer);
     dvr_destroy_descriptor_set_layout(g_app_state.descriptor_set_layout);
     dvr_destroy_pipeline(g_app_state.pipeline);
 }
@@ -1,6 +1,10 @@
 #include "dvr.h"
 #include "dvr_utils.h"
 
+#ifdef APP_SHADER_HOT_RELOAD
+#include "dvr_shader_manager.h"
+#endif
+
 #include <cglm/cglm.h>
 
 #include <stb/stb_ds.h>
@@ -77,8 +81,10 @@ static void set_executable_directory(const char* path) {
 
 static DVR_RESULT(dvr_none) app_setup();
 static void app_update();
-static void app_compute();
-static void app_draw();
+static void app_diffuse(void* user_data);
+static void app_update_particles(void* user_data);
+static void app_render(void* user_data);
+static DVR_RESULT(dvr_none) app_draw();
 static void app_draw_imgui();
 static void app_shutdown();
 
@@ -96,33 +102,37 @@ int main(void) {
         .app_name = APP_WINDOW_NAME,
         .initial_width = APP_WINDOW_WIDTH,
         .initial_height = APP_WINDOW_HEIGHT,
+        // a single fullscreen triangle, nothing to antialias or depth test
+        .msaa_samples = VK_SAMPLE_COUNT_1_BIT,
+        .no_depth = true,
     });
     DVR_EXIT_ON_ERROR(result);
 
     result = dvr_imgui_setup();
     DVR_EXIT_ON_ERROR(result);
 
+#ifdef APP_SHADER_HOT_RELOAD
+    result = dvr_shader_manager_setup(&(dvr_shader_manager_desc){ 0 });
+    DVR_EXIT_ON_ERROR(result);
+#endif
+
     result = app_setup();
     DVR_EXIT_ON_ERROR(result);
 
     while (!dvr_should_close()) {
         dvr_poll_events();
+#ifdef APP_SHADER_HOT_RELOAD
+        dvr_update_shaders();
+#endif
         app_update();
 
         app_draw_imgui();
 
-        result = dvr_begin_compute();
-        DVR_EXIT_ON_ERROR(result);
-
-        app_compute();
-
-        result = dvr_end_compute();
-        DVR_EXIT_ON_ERROR(result);
-
         result = dvr_begin_frame();
         DVR_EXIT_ON_ERROR(result);
 
-        app_draw();
+        result = app_draw();
+        DVR_EXIT_ON_ERROR(result);
 
         result = dvr_end_frame();
         DVR_EXIT_ON_ERROR(result);
@@ -130,6 +140,10 @@ int main(void) {
 
     app_shutdown();
 
+#ifdef APP_SHADER_HOT_RELOAD
+    dvr_shader_manager_shutdown();
+#endif
+
     dvr_imgui_shutdown();
 
     dvr_shutdown();
@@ -152,11 +166,16 @@ typedef struct app_state {
     dvr_descriptor_set compute_descriptor_sets[2];
 
     dvr_compute_pipeline particle_update_pipeline;
+    u32 particle_workgroup_size;
     dvr_compute_pipeline diffuse_pipeline;
 
     dvr_descriptor_set_layout descriptor_set_layout;
     dvr_descriptor_set descriptor_sets[2];
     dvr_pipeline pipeline;
+#ifdef APP_SHADER_HOT_RELOAD
+    // recreating the pipeline for one changed stage needs the module of the other
+    dvr_shader_module render_shaders[2];
+#endif
 
     f64 start_time;
     f64 total_time;
@@ -282,6 +301,7 @@ static DVR_RESULT(dvr_none) app_setup(void) {
     DVR_BUBBLE_INTO(dvr_none, storage_buffer_res_2);
     g_app_state.particle_buffers[1] = DVR_UNWRAP(storage_buffer_res_2);
 
+    // the same layout the compute pipelines reflect from their shaders, so both share one object
     DVR_RESULT(dvr_descriptor_set_layout)
     descriptor_set_layout_res =
         dvr_create_descriptor_set_layout(&(dvr_descriptor_set_layout_desc){
@@ -433,45 +453,65 @@ static DVR_RESULT(dvr_none) app_setup(void) {
 
     dvr_shader_module diffuse_shader = DVR_UNWRAP(compute_shader_res);
 
-    DVR_RESULT(dvr_compute_pipeline)
-    comp_pipeline_res = dvr_create_compute_pipeline(&(dvr_compute_pipeline_desc){
+    // a few subgroups per workgroup, whatever the subgroup size of the GPU is
+    u32 max_workgroup_size = dvr_max_compute_workgroup_size();
+    g_app_state.particle_workgroup_size = 4 * dvr_subgroup_size();
+    while (g_app_state.particle_workgroup_size > max_workgroup_size) {
+        g_app_state.particle_workgroup_size /= 2;
+    }
+    struct {
+        u32 workgroup_size;
+        i32 sensor_area_size;
+    } particle_constants = {
+        .workgroup_size = g_app_state.particle_workgroup_size,
+        .sensor_area_size = 2,
+    };
+
+    dvr_compute_pipeline_desc particle_update_desc = {
         .shader_module = particle_update_shader,
         .entry_point = "main",
-        .num_desc_set_layouts = 1,
-        .desc_set_layouts = &g_app_state.compute_descriptor_set_layout,
-        .num_push_constant_ranges = 1,
-        .push_constant_ranges =
-            (VkPushConstantRange[]){
-                (VkPushConstantRange){
-                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-                    .offset = 0,
-                    .size = sizeof(particle_push_constants),
-                },
+        .reflect_layout = true,
+        .specialization = {
+            .num_entries = 2,
+            .entries = (VkSpecializationMapEntry[]){
+                { .constantID = 0, .offset = 0, .size = sizeof(u32) },
+                { .constantID = 1, .offset = sizeof(u32), .size = sizeof(i32) },
             },
-    });
+            .data = { .base = &particle_constants, .size = sizeof(particle_constants) },
+        },
+    };
+    DVR_RESULT(dvr_compute_pipeline)
+    comp_pipeline_res = dvr_create_compute_pipeline(&particle_update_desc);
     DVR_BUBBLE_INTO(dvr_none, comp_pipeline_res);
 
     g_app_state.particle_update_pipeline = DVR_UNWRAP(comp_pipeline_res);
 
-    comp_pipeline_res = dvr_create_compute_pipeline(&(dvr_compute_pipeline_desc){
+    dvr_compute_pipeline_desc diffuse_desc = {
         .shader_module = diffuse_shader,
         .entry_point = "main",
-        .num_desc_set_layouts = 1,
-        .desc_set_layouts = &g_app_state.compute_descriptor_set_layout,
-        .num_push_constant_ranges = 1,
-        .push_constant_ranges =
-            (VkPushConstantRange[]){
-                (VkPushConstantRange){
-                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-                    .offset = 0,
-                    .size = sizeof(diffuse_push_constants),
-                },
-            },
-    });
+        .reflect_layout = true,
+    };
+    comp_pipeline_res = dvr_create_compute_pipeline(&diffuse_desc);
     DVR_BUBBLE_INTO(dvr_none, comp_pipeline_res);
 
     g_app_state.diffuse_pipeline = DVR_UNWRAP(comp_pipeline_res);
 
+#ifdef APP_SHADER_HOT_RELOAD
+    DVR_RESULT(dvr_none)
+    watch_res = dvr_watch_compute_pipeline(
+        g_app_state.particle_update_pipeline,
+        &particle_update_desc,
+        APP_SHADER_DIR "/mold_update_cs.glsl"
+    );
+    DVR_BUBBLE(watch_res);
+    watch_res = dvr_watch_compute_pipeline(
+        g_app_state.diffuse_pipeline,
+        &diffuse_desc,
+        APP_SHADER_DIR "/mold_diffuse_cs.glsl"
+    );
+    DVR_BUBBLE(watch_res);
+#endif
+
     dvr_destroy_shader_module(particle_update_shader);
     dvr_destroy_shader_module(diffuse_shader);
 
@@ -531,7 +571,7 @@ static DVR_RESULT(dvr_none) app_setup(void) {
                         .image = {
                             .image = g_app_state.compute_targets[i],
                             .sampler = g_app_state.sampler,
-                            .layout = VK_IMAGE_LAYOUT_GENERAL,
+                            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                         },
                     },
                 },
@@ -540,23 +580,10 @@ static DVR_RESULT(dvr_none) app_setup(void) {
         g_app_state.descriptor_sets[i] = DVR_UNWRAP(descriptor_set_res);
     }
 
-    DVR_RESULT(dvr_pipeline)
-    pipeline_res = dvr_create_pipeline(&(dvr_pipeline_desc){
+    dvr_pipeline_desc pipeline_desc = {
         .render_pass = dvr_swapchain_render_pass(),
         .subpass = 0,
-        .layout = {
-            .num_desc_set_layouts = 1,
-            .desc_set_layouts = &g_app_state.descriptor_set_layout,
-            .num_push_constant_ranges = 1,
-            .push_constant_ranges =
-                (VkPushConstantRange[]){
-                    (VkPushConstantRange){
-                        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-                        .offset = 0,
-                        .size = sizeof(render_push_constants),
-                    },
-                },
-        },
+        .layout.reflect = true,
         .num_stages = 2,
         .stages = (dvr_pipeline_stage_desc[]){
             {
@@ -593,7 +620,7 @@ static DVR_RESULT(dvr_none) app_setup(void) {
             .dst_alpha_blend_factor = VK_BLEND_FACTOR_ZERO,
         },
         .multisample = {
-            .rasterization_samples = dvr_max_msaa_samples(),
+            .rasterization_samples = dvr_swapchain_samples(),
             .sample_shading_enable = false,
             .alpha_to_one_enable = false,
             .alpha_to_coverage_enable = false,
@@ -605,8 +632,8 @@ static DVR_RESULT(dvr_none) app_setup(void) {
             .attributes = NULL,
         },
         .depth_stencil = {
-            .depth_test_enable = true,
-            .depth_write_enable = true,
+            .depth_test_enable = false,
+            .depth_write_enable = false,
             .depth_compare_op = VK_COMPARE_OP_LESS,
             .depth_bounds_test_enable = false,
             .stencil_test_enable = false,
@@ -620,12 +647,28 @@ static DVR_RESULT(dvr_none) app_setup(void) {
             .primitive_restart_enable = false,
             .rasterizer_discard_enable = false,
         },
-    });
+    };
+    DVR_RESULT(dvr_pipeline) pipeline_res = dvr_create_pipeline(&pipeline_desc);
     DVR_BUBBLE_INTO(dvr_none, pipeline_res);
     g_app_state.pipeline = DVR_UNWRAP(pipeline_res);
 
+#ifdef APP_SHADER_HOT_RELOAD
+    watch_res = dvr_watch_pipeline(
+        g_app_state.pipeline,
+        &pipeline_desc,
+        (const char*[]){
+            APP_SHADER_DIR "/mold_render_vs.glsl",
+            APP_SHADER_DIR "/mold_render_fs.glsl",
+        }
+    );
+    DVR_BUBBLE(watch_res);
+
+    g_app_state.render_shaders[0] = vert_shader;
+    g_app_state.render_shaders[1] = frag_shader;
+#else
     dvr_destroy_shader_module(vert_shader);
     dvr_destroy_shader_module(frag_shader);
+#endif
 
     struct timespec start_time;
     clock_gettime(CLOCK_MONOTONIC, &start_time);
@@ -652,7 +695,9 @@ static void app_update(void) {
     g_app_state.frame_count++;
 }
 
-static void app_compute(void) {
+static void app_diffuse(void* user_data) {
+    (void)user_data;
+
     dvr_bind_compute_pipeline(g_app_state.diffuse_pipeline);
     dvr_bind_descriptor_set_compute(
         g_app_state.diffuse_pipeline,
@@ -678,26 +723,10 @@ static void app_compute(void) {
         (u32)ceilf((f32)APP_WINDOW_HEIGHT / 32.0f),
         1
     );
+}
 
-    VkMemoryBarrier memory_barrier = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-        .pNext = NULL,
-        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
-    };
-
-    vkCmdPipelineBarrier(
-        dvr_compute_command_buffer(),
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        0,
-        1,
-        &memory_barrier,
-        0,
-        NULL,
-        0,
-        NULL
-    );
+static void app_update_particles(void* user_data) {
+    (void)user_data;
 
     dvr_bind_compute_pipeline(g_app_state.particle_update_pipeline);
     dvr_bind_descriptor_set_compute(
@@ -725,7 +754,8 @@ static void app_compute(void) {
         }
     );
 
-    dvr_dispatch_compute(NUM_PARTICLES / 256, 1, 1);
+    u32 workgroup_size = g_app_state.particle_workgroup_size;
+    dvr_dispatch_compute((NUM_PARTICLES + workgroup_size - 1) / workgroup_size, 1, 1);
 }
 
 static void reset_particles(void) {
@@ -761,7 +791,9 @@ static void reset_particles(void) {
     dvr_destroy_buffer(copy_src);
 }
 
-static void app_draw(void) {
+static void app_render(void* user_data) {
+    (void)user_data;
+
     dvr_begin_swapchain_render_pass();
 
     dvr_bind_pipeline(g_app_state.pipeline);
@@ -781,13 +813,69 @@ static void app_draw(void) {
             .size = sizeof(render_push_constants),
         }
     );
-    vkCmdDraw(dvr_command_buffer(), 3, 1, 0, 0);
+    dvr_draw(3, 1, 0, 0);
 
     dvr_imgui_render();
 
     dvr_end_render_pass();
 }
 
+static DVR_RESULT(dvr_none) app_draw(void) {
+    u32 k = (g_app_state.frame_count - 1) % 2;
+
+    dvr_render_graph_begin();
+
+    dvr_render_graph_resource targets[2] = {
+        dvr_render_graph_import_image(g_app_state.compute_targets[0]),
+        dvr_render_graph_import_image(g_app_state.compute_targets[1]),
+    };
+    dvr_render_graph_resource particles[2] = {
+        dvr_render_graph_import_buffer(g_app_state.particle_buffers[0]),
+        dvr_render_graph_import_buffer(g_app_state.particle_buffers[1]),
+    };
+
+    dvr_render_graph_add_pass(&(dvr_render_graph_pass_desc){
+        .name = "diffuse",
+        .type = DVR_RENDER_GRAPH_PASS_COMPUTE,
+        .num_uses = 2,
+        .uses =
+            (dvr_render_graph_use[]){
+                { .resource = targets[k], .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_READ },
+                { .resource = targets[1 - k], .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_WRITE },
+            },
+        .execute = app_diffuse,
+    });
+
+    dvr_render_graph_add_pass(&(dvr_render_graph_pass_desc){
+        .name = "update particles",
+        .type = DVR_RENDER_GRAPH_PASS_COMPUTE,
+        .num_uses = 4,
+        .uses =
+            (dvr_render_graph_use[]){
+                { .resource = particles[k], .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_READ },
+                { .resource = particles[1 - k], .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_WRITE },
+                { .resource = targets[k], .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_READ },
+                { .resource = targets[1 - k],
+                  .access = DVR_RENDER_GRAPH_ACCESS_STORAGE_READ_WRITE },
+            },
+        .execute = app_update_particles,
+    });
+
+    dvr_render_graph_add_pass(&(dvr_render_graph_pass_desc){
+        .name = "render",
+        .type = DVR_RENDER_GRAPH_PASS_GRAPHICS,
+        .num_uses = 1,
+        .uses =
+            (dvr_render_graph_use[]){
+                { .resource = targets[k], .access = DVR_RENDER_GRAPH_ACCESS_SAMPLED },
+            },
+        .side_effects = true,
+        .execute = app_render,
+    });
+
+    return dvr_render_graph_execute();
+}
+
 static void app_draw_imgui(void) {
     dvr_imgui_begin_frame();
 
@@ -834,6 +922,8 @@ static void app_draw_imgui(void) {
     }
 
     igEnd();
+
+    dvr_imgui_frame_stats();
 }
 
 static void app_shutdown(void) {
@@ -848,6 +938,13 @@ static void app_shutdown(void) {
     dvr_destroy_sampler(g_app_state.sampler);
     dvr_destroy_descriptor_set_layout(g_app_state.compute_descriptor_set_layout);
     dvr_destroy_descriptor_set_layout(g_app_state.descriptor_set_layout);
+#ifdef APP_SHADER_HOT_RELOAD
+    dvr_unwatch_compute_pipeline(g_app_state.particle_update_pipeline);
+    dvr_unwatch_compute_pipeline(g_app_state.diffuse_pipeline);
+    dvr_unwatch_pipeline(g_app_state.pipeline);
+    dvr_destroy_shader_module(g_app_state.render_shaders[0]);
+    dvr_destroy_shader_module(g_app_state.render_shaders[1]);
+#endif
     dvr_destroy_compute_pipeline(g_app_state.particle_update_pipeline);
     dvr_destroy_compute_pipeline(g_app_state.diffuse_pipeline);
     dvr_destroy_pipeline(g_app_state.pipeline);
@@ -2,8 +2,9 @@
 #pragma shader_stage(vertex)
 
 layout(location = 0) in vec3 iPosition;
-layout(location = 1) in vec3 iColor;
 layout(location = 2) in vec2 iUv;
+// per instance, locations 4 to 7
+layout(location = 4) in mat4 iInstanceModel;
 
 layout(location = 0) out vec3 aColor;
 layout(location = 1) out vec2 aUv;
@@ -16,7 +17,7 @@ layout(binding = 0) uniform transform {
 
 void main()
 {
-    gl_Position = u_proj * u_view * u_model * vec4(iPosition, 1.0);
-    aColor = iColor;
+    gl_Position = u_proj * u_view * iInstanceModel * u_model * vec4(iPosition, 1.0);
+    aColor = vec3(1.0);
     aUv = iUv;
 }
@@ -54,7 +54,10 @@ float sniff_area(vec2 pos, float angle, float dt, float sniff_angle, float sniff
     return sum;
 }
 
-layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+// both are specialized at pipeline creation, the values here are the defaults
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1, local_size_x_id = 0) in;
+layout(constant_id = 1) const int sensor_area_size = 2;
+
 void main()
 {
     uint index = gl_GlobalInvocationID.x;
@@ -70,7 +73,6 @@ void main()
 
     float sensor_angle = push_constants.sensor_angle;
     float sensor_dist = push_constants.sensor_dist;
-    int sensor_area_size = 2;
 
     float left = sniff_area(pos, angle, push_constants.dt, sensor_angle, sensor_dist, sensor_area_size);
     float right = sniff_area(pos, angle, push_constants.dt, -sensor_angle, sensor_dist, sensor_area_size);
@@ -10,10 +10,42 @@
 
 #include <vulkan/vulkan.h>
 
+typedef enum dvr_present_mode {
+    DVR_PRESENT_MODE_DEFAULT,
+    DVR_PRESENT_MODE_IMMEDIATE,
+    DVR_PRESENT_MODE_MAILBOX,
+    DVR_PRESENT_MODE_FIFO,
+    DVR_PRESENT_MODE_FIFO_RELAXED,
+} dvr_present_mode;
+
 typedef struct dvr_setup_desc {
     u32 initial_width;
     u32 initial_height;
     const char* app_name;
+    /// Requested present mode, falls back to FIFO when the surface does not support it.
+    dvr_present_mode present_mode;
+    /// Minimum time between two frames in seconds, 0 disables the frame limiter.
+    f64 target_frame_interval;
+    /// Maximum number of presents that may be queued before `dvr_begin_frame` blocks. Only
+    /// used when VK_KHR_present_wait is available, 0 disables latency pacing.
+    u32 max_frame_latency;
+    /// Render into offscreen images instead of a window. No surface is created and frames
+    /// are never presented, which allows running on devices without a display (lavapipe).
+    bool headless;
+    /// Render through VK_KHR_dynamic_rendering instead of render pass and framebuffer objects.
+    /// The swapchain then has no render pass, pipelines drawing to it are created with
+    /// `rendering` formats instead.
+    bool dynamic_rendering;
+    /// Sample count of the swapchain pass, 0 uses `dvr_max_msaa_samples`. With a single sample
+    /// the pass renders straight into the swapchain image and nothing is resolved.
+    VkSampleCountFlagBits msaa_samples;
+    /// Depth format of the swapchain pass, VK_FORMAT_UNDEFINED defaults to D32_SFLOAT.
+    VkFormat depth_format;
+    /// Leave the swapchain pass without a depth attachment.
+    bool no_depth;
+    /// Keep the depth of the swapchain pass after it ends so `dvr_build_depth_pyramid` can
+    /// reduce it. Needs depth and forces a single sample, multisampled depth can't be reduced.
+    bool depth_pyramid;
 } dvr_setup_desc;
 
 typedef enum dvr_buffer_lifecycle {
@@ -29,6 +61,8 @@ typedef enum dvr_buffer_usage {
     DVR_BUFFER_USAGE_TRANSFER_SRC = 1 << 3,
     DVR_BUFFER_USAGE_TRANSFER_DST = 1 << 4,
     DVR_BUFFER_USAGE_STORAGE = 1 << 5,
+    /// Source of indirect draw or dispatch parameters.
+    DVR_BUFFER_USAGE_INDIRECT = 1 << 6,
 } dvr_buffer_usage;
 
 typedef struct dvr_buffer_desc {
@@ -44,18 +78,33 @@ DVR_RESULT_DEF(dvr_buffer);
 
 DVR_RESULT(dvr_buffer) dvr_create_buffer(dvr_buffer_desc* desc);
 void dvr_destroy_buffer(dvr_buffer buffer);
+/// Like `dvr_destroy_buffer`, but waits for the frame that is being recorded to complete, for
+/// buffers that commands have already been recorded against.
+void dvr_retire_buffer(dvr_buffer buffer);
 void dvr_write_buffer(dvr_buffer buffer, dvr_range data, u32 offset);
 void dvr_copy_buffer(dvr_buffer src, dvr_buffer dst, u32 src_offset, u32 dst_offset, u32 size);
 void dvr_bind_vertex_buffer(dvr_buffer buffer, u32 binding);
 void dvr_bind_index_buffer(dvr_buffer buffer, VkIndexType index_type);
 void dvr_bind_uniform_buffer(dvr_buffer buffer, u32 binding);
 
+/// Location of one mip level inside `dvr_image_desc.data`.
+typedef struct dvr_image_level {
+    usize offset;
+    usize size;
+} dvr_image_level;
+
 typedef struct dvr_image_desc {
     u32 width;
     u32 height;
     bool render_target;
     dvr_range data;
     bool generate_mipmaps;
+    /// Number of mip levels already present in `data`, 0 means 1. Cannot be combined with
+    /// `generate_mipmaps`, block-compressed formats have to ship their mips this way.
+    u32 mip_levels;
+    /// Byte range of every level in `data`, largest first. NULL means the levels are tightly
+    /// packed one after another.
+    const dvr_image_level* levels;
     VkSampleCountFlagBits num_samples;
     VkFormat format;
     VkImageTiling tiling;
@@ -69,7 +118,17 @@ typedef struct dvr_image {
 DVR_RESULT_DEF(dvr_image);
 
 DVR_RESULT(dvr_image) dvr_create_image(dvr_image_desc* desc);
+/// Size in bytes of one tightly packed level, 0 for formats dvr doesn't know the layout of.
+usize dvr_image_level_size(VkFormat format, u32 width, u32 height);
+/// BC1-BC7 formats, which are sampled straight from their 4x4 blocks.
+bool dvr_format_is_block_compressed(VkFormat format);
 void dvr_destroy_image(dvr_image image);
+/// Like `dvr_destroy_image`, but waits for the frame that is being recorded to complete.
+void dvr_retire_image(dvr_image image);
+/// Regenerates the mip chain of an image created with `generate_mipmaps` from its first level,
+/// recorded into the frame command buffer outside of any render pass. The image ends up in
+/// SHADER_READ_ONLY_OPTIMAL.
+DVR_RESULT(dvr_none) dvr_generate_mipmaps(dvr_image image);
 
 typedef struct dvr_sampler_desc {
     VkFilter mag_filter;
@@ -136,6 +195,36 @@ void dvr_begin_render_pass(
 );
 void dvr_end_render_pass();
 
+typedef struct dvr_rendering_attachment_desc {
+    dvr_image image;
+    /// Resolve the (multisampled) image into `resolve_image` at the end of rendering.
+    bool resolve;
+    dvr_image resolve_image;
+    VkAttachmentLoadOp load_op;
+    VkAttachmentStoreOp store_op;
+    VkClearValue clear_value;
+} dvr_rendering_attachment_desc;
+
+typedef struct dvr_rendering_desc {
+    /// Size of the render area, defaults to the size of the first attachment.
+    u32 width;
+    u32 height;
+    u32 num_color_attachments;
+    dvr_rendering_attachment_desc color_attachments[DVR_MAX_RENDER_PASS_COLOR_ATTACHMENTS];
+    bool has_depth_attachment;
+    dvr_rendering_attachment_desc depth_attachment;
+} dvr_rendering_desc;
+
+/// Begins dynamic rendering directly into the given images, they are transitioned into
+/// attachment layouts as needed. Requires `dynamic_rendering` in `dvr_setup_desc`.
+void dvr_begin_rendering(dvr_rendering_desc* desc);
+void dvr_end_rendering(void);
+
+/// Records a layout transition into the frame command buffer, e.g. to sample an image that
+/// was rendered to with `dvr_begin_rendering`. Layouts are only tracked for images used with
+/// dynamic rendering, not for attachments of render pass objects.
+void dvr_transition_image(dvr_image image, VkImageLayout layout);
+
 typedef struct dvr_descriptor_set_layout_binding_desc {
     u32 binding;
     u32 array_element;
@@ -154,6 +243,8 @@ typedef struct dvr_descriptor_set_layout {
 } dvr_descriptor_set_layout;
 DVR_RESULT_DEF(dvr_descriptor_set_layout);
 
+/// Identical layouts are shared, creating one that already exists returns the existing handle.
+/// Every create still has to be matched by a destroy.
 DVR_RESULT(dvr_descriptor_set_layout)
 dvr_create_descriptor_set_layout(dvr_descriptor_set_layout_desc* desc);
 void dvr_destroy_descriptor_set_layout(dvr_descriptor_set_layout desc_set_layout);
@@ -203,13 +294,24 @@ typedef struct dvr_shader_module {
 } dvr_shader_module;
 DVR_RESULT_DEF(dvr_shader_module);
 
+/// Modules are reflected on creation, see `dvr_get_shader_reflection`.
 DVR_RESULT(dvr_shader_module) dvr_create_shader_module(dvr_shader_module_desc* desc);
 void dvr_destroy_shader_module(dvr_shader_module shader_module);
 
+/// Values of the `layout(constant_id = N)` constants of a stage, fixed when the pipeline is
+/// created so that the driver can fold them like literals. Entry i reads `entries[i].size`
+/// bytes at `entries[i].offset` of `data`. Constants without an entry keep their default.
+typedef struct dvr_specialization_desc {
+    u32 num_entries;
+    VkSpecializationMapEntry* entries;
+    dvr_range data;
+} dvr_specialization_desc;
+
 typedef struct dvr_pipeline_stage_desc {
     VkShaderStageFlagBits stage;
     dvr_shader_module shader_module;
     const char* entry_point;
+    dvr_specialization_desc specialization;
 } dvr_pipeline_stage_desc;
 
 typedef struct dvr_vertex_input_state_desc {
@@ -224,6 +326,13 @@ typedef struct dvr_pipeline_desc {
     dvr_pipeline_stage_desc* stages;
     dvr_render_pass render_pass;
     u32 subpass;
+    /// Attachment formats for pipelines used with `dvr_begin_rendering`. When any format is
+    /// set `render_pass` and `subpass` are ignored.
+    struct {
+        u32 num_color_formats;
+        VkFormat color_formats[DVR_MAX_RENDER_PASS_COLOR_ATTACHMENTS];
+        VkFormat depth_format;
+    } rendering;
     VkViewport viewport;
     VkRect2D scissor;
 
@@ -276,6 +385,9 @@ typedef struct dvr_pipeline_desc {
     } color_blend;
 
     struct {
+        /// Derive the descriptor set layouts and push constant range from the reflection of
+        /// the stages instead, see `dvr_get_pipeline_set_layout`.
+        bool reflect;
         u32 num_desc_set_layouts;
         dvr_descriptor_set_layout* desc_set_layouts;
         u32 num_push_constant_ranges;
@@ -288,12 +400,74 @@ typedef struct dvr_pipeline {
 } dvr_pipeline;
 DVR_RESULT_DEF(dvr_pipeline);
 
+/// Pipelines are cached by their state, creating one identical to an existing pipeline returns
+/// the existing handle without compiling anything. Every create still has to be matched by a
+/// destroy.
 DVR_RESULT(dvr_pipeline) dvr_create_pipeline(dvr_pipeline_desc* desc);
 void dvr_destroy_pipeline(dvr_pipeline pipeline);
 
+typedef enum dvr_pipeline_variant_flags {
+    DVR_PIPELINE_VARIANT_TOPOLOGY = 1 << 0,
+    DVR_PIPELINE_VARIANT_POLYGON_MODE = 1 << 1,
+    /// Cull mode and front face.
+    DVR_PIPELINE_VARIANT_CULL_MODE = 1 << 2,
+    /// Depth test, write and compare op.
+    DVR_PIPELINE_VARIANT_DEPTH = 1 << 3,
+    /// Blend enable, factors and ops.
+    DVR_PIPELINE_VARIANT_BLEND = 1 << 4,
+    DVR_PIPELINE_VARIANT_SPECIALIZATION = 1 << 5,
+} dvr_pipeline_variant_flags;
+
+/// State that differs from a base pipeline, only the groups set in `flags` are read.
+typedef struct dvr_pipeline_variant_desc {
+    u32 flags;
+    VkPrimitiveTopology topology;
+    VkPolygonMode polygon_mode;
+    VkCullModeFlags cull_mode;
+    VkFrontFace front_face;
+    bool depth_test_enable;
+    bool depth_write_enable;
+    VkCompareOp depth_compare_op;
+    bool blend_enable;
+    VkBlendFactor src_color_blend_factor;
+    VkBlendFactor dst_color_blend_factor;
+    VkBlendOp color_blend_op;
+    VkBlendFactor src_alpha_blend_factor;
+    VkBlendFactor dst_alpha_blend_factor;
+    VkBlendOp alpha_blend_op;
+    /// One per stage of the base pipeline, in the same order.
+    dvr_specialization_desc* specializations;
+} dvr_pipeline_variant_desc;
+
+/// Create or look up the pipeline `base` was created from with `variant` applied, a variant
+/// asked for twice compiles once. The shader modules and set layouts of `base` have to be alive.
+DVR_RESULT(dvr_pipeline)
+dvr_create_pipeline_variant(dvr_pipeline base, const dvr_pipeline_variant_desc* variant);
+/// Move the Vulkan objects of `replacement` into `pipeline` and release the `replacement`
+/// handle, everything holding `pipeline` uses e.g. recompiled shaders from then on. The old
+/// objects are destroyed once the frames that may have bound them completed. Fails without
+/// touching either handle if `replacement` is shared through the pipeline cache.
+DVR_RESULT(dvr_none) dvr_replace_pipeline(dvr_pipeline pipeline, dvr_pipeline replacement);
+/// Descriptor set layout of a pipeline created with a reflected layout, owned by the pipeline.
+/// The push constant range of such a pipeline covers every stage declaring the block, so push
+/// constants with the flags of all of those stages.
+DVR_RESULT(dvr_descriptor_set_layout) dvr_get_pipeline_set_layout(dvr_pipeline pipeline, u32 set);
+
 void dvr_bind_pipeline(dvr_pipeline pipeline);
 void dvr_push_constants(dvr_pipeline pipeline, VkShaderStageFlags stage, u32 offset, dvr_range data);
 
+void dvr_draw(u32 vertex_count, u32 instance_count, u32 first_vertex, u32 first_instance);
+void dvr_draw_indexed(
+    u32 index_count,
+    u32 instance_count,
+    u32 first_index,
+    i32 vertex_offset,
+    u32 first_instance
+);
+/// `draw_count` VkDrawIndexedIndirectCommand read from `buffer` at `offset`, `stride` bytes
+/// apart. More than one draw needs the multiDrawIndirect feature.
+void dvr_draw_indexed_indirect(dvr_buffer buffer, u64 offset, u32 draw_count, u32 stride);
+
 typedef struct dvr_framebuffer_desc {
     dvr_render_pass render_pass;
     u32 num_attachments;
@@ -310,6 +484,18 @@ DVR_RESULT_DEF(dvr_framebuffer);
 DVR_RESULT(dvr_framebuffer) dvr_create_framebuffer(dvr_framebuffer_desc* desc);
 void dvr_destroy_framebuffer(dvr_framebuffer framebuffer);
 
+/// Hands out an image matching `desc` from the render target pool instead of allocating a new
+/// one. The image returns to the pool at the end of the frame and its contents are undefined
+/// on the next acquire. Images unused for a few frames are destroyed. `desc` can't have data
+/// or mipmaps.
+DVR_RESULT(dvr_image) dvr_acquire_render_target(dvr_image_desc* desc);
+/// Return a pooled image before the end of the frame so later passes can reuse it. The caller
+/// is responsible for synchronizing the reuse.
+void dvr_release_render_target(dvr_image image);
+/// Framebuffer for the given attachments, cached and evicted alongside pooled render targets.
+/// Any attachment may be used, a destroyed and recreated attachment gets a new framebuffer.
+DVR_RESULT(dvr_framebuffer) dvr_acquire_framebuffer(dvr_framebuffer_desc* desc);
+
 typedef struct dvr_compute_pipeline {
     u16 id;
 } dvr_compute_pipeline;
@@ -318,6 +504,10 @@ DVR_RESULT_DEF(dvr_compute_pipeline);
 typedef struct dvr_compute_pipeline_desc {
     dvr_shader_module shader_module;
     const char* entry_point;
+    /// E.g. the workgroup size through `layout(local_size_x_id = N) in;`.
+    dvr_specialization_desc specialization;
+    /// Derive the layout from the reflection of the shader, like `dvr_pipeline_desc`.
+    bool reflect_layout;
     u32 num_desc_set_layouts;
     dvr_descriptor_set_layout* desc_set_layouts;
     u32 num_push_constant_ranges;
@@ -326,20 +516,135 @@ typedef struct dvr_compute_pipeline_desc {
 
 DVR_RESULT(dvr_compute_pipeline) dvr_create_compute_pipeline(dvr_compute_pipeline_desc* desc);
 void dvr_destroy_compute_pipeline(dvr_compute_pipeline pipeline);
+/// Compute counterpart of `dvr_replace_pipeline`.
+void dvr_replace_compute_pipeline(dvr_compute_pipeline pipeline, dvr_compute_pipeline replacement);
+DVR_RESULT(dvr_descriptor_set_layout)
+dvr_get_compute_pipeline_set_layout(dvr_compute_pipeline pipeline, u32 set);
 
 void dvr_bind_compute_pipeline(dvr_compute_pipeline pipeline);
 void dvr_dispatch_compute(u32 group_count_x, u32 group_count_y, u32 group_count_z);
 void dvr_push_constants_compute(dvr_compute_pipeline pipeline, u32 offset, dvr_range data);
 
+typedef struct dvr_render_graph_resource {
+    u16 id;
+} dvr_render_graph_resource;
+
+typedef enum dvr_render_graph_pass_type {
+    DVR_RENDER_GRAPH_PASS_GRAPHICS,
+    DVR_RENDER_GRAPH_PASS_COMPUTE,
+    DVR_RENDER_GRAPH_PASS_TRANSFER,
+} dvr_render_graph_pass_type;
+
+typedef enum dvr_render_graph_access {
+    DVR_RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT,
+    DVR_RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT,
+    DVR_RENDER_GRAPH_ACCESS_DEPTH_READ,
+    DVR_RENDER_GRAPH_ACCESS_SAMPLED,
+    DVR_RENDER_GRAPH_ACCESS_STORAGE_READ,
+    DVR_RENDER_GRAPH_ACCESS_STORAGE_WRITE,
+    DVR_RENDER_GRAPH_ACCESS_STORAGE_READ_WRITE,
+    DVR_RENDER_GRAPH_ACCESS_TRANSFER_SRC,
+    DVR_RENDER_GRAPH_ACCESS_TRANSFER_DST,
+    DVR_RENDER_GRAPH_ACCESS_VERTEX_BUFFER,
+    DVR_RENDER_GRAPH_ACCESS_INDEX_BUFFER,
+    DVR_RENDER_GRAPH_ACCESS_UNIFORM_BUFFER,
+    DVR_RENDER_GRAPH_ACCESS_INDIRECT_BUFFER,
+} dvr_render_graph_access;
+
+typedef struct dvr_render_graph_use {
+    dvr_render_graph_resource resource;
+    dvr_render_graph_access access;
+    /// Attachments only. With dynamic rendering enabled the graph begins rendering for
+    /// graphics passes that use attachments, with these load ops and clear values.
+    VkAttachmentLoadOp load_op;
+    VkClearValue clear_value;
+    bool resolve;
+    dvr_render_graph_resource resolve_target;
+} dvr_render_graph_use;
+
+/// A transient image only lives for the duration of the graph. Transients whose lifetimes
+/// don't overlap share memory.
+typedef struct dvr_render_graph_image_desc {
+    u32 width;
+    u32 height;
+    VkFormat format;
+    VkSampleCountFlagBits samples;
+} dvr_render_graph_image_desc;
+
+typedef struct dvr_render_graph_pass_desc {
+    const char* name;
+    dvr_render_graph_pass_type type;
+    u32 num_uses;
+    dvr_render_graph_use* uses;
+    /// Keep the pass even when nothing reads its outputs, e.g. because it draws to the
+    /// swapchain through a render pass. Passes writing imported resources are always kept.
+    bool side_effects;
+    void (*execute)(void* user_data);
+    void* user_data;
+} dvr_render_graph_pass_desc;
+
+/// Starts recording a new graph for the current frame. Passes are culled, synchronized and
+/// recorded into the frame command buffer by `dvr_render_graph_execute`, compute work inside
+/// a pass is recorded there as well.
+void dvr_render_graph_begin(void);
+dvr_render_graph_resource dvr_render_graph_import_image(dvr_image image);
+dvr_render_graph_resource dvr_render_graph_import_buffer(dvr_buffer buffer);
+/// Imports the swapchain image acquired for this frame.
+dvr_render_graph_resource dvr_render_graph_import_swapchain(void);
+dvr_render_graph_resource dvr_render_graph_create_image(dvr_render_graph_image_desc* desc);
+void dvr_render_graph_add_pass(dvr_render_graph_pass_desc* desc);
+DVR_RESULT(dvr_none) dvr_render_graph_execute(void);
+
+/// Only valid inside a pass, transient images are backed by memory for the passes using them.
+dvr_image dvr_render_graph_image(dvr_render_graph_resource resource);
+dvr_buffer dvr_render_graph_buffer(dvr_render_graph_resource resource);
+
+/// Drops everything stored in the internal pipeline cache, so that the next pipeline creation
+/// compiles from scratch.
+DVR_RESULT(dvr_none) dvr_reset_pipeline_cache(void);
+
 DVR_RESULT(dvr_none) dvr_setup(dvr_setup_desc* desc);
 void dvr_shutdown();
 
 VkFormat dvr_swapchain_format();
+/// VK_FORMAT_UNDEFINED when the swapchain pass has no depth attachment.
+VkFormat dvr_swapchain_depth_format();
 VkSampleCountFlags dvr_max_msaa_samples();
+/// Invocations per subgroup of the selected GPU, e.g. to size workgroups with specialization
+/// constants.
+u32 dvr_subgroup_size(void);
+/// Largest one dimensional workgroup the GPU accepts.
+u32 dvr_max_compute_workgroup_size(void);
+VkSampleCountFlagBits dvr_swapchain_samples();
 dvr_framebuffer dvr_swapchain_framebuffer();
 dvr_render_pass dvr_swapchain_render_pass();
 void dvr_begin_swapchain_render_pass();
 
+/// Hierarchical depth of the swapchain pass, the level below the top one holds the farthest
+/// depth of a power of two sized grid over the viewport and every further level the farthest
+/// of the 2x2 texels below it. Something whose nearest depth is farther than the texels it
+/// covers is hidden.
+typedef struct dvr_depth_pyramid {
+    /// R32_SFLOAT, always in GENERAL layout.
+    dvr_image image;
+    u32 width;
+    u32 height;
+    u32 num_levels;
+    /// Changes whenever the image is recreated, descriptor sets referencing it have to be
+    /// recreated too.
+    u32 generation;
+    /// Whether the image holds the depth of a frame since it was created.
+    bool valid;
+} dvr_depth_pyramid;
+DVR_RESULT_DEF(dvr_depth_pyramid);
+
+/// Reduce the depth of the swapchain pass into the depth pyramid, recorded after the pass
+/// ended. The pyramid is meant to be read by the next frame, needs `dvr_setup_desc.depth_pyramid`.
+DVR_RESULT(dvr_none) dvr_build_depth_pyramid(void);
+/// Creates the pyramid on first use or after a resize, it is not valid until built.
+DVR_RESULT(dvr_depth_pyramid) dvr_get_depth_pyramid(void);
+
+VkPhysicalDevice dvr_physical_device();
 VkDevice dvr_device();
 VkCommandBuffer dvr_command_buffer();
 #define DVR_COMMAND_BUFFER dvr_command_buffer()
@@ -349,16 +654,83 @@ VkCommandBuffer dvr_compute_command_buffer();
 
 DVR_RESULT(dvr_none) dvr_begin_frame();
 DVR_RESULT(dvr_none) dvr_end_frame();
+/// Whether the commands recorded this frame are going to be dropped, e.g. while minimized.
+bool dvr_frame_skipped(void);
+/// Index of the frame being recorded, advances with every `dvr_end_frame`.
+u64 dvr_frame_index(void);
+
+/// Record an upload of the first `num_levels` levels of `data`, laid out like
+/// `dvr_image_desc.data`, into the frame command buffer instead of waiting on a transient
+/// submit. The data is staged right away. The image needs TRANSFER_DST usage and ends up in
+/// SHADER_READ_ONLY_OPTIMAL. Has to be recorded outside of render passes.
+DVR_RESULT(dvr_none) dvr_upload_image(
+    dvr_image image,
+    dvr_range data,
+    u32 num_levels,
+    const dvr_image_level* levels
+);
+/// Buffer counterpart of `dvr_upload_image`, the buffer needs TRANSFER_DST usage.
+DVR_RESULT(dvr_none) dvr_upload_buffer(dvr_buffer buffer, dvr_range data, u64 offset);
 
 DVR_RESULT(dvr_none) dvr_begin_compute();
 DVR_RESULT(dvr_none) dvr_end_compute();
 
+void dvr_set_target_frame_interval(f64 seconds);
+
 bool dvr_should_close(void);
 void dvr_poll_events(void);
 void dvr_close(void);
 void dvr_wait_idle(void);
 void dvr_get_window_size(u32* width, u32* height);
 
+/// Counters collected between two calls to `dvr_end_frame`. Live counts are a snapshot of
+/// the resource tables taken when the stats are queried.
+typedef struct dvr_frame_stats {
+    u64 frame_index;
+    u32 draw_calls;
+    u32 dispatches;
+    u32 pipeline_binds;
+    u32 descriptor_set_binds;
+    u32 barriers;
+    u64 staging_bytes_uploaded;
+    u32 transient_submits;
+    u32 queue_waits;
+
+    struct {
+        u32 buffers;
+        u32 images;
+        u32 samplers;
+        u32 render_passes;
+        u32 shader_modules;
+        u32 pipelines;
+        u32 framebuffers;
+        u32 descriptor_set_layouts;
+        u32 descriptor_sets;
+        u32 compute_pipelines;
+    } live;
+} dvr_frame_stats;
+
+/// Returns the stats of the last completed frame.
+dvr_frame_stats dvr_get_frame_stats(void);
+
+/// GPU side counts of the commands recorded between `dvr_begin_pipeline_statistics` and
+/// `dvr_end_pipeline_statistics`, both called outside of render passes.
+typedef struct dvr_pipeline_statistics {
+    u64 input_assembly_vertices;
+    u64 input_assembly_primitives;
+    u64 vertex_shader_invocations;
+    u64 clipping_primitives;
+    u64 fragment_shader_invocations;
+} dvr_pipeline_statistics;
+DVR_RESULT_DEF(dvr_pipeline_statistics);
+
+/// Needs the pipelineStatisticsQuery device feature, begin and end do nothing without it.
+bool dvr_pipeline_statistics_supported(void);
+void dvr_begin_pipeline_statistics(void);
+void dvr_end_pipeline_statistics(void);
+/// Results of the last ended query, available once its frame completed.
+DVR_RESULT(dvr_pipeline_statistics) dvr_get_pipeline_statistics(void);
+
 #ifdef DVR_ENABLE_IMGUI
 DVR_RESULT(dvr_none) dvr_imgui_setup();
 void dvr_imgui_shutdown();
@@ -367,5 +739,6 @@ void dvr_imgui_begin_frame();
 void dvr_imgui_render();
 
 void dvr_imgui_info(void);
+void dvr_imgui_frame_stats(void);
 #endif
 
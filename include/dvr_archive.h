@@ -0,0 +1,81 @@
+#pragma once
+
+/// DVRA asset archives
+///
+/// A single file holding many named blobs, written by the dvr_pack tool. The index is sorted by
+/// name hash and bucketed by the top bits of the hash, so lookups touch one bucket.
+/// Uncompressed blobs can be used straight from the mapped archive.
+///
+/// Layout, everything little endian:
+/// - `dvr_archive_header`
+/// - `(1 << bucket_bits) + 1` u32 bucket starts into the entry array
+/// - `num_entries` `dvr_archive_entry`, sorted by hash
+/// - entry names, not NUL terminated
+/// - blobs, each aligned to `DVR_ARCHIVE_ALIGNMENT`
+
+#include "dvr_result.h"
+#include "dvr_types.h"
+#include "dvr_utils.h"
+
+#define DVR_ARCHIVE_MAGIC 0x41525644u // "DVRA"
+#define DVR_ARCHIVE_VERSION 1
+#define DVR_ARCHIVE_ALIGNMENT 16
+
+typedef enum dvr_archive_compression {
+    DVR_ARCHIVE_COMPRESSION_NONE,
+    /// LZ4 block format, without the frame.
+    DVR_ARCHIVE_COMPRESSION_LZ4,
+} dvr_archive_compression;
+
+typedef struct dvr_archive_header {
+    u32 magic;
+    u32 version;
+    u32 num_entries;
+    u32 bucket_bits;
+    u64 buckets_offset;
+    u64 entries_offset;
+    u64 names_offset;
+} dvr_archive_header;
+
+typedef struct dvr_archive_entry {
+    u64 hash;
+    u64 offset;
+    /// Size once decompressed.
+    u64 size;
+    /// Size of the blob in the archive.
+    u64 stored_size;
+    u32 name_offset;
+    u32 name_length;
+    u32 compression;
+    u32 reserved;
+} dvr_archive_entry;
+
+typedef struct dvr_archive {
+    dvr_mapped_file file;
+    dvr_archive_header header;
+    // views into the mapping
+    const u32* buckets;
+    const dvr_archive_entry* entries;
+    const char* names;
+} dvr_archive;
+DVR_RESULT_DEF(dvr_archive);
+
+/// FNV-1a of the entry name.
+static inline u64 dvr_archive_hash(const char* name, usize length) {
+    u64 hash = 0xCBF29CE484222325ull;
+    for (usize i = 0; i < length; i++) {
+        hash ^= (u8)name[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+/// Map an archive and validate its index. The whole file is read ahead in one go.
+DVR_RESULT(dvr_archive) dvr_open_archive(const char* path);
+void dvr_close_archive(dvr_archive* archive);
+
+bool dvr_archive_contains(const dvr_archive* archive, const char* name);
+/// Contents of an uncompressed entry, pointing into the archive mapping.
+DVR_RESULT(dvr_range) dvr_archive_view(const dvr_archive* archive, const char* name);
+/// Copy of an entry, decompressed if needed. Free with `dvr_free_file`.
+DVR_RESULT(dvr_range) dvr_archive_read(const dvr_archive* archive, const char* name);
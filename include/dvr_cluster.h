@@ -0,0 +1,65 @@
+#pragma once
+
+/// Cluster culling
+///
+/// Meshes are split into meshlets with a bounding sphere and a normal cone each. A compute
+/// pass tests every meshlet against the frustum and the cone and compacts the indices of the
+/// visible ones into an index buffer drawn with a single indirect draw, so hidden and back
+/// facing parts of a mesh never reach the vertex shader.
+
+#include "dvr.h"
+
+typedef struct dvr_cluster_mesh_desc {
+    /// Triangle list, relative to the vertex buffer the clusters are drawn with.
+    const u32* indices;
+    usize index_count;
+    /// Three floats at the start of every `position_stride` bytes, in mesh space.
+    const f32* positions;
+    usize vertex_count;
+    usize position_stride;
+} dvr_cluster_mesh_desc;
+
+typedef struct dvr_cluster_mesh {
+    u32 num_meshlets;
+    u32 num_indices;
+    dvr_buffer meshlet_buffer;
+    /// Indices of every meshlet in meshlet order, the input of the culling pass.
+    dvr_buffer source_index_buffer;
+    /// Indices of the visible meshlets, written by the culling pass.
+    dvr_buffer index_buffer;
+    /// VkDrawIndexedIndirectCommand, reset and filled by the culling pass.
+    dvr_buffer draw_buffer;
+    dvr_descriptor_set descriptor_set;
+} dvr_cluster_mesh;
+DVR_RESULT_DEF(dvr_cluster_mesh);
+
+typedef struct dvr_cluster_view {
+    /// Clip space transform of the mesh, the frustum planes are taken from it.
+    mat4 model_view_proj;
+    /// Camera position in mesh space.
+    vec3 camera_position;
+    /// Also cull meshlets facing away from the camera, leave off for double sided meshes.
+    bool cone_culling;
+} dvr_cluster_view;
+
+/// Normalized frustum planes of a column major clip space transform, Vulkan depth range. A
+/// sphere is outside when `dot(plane.xyz, center) + plane.w < -radius` for any of them.
+void dvr_frustum_planes(const vec4* m, f32 planes[6][4]);
+
+/// Create the culling pipeline, call after `dvr_setup`.
+DVR_RESULT(dvr_none) dvr_cluster_setup(void);
+/// Call before `dvr_shutdown`.
+void dvr_cluster_shutdown(void);
+
+/// Build the meshlets of a triangle list and upload them with their bounds. The indices are
+/// reordered for the vertex cache first, the input is left untouched.
+DVR_RESULT(dvr_cluster_mesh) dvr_create_cluster_mesh(dvr_cluster_mesh_desc* desc);
+void dvr_destroy_cluster_mesh(dvr_cluster_mesh* mesh);
+
+/// Record the culling dispatch. Use it in a compute pass of a render graph that writes the
+/// index and draw buffers, or between `dvr_begin_compute` and `dvr_end_compute`. Only one
+/// view per mesh and frame, the draw buffer is reset from the CPU.
+void dvr_cull_clusters(const dvr_cluster_mesh* mesh, const dvr_cluster_view* view);
+/// Bind the compacted index buffer and draw the visible meshlets. The vertex buffers and the
+/// graphics pipeline are bound by the caller.
+void dvr_draw_clusters(const dvr_cluster_mesh* mesh);
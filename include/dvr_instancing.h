@@ -0,0 +1,79 @@
+#pragma once
+
+/// Hardware instancing
+///
+/// Per-instance data is streamed through a vertex binding that advances once per instance, so
+/// thousands of copies of a mesh are drawn by a single draw call per submesh instead of one
+/// descriptor set and uniform buffer per copy.
+
+#include "dvr.h"
+#include "dvr_mesh.h"
+
+#define DVR_VERTEX_INPUT_MAX_BINDINGS 16
+#define DVR_VERTEX_INPUT_MAX_ATTRIBUTES 16
+
+/// Vertex input assembled binding by binding, e.g. the streams of a mesh followed by an
+/// instance binding. Owns its descriptions, the desc returned by `dvr_vertex_input_desc`
+/// points into it.
+typedef struct dvr_vertex_input {
+    u32 num_bindings;
+    VkVertexInputBindingDescription bindings[DVR_VERTEX_INPUT_MAX_BINDINGS];
+    u32 num_attributes;
+    VkVertexInputAttributeDescription attributes[DVR_VERTEX_INPUT_MAX_ATTRIBUTES];
+} dvr_vertex_input;
+
+/// Copy the bindings and attributes of `desc`, e.g. `dvr_mesh_vertex_input`.
+void dvr_vertex_input_append(dvr_vertex_input* input, dvr_vertex_input_state_desc desc);
+/// Add a binding of `stride` bytes that advances once per instance, returns its index.
+u32 dvr_vertex_input_add_instance_binding(dvr_vertex_input* input, u32 stride);
+void dvr_vertex_input_add_attribute(
+    dvr_vertex_input* input,
+    u32 binding,
+    u32 location,
+    VkFormat format,
+    u32 offset
+);
+/// A column major mat4 takes four vec4 attributes, at `location` to `location + 3`.
+void dvr_vertex_input_add_mat4(dvr_vertex_input* input, u32 binding, u32 location, u32 offset);
+dvr_vertex_input_state_desc dvr_vertex_input_desc(dvr_vertex_input* input);
+
+typedef struct dvr_instance_buffer_desc {
+    /// Size of the data of one instance.
+    u32 stride;
+    /// Instances one frame can push.
+    u32 capacity;
+    /// Vertex binding the instance data is bound to.
+    u32 binding;
+} dvr_instance_buffer_desc;
+
+/// Host visible buffer refilled every frame, instances pushed in a new frame replace the
+/// ones of the previous frame.
+typedef struct dvr_instance_buffer {
+    dvr_buffer buffer;
+    u32 stride;
+    u32 capacity;
+    u32 binding;
+    u32 count;
+    u64 frame_index;
+} dvr_instance_buffer;
+DVR_RESULT_DEF(dvr_instance_buffer);
+
+/// Instances pushed together, drawn with `first_instance`.
+typedef struct dvr_instance_range {
+    u32 first_instance;
+    u32 instance_count;
+} dvr_instance_range;
+DVR_RESULT_DEF(dvr_instance_range);
+
+DVR_RESULT(dvr_instance_buffer) dvr_create_instance_buffer(dvr_instance_buffer_desc* desc);
+void dvr_destroy_instance_buffer(dvr_instance_buffer* instances);
+
+/// Copy `count` instances of `stride` bytes from `data` into this frame's instances.
+DVR_RESULT(dvr_instance_range)
+dvr_push_instances(dvr_instance_buffer* instances, const void* data, u32 count);
+/// Bind the instance data at its binding, alongside the vertex buffers of the mesh.
+void dvr_bind_instance_buffer(const dvr_instance_buffer* instances);
+
+/// Draw one LOD of one submesh for every instance of `range`. The mesh and the instance
+/// buffer have to be bound.
+void dvr_draw_instanced(const dvr_mesh* mesh, u32 submesh, u32 lod, dvr_instance_range range);
@@ -0,0 +1,68 @@
+#pragma once
+
+/// Background asset loading
+///
+/// Files are read, decompressed and decoded on worker threads. Finished loads are turned into
+/// dvr resources by `dvr_loader_update` on the main thread, which records their uploads into
+/// the frame command buffer, so the render loop never blocks on a load.
+
+#include "dvr.h"
+#include "dvr_archive.h"
+
+typedef enum dvr_load_kind {
+    /// DVRT or KTX2 texture, see dvr_texture.h.
+    DVR_LOAD_KIND_TEXTURE,
+    /// Raw bytes, or the output of `decode`, uploaded into a static buffer.
+    DVR_LOAD_KIND_BUFFER,
+} dvr_load_kind;
+
+typedef enum dvr_load_state {
+    DVR_LOAD_STATE_PENDING,
+    DVR_LOAD_STATE_READY,
+    DVR_LOAD_STATE_FAILED,
+} dvr_load_state;
+
+typedef struct dvr_load_desc {
+    dvr_load_kind kind;
+    /// File to load, or the name of the entry in `archive`. Copied.
+    const char* path;
+    /// Load from an archive, which has to stay open until the load finished.
+    const dvr_archive* archive;
+    /// Usage of the created buffer, TRANSFER_DST is added.
+    dvr_buffer_usage buffer_usage;
+    /// Optional, runs on a worker with the file contents and returns the bytes to load in a
+    /// malloc'd range. Has to be thread safe.
+    dvr_result_dvr_range_t (*decode)(dvr_range data, void* user_data);
+    void* user_data;
+} dvr_load_desc;
+
+typedef struct dvr_load {
+    u16 id;
+} dvr_load;
+DVR_RESULT_DEF(dvr_load);
+
+typedef struct dvr_loader_desc {
+    /// Worker threads, 0 uses one less than the number of cores.
+    u32 num_threads;
+    /// Bytes uploaded by one `dvr_loader_update`, 0 defaults to 64 MiB. A single larger load
+    /// still goes through on its own.
+    usize upload_budget;
+} dvr_loader_desc;
+
+DVR_RESULT(dvr_none) dvr_loader_setup(dvr_loader_desc* desc);
+/// Joins the workers and drops unfinished loads, call before `dvr_shutdown`. Resources of
+/// finished loads belong to the caller.
+void dvr_loader_shutdown(void);
+
+DVR_RESULT(dvr_load) dvr_load_async(dvr_load_desc* desc);
+/// Create the resources of finished loads and record their uploads. Call once per frame
+/// after `dvr_begin_frame`, outside of render passes.
+void dvr_loader_update(void);
+
+dvr_load_state dvr_load_get_state(dvr_load load);
+/// Resource of a ready load.
+dvr_image dvr_load_get_image(dvr_load load);
+dvr_buffer dvr_load_get_buffer(dvr_load load);
+const char* dvr_load_get_error(dvr_load load);
+/// Forget a load, a pending one is cancelled. The resource of a ready load is not destroyed.
+void dvr_release_load(dvr_load load);
@@ -0,0 +1,192 @@
+#pragma once
+
+/// Loading of cooked meshes, vertex and index data are copied into buffers as they are stored,
+/// without any parsing at runtime.
+
+#include "dvr.h"
+
+#define DVR_MESH_MAX_STREAMS 8
+#define DVR_MESH_MAX_ATTRIBUTES 8
+
+/// DVRM, the container written by the dvr_meshcook tool: a header, the attribute, stream and
+/// submesh tables and the stream and index data, each blob aligned to `DVR_DVRM_ALIGNMENT`.
+/// Everything is little endian. A stream holds one or more attributes interleaved with its
+/// stride, so a file can be fully interleaved, one stream per attribute or anything between.
+/// Quantized positions are stored as unorm16, their mesh space position is
+/// `position_offset + position_scale * stored`, see dvr_quantize.h for the other encodings.
+/// Every submesh owns a chain of LODs, index ranges over the shared vertices from full detail
+/// to coarsest, which come after the full detail indices of every submesh.
+#define DVR_DVRM_MAGIC 0x4D525644u // "DVRM"
+#define DVR_DVRM_VERSION 3
+#define DVR_DVRM_ALIGNMENT 16
+
+/// Vertex attribute semantic, also the shader input location the attribute is bound to.
+typedef enum dvr_mesh_attribute {
+    DVR_MESH_ATTRIBUTE_POSITION = 0,
+    DVR_MESH_ATTRIBUTE_COLOR = 1,
+    DVR_MESH_ATTRIBUTE_UV = 2,
+    DVR_MESH_ATTRIBUTE_NORMAL = 3,
+    DVR_MESH_ATTRIBUTE_COUNT,
+} dvr_mesh_attribute;
+
+typedef struct dvr_dvrm_header {
+    u32 magic;
+    u32 version;
+    u32 num_vertices;
+    u32 num_indices;
+    /// 2 or 4 bytes.
+    u32 index_size;
+    u32 num_attributes;
+    u32 num_streams;
+    u32 num_submeshes;
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    f32 position_scale[3];
+    f32 position_offset[3];
+    u32 num_lods;
+    u32 reserved;
+    u64 attributes_offset;
+    u64 streams_offset;
+    u64 submeshes_offset;
+    u64 lods_offset;
+    u64 indices_offset;
+} dvr_dvrm_header;
+
+typedef struct dvr_dvrm_attribute {
+    /// `dvr_mesh_attribute`
+    u32 semantic;
+    /// VkFormat
+    u32 format;
+    u32 stream;
+    u32 offset;
+} dvr_dvrm_attribute;
+
+typedef struct dvr_dvrm_stream {
+    u64 offset;
+    u32 stride;
+    u32 reserved;
+} dvr_dvrm_stream;
+
+/// Range of the index buffer drawn on its own, indices are relative to `vertex_offset`.
+typedef struct dvr_dvrm_submesh {
+    u32 first_index;
+    u32 index_count;
+    u32 vertex_offset;
+    u32 vertex_count;
+    /// LODs of the submesh in the LOD table, the first one is the full detail range.
+    u32 first_lod;
+    u32 num_lods;
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+} dvr_dvrm_submesh;
+
+typedef struct dvr_dvrm_lod {
+    u32 first_index;
+    u32 index_count;
+    /// Largest distance the simplification moved the surface, in mesh units.
+    f32 error;
+    u32 reserved;
+} dvr_dvrm_lod;
+
+typedef struct dvr_mesh_file {
+    /// Backing file contents, every range points into it.
+    dvr_range file;
+    u32 num_vertices;
+    u32 num_indices;
+    VkIndexType index_type;
+    dvr_range indices;
+    u32 num_streams;
+    dvr_range streams[DVR_MESH_MAX_STREAMS];
+    u32 strides[DVR_MESH_MAX_STREAMS];
+    u32 num_attributes;
+    dvr_dvrm_attribute attributes[DVR_MESH_MAX_ATTRIBUTES];
+    u32 num_submeshes;
+    const dvr_dvrm_submesh* submeshes;
+    u32 num_lods;
+    const dvr_dvrm_lod* lods;
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    f32 position_scale[3];
+    f32 position_offset[3];
+} dvr_mesh_file;
+DVR_RESULT_DEF(dvr_mesh_file);
+
+typedef struct dvr_mesh {
+    u32 num_streams;
+    dvr_buffer vertex_buffers[DVR_MESH_MAX_STREAMS];
+    dvr_buffer index_buffer;
+    VkIndexType index_type;
+    u32 num_indices;
+    u32 num_submeshes;
+    dvr_dvrm_submesh* submeshes;
+    u32 num_lods;
+    dvr_dvrm_lod* lods;
+    u32 num_attributes;
+    VkVertexInputBindingDescription bindings[DVR_MESH_MAX_STREAMS];
+    VkVertexInputAttributeDescription attributes[DVR_MESH_MAX_ATTRIBUTES];
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    f32 position_scale[3];
+    f32 position_offset[3];
+} dvr_mesh;
+DVR_RESULT_DEF(dvr_mesh);
+
+/// Preset for vertices built at runtime, the packed formats of dvr_quantize.h in one stream.
+/// 20 bytes against 48 for the same attributes as floats.
+typedef struct dvr_packed_vertex {
+    /// R16G16B16A16_UNORM, dequantized with `dvr_mesh_position_transform` or its own transform.
+    u16 position[4];
+    /// R16G16_SNORM, octahedral.
+    i16 normal[2];
+    /// R16G16_SFLOAT
+    u16 uv[2];
+    /// R8G8B8A8_UNORM
+    u8 color[4];
+} dvr_packed_vertex;
+
+/// Vertex input for `dvr_packed_vertex` on binding 0, at the `dvr_mesh_attribute` locations.
+dvr_vertex_input_state_desc dvr_packed_vertex_input(void);
+
+/// Parse a DVRM file. The result references `file`, which has to outlive it.
+DVR_RESULT(dvr_mesh_file) dvr_parse_mesh(dvr_range file);
+/// Static vertex buffers, one per stream, and an index buffer with the data of the file.
+DVR_RESULT(dvr_mesh) dvr_create_mesh(const dvr_mesh_file* mesh_file);
+/// Parse and upload a DVRM file already in memory, `data` can be freed afterwards.
+DVR_RESULT(dvr_mesh) dvr_load_mesh_from_memory(dvr_range data);
+/// Map, parse and upload a DVRM file in one go.
+DVR_RESULT(dvr_mesh) dvr_load_mesh(const char* path);
+void dvr_destroy_mesh(dvr_mesh* mesh);
+
+/// Vertex input matching the streams of the mesh, pointing into it.
+dvr_vertex_input_state_desc dvr_mesh_vertex_input(dvr_mesh* mesh);
+/// Maps the stored positions into mesh space, multiply it into the model matrix to
+/// dequantize positions for free in the vertex shader. Identity for float positions.
+void dvr_mesh_position_transform(const dvr_mesh* mesh, mat4 dst);
+
+/// Pixels one mesh unit covers at a distance of one, for a perspective projection with a
+/// vertical field of view of `fov_y` radians.
+f32 dvr_lod_pixel_scale(f32 fov_y, f32 viewport_height);
+/// Coarsest LOD of the submesh whose error stays below `max_pixel_error` pixels when seen from
+/// `distance` mesh units away. Divide the distance by the scale of instances scaled up.
+u32 dvr_select_mesh_lod(
+    const dvr_mesh* mesh,
+    u32 submesh,
+    f32 distance,
+    f32 pixel_scale,
+    f32 max_pixel_error
+);
+
+/// Bind every vertex stream and the index buffer.
+void dvr_bind_mesh(const dvr_mesh* mesh);
+/// Draw every submesh at full detail, the mesh has to be bound.
+void dvr_draw_mesh(const dvr_mesh* mesh, u32 instance_count);
+/// Draw one LOD of one submesh, the mesh has to be bound.
+void dvr_draw_submesh(const dvr_mesh* mesh, u32 submesh, u32 lod, u32 instance_count);
+/// `dvr_draw_submesh` starting at `first_instance` of the bound instance rate streams.
+void dvr_draw_submesh_instances(
+    const dvr_mesh* mesh,
+    u32 submesh,
+    u32 lod,
+    u32 instance_count,
+    u32 first_instance
+);
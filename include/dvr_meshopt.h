@@ -0,0 +1,134 @@
+#pragma once
+
+/// Index and vertex buffer reordering for the post-transform vertex cache, overdraw and
+/// vertex fetch locality. Pure CPU functions, usable from tools and at load time.
+///
+/// Indices are relative to the vertex buffer they are passed with. `dst` may alias `indices`
+/// for every function that produces indices.
+
+#include "dvr_types.h"
+
+/// Cache size the optimizations target, small enough to fit any GPU.
+#define DVR_VERTEX_CACHE_SIZE 16
+/// Cache efficiency the overdraw optimization may give up, as a ratio of the ACMR.
+#define DVR_OVERDRAW_THRESHOLD 1.05f
+
+typedef struct dvr_vertex_cache_stats {
+    u32 vertices_transformed;
+    /// Average cache miss ratio, transformed vertices per triangle. 0.5 at best, 3 at worst.
+    f32 acmr;
+    /// Average transform to vertex ratio, 1 means every vertex is transformed once.
+    f32 atvr;
+} dvr_vertex_cache_stats;
+
+/// Simulate a FIFO post-transform cache of `cache_size` entries over the index buffer.
+dvr_vertex_cache_stats dvr_analyze_vertex_cache(
+    const u32* indices,
+    usize index_count,
+    usize vertex_count,
+    u32 cache_size
+);
+
+/// Reorder triangles for vertex cache hits (Tipsify, Sander et al. 2007).
+void dvr_optimize_vertex_cache(
+    u32* dst,
+    const u32* indices,
+    usize index_count,
+    usize vertex_count
+);
+
+/// Reorder clusters of an already cache optimized index buffer so outward facing clusters are
+/// drawn first, giving up at most `threshold` of the cache efficiency. `positions` holds three
+/// floats at the start of every `position_stride` bytes.
+void dvr_optimize_overdraw(
+    u32* dst,
+    const u32* indices,
+    usize index_count,
+    const f32* positions,
+    usize vertex_count,
+    usize position_stride,
+    f32 threshold
+);
+
+/// Remap table that orders vertices by their first use in the index buffer, unused vertices
+/// map to UINT32_MAX. Returns the number of used vertices.
+usize dvr_optimize_vertex_fetch_remap(
+    u32* remap,
+    const u32* indices,
+    usize index_count,
+    usize vertex_count
+);
+void dvr_remap_index_buffer(u32* dst, const u32* indices, usize index_count, const u32* remap);
+/// `dst` holds one vertex per used vertex of the remap table and may not alias `vertices`.
+void dvr_remap_vertex_buffer(
+    void* dst,
+    const void* vertices,
+    usize vertex_count,
+    usize vertex_size,
+    const u32* remap
+);
+
+/// Collapse edges by increasing quadric error (Garland and Heckbert 1997) until the index count
+/// reaches `target_index_count` or the next collapse would move the surface more than
+/// `target_error` mesh units. Vertices only move onto their neighbours, so the result indexes
+/// the same vertex buffer; borders and attribute seams are kept. Returns the new index count,
+/// `result_error` receives the largest error any collapse introduced and may be NULL.
+usize dvr_simplify(
+    u32* dst,
+    const u32* indices,
+    usize index_count,
+    const f32* positions,
+    usize vertex_count,
+    usize position_stride,
+    usize target_index_count,
+    f32 target_error,
+    f32* result_error
+);
+
+/// Cluster limits that fit the 8-bit local indices of a meshlet and common mesh shader output
+/// limits, 124 triangles keep the triangle list of a meshlet within 372 bytes.
+#define DVR_MESHLET_MAX_VERTICES 64
+#define DVR_MESHLET_MAX_TRIANGLES 124
+
+/// A cluster of triangles, `vertex_count` entries of the meshlet vertex list starting at
+/// `vertex_offset` and `triangle_count` triangles of three local 8-bit indices into them.
+typedef struct dvr_meshlet {
+    u32 vertex_offset;
+    u32 triangle_offset;
+    u32 vertex_count;
+    u32 triangle_count;
+} dvr_meshlet;
+
+/// Culling volumes of a meshlet. The whole meshlet faces away from a camera at `camera` when
+/// `dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius`.
+typedef struct dvr_meshlet_bounds {
+    f32 center[3];
+    f32 radius;
+    f32 cone_axis[3];
+    /// Sine of the cone half angle, 1 for meshlets too curved to ever be culled by the cone.
+    f32 cone_cutoff;
+} dvr_meshlet_bounds;
+
+/// Upper bound of the meshlets `dvr_build_meshlets` produces, to size its outputs. The vertex
+/// list needs room for `max_meshlets * max_vertices` and the triangles for
+/// `max_meshlets * max_triangles * 3` entries.
+usize dvr_build_meshlets_bound(usize index_count, usize max_vertices, usize max_triangles);
+/// Split the index buffer into meshlets in order, run `dvr_optimize_vertex_cache` first for
+/// compact clusters. Returns the number of meshlets.
+usize dvr_build_meshlets(
+    dvr_meshlet* meshlets,
+    u32* meshlet_vertices,
+    u8* meshlet_triangles,
+    const u32* indices,
+    usize index_count,
+    usize vertex_count,
+    usize max_vertices,
+    usize max_triangles
+);
+dvr_meshlet_bounds dvr_compute_meshlet_bounds(
+    const dvr_meshlet* meshlet,
+    const u32* meshlet_vertices,
+    const u8* meshlet_triangles,
+    const f32* positions,
+    usize position_stride
+);
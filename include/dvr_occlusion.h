@@ -0,0 +1,88 @@
+#pragma once
+
+/// Occlusion culling
+///
+/// Instances are tested against the frustum and against the depth pyramid the previous frame
+/// left behind, then the data of the visible ones is compacted into a vertex buffer drawn by
+/// indirect draws whose instance counts the test wrote. Instances hidden behind what was drawn
+/// last frame never reach the rasterizer. Needs `dvr_setup_desc.depth_pyramid`, the pyramid
+/// has to be rebuilt every frame with `dvr_build_depth_pyramid` once the swapchain pass ended.
+
+#include "dvr.h"
+
+#define DVR_OCCLUSION_MAX_DRAWS 8
+
+/// Indexed draw every visible instance is drawn with, e.g. one LOD of a submesh.
+typedef struct dvr_occlusion_draw {
+    u32 index_count;
+    u32 first_index;
+    i32 vertex_offset;
+} dvr_occlusion_draw;
+
+typedef struct dvr_occlusion_batch_desc {
+    /// Instances one frame can push.
+    u32 max_instances;
+    /// Size of the data of one instance, a multiple of 4.
+    u32 instance_stride;
+    /// Vertex binding the visible instances are bound to.
+    u32 binding;
+    u32 num_draws;
+    dvr_occlusion_draw draws[DVR_OCCLUSION_MAX_DRAWS];
+} dvr_occlusion_batch_desc;
+
+/// Instances of one mesh culled together, refilled every frame like `dvr_instance_buffer`.
+typedef struct dvr_occlusion_batch {
+    u32 max_instances;
+    u32 instance_stride;
+    u32 binding;
+    u32 num_draws;
+    dvr_occlusion_draw draws[DVR_OCCLUSION_MAX_DRAWS];
+    u32 count;
+    u64 frame_index;
+    /// World space bounding spheres, x y z and radius.
+    dvr_buffer bounds_buffer;
+    dvr_buffer instance_buffer;
+    /// Data of the visible instances, written by the culling pass.
+    dvr_buffer visible_buffer;
+    /// One VkDrawIndexedIndirectCommand per draw, reset and counted by the culling pass.
+    dvr_buffer draw_buffer;
+    dvr_buffer uniform_buffer;
+    dvr_descriptor_set descriptor_set;
+    /// Generation of the depth pyramid the descriptor set references, 0 before the first cull.
+    u32 pyramid_generation;
+} dvr_occlusion_batch;
+DVR_RESULT_DEF(dvr_occlusion_batch);
+
+typedef struct dvr_occlusion_view {
+    /// World to clip space of the frame being drawn, the frustum planes are taken from it.
+    mat4 view_proj;
+    /// World to clip space of the previous frame, which the depth pyramid holds the depth of.
+    mat4 previous_view_proj;
+    /// Only test against the frustum, e.g. after a camera cut.
+    bool disable_occlusion;
+} dvr_occlusion_view;
+
+/// Create the culling pipeline, call after `dvr_setup`.
+DVR_RESULT(dvr_none) dvr_occlusion_setup(void);
+/// Call before `dvr_shutdown`.
+void dvr_occlusion_shutdown(void);
+
+DVR_RESULT(dvr_occlusion_batch) dvr_create_occlusion_batch(dvr_occlusion_batch_desc* desc);
+void dvr_destroy_occlusion_batch(dvr_occlusion_batch* batch);
+
+/// Copy `count` instances of `instance_stride` bytes from `data` and a bounding sphere per
+/// instance into this frame's batch.
+DVR_RESULT(dvr_none) dvr_push_occlusion_instances(
+    dvr_occlusion_batch* batch,
+    const void* data,
+    const vec4* spheres,
+    u32 count
+);
+/// Record the culling dispatch, like `dvr_cull_clusters` in a compute pass of a render graph
+/// or between `dvr_begin_compute` and `dvr_end_compute`. Once per batch and frame, the draws
+/// are reset from the CPU. Before the pyramid was first built only the frustum is tested.
+DVR_RESULT(dvr_none)
+dvr_cull_occlusion_batch(dvr_occlusion_batch* batch, const dvr_occlusion_view* view);
+/// Bind the visible instances and draw them with every draw of the batch. The mesh and the
+/// graphics pipeline are bound by the caller.
+void dvr_draw_occlusion_batch(const dvr_occlusion_batch* batch);
@@ -0,0 +1,44 @@
+#pragma once
+
+/// Conversion of vertex attributes into packed formats, pure CPU functions usable from tools
+/// and at load time. Every quantizer rounds to nearest and clamps to the range of its format.
+///
+/// Typical packing, matching `dvr_packed_vertex`:
+/// - positions as R16G16B16A16_UNORM relative to the mesh bounds, see `dvr_position_quantization`
+/// - normals octahedral encoded as R16G16_SNORM
+/// - UVs as R16G16_UNORM when they stay inside [0, 1], R16G16_SFLOAT otherwise
+/// - colors as R8G8B8A8_UNORM
+
+#include "dvr_types.h"
+
+/// Nearest IEEE half, overflowing to infinity.
+u16 dvr_quantize_half(f32 v);
+f32 dvr_dequantize_half(u16 v);
+u16 dvr_quantize_unorm16(f32 v);
+i16 dvr_quantize_snorm16(f32 v);
+u8 dvr_quantize_unorm8(f32 v);
+i8 dvr_quantize_snorm8(f32 v);
+
+/// Octahedral mapping of a unit vector onto [-1, 1]^2 (Cigolle et al. 2014). Decode in GLSL:
+///     vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+///     float t = max(-n.z, 0.0);
+///     n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+///     n = normalize(n);
+void dvr_encode_octahedral(const f32 normal[3], f32 dst[2]);
+void dvr_decode_octahedral(const f32 encoded[2], f32 dst[3]);
+
+/// Maps unorm16 positions back into mesh space, `position = offset + scale * stored`.
+typedef struct dvr_position_quantization {
+    f32 scale[3];
+    f32 offset[3];
+} dvr_position_quantization;
+
+/// Quantization covering the bounds, flat axes get a scale of 0.
+dvr_position_quantization
+    dvr_position_quantization_from_bounds(const f32 bounds_min[3], const f32 bounds_max[3]);
+/// Four components, w is always 1 as three component 16 bit formats are rarely supported.
+void dvr_quantize_position(
+    const dvr_position_quantization* quantization,
+    const f32 position[3],
+    u16 dst[4]
+);
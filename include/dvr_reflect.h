@@ -0,0 +1,51 @@
+#pragma once
+
+/// SPIR-V reflection of the interface of a shader: descriptor bindings, the push constant
+/// block, workgroup size and vertex inputs. Only the first entry point of a module is
+/// described, and the parser understands exactly what glslc emits for Vulkan GLSL.
+
+#include "dvr.h"
+
+#define DVR_SHADER_MAX_BINDINGS 32
+#define DVR_SHADER_MAX_VERTEX_INPUTS 16
+/// Highest descriptor set index + 1 a reflected pipeline layout can have.
+#define DVR_SHADER_MAX_DESCRIPTOR_SETS 4
+
+typedef struct dvr_shader_binding {
+    u32 set;
+    u32 binding;
+    /// Uniform buffers are never reflected as dynamic.
+    VkDescriptorType type;
+    u32 count;
+} dvr_shader_binding;
+DVR_RESULT_DEF(dvr_shader_binding);
+
+typedef struct dvr_shader_vertex_input {
+    u32 location;
+    /// 32-bit float, int and uint scalars and vectors, undefined for everything else.
+    VkFormat format;
+} dvr_shader_vertex_input;
+
+typedef struct dvr_shader_reflection {
+    VkShaderStageFlagBits stage;
+    /// Local size of compute shaders, 0 for other stages. Sizes set through specialization
+    /// constants are reported with their default value.
+    u32 workgroup_size[3];
+    /// Specialization constant id of every dimension, UINT32_MAX for fixed dimensions.
+    u32 workgroup_size_spec_ids[3];
+    /// Sorted by set, then binding.
+    u32 num_bindings;
+    dvr_shader_binding bindings[DVR_SHADER_MAX_BINDINGS];
+    /// Bytes of the push constant block covered by its members, size 0 without one.
+    u32 push_constant_offset;
+    u32 push_constant_size;
+    /// Inputs of vertex shaders with a location, sorted by location. Matrices have an input
+    /// per column.
+    u32 num_vertex_inputs;
+    dvr_shader_vertex_input vertex_inputs[DVR_SHADER_MAX_VERTEX_INPUTS];
+} dvr_shader_reflection;
+
+DVR_RESULT(dvr_none) dvr_reflect_shader(dvr_range code, dvr_shader_reflection* reflection);
+/// Reflection of a module taken by `dvr_create_shader_module`, NULL when the module couldn't
+/// be reflected.
+const dvr_shader_reflection* dvr_get_shader_reflection(dvr_shader_module module);
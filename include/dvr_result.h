@@ -157,3 +157,4 @@ DVR_RESULT_DEF(dvr_none);
 DVR_RESULT_DEF(i32);
 DVR_RESULT_DEF(u32);
 DVR_RESULT_DEF(dvr_range);
+DVR_RESULT_DEF(dvr_mapped_file);
@@ -0,0 +1,53 @@
+#pragma once
+
+/// Shader hot reload
+///
+/// Watches the GLSL sources of pipelines with inotify and recompiles changed ones with glslc on
+/// a background thread. `dvr_update_shaders` then recreates every pipeline using a recompiled
+/// source and swaps it into the existing handle, so a saved shader shows up within a frame
+/// without restarting. A source that fails to compile logs the compiler output and keeps the
+/// previous pipeline. Only available on Linux.
+
+#include "dvr.h"
+
+/// Vertex, tessellation control and evaluation, geometry and fragment.
+#define DVR_SHADER_MANAGER_MAX_STAGES 5
+
+typedef struct dvr_shader_manager_desc {
+    /// Compiler invoked as `compiler -fshader-stage=<stage> [args] <source> -o <output>`, NULL
+    /// looks up glslc in PATH.
+    const char* compiler;
+    /// Extra arguments, e.g. include directories or defines. Copied.
+    u32 num_args;
+    const char* const* args;
+    /// Directory the compiled SPIR-V is written to, NULL uses /tmp.
+    const char* output_dir;
+} dvr_shader_manager_desc;
+
+/// Start the watcher thread, call after `dvr_setup`.
+DVR_RESULT(dvr_none) dvr_shader_manager_setup(dvr_shader_manager_desc* desc);
+/// Call before `dvr_shutdown`.
+void dvr_shader_manager_shutdown(void);
+
+/// Recreate `pipeline` from `desc` whenever the source of one of its stages changes. `sources`
+/// has a GLSL path per stage of `desc`, NULL for stages that aren't watched. Everything `desc`
+/// points to is copied, the shader modules of unwatched stages, or of watched stages that
+/// didn't change yet, have to stay alive until the pipeline is unwatched.
+DVR_RESULT(dvr_none) dvr_watch_pipeline(
+    dvr_pipeline pipeline,
+    const dvr_pipeline_desc* desc,
+    const char* const* sources
+);
+DVR_RESULT(dvr_none) dvr_watch_compute_pipeline(
+    dvr_compute_pipeline pipeline,
+    const dvr_compute_pipeline_desc* desc,
+    const char* source
+);
+/// Stop recreating a pipeline, before destroying it.
+void dvr_unwatch_pipeline(dvr_pipeline pipeline);
+void dvr_unwatch_compute_pipeline(dvr_compute_pipeline pipeline);
+
+/// Swap in the pipelines of every source compiled since the last call. Call once per frame on
+/// the main thread, old pipelines are destroyed once the frames that used them completed.
+/// Returns the number of pipelines replaced.
+u32 dvr_update_shaders(void);
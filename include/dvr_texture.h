@@ -0,0 +1,56 @@
+#pragma once
+
+/// Loading of preprocessed textures, uploaded as-is with every mip level and without any CPU
+/// side decoding.
+
+#include "dvr.h"
+
+#define DVR_TEXTURE_MAX_LEVELS 16
+
+/// DVRT, the container written by the dvr_texcook tool: a header, one `dvr_dvrt_level` per mip
+/// level and the level data, each level aligned to `DVR_DVRT_ALIGNMENT`. Everything is little
+/// endian and the level data is already in the layout `dvr_create_image` uploads.
+#define DVR_DVRT_MAGIC 0x54525644u // "DVRT"
+#define DVR_DVRT_VERSION 1
+#define DVR_DVRT_ALIGNMENT 16
+
+typedef struct dvr_dvrt_header {
+    u32 magic;
+    u32 version;
+    u32 format;
+    u32 width;
+    u32 height;
+    u32 mip_levels;
+} dvr_dvrt_header;
+
+typedef struct dvr_dvrt_level {
+    u64 offset;
+    u64 size;
+} dvr_dvrt_level;
+
+typedef struct dvr_texture_file {
+    /// Backing file contents, level ranges point into it.
+    dvr_range file;
+    VkFormat format;
+    u32 width;
+    u32 height;
+    u32 mip_levels;
+    dvr_image_level levels[DVR_TEXTURE_MAX_LEVELS];
+    /// The file only holds the base level and asks for the rest to be generated on upload.
+    bool generate_mipmaps;
+} dvr_texture_file;
+DVR_RESULT_DEF(dvr_texture_file);
+
+/// Parse a KTX2 container holding a single 2D texture without supercompression. The result
+/// references `file`, which has to outlive it.
+DVR_RESULT(dvr_texture_file) dvr_parse_ktx2(dvr_range file);
+/// Parse a DVRT file, with the same lifetime rules as `dvr_parse_ktx2`.
+DVR_RESULT(dvr_texture_file) dvr_parse_dvrt(dvr_range file);
+/// Parse either container, picked by its magic.
+DVR_RESULT(dvr_texture_file) dvr_parse_texture(dvr_range file);
+/// Sampled, device local image with every level of the texture.
+DVR_RESULT(dvr_image) dvr_create_image_from_texture(const dvr_texture_file* texture);
+/// Parse and upload a DVRT or KTX2 file already in memory, `data` can be freed afterwards.
+DVR_RESULT(dvr_image) dvr_load_texture_from_memory(dvr_range data);
+/// Read, parse and upload a DVRT or KTX2 file in one go.
+DVR_RESULT(dvr_image) dvr_load_texture(const char* path);
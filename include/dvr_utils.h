@@ -50,5 +50,30 @@ typedef struct dvr_range {
 typedef struct dvr_result_dvr_range dvr_result_dvr_range_t;
 
 dvr_result_dvr_range_t dvr_read_file(const char* path);
-dvr_result_dvr_range_t dvr_read_file_range(const char* path, usize offset, usize size);
+dvr_result_dvr_range_t dvr_read_file_range(const char* path, u64 offset, usize size);
 void dvr_free_file(dvr_range range);
+
+/// How a mapped file is going to be read, forwarded to the kernel as a paging hint.
+typedef enum dvr_file_access {
+    DVR_FILE_ACCESS_NORMAL,
+    DVR_FILE_ACCESS_SEQUENTIAL,
+    DVR_FILE_ACCESS_RANDOM,
+    /// Start reading the whole range in ahead of the first access.
+    DVR_FILE_ACCESS_WILLNEED,
+} dvr_file_access;
+
+typedef struct dvr_mapped_file {
+    /// The requested bytes, read-only.
+    dvr_range range;
+    // the mapping itself starts at a page boundary before the requested offset
+    void* mapping;
+    usize mapping_size;
+} dvr_mapped_file;
+
+typedef struct dvr_result_dvr_mapped_file dvr_result_dvr_mapped_file_t;
+
+/// Map `size` bytes of a file starting at `offset` read-only, 0 maps everything up to the end
+/// of the file. The range stays valid until `dvr_unmap_file`, the file handle is not kept open.
+dvr_result_dvr_mapped_file_t
+    dvr_map_file(const char* path, u64 offset, u64 size, dvr_file_access access);
+void dvr_unmap_file(dvr_mapped_file* file);
@@ -0,0 +1,223 @@
+#include "dvr_archive.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(dvr_archive_header) == 40, "unexpected padding in dvr_archive_header");
+_Static_assert(sizeof(dvr_archive_entry) == 48, "unexpected padding in dvr_archive_entry");
+
+/// LZ4 block decoder, every length and offset is checked against both buffers.
+static bool dvr_lz4_decompress(const u8* src, usize src_size, u8* dst, usize dst_size) {
+    const u8* ip = src;
+    const u8* ip_end = src + src_size;
+    u8* op = dst;
+    u8* op_end = dst + dst_size;
+
+    while (ip < ip_end) {
+        u32 token = *ip++;
+
+        usize literal_length = token >> 4;
+        if (literal_length == 15) {
+            u8 extra;
+            do {
+                if (ip >= ip_end) {
+                    return false;
+                }
+                extra = *ip++;
+                literal_length += extra;
+            } while (extra == 255);
+        }
+        if (literal_length > (usize)(ip_end - ip) || literal_length > (usize)(op_end - op)) {
+            return false;
+        }
+        memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        // the last sequence only carries literals
+        if (ip == ip_end) {
+            break;
+        }
+
+        if (ip_end - ip < 2) {
+            return false;
+        }
+        usize offset = (usize)ip[0] | ((usize)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (usize)(op - dst)) {
+            return false;
+        }
+
+        usize match_length = token & 15;
+        if (match_length == 15) {
+            u8 extra;
+            do {
+                if (ip >= ip_end) {
+                    return false;
+                }
+                extra = *ip++;
+                match_length += extra;
+            } while (extra == 255);
+        }
+        match_length += 4;
+        if (match_length > (usize)(op_end - op)) {
+            return false;
+        }
+
+        // matches may overlap their own output
+        const u8* match = op - offset;
+        for (usize i = 0; i < match_length; i++) {
+            op[i] = match[i];
+        }
+        op += match_length;
+    }
+
+    return op == op_end;
+}
+
+static bool dvr_archive_section_fits(const dvr_archive* archive, u64 offset, u64 size) {
+    u64 file_size = archive->file.range.size;
+    return offset <= file_size && size <= file_size - offset && offset % 8 == 0;
+}
+
+DVR_RESULT(dvr_archive) dvr_open_archive(const char* path) {
+    DVR_RESULT(dvr_mapped_file) file_res = dvr_map_file(path, 0, 0, DVR_FILE_ACCESS_WILLNEED);
+    DVR_BUBBLE_INTO(dvr_archive, file_res);
+
+    dvr_archive archive = {
+        .file = DVR_UNWRAP(file_res),
+    };
+    const u8* bytes = archive.file.range.base;
+
+    const char* error = NULL;
+    if (archive.file.range.size < sizeof(dvr_archive_header)) {
+        error = "not a DVRA archive";
+    } else {
+        memcpy(&archive.header, bytes, sizeof(archive.header));
+        dvr_archive_header* header = &archive.header;
+
+        if (header->magic != DVR_ARCHIVE_MAGIC) {
+            error = "not a DVRA archive";
+        } else if (header->version != DVR_ARCHIVE_VERSION) {
+            error = "unsupported DVRA version, repack the archive";
+        } else if (header->bucket_bits > 24) {
+            error = "DVRA archive has too many buckets";
+        } else if (!dvr_archive_section_fits(
+                       &archive,
+                       header->buckets_offset,
+                       (((u64)1 << header->bucket_bits) + 1) * 4
+                   ) ||
+                   !dvr_archive_section_fits(
+                       &archive,
+                       header->entries_offset,
+                       (u64)header->num_entries * sizeof(dvr_archive_entry)
+                   ) ||
+                   header->names_offset > archive.file.range.size) {
+            error = "DVRA index lies outside of the archive";
+        }
+    }
+
+    if (error == NULL) {
+        archive.buckets = (const u32*)(bytes + archive.header.buckets_offset);
+        archive.entries = (const dvr_archive_entry*)(bytes + archive.header.entries_offset);
+        archive.names = (const char*)(bytes + archive.header.names_offset);
+
+        u64 names_size = archive.file.range.size - archive.header.names_offset;
+        u32 num_buckets = (1u << archive.header.bucket_bits) + 1;
+        for (u32 i = 0; error == NULL && i < num_buckets; i++) {
+            if (archive.buckets[i] > archive.header.num_entries ||
+                (i > 0 && archive.buckets[i] < archive.buckets[i - 1])) {
+                error = "DVRA bucket table is corrupt";
+            }
+        }
+        for (u32 i = 0; error == NULL && i < archive.header.num_entries; i++) {
+            const dvr_archive_entry* entry = &archive.entries[i];
+            if ((u64)entry->name_offset + entry->name_length > names_size ||
+                !dvr_archive_section_fits(&archive, entry->offset, entry->stored_size)) {
+                error = "DVRA entry lies outside of the archive";
+            } else if (entry->compression > DVR_ARCHIVE_COMPRESSION_LZ4 ||
+                       (entry->compression == DVR_ARCHIVE_COMPRESSION_NONE &&
+                        entry->size != entry->stored_size)) {
+                error = "DVRA entry has an invalid compression";
+            }
+        }
+    }
+
+    if (error != NULL) {
+        dvr_unmap_file(&archive.file);
+        return DVR_ERROR(dvr_archive, error);
+    }
+
+    return DVR_OK(dvr_archive, archive);
+}
+
+void dvr_close_archive(dvr_archive* archive) {
+    dvr_unmap_file(&archive->file);
+    *archive = (dvr_archive){};
+}
+
+static const dvr_archive_entry* dvr_archive_find(const dvr_archive* archive, const char* name) {
+    usize length = strlen(name);
+    u64 hash = dvr_archive_hash(name, length);
+    u64 bucket = archive->header.bucket_bits > 0 ? hash >> (64 - archive->header.bucket_bits) : 0;
+
+    for (u32 i = archive->buckets[bucket]; i < archive->buckets[bucket + 1]; i++) {
+        const dvr_archive_entry* entry = &archive->entries[i];
+        if (entry->hash == hash && entry->name_length == length &&
+            memcmp(archive->names + entry->name_offset, name, length) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+bool dvr_archive_contains(const dvr_archive* archive, const char* name) {
+    return dvr_archive_find(archive, name) != NULL;
+}
+
+DVR_RESULT(dvr_range) dvr_archive_view(const dvr_archive* archive, const char* name) {
+    const dvr_archive_entry* entry = dvr_archive_find(archive, name);
+    if (entry == NULL) {
+        return DVR_ERROR(dvr_range, "archive entry not found");
+    }
+    if (entry->compression != DVR_ARCHIVE_COMPRESSION_NONE) {
+        return DVR_ERROR(dvr_range, "compressed archive entries can only be read");
+    }
+
+    dvr_range range = {
+        .base = (u8*)archive->file.range.base + entry->offset,
+        .size = (usize)entry->size,
+    };
+
+    return DVR_OK(dvr_range, range);
+}
+
+DVR_RESULT(dvr_range) dvr_archive_read(const dvr_archive* archive, const char* name) {
+    const dvr_archive_entry* entry = dvr_archive_find(archive, name);
+    if (entry == NULL) {
+        return DVR_ERROR(dvr_range, "archive entry not found");
+    }
+
+    u8* buffer = malloc(entry->size > 0 ? (usize)entry->size : 1);
+    if (buffer == NULL) {
+        return DVR_ERROR(dvr_range, "failed to allocate buffer");
+    }
+
+    const u8* blob = (const u8*)archive->file.range.base + entry->offset;
+    if (entry->compression == DVR_ARCHIVE_COMPRESSION_LZ4) {
+        if (!dvr_lz4_decompress(blob, (usize)entry->stored_size, buffer, (usize)entry->size)) {
+            free(buffer);
+            return DVR_ERROR(dvr_range, "corrupt LZ4 data in archive entry");
+        }
+    } else {
+        memcpy(buffer, blob, (usize)entry->size);
+    }
+
+    dvr_range range = {
+        .base = buffer,
+        .size = (usize)entry->size,
+    };
+
+    return DVR_OK(dvr_range, range);
+}
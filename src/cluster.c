@@ -0,0 +1,391 @@
+#include "dvr_cluster.h"
+
+#include "dvr_meshopt.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const u32 dvr_cluster_cull_cs_spv[] =
+#include "dvr_cluster_cull_cs.spv.h"
+    ;
+
+// one workgroup per meshlet, matches dvr_cluster_cull_cs.glsl
+#define DVR_CLUSTER_MAX_GROUPS_X 65535
+
+/// Meshlet as read by the culling shader.
+typedef struct dvr_cluster_meshlet {
+    f32 sphere[4];
+    f32 cone[4];
+    u32 first_index;
+    u32 index_count;
+    u32 reserved[2];
+} dvr_cluster_meshlet;
+
+typedef struct dvr_cluster_push_constants {
+    f32 planes[6][4];
+    f32 camera_position[4];
+    u32 num_meshlets;
+} dvr_cluster_push_constants;
+
+_Static_assert(sizeof(dvr_cluster_meshlet) == 48, "unexpected padding in dvr_cluster_meshlet");
+_Static_assert(
+    sizeof(dvr_cluster_push_constants) == 116,
+    "unexpected padding in dvr_cluster_push_constants"
+);
+
+static struct {
+    bool running;
+    dvr_shader_module shader_module;
+    dvr_descriptor_set_layout layout;
+    dvr_compute_pipeline pipeline;
+} g_dvr_cluster;
+
+DVR_RESULT(dvr_none) dvr_cluster_setup(void) {
+    if (g_dvr_cluster.running) {
+        return DVR_ERROR(dvr_none, "cluster culling is already set up");
+    }
+
+    DVR_RESULT(dvr_shader_module)
+    shader_module_res = dvr_create_shader_module(&(dvr_shader_module_desc){
+        .code = DVR_RANGE(dvr_cluster_cull_cs_spv),
+    });
+    DVR_BUBBLE_INTO(dvr_none, shader_module_res);
+    g_dvr_cluster.shader_module = DVR_UNWRAP(shader_module_res);
+
+    dvr_descriptor_set_layout_binding_desc bindings[4];
+    for (u32 i = 0; i < 4; i++) {
+        bindings[i] = (dvr_descriptor_set_layout_binding_desc){
+            .binding = i,
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .count = 1,
+            .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+        };
+    }
+    DVR_RESULT(dvr_descriptor_set_layout)
+    layout_res = dvr_create_descriptor_set_layout(&(dvr_descriptor_set_layout_desc){
+        .num_bindings = 4,
+        .bindings = bindings,
+    });
+    if (!layout_res.is_ok) {
+        dvr_destroy_shader_module(g_dvr_cluster.shader_module);
+        return DVR_ERROR(dvr_none, layout_res.error.message);
+    }
+    g_dvr_cluster.layout = DVR_UNWRAP(layout_res);
+
+    DVR_RESULT(dvr_compute_pipeline)
+    pipeline_res = dvr_create_compute_pipeline(&(dvr_compute_pipeline_desc){
+        .shader_module = g_dvr_cluster.shader_module,
+        .entry_point = "main",
+        .num_desc_set_layouts = 1,
+        .desc_set_layouts = &g_dvr_cluster.layout,
+        .num_push_constant_ranges = 1,
+        .push_constant_ranges =
+            &(VkPushConstantRange){
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(dvr_cluster_push_constants),
+            },
+    });
+    if (!pipeline_res.is_ok) {
+        dvr_destroy_descriptor_set_layout(g_dvr_cluster.layout);
+        dvr_destroy_shader_module(g_dvr_cluster.shader_module);
+        return DVR_ERROR(dvr_none, pipeline_res.error.message);
+    }
+    g_dvr_cluster.pipeline = DVR_UNWRAP(pipeline_res);
+    g_dvr_cluster.running = true;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+void dvr_cluster_shutdown(void) {
+    if (!g_dvr_cluster.running) {
+        return;
+    }
+
+    dvr_destroy_compute_pipeline(g_dvr_cluster.pipeline);
+    dvr_destroy_descriptor_set_layout(g_dvr_cluster.layout);
+    dvr_destroy_shader_module(g_dvr_cluster.shader_module);
+    g_dvr_cluster.running = false;
+}
+
+/// Meshlets, with absolute indices in meshlet order, of an index buffer already optimized for
+/// the vertex cache. Returns the number of meshlets, `out_indices` holds as many indices as
+/// the input.
+static usize dvr_cluster_build(
+    dvr_cluster_meshlet** out_meshlets,
+    u32** out_indices,
+    const u32* indices,
+    dvr_cluster_mesh_desc* desc
+) {
+    usize max_meshlets = dvr_build_meshlets_bound(
+        desc->index_count,
+        DVR_MESHLET_MAX_VERTICES,
+        DVR_MESHLET_MAX_TRIANGLES
+    );
+    dvr_meshlet* meshlets = malloc(max_meshlets * sizeof(dvr_meshlet));
+    u32* meshlet_vertices = malloc(max_meshlets * DVR_MESHLET_MAX_VERTICES * sizeof(u32));
+    u8* meshlet_triangles = malloc(max_meshlets * DVR_MESHLET_MAX_TRIANGLES * 3);
+    dvr_cluster_meshlet* cluster_meshlets = malloc(max_meshlets * sizeof(dvr_cluster_meshlet));
+    u32* cluster_indices = malloc(desc->index_count * sizeof(u32));
+    if (meshlets == NULL || meshlet_vertices == NULL || meshlet_triangles == NULL ||
+        cluster_meshlets == NULL || cluster_indices == NULL) {
+        free(meshlets);
+        free(meshlet_vertices);
+        free(meshlet_triangles);
+        free(cluster_meshlets);
+        free(cluster_indices);
+        return 0;
+    }
+
+    usize num_meshlets = dvr_build_meshlets(
+        meshlets,
+        meshlet_vertices,
+        meshlet_triangles,
+        indices,
+        desc->index_count,
+        desc->vertex_count,
+        DVR_MESHLET_MAX_VERTICES,
+        DVR_MESHLET_MAX_TRIANGLES
+    );
+
+    u32 first_index = 0;
+    for (usize i = 0; i < num_meshlets; i++) {
+        const dvr_meshlet* meshlet = &meshlets[i];
+        dvr_meshlet_bounds bounds = dvr_compute_meshlet_bounds(
+            meshlet,
+            meshlet_vertices,
+            meshlet_triangles,
+            desc->positions,
+            desc->position_stride
+        );
+
+        u32 index_count = meshlet->triangle_count * 3;
+        const u8* local = &meshlet_triangles[meshlet->triangle_offset];
+        for (u32 j = 0; j < index_count; j++) {
+            cluster_indices[first_index + j] = meshlet_vertices[meshlet->vertex_offset + local[j]];
+        }
+
+        cluster_meshlets[i] = (dvr_cluster_meshlet){
+            .sphere = { bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius },
+            .cone = {
+                bounds.cone_axis[0],
+                bounds.cone_axis[1],
+                bounds.cone_axis[2],
+                bounds.cone_cutoff,
+            },
+            .first_index = first_index,
+            .index_count = index_count,
+        };
+        first_index += index_count;
+    }
+
+    free(meshlets);
+    free(meshlet_vertices);
+    free(meshlet_triangles);
+
+    *out_meshlets = cluster_meshlets;
+    *out_indices = cluster_indices;
+    return num_meshlets;
+}
+
+DVR_RESULT(dvr_cluster_mesh) dvr_create_cluster_mesh(dvr_cluster_mesh_desc* desc) {
+    if (!g_dvr_cluster.running) {
+        return DVR_ERROR(dvr_cluster_mesh, "cluster culling is not set up");
+    }
+    if (desc->index_count == 0 || desc->index_count % 3 != 0 || desc->index_count > UINT32_MAX) {
+        return DVR_ERROR(dvr_cluster_mesh, "cluster mesh needs a non empty triangle list");
+    }
+
+    u32* optimized = malloc(desc->index_count * sizeof(u32));
+    if (optimized == NULL) {
+        return DVR_ERROR(dvr_cluster_mesh, "failed to allocate cluster indices");
+    }
+    dvr_optimize_vertex_cache(optimized, desc->indices, desc->index_count, desc->vertex_count);
+
+    dvr_cluster_meshlet* meshlets = NULL;
+    u32* indices = NULL;
+    usize num_meshlets = dvr_cluster_build(&meshlets, &indices, optimized, desc);
+    free(optimized);
+    if (num_meshlets == 0) {
+        return DVR_ERROR(dvr_cluster_mesh, "failed to allocate meshlets");
+    }
+
+    dvr_cluster_mesh mesh = {
+        .num_meshlets = (u32)num_meshlets,
+        .num_indices = (u32)desc->index_count,
+    };
+    usize indices_size = desc->index_count * sizeof(u32);
+    const char* error = NULL;
+
+    DVR_RESULT(dvr_buffer)
+    meshlet_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .data = { .base = meshlets, .size = num_meshlets * sizeof(dvr_cluster_meshlet) },
+        .usage = DVR_BUFFER_USAGE_STORAGE,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_RESULT(dvr_buffer)
+    source_index_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .data = { .base = indices, .size = indices_size },
+        .usage = DVR_BUFFER_USAGE_STORAGE,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_RESULT(dvr_buffer)
+    index_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .data = { .base = NULL, .size = indices_size },
+        .usage = DVR_BUFFER_USAGE_STORAGE | DVR_BUFFER_USAGE_INDEX,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_RESULT(dvr_buffer)
+    draw_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .data = { .base = NULL, .size = sizeof(VkDrawIndexedIndirectCommand) },
+        .usage = DVR_BUFFER_USAGE_STORAGE | DVR_BUFFER_USAGE_INDIRECT,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+    });
+    free(meshlets);
+    free(indices);
+
+    if (meshlet_buffer_res.is_ok) {
+        mesh.meshlet_buffer = DVR_UNWRAP(meshlet_buffer_res);
+    } else {
+        error = meshlet_buffer_res.error.message;
+    }
+    if (source_index_buffer_res.is_ok) {
+        mesh.source_index_buffer = DVR_UNWRAP(source_index_buffer_res);
+    } else {
+        error = source_index_buffer_res.error.message;
+    }
+    if (index_buffer_res.is_ok) {
+        mesh.index_buffer = DVR_UNWRAP(index_buffer_res);
+    } else {
+        error = index_buffer_res.error.message;
+    }
+    if (draw_buffer_res.is_ok) {
+        mesh.draw_buffer = DVR_UNWRAP(draw_buffer_res);
+    } else {
+        error = draw_buffer_res.error.message;
+    }
+
+    if (error == NULL) {
+        dvr_buffer buffers[4] = {
+            mesh.meshlet_buffer,
+            mesh.source_index_buffer,
+            mesh.index_buffer,
+            mesh.draw_buffer,
+        };
+        u32 sizes[4] = {
+            mesh.num_meshlets * (u32)sizeof(dvr_cluster_meshlet),
+            (u32)indices_size,
+            (u32)indices_size,
+            (u32)sizeof(VkDrawIndexedIndirectCommand),
+        };
+        dvr_descriptor_set_binding_desc bindings[4];
+        for (u32 i = 0; i < 4; i++) {
+            bindings[i] = (dvr_descriptor_set_binding_desc){
+                .binding = i,
+                .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .buffer = { .buffer = buffers[i], .offset = 0, .size = sizes[i] },
+            };
+        }
+        DVR_RESULT(dvr_descriptor_set)
+        descriptor_set_res = dvr_create_descriptor_set(&(dvr_descriptor_set_desc){
+            .layout = g_dvr_cluster.layout,
+            .num_bindings = 4,
+            .bindings = bindings,
+        });
+        if (descriptor_set_res.is_ok) {
+            mesh.descriptor_set = DVR_UNWRAP(descriptor_set_res);
+        } else {
+            error = descriptor_set_res.error.message;
+        }
+    }
+
+    if (error != NULL) {
+        if (meshlet_buffer_res.is_ok) {
+            dvr_destroy_buffer(mesh.meshlet_buffer);
+        }
+        if (source_index_buffer_res.is_ok) {
+            dvr_destroy_buffer(mesh.source_index_buffer);
+        }
+        if (index_buffer_res.is_ok) {
+            dvr_destroy_buffer(mesh.index_buffer);
+        }
+        if (draw_buffer_res.is_ok) {
+            dvr_destroy_buffer(mesh.draw_buffer);
+        }
+        return DVR_ERROR(dvr_cluster_mesh, error);
+    }
+
+    return DVR_OK(dvr_cluster_mesh, mesh);
+}
+
+void dvr_destroy_cluster_mesh(dvr_cluster_mesh* mesh) {
+    dvr_destroy_descriptor_set(mesh->descriptor_set);
+    dvr_destroy_buffer(mesh->draw_buffer);
+    dvr_destroy_buffer(mesh->index_buffer);
+    dvr_destroy_buffer(mesh->source_index_buffer);
+    dvr_destroy_buffer(mesh->meshlet_buffer);
+    *mesh = (dvr_cluster_mesh){};
+}
+
+void dvr_frustum_planes(const vec4* m, f32 planes[6][4]) {
+    for (u32 i = 0; i < 4; i++) {
+        f32 x = m[i][0];
+        f32 y = m[i][1];
+        f32 z = m[i][2];
+        f32 w = m[i][3];
+        planes[0][i] = w + x;
+        planes[1][i] = w - x;
+        planes[2][i] = w + y;
+        planes[3][i] = w - y;
+        planes[4][i] = z;
+        planes[5][i] = w - z;
+    }
+
+    for (u32 i = 0; i < 6; i++) {
+        f32 length = sqrtf(
+            planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+            planes[i][2] * planes[i][2]
+        );
+        f32 inv_length = length > 0.0f ? 1.0f / length : 0.0f;
+        for (u32 j = 0; j < 4; j++) {
+            planes[i][j] *= inv_length;
+        }
+    }
+}
+
+void dvr_cull_clusters(const dvr_cluster_mesh* mesh, const dvr_cluster_view* view) {
+    VkDrawIndexedIndirectCommand draw = {
+        .indexCount = 0,
+        .instanceCount = 1,
+        .firstIndex = 0,
+        .vertexOffset = 0,
+        .firstInstance = 0,
+    };
+    dvr_write_buffer(mesh->draw_buffer, DVR_RANGE(draw), 0);
+
+    dvr_cluster_push_constants push_constants = {
+        .camera_position = {
+            view->camera_position[0],
+            view->camera_position[1],
+            view->camera_position[2],
+            view->cone_culling ? 1.0f : 0.0f,
+        },
+        .num_meshlets = mesh->num_meshlets,
+    };
+    dvr_frustum_planes(view->model_view_proj, push_constants.planes);
+
+    u32 groups_x = mesh->num_meshlets < DVR_CLUSTER_MAX_GROUPS_X ? mesh->num_meshlets
+                                                                 : DVR_CLUSTER_MAX_GROUPS_X;
+    u32 groups_y = (mesh->num_meshlets + groups_x - 1) / groups_x;
+
+    dvr_bind_compute_pipeline(g_dvr_cluster.pipeline);
+    dvr_bind_descriptor_set_compute(g_dvr_cluster.pipeline, mesh->descriptor_set);
+    dvr_push_constants_compute(g_dvr_cluster.pipeline, 0, DVR_RANGE(push_constants));
+    dvr_dispatch_compute(groups_x, groups_y, 1);
+}
+
+void dvr_draw_clusters(const dvr_cluster_mesh* mesh) {
+    dvr_bind_index_buffer(mesh->index_buffer, VK_INDEX_TYPE_UINT32);
+    dvr_draw_indexed_indirect(mesh->draw_buffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+}
@@ -1,14 +1,28 @@
 #include "dvr.h"
 #include "dvr_log.h"
+#include "dvr_reflect.h"
 
 #include <math.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include <stb/stb_ds.h>
 
+// generated from src/shaders at build time
+static const u32 dvr_mipgen_cs_spv[] =
+#include "dvr_mipgen_cs.spv.h"
+    ;
+static const u32 dvr_depth_pyramid_cs_spv[] =
+#include "dvr_depth_pyramid_cs.spv.h"
+    ;
+
 #ifdef RELEASE
 #define DVR_ENABLE_VALIDATION_LAYERS false
 #else
@@ -34,6 +48,16 @@ typedef struct dvr_image_data {
     u32 width;
     u32 height;
     u32 mip_level;
+    // unique over the lifetime of dvr, unlike slots, for framebuffer keys
+    u64 serial;
+    // last layout recorded through dynamic rendering or dvr_transition_image
+    VkImageLayout layout;
+    // mip chain is generated by the compute downsampler instead of blits
+    bool compute_mipgen;
+    // per level views and descriptor sets of the downsampler, created on first use
+    VkImageView* mip_views;
+    VkImageView* mip_storage_views;
+    VkDescriptorSet* mipgen_sets;
 } dvr_image_data;
 
 typedef struct dvr_sampler_data {
@@ -46,19 +70,47 @@ typedef struct dvr_render_pass_data {
     struct {
         VkRenderPass render_pass;
     } vk;
+    // unique over the lifetime of dvr, unlike slots, for pipeline and framebuffer keys
+    u64 serial;
 } dvr_render_pass_data;
 
 typedef struct dvr_shader_module_data {
     struct {
         VkShaderModule module;
     } vk;
+    u64 serial;
+    bool reflected;
+    dvr_shader_reflection reflection;
 } dvr_shader_module_data;
 
+// layout objects created for a pipeline from the reflection of its stages, released with it
+typedef struct dvr_reflected_layout {
+    u32 num_set_layouts;
+    dvr_descriptor_set_layout set_layouts[DVR_SHADER_MAX_DESCRIPTOR_SETS];
+    u32 num_push_constant_ranges;
+    VkPushConstantRange push_constant_range;
+} dvr_reflected_layout;
+
+// a deep copy of the desc a pipeline was created from, the base of its variants
+typedef struct dvr_pipeline_desc_copy {
+    dvr_pipeline_desc desc;
+    // everything `desc` points to
+    void** allocations;
+    // to tell whether the shader modules still exist
+    u64* module_serials;
+} dvr_pipeline_desc_copy;
+
 typedef struct dvr_pipeline_data {
     struct {
         VkPipelineLayout layout;
         VkPipeline pipeline;
     } vk;
+    dvr_reflected_layout reflected;
+    // pipelines created from identical descs share a slot, see `dvr_pipeline_key`
+    u32 refs;
+    u64 hash;
+    u8* key;
+    dvr_pipeline_desc_copy* desc;
 } dvr_pipeline_data;
 
 typedef struct dvr_framebuffer_data {
@@ -72,6 +124,11 @@ typedef struct dvr_descriptor_set_layout_data {
     struct {
         VkDescriptorSetLayout layout;
     } vk;
+    // identical layouts share a slot, compared by their bindings sorted by binding index
+    u32 refs;
+    u64 hash;
+    u32 num_bindings;
+    dvr_descriptor_set_layout_binding_desc* bindings;
 } dvr_descriptor_set_layout_data;
 
 typedef struct dvr_descriptor_set_data {
@@ -85,6 +142,7 @@ typedef struct dvr_compute_pipeline_data {
         VkPipelineLayout layout;
         VkPipeline pipeline;
     } vk;
+    dvr_reflected_layout reflected;
 } dvr_compute_pipeline_data;
 
 #define DVR_MAX_BUFFERS 1024
@@ -101,12 +159,161 @@ typedef struct dvr_compute_pipeline_data {
 #define DVR_POOL_MAX_UBOS 1024
 #define DVR_POOL_MAX_SAMPLERS 1024
 
+// statistics gathered by the pipeline statistics query, results come back in bit order
+#define DVR_PIPELINE_STATISTICS_FLAGS                                                          \
+    (VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |                                 \
+     VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |                               \
+     VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |                               \
+     VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |                                     \
+     VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+
+typedef enum dvr_deferred_destroy_kind {
+    DVR_DEFERRED_DESTROY_IMAGE,
+    DVR_DEFERRED_DESTROY_FRAMEBUFFER,
+    DVR_DEFERRED_DESTROY_RENDER_PASS,
+    DVR_DEFERRED_DESTROY_SWAPCHAIN_IMAGE,
+    DVR_DEFERRED_DESTROY_SWAPCHAIN,
+    DVR_DEFERRED_DESTROY_MEMORY,
+    DVR_DEFERRED_DESTROY_BUFFER,
+    DVR_DEFERRED_DESTROY_DEPTH_PYRAMID,
+    DVR_DEFERRED_DESTROY_PIPELINE,
+} dvr_deferred_destroy_kind;
+
+/// A resource that may still be referenced by a frame in flight. It is destroyed once
+/// `retire_frame` has been completed on the gpu.
+typedef struct dvr_deferred_destroy {
+    dvr_deferred_destroy_kind kind;
+    u64 retire_frame;
+    union {
+        dvr_image image;
+        dvr_framebuffer framebuffer;
+        dvr_render_pass render_pass;
+        struct {
+            dvr_image image;
+            VkImageView view;
+        } swapchain_image;
+        VkSwapchainKHR swapchain;
+        VkDeviceMemory memory;
+        struct {
+            VkBuffer buffer;
+            VkDeviceMemory memory;
+        } buffer;
+        struct {
+            dvr_image image;
+            VkDescriptorSet* sets;
+        } depth_pyramid;
+        // graphics or compute
+        struct {
+            VkPipeline pipeline;
+            VkPipelineLayout layout;
+        } pipeline;
+    };
+} dvr_deferred_destroy;
+
+// only 4 byte fields so the keys can be hashed without padding
+typedef struct dvr_render_target_key {
+    u32 width;
+    u32 height;
+    VkFormat format;
+    VkSampleCountFlagBits samples;
+    VkImageTiling tiling;
+    VkImageUsageFlags usage;
+    VkMemoryPropertyFlags properties;
+    u32 render_target;
+} dvr_render_target_key;
+
+typedef struct dvr_pooled_render_target {
+    usize hash;
+    dvr_render_target_key key;
+    dvr_image image;
+    u64 last_used_frame;
+    bool in_use;
+} dvr_pooled_render_target;
+
+#define DVR_POOLED_FRAMEBUFFER_MAX_ATTACHMENTS (DVR_MAX_RENDER_PASS_COLOR_ATTACHMENTS * 2 + 1)
+
+// objects are identified by serials, slots are reused as soon as they are destroyed
+typedef struct dvr_framebuffer_key {
+    u64 render_pass;
+    u64 attachments[DVR_POOLED_FRAMEBUFFER_MAX_ATTACHMENTS];
+    u32 width;
+    u32 height;
+    u32 num_attachments;
+    // explicit so the key has no padding to hash
+    u32 reserved;
+} dvr_framebuffer_key;
+
+typedef struct dvr_pooled_framebuffer {
+    usize hash;
+    dvr_framebuffer_key key;
+    dvr_framebuffer framebuffer;
+    u64 last_used_frame;
+} dvr_pooled_framebuffer;
+
+typedef struct dvr_image_layout_change {
+    dvr_image_data* image;
+    VkImageLayout layout;
+} dvr_image_layout_change;
+
+typedef struct dvr_render_graph_resource_data {
+    bool is_image;
+    bool imported;
+    dvr_image image;
+    dvr_buffer buffer;
+    // transient images
+    dvr_render_graph_image_desc desc;
+    VkImageUsageFlags usage;
+    i32 transient;
+    // culling and lifetime, in pass indices
+    bool needed;
+    bool touched;
+    bool recorded;
+    u32 first_pass;
+    u32 last_pass;
+    // synchronization state while recording
+    VkPipelineStageFlags write_stage;
+    VkAccessFlags write_access;
+    VkPipelineStageFlags read_stages;
+    VkAccessFlags read_access;
+    VkImageLayout layout;
+} dvr_render_graph_resource_data;
+
+typedef struct dvr_render_graph_pass_data {
+    dvr_render_graph_pass_desc desc;
+    u32 first_use;
+    bool kept;
+} dvr_render_graph_pass_data;
+
+/// Physical image backing a transient resource, kept across frames while the graph keeps the
+/// same shape.
+typedef struct dvr_render_graph_transient {
+    dvr_render_graph_image_desc desc;
+    VkImageUsageFlags usage;
+    u32 first_pass;
+    u32 last_pass;
+    dvr_image image;
+    u32 block;
+    // transient that used the same memory before this one, -1 if none
+    i32 alias_prev;
+    // resource using this transient in the current graph
+    u32 resource;
+} dvr_render_graph_transient;
+
+typedef struct dvr_render_graph_memory_block {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    u32 type_bits;
+    u32 free_after;
+    i32 last_transient;
+} dvr_render_graph_memory_block;
+
 typedef struct dvr_state {
     struct {
         VkInstance instance;
         VkDebugUtilsMessengerEXT debug_messenger;
         VkPhysicalDevice physical_device;
         VkPhysicalDeviceProperties physical_device_props;
+        u32 subgroup_size;
         VkDevice device;
         VkQueue graphics_queue;
         VkQueue compute_queue;
@@ -124,11 +331,20 @@ typedef struct dvr_state {
         VkCommandBuffer command_buffer;
         VkCommandBuffer compute_command_buffer;
         VkSampleCountFlagBits max_msaa_samples;
+        VkSampleCountFlagBits swapchain_samples;
+        // VK_FORMAT_UNDEFINED when the swapchain pass has no depth attachment
+        VkFormat swapchain_depth_format;
+        bool lazy_memory;
         VkSemaphore image_available_sem;
         VkSemaphore render_finished_sem;
         VkSemaphore compute_finished_sem;
         VkFence in_flight_fence;
         VkFence compute_fence;
+        bool compute_pending;
+        VkPipelineCache pipeline_cache;
+        PFN_vkCmdBeginRenderingKHR cmd_begin_rendering;
+        PFN_vkCmdEndRenderingKHR cmd_end_rendering;
+        bool rendering_active;
         u32 image_index;
     } vk;
     struct {
@@ -152,6 +368,7 @@ typedef struct dvr_state {
         u64 descriptor_set_usage_map[DVR_MAX_DESCRIPTOR_SETS / 64];
         dvr_compute_pipeline_data compute_pipelines[DVR_MAX_COMPUTE_PIPELINES];
         u64 compute_pipeline_usage_map[DVR_MAX_COMPUTE_PIPELINES / 64];
+        u64 next_serial;
     } res;
     struct {
         dvr_image swapchain_render_image;
@@ -160,10 +377,99 @@ typedef struct dvr_state {
         dvr_image* swapchain_images;
         dvr_framebuffer* swapchain_framebuffers;
     } defaults;
+    struct {
+        bool headless;
+        u32 width;
+        u32 height;
+        dvr_present_mode present_mode;
+        f64 target_frame_interval;
+        u32 max_frame_latency;
+        bool dynamic_rendering;
+        bool depth_pyramid;
+    } config;
+    struct {
+        f64 next_frame_time;
+        bool present_wait_enabled;
+        PFN_vkWaitForPresentKHR wait_for_present;
+        u64 present_id;
+        // first present id of the current swapchain, ids before it can't be waited on
+        u64 present_id_base;
+    } pacing;
+    struct {
+        // number of graphics submissions, a frame is complete once its fence was waited on
+        u64 submitted;
+        u64 completed;
+        // the command buffer is recorded but not submitted, e.g. while minimized
+        bool skipped;
+        dvr_deferred_destroy* deferred_destroys;
+        // layout changes recorded into a skipped frame, undone since they never execute
+        dvr_image_layout_change* layout_journal;
+    } frame;
+    struct {
+        dvr_render_graph_resource_data* resources;
+        dvr_render_graph_pass_data* passes;
+        dvr_render_graph_use* uses;
+        dvr_render_graph_transient* transients;
+        dvr_render_graph_memory_block* blocks;
+        // compute commands go into the frame command buffer while a pass executes
+        bool recording;
+    } graph;
+    struct {
+        dvr_pooled_render_target* images;
+        dvr_pooled_framebuffer* framebuffers;
+    } render_target_pool;
+    struct {
+        // the downsampler writes untyped storage images, without that feature only blits work
+        bool write_without_format;
+        VkDescriptorPool pool;
+        VkDescriptorSetLayout set_layout;
+        VkPipelineLayout layout;
+        VkPipeline pipeline;
+        VkSampler sampler;
+    } mipgen;
+    struct {
+        VkDescriptorPool pool;
+        VkDescriptorSetLayout set_layout;
+        VkPipelineLayout layout;
+        VkPipeline pipeline;
+        VkSampler sampler;
+        // the pyramid is recreated when the depth image or the extent it covers changes
+        dvr_image source;
+        VkExtent2D source_extent;
+        dvr_image image;
+        u32 width;
+        u32 height;
+        u32 num_levels;
+        // one set per level, reading the level above and writing the level itself
+        VkDescriptorSet* sets;
+        u32 generation;
+        bool valid;
+    } depth_pyramid;
+    struct {
+        // persistently mapped staging arena for uploads recorded into the frame command
+        // buffer, recycled once the frame completed
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        u8* mapped;
+        usize size;
+        usize head;
+    } upload;
+    struct {
+        // VK_NULL_HANDLE without the pipelineStatisticsQuery feature
+        VkQueryPool pool;
+        bool active;
+        // the query was recorded into a submitted frame
+        bool recorded;
+        u64 frame;
+    } pipeline_statistics;
     struct {
         GLFWwindow* window;
         bool just_resized;
     } window;
+    struct {
+        dvr_frame_stats current;
+        dvr_frame_stats last;
+    } stats;
 #ifdef DVR_ENABLE_IMGUI
     struct {
         VkDescriptorPool pool;
@@ -245,6 +551,8 @@ static void dvr_vk_end_transient_commands(VkCommandBuffer command_buffer) {
 
     vkQueueSubmit(g_dvr_state.vk.graphics_queue, 1, &submitInfo, VK_NULL_HANDLE);
     vkQueueWaitIdle(g_dvr_state.vk.graphics_queue);
+    g_dvr_state.stats.current.transient_submits++;
+    g_dvr_state.stats.current.queue_waits++;
 
     vkFreeCommandBuffers(DVR_DEVICE, g_dvr_state.vk.command_pool, 1, &command_buffer);
 }
@@ -331,6 +639,9 @@ static DVR_RESULT(dvr_buffer) dvr_vk_create_static_buffer(dvr_buffer_desc* desc)
     if (desc->usage & DVR_BUFFER_USAGE_STORAGE) {
         usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
     }
+    if (desc->usage & DVR_BUFFER_USAGE_INDIRECT) {
+        usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    }
     if (desc->usage & DVR_BUFFER_USAGE_TRANSFER_SRC) {
         usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     }
@@ -394,6 +705,7 @@ static DVR_RESULT(dvr_buffer) dvr_vk_create_static_buffer(dvr_buffer_desc* desc)
                 vkMapMemory(DVR_DEVICE, src_memory, 0, desc->data.size, 0, &mapped);
                 memcpy(mapped, desc->data.base, desc->data.size);
                 vkUnmapMemory(DVR_DEVICE, src_memory);
+                g_dvr_state.stats.current.staging_bytes_uploaded += desc->data.size;
             }
 
             VkBuffer dst_buffer;
@@ -474,6 +786,9 @@ static DVR_RESULT(dvr_buffer) dvr_vk_create_dynamic_buffer(dvr_buffer_desc* desc
     if (desc->usage & DVR_BUFFER_USAGE_STORAGE) {
         usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
     }
+    if (desc->usage & DVR_BUFFER_USAGE_INDIRECT) {
+        usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    }
     if (desc->usage & DVR_BUFFER_USAGE_TRANSFER_SRC) {
         usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     }
@@ -613,6 +928,83 @@ static dvr_image_data* dvr_get_image_data(dvr_image image) {
     return &g_dvr_state.res.images[image.id];
 }
 
+/// Texel block extent and size of the formats images can be uploaded in.
+static bool dvr_vk_format_block(VkFormat format, u32* block_extent, u32* block_bytes) {
+    *block_extent = 1;
+    switch (format) {
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_SRGB:
+            *block_bytes = 1;
+            return true;
+        case VK_FORMAT_R8G8_UNORM:
+        case VK_FORMAT_R8G8_SRGB:
+        case VK_FORMAT_R16_UNORM:
+        case VK_FORMAT_R16_SFLOAT:
+            *block_bytes = 2;
+            return true;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+        case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+            *block_bytes = 4;
+            return true;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            *block_bytes = 8;
+            return true;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            *block_bytes = 16;
+            return true;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            *block_extent = 4;
+            *block_bytes = 8;
+            return true;
+        case VK_FORMAT_BC2_UNORM_BLOCK:
+        case VK_FORMAT_BC2_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            *block_extent = 4;
+            *block_bytes = 16;
+            return true;
+        default:
+            *block_bytes = 0;
+            return false;
+    }
+}
+
+bool dvr_format_is_block_compressed(VkFormat format) {
+    u32 block_extent, block_bytes;
+    return dvr_vk_format_block(format, &block_extent, &block_bytes) && block_extent > 1;
+}
+
+usize dvr_image_level_size(VkFormat format, u32 width, u32 height) {
+    u32 block_extent, block_bytes;
+    if (!dvr_vk_format_block(format, &block_extent, &block_bytes)) {
+        return 0;
+    }
+
+    usize blocks_x = (width + block_extent - 1) / block_extent;
+    usize blocks_y = (height + block_extent - 1) / block_extent;
+    return blocks_x * blocks_y * block_bytes;
+}
+
 static void dvr_vk_transition_image_layout(
     VkImage image,
     VkFormat format,
@@ -709,34 +1101,21 @@ static void dvr_vk_transition_image_layout(
     dvr_vk_end_transient_commands(command_buffer);
 }
 
-static void dvr_vk_copy_buffer_to_image(VkBuffer buffer, VkImage image, u32 width, u32 height) {
+static void dvr_vk_copy_buffer_to_image(
+    VkBuffer buffer,
+    VkImage image,
+    const VkBufferImageCopy* regions,
+    u32 num_regions
+) {
     VkCommandBuffer command_buffer = dvr_vk_begin_transient_commands();
 
-    VkBufferImageCopy region = {
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-        .imageSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1,
-        },
-        .imageOffset = { 0, 0, 0 },
-        .imageExtent = {
-            width,
-            height,
-            1,
-        },
-    };
-
     vkCmdCopyBufferToImage(
         command_buffer,
         buffer,
         image,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region
+        num_regions,
+        regions
     );
 
     dvr_vk_end_transient_commands(command_buffer);
@@ -782,21 +1161,17 @@ static DVR_RESULT(VkImageView)
     return DVR_OK(VkImageView, view);
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_generate_image_mipmaps(dvr_image_data* img) {
+static bool dvr_vk_blit_mipmaps_supported(VkFormat format) {
     VkFormatProperties format_properties;
-    vkGetPhysicalDeviceFormatProperties(
-        g_dvr_state.vk.physical_device,
-        img->vk.format,
-        &format_properties
-    );
+    vkGetPhysicalDeviceFormatProperties(g_dvr_state.vk.physical_device, format, &format_properties);
 
-    if (!(format_properties.optimalTilingFeatures &
-          VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-        return DVR_ERROR(dvr_none, "image format does not support linear filtering");
-    }
-
-    VkCommandBuffer command_buffer = dvr_vk_begin_transient_commands();
+    return format_properties.optimalTilingFeatures &
+           VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+}
 
+/// Fallback mip generation, one blit per level. Expects every level in TRANSFER_DST_OPTIMAL
+/// and leaves them in SHADER_READ_ONLY_OPTIMAL.
+static void dvr_vk_cmd_blit_mipmaps(VkCommandBuffer command_buffer, dvr_image_data* img) {
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .image = img->vk.image,
@@ -905,135 +1280,766 @@ static DVR_RESULT(dvr_none) dvr_vk_generate_image_mipmaps(dvr_image_data* img) {
         1,
         &barrier
     );
+}
 
-    dvr_vk_end_transient_commands(command_buffer);
+// DVR_MIPGEN FUNCTIONS
 
-    return DVR_OK(dvr_none, DVR_NONE);
-}
+static VkImageAspectFlags dvr_vk_barrier_aspect(VkFormat format);
+static void dvr_vk_layout_sync(
+    VkImageLayout layout,
+    VkPipelineStageFlags* stage,
+    VkAccessFlags* access
+);
 
-DVR_RESULT(dvr_image) dvr_vk_create_image(dvr_image_desc* desc) {
-    // validate desc (only for debug builds)
+// levels written by a single downsampler dispatch, matches dvr_mipgen_cs.glsl
+#define DVR_MIPGEN_LEVELS_PER_DISPATCH 6
+#define DVR_MIPGEN_TILE_SIZE 32
+#define DVR_MIPGEN_MAX_SETS 256
 
-    bool has_data = desc->data.base != NULL;
-    if (desc->num_samples == 0) {
-        desc->num_samples = VK_SAMPLE_COUNT_1_BIT;
-    }
-#ifndef NDEBUG
-    if (desc->width == 0 || desc->height == 0) {
-        return DVR_ERROR(dvr_image, "image width and height must be greater than 0");
+typedef struct dvr_mipgen_push_constants {
+    u32 num_levels;
+    u32 srgb;
+} dvr_mipgen_push_constants;
+
+/// sRGB formats can't be storage images, the downsampler writes through a UNORM view and
+/// encodes manually.
+static VkFormat dvr_vk_mipgen_storage_format(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8_SRGB:
+            return VK_FORMAT_R8_UNORM;
+        case VK_FORMAT_R8G8_SRGB:
+            return VK_FORMAT_R8G8_UNORM;
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            return VK_FORMAT_B8G8R8A8_UNORM;
+        case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+            return VK_FORMAT_A8B8G8R8_UNORM_PACK32;
+        default:
+            return format;
     }
-    if (desc->format == VK_FORMAT_UNDEFINED) {
-        return DVR_ERROR(dvr_image, "image format must be specified");
+}
+
+static bool dvr_vk_mipgen_supported(VkFormat format, VkImageTiling tiling) {
+    if (g_dvr_state.mipgen.pipeline == VK_NULL_HANDLE || tiling != VK_IMAGE_TILING_OPTIMAL ||
+        dvr_vk_barrier_aspect(format) != VK_IMAGE_ASPECT_COLOR_BIT) {
+        return false;
     }
 
-    if (has_data) {
-        if (desc->render_target) {
-            return DVR_ERROR(dvr_image, "image cannot be a render target and have data");
-        }
-        if (desc->num_samples != VK_SAMPLE_COUNT_1_BIT) {
-            return DVR_ERROR(dvr_image, "image cannot have data and be multisampled");
-        }
-    } else {
-        if (desc->generate_mipmaps) {
-            return DVR_ERROR(dvr_image, "cannot generate mipmaps for image with no data");
-        }
+    VkFormatProperties sampled_properties;
+    vkGetPhysicalDeviceFormatProperties(
+        g_dvr_state.vk.physical_device,
+        format,
+        &sampled_properties
+    );
+    VkFormatProperties storage_properties;
+    vkGetPhysicalDeviceFormatProperties(
+        g_dvr_state.vk.physical_device,
+        dvr_vk_mipgen_storage_format(format),
+        &storage_properties
+    );
+
+    return (sampled_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) &&
+           (storage_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+}
+
+static DVR_RESULT(VkImageView)
+    dvr_vk_create_image_level_view(VkImage image, VkFormat format, u32 level) {
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+
+    VkImageView view;
+    if (vkCreateImageView(DVR_DEVICE, &view_info, NULL, &view) != VK_SUCCESS) {
+        return DVR_ERROR(VkImageView, "failed to create image level view");
     }
-#endif
+    return DVR_OK(VkImageView, view);
+}
 
-    u32 mip_levels = 1;
-    if (desc->generate_mipmaps) {
-        mip_levels = (u32)log2(fmax(desc->width, desc->height)) + 1;
+static void dvr_vk_release_mipgen(dvr_image_data* img) {
+    for (usize i = 0; i < arrlenu(img->mip_views); i++) {
+        vkDestroyImageView(DVR_DEVICE, img->mip_views[i], NULL);
+    }
+    for (usize i = 0; i < arrlenu(img->mip_storage_views); i++) {
+        vkDestroyImageView(DVR_DEVICE, img->mip_storage_views[i], NULL);
+    }
+    if (arrlenu(img->mipgen_sets) > 0) {
+        vkFreeDescriptorSets(
+            DVR_DEVICE,
+            g_dvr_state.mipgen.pool,
+            (u32)arrlenu(img->mipgen_sets),
+            img->mipgen_sets
+        );
     }
 
-    VkImageCreateInfo image_info = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-        .imageType = VK_IMAGE_TYPE_2D,
-        .extent.width = desc->width,
-        .extent.height = desc->height,
-        .extent.depth = 1,
-        .mipLevels = mip_levels,
-        .arrayLayers = 1,
-        .format = desc->format,
-        .tiling = desc->tiling,
-        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .usage = desc->usage | (has_data ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0) |
-                 (desc->render_target ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : 0) |
-                 (desc->generate_mipmaps
-                      ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
-                      : 0),
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .samples = desc->num_samples,
-        .flags = 0,
-    };
+    arrfree(img->mip_views);
+    arrfree(img->mip_storage_views);
+    arrfree(img->mipgen_sets);
+}
 
-    VkImage image;
-    VkDeviceMemory memory;
+static DVR_RESULT(dvr_none) dvr_vk_prepare_mipgen(dvr_image_data* img) {
+    VkFormat storage_format = dvr_vk_mipgen_storage_format(img->vk.format);
 
-    if (vkCreateImage(DVR_DEVICE, &image_info, NULL, &image) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_image, "failed to create image");
+    for (u32 level = 0; level < img->mip_level; level++) {
+        DVR_RESULT(VkImageView)
+        view_res = dvr_vk_create_image_level_view(img->vk.image, img->vk.format, level);
+        if (DVR_RESULT_IS_ERROR(view_res)) {
+            dvr_vk_release_mipgen(img);
+            return DVR_ERROR(dvr_none, view_res.error.message);
+        }
+        arrput(img->mip_views, DVR_UNWRAP(view_res));
+
+        view_res = dvr_vk_create_image_level_view(img->vk.image, storage_format, level);
+        if (DVR_RESULT_IS_ERROR(view_res)) {
+            dvr_vk_release_mipgen(img);
+            return DVR_ERROR(dvr_none, view_res.error.message);
+        }
+        arrput(img->mip_storage_views, DVR_UNWRAP(view_res));
     }
 
-    VkMemoryRequirements mem_reqs;
-    vkGetImageMemoryRequirements(DVR_DEVICE, image, &mem_reqs);
+    for (u32 base = 0; base + 1 < img->mip_level; base += DVR_MIPGEN_LEVELS_PER_DISPATCH) {
+        VkDescriptorSetAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = g_dvr_state.mipgen.pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &g_dvr_state.mipgen.set_layout,
+        };
 
-    DVR_RESULT(u32)
-    memory_type_res = dvr_vk_find_memory_type(mem_reqs.memoryTypeBits, desc->properties);
-    DVR_BUBBLE_INTO(dvr_image, memory_type_res);
+        VkDescriptorSet set;
+        if (vkAllocateDescriptorSets(DVR_DEVICE, &alloc_info, &set) != VK_SUCCESS) {
+            dvr_vk_release_mipgen(img);
+            return DVR_ERROR(dvr_none, "failed to allocate mipgen descriptor set");
+        }
+        arrput(img->mipgen_sets, set);
 
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = DVR_UNWRAP(memory_type_res),
-    };
+        VkDescriptorImageInfo src_info = {
+            .sampler = g_dvr_state.mipgen.sampler,
+            .imageView = img->mip_views[base],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
 
-    if (vkAllocateMemory(DVR_DEVICE, &alloc_info, NULL, &memory) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_image, "failed to allocate image memory");
+        // every array element needs a valid view, levels past the end repeat the last one
+        VkDescriptorImageInfo dst_infos[DVR_MIPGEN_LEVELS_PER_DISPATCH];
+        for (u32 i = 0; i < DVR_MIPGEN_LEVELS_PER_DISPATCH; i++) {
+            u32 level = base + 1 + i < img->mip_level ? base + 1 + i : img->mip_level - 1;
+            dst_infos[i] = (VkDescriptorImageInfo){
+                .imageView = img->mip_storage_views[level],
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            };
+        }
+
+        VkWriteDescriptorSet writes[2] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = set,
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &src_info,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = set,
+                .dstBinding = 1,
+                .descriptorCount = DVR_MIPGEN_LEVELS_PER_DISPATCH,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = dst_infos,
+            },
+        };
+        vkUpdateDescriptorSets(DVR_DEVICE, 2, writes, 0, NULL);
     }
 
-    vkBindImageMemory(DVR_DEVICE, image, memory, 0);
+    return DVR_OK(dvr_none, DVR_NONE);
+}
 
-    DVR_RESULT(VkImageView)
-    view_res = dvr_vk_create_image_view(image, desc->format, mip_levels);
-    DVR_BUBBLE_INTO(dvr_image, view_res);
+/// Generates the mip chain with the compute downsampler, one dispatch and barrier per 6
+/// levels. Level 0 is expected in `old_layout`, every level ends up in SHADER_READ_ONLY_OPTIMAL.
+static void dvr_vk_cmd_compute_mipmaps(
+    VkCommandBuffer command_buffer,
+    dvr_image_data* img,
+    VkImageLayout old_layout
+) {
+    VkPipelineStageFlags src_stage;
+    VkAccessFlags src_access;
+    dvr_vk_layout_sync(old_layout, &src_stage, &src_access);
+
+    // level 0 keeps its contents, the rest is overwritten anyway
+    VkImageMemoryBarrier barriers[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = src_access,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = old_layout,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = img->vk.image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = src_access,
+            .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = img->vk.image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 1,
+                .levelCount = img->mip_level - 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        },
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        src_stage,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0,
+        NULL,
+        0,
+        NULL,
+        2,
+        barriers
+    );
+    g_dvr_state.stats.current.barriers++;
 
-    dvr_image_data img = {
-        .vk.image = image,
-        .vk.memory = memory,
-        .vk.view = DVR_UNWRAP(view_res),
-        .vk.format = desc->format,
-        .width = desc->width,
-        .height = desc->height,
-        .mip_level = mip_levels,
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, g_dvr_state.mipgen.pipeline);
+
+    dvr_mipgen_push_constants push_constants = {
+        .srgb = dvr_vk_mipgen_storage_format(img->vk.format) != img->vk.format,
     };
 
-    if (has_data) {
-        VkBuffer staging_buffer;
-        VkDeviceMemory staging_memory;
+    for (u32 base = 0; base + 1 < img->mip_level; base += DVR_MIPGEN_LEVELS_PER_DISPATCH) {
+        if (base > 0) {
+            // the next dispatch reads the last level of this one
+            VkMemoryBarrier memory_barrier = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            };
+            vkCmdPipelineBarrier(
+                command_buffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1,
+                &memory_barrier,
+                0,
+                NULL,
+                0,
+                NULL
+            );
+            g_dvr_state.stats.current.barriers++;
+        }
 
-        DVR_RESULT(dvr_none)
-        result = dvr_vk_create_buffer(
-            desc->data.size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &staging_buffer,
-            &staging_memory
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            g_dvr_state.mipgen.layout,
+            0,
+            1,
+            &img->mipgen_sets[base / DVR_MIPGEN_LEVELS_PER_DISPATCH],
+            0,
+            NULL
         );
-        DVR_BUBBLE_INTO(dvr_image, result);
-
-        void* mapped;
-        vkMapMemory(DVR_DEVICE, staging_memory, 0, desc->data.size, 0, &mapped);
-        memcpy(mapped, desc->data.base, desc->data.size);
-        vkUnmapMemory(DVR_DEVICE, staging_memory);
 
-        dvr_vk_transition_image_layout(
-            image,
-            desc->format,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            mip_levels
+        u32 remaining = img->mip_level - 1 - base;
+        push_constants.num_levels = remaining < DVR_MIPGEN_LEVELS_PER_DISPATCH
+                                        ? remaining
+                                        : DVR_MIPGEN_LEVELS_PER_DISPATCH;
+        vkCmdPushConstants(
+            command_buffer,
+            g_dvr_state.mipgen.layout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(push_constants),
+            &push_constants
         );
 
-        dvr_vk_copy_buffer_to_image(staging_buffer, image, desc->width, desc->height);
+        u32 width = img->width >> (base + 1);
+        u32 height = img->height >> (base + 1);
+        width = width > 0 ? width : 1;
+        height = height > 0 ? height : 1;
+        vkCmdDispatch(
+            command_buffer,
+            (width + DVR_MIPGEN_TILE_SIZE - 1) / DVR_MIPGEN_TILE_SIZE,
+            (height + DVR_MIPGEN_TILE_SIZE - 1) / DVR_MIPGEN_TILE_SIZE,
+            1
+        );
+        g_dvr_state.stats.current.dispatches++;
+    }
+
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = img->vk.image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = img->mip_level,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0,
+        NULL,
+        0,
+        NULL,
+        1,
+        &barrier
+    );
+    g_dvr_state.stats.current.barriers++;
+}
+
+/// Upload time mip generation, levels are in TRANSFER_DST_OPTIMAL after the copy.
+static DVR_RESULT(dvr_none) dvr_vk_generate_image_mipmaps(dvr_image_data* img) {
+    if (img->compute_mipgen) {
+        DVR_RESULT(dvr_none) res = dvr_vk_prepare_mipgen(img);
+        DVR_BUBBLE(res);
+
+        VkCommandBuffer command_buffer = dvr_vk_begin_transient_commands();
+        dvr_vk_cmd_compute_mipmaps(command_buffer, img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        dvr_vk_end_transient_commands(command_buffer);
+
+        // static images are done, don't keep the per level views around
+        dvr_vk_release_mipgen(img);
+
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    if (!dvr_vk_blit_mipmaps_supported(img->vk.format)) {
+        return DVR_ERROR(dvr_none, "image format does not support linear filtering");
+    }
+
+    VkCommandBuffer command_buffer = dvr_vk_begin_transient_commands();
+    dvr_vk_cmd_blit_mipmaps(command_buffer, img);
+    dvr_vk_end_transient_commands(command_buffer);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_mipgen_pipeline(void) {
+    if (!g_dvr_state.mipgen.write_without_format) {
+        DVRLOG_INFO("storage image writes without format unsupported, mipmaps use blits");
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    VkShaderModuleCreateInfo module_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = sizeof(dvr_mipgen_cs_spv),
+        .pCode = dvr_mipgen_cs_spv,
+    };
+    VkShaderModule module;
+    if (vkCreateShaderModule(DVR_DEVICE, &module_info, NULL, &module) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create mipgen shader module");
+    }
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 2,
+        .pBindings =
+            (VkDescriptorSetLayoutBinding[]){
+                {
+                    .binding = 0,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .descriptorCount = 1,
+                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                },
+                {
+                    .binding = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .descriptorCount = DVR_MIPGEN_LEVELS_PER_DISPATCH,
+                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                },
+            },
+    };
+    if (vkCreateDescriptorSetLayout(
+            DVR_DEVICE,
+            &set_layout_info,
+            NULL,
+            &g_dvr_state.mipgen.set_layout
+        ) != VK_SUCCESS) {
+        vkDestroyShaderModule(DVR_DEVICE, module, NULL);
+        return DVR_ERROR(dvr_none, "failed to create mipgen descriptor set layout");
+    }
+
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &g_dvr_state.mipgen.set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges =
+            &(VkPushConstantRange){
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(dvr_mipgen_push_constants),
+            },
+    };
+    if (vkCreatePipelineLayout(DVR_DEVICE, &layout_info, NULL, &g_dvr_state.mipgen.layout) !=
+        VK_SUCCESS) {
+        vkDestroyShaderModule(DVR_DEVICE, module, NULL);
+        return DVR_ERROR(dvr_none, "failed to create mipgen pipeline layout");
+    }
+
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = module,
+            .pName = "main",
+        },
+        .layout = g_dvr_state.mipgen.layout,
+    };
+    VkResult result = vkCreateComputePipelines(
+        DVR_DEVICE,
+        g_dvr_state.vk.pipeline_cache,
+        1,
+        &pipeline_info,
+        NULL,
+        &g_dvr_state.mipgen.pipeline
+    );
+    vkDestroyShaderModule(DVR_DEVICE, module, NULL);
+    if (result != VK_SUCCESS) {
+        g_dvr_state.mipgen.pipeline = VK_NULL_HANDLE;
+        return DVR_ERROR(dvr_none, "failed to create mipgen pipeline");
+    }
+
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    };
+    if (vkCreateSampler(DVR_DEVICE, &sampler_info, NULL, &g_dvr_state.mipgen.sampler) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create mipgen sampler");
+    }
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .maxSets = DVR_MIPGEN_MAX_SETS,
+        .poolSizeCount = 2,
+        .pPoolSizes =
+            (VkDescriptorPoolSize[]){
+                {
+                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .descriptorCount = DVR_MIPGEN_MAX_SETS,
+                },
+                {
+                    .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .descriptorCount = DVR_MIPGEN_MAX_SETS * DVR_MIPGEN_LEVELS_PER_DISPATCH,
+                },
+            },
+    };
+    if (vkCreateDescriptorPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.mipgen.pool) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create mipgen descriptor pool");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static void dvr_vk_destroy_mipgen_pipeline(void) {
+    vkDestroyDescriptorPool(DVR_DEVICE, g_dvr_state.mipgen.pool, NULL);
+    vkDestroySampler(DVR_DEVICE, g_dvr_state.mipgen.sampler, NULL);
+    vkDestroyPipeline(DVR_DEVICE, g_dvr_state.mipgen.pipeline, NULL);
+    vkDestroyPipelineLayout(DVR_DEVICE, g_dvr_state.mipgen.layout, NULL);
+    vkDestroyDescriptorSetLayout(DVR_DEVICE, g_dvr_state.mipgen.set_layout, NULL);
+}
+
+/// Copy regions for the first `num_levels` levels of `data`, laid out as described by
+/// `dvr_image_desc.levels`. Only the span between `upload_begin` and `upload_end` has to be
+/// staged, containers keep headers around the levels. Region offsets are relative to its start.
+static DVR_RESULT(u32) dvr_vk_image_upload_regions(
+    VkFormat format,
+    u32 width,
+    u32 height,
+    dvr_range data,
+    u32 num_levels,
+    const dvr_image_level* levels,
+    VkBufferImageCopy regions[32],
+    usize* upload_begin,
+    usize* upload_end
+) {
+    *upload_begin = SIZE_MAX;
+    *upload_end = 0;
+
+    usize packed_offset = 0;
+    for (u32 level = 0; level < num_levels; level++) {
+        u32 level_width = width >> level ? width >> level : 1;
+        u32 level_height = height >> level ? height >> level : 1;
+
+        dvr_image_level range = { .offset = 0, .size = data.size };
+        if (levels != NULL) {
+            range = levels[level];
+            usize expected = dvr_image_level_size(format, level_width, level_height);
+            if (expected != 0 && range.size != expected) {
+                return DVR_ERROR(u32, "image level size doesn't match its format");
+            }
+        } else if (num_levels > 1) {
+            range.offset = packed_offset;
+            range.size = dvr_image_level_size(format, level_width, level_height);
+            if (range.size == 0) {
+                return DVR_ERROR(u32, "level layout of format unknown, pass levels");
+            }
+        }
+        if (range.offset > data.size || range.size > data.size - range.offset) {
+            return DVR_ERROR(u32, "image level lies outside of the data");
+        }
+        packed_offset = range.offset + range.size;
+        *upload_begin = range.offset < *upload_begin ? range.offset : *upload_begin;
+        *upload_end = packed_offset > *upload_end ? packed_offset : *upload_end;
+
+        regions[level] = (VkBufferImageCopy){
+            .bufferOffset = range.offset,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageExtent = { level_width, level_height, 1 },
+        };
+    }
+    for (u32 level = 0; level < num_levels; level++) {
+        regions[level].bufferOffset -= *upload_begin;
+    }
+
+    return DVR_OK(u32, num_levels);
+}
+
+DVR_RESULT(dvr_image) dvr_vk_create_image(dvr_image_desc* desc) {
+    // validate desc (only for debug builds)
+
+    bool has_data = desc->data.base != NULL;
+    bool compressed = dvr_format_is_block_compressed(desc->format);
+    if (desc->num_samples == 0) {
+        desc->num_samples = VK_SAMPLE_COUNT_1_BIT;
+    }
+#ifndef NDEBUG
+    if (desc->width == 0 || desc->height == 0) {
+        return DVR_ERROR(dvr_image, "image width and height must be greater than 0");
+    }
+    if (desc->format == VK_FORMAT_UNDEFINED) {
+        return DVR_ERROR(dvr_image, "image format must be specified");
+    }
+
+    if (has_data) {
+        if (desc->render_target) {
+            return DVR_ERROR(dvr_image, "image cannot be a render target and have data");
+        }
+        if (desc->num_samples != VK_SAMPLE_COUNT_1_BIT) {
+            return DVR_ERROR(dvr_image, "image cannot have data and be multisampled");
+        }
+    }
+    if (desc->generate_mipmaps && desc->mip_levels > 1) {
+        return DVR_ERROR(dvr_image, "image cannot both contain and generate mip levels");
+    }
+    if (compressed && (desc->render_target || desc->generate_mipmaps)) {
+        return DVR_ERROR(dvr_image, "block-compressed images can only be sampled");
+    }
+#endif
+
+    u32 full_mip_levels = (u32)log2(fmax(desc->width, desc->height)) + 1;
+    u32 mip_levels = desc->mip_levels > 0 ? desc->mip_levels : 1;
+    if (desc->generate_mipmaps) {
+        mip_levels = full_mip_levels;
+    }
+    if (mip_levels > full_mip_levels) {
+        return DVR_ERROR(dvr_image, "image has more mip levels than its extent allows");
+    }
+
+    if (compressed) {
+        VkFormatProperties format_properties;
+        vkGetPhysicalDeviceFormatProperties(
+            g_dvr_state.vk.physical_device,
+            desc->format,
+            &format_properties
+        );
+        VkFormatFeatureFlags features = desc->tiling == VK_IMAGE_TILING_LINEAR
+                                            ? format_properties.linearTilingFeatures
+                                            : format_properties.optimalTilingFeatures;
+        if (!(features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            return DVR_ERROR(dvr_image, "block-compressed format not supported by the device");
+        }
+    }
+
+    // one copy region per level present in the data, the rest is generated afterwards
+    VkBufferImageCopy regions[32];
+    u32 num_regions = 0;
+    usize upload_begin = 0;
+    usize upload_end = 0;
+    if (has_data) {
+        DVR_RESULT(u32)
+        regions_res = dvr_vk_image_upload_regions(
+            desc->format,
+            desc->width,
+            desc->height,
+            desc->data,
+            desc->generate_mipmaps ? 1 : mip_levels,
+            desc->levels,
+            regions,
+            &upload_begin,
+            &upload_end
+        );
+        DVR_BUBBLE_INTO(dvr_image, regions_res);
+        num_regions = DVR_UNWRAP(regions_res);
+    }
+
+    bool compute_mipgen = desc->generate_mipmaps && mip_levels > 1 &&
+                          dvr_vk_mipgen_supported(desc->format, desc->tiling);
+    VkImageUsageFlags mipgen_usage = 0;
+    VkImageCreateFlags mipgen_flags = 0;
+    if (compute_mipgen) {
+        mipgen_usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+        // storage usage only applies to the UNORM views of sRGB images
+        if (dvr_vk_mipgen_storage_format(desc->format) != desc->format) {
+            mipgen_flags =
+                VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+        }
+    } else if (desc->generate_mipmaps) {
+        mipgen_usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .extent.width = desc->width,
+        .extent.height = desc->height,
+        .extent.depth = 1,
+        .mipLevels = mip_levels,
+        .arrayLayers = 1,
+        .format = desc->format,
+        .tiling = desc->tiling,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .usage = desc->usage | (has_data ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0) |
+                 (desc->render_target ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : 0) | mipgen_usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .samples = desc->num_samples,
+        .flags = mipgen_flags,
+    };
+
+    VkImage image;
+    VkDeviceMemory memory;
+
+    if (vkCreateImage(DVR_DEVICE, &image_info, NULL, &image) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_image, "failed to create image");
+    }
+
+    VkMemoryRequirements mem_reqs;
+    vkGetImageMemoryRequirements(DVR_DEVICE, image, &mem_reqs);
+
+    DVR_RESULT(u32)
+    memory_type_res = dvr_vk_find_memory_type(mem_reqs.memoryTypeBits, desc->properties);
+    // not every image can live in lazily allocated memory, even on devices that have it
+    if (!memory_type_res.is_ok && (desc->properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+        memory_type_res = dvr_vk_find_memory_type(
+            mem_reqs.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+    }
+    if (!memory_type_res.is_ok) {
+        vkDestroyImage(DVR_DEVICE, image, NULL);
+    }
+    DVR_BUBBLE_INTO(dvr_image, memory_type_res);
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = mem_reqs.size,
+        .memoryTypeIndex = DVR_UNWRAP(memory_type_res),
+    };
+
+    if (vkAllocateMemory(DVR_DEVICE, &alloc_info, NULL, &memory) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_image, "failed to allocate image memory");
+    }
+
+    vkBindImageMemory(DVR_DEVICE, image, memory, 0);
+
+    DVR_RESULT(VkImageView)
+    view_res = dvr_vk_create_image_view(image, desc->format, mip_levels);
+    DVR_BUBBLE_INTO(dvr_image, view_res);
+
+    dvr_image_data img = {
+        .vk.image = image,
+        .vk.memory = memory,
+        .vk.view = DVR_UNWRAP(view_res),
+        .vk.format = desc->format,
+        .width = desc->width,
+        .height = desc->height,
+        .mip_level = mip_levels,
+        .serial = ++g_dvr_state.res.next_serial,
+        .compute_mipgen = compute_mipgen,
+    };
+
+    if (has_data) {
+        VkBuffer staging_buffer;
+        VkDeviceMemory staging_memory;
+
+        usize upload_size = upload_end - upload_begin;
+
+        DVR_RESULT(dvr_none)
+        result = dvr_vk_create_buffer(
+            upload_size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &staging_buffer,
+            &staging_memory
+        );
+        DVR_BUBBLE_INTO(dvr_image, result);
+
+        // with a mapped file as data this is the only copy, straight from the page cache
+        void* mapped;
+        vkMapMemory(DVR_DEVICE, staging_memory, 0, upload_size, 0, &mapped);
+        memcpy(mapped, (u8*)desc->data.base + upload_begin, upload_size);
+        vkUnmapMemory(DVR_DEVICE, staging_memory);
+        g_dvr_state.stats.current.staging_bytes_uploaded += upload_size;
+
+        dvr_vk_transition_image_layout(
+            image,
+            desc->format,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            mip_levels
+        );
+
+        dvr_vk_copy_buffer_to_image(staging_buffer, image, regions, num_regions);
 
         vkDestroyBuffer(DVR_DEVICE, staging_buffer, NULL);
         vkFreeMemory(DVR_DEVICE, staging_memory, NULL);
@@ -1071,6 +2077,16 @@ DVR_RESULT(dvr_image) dvr_vk_create_image(dvr_image_desc* desc) {
         );
     }
 
+    if (desc->render_target) {
+        img.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    } else if (desc->usage & VK_IMAGE_USAGE_STORAGE_BIT) {
+        img.layout = VK_IMAGE_LAYOUT_GENERAL;
+    } else if (has_data) {
+        img.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    } else {
+        img.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
     u16 free_slot = dvr_find_free_slot(g_dvr_state.res.image_usage_map, DVR_MAX_IMAGES);
     g_dvr_state.res.images[free_slot] = img;
     dvr_set_slot_used(g_dvr_state.res.image_usage_map, free_slot);
@@ -1084,6 +2100,7 @@ DVR_RESULT(dvr_image) dvr_create_image(dvr_image_desc* desc) {
 
 static void dvr_vk_destroy_image(dvr_image image) {
     dvr_image_data* img = dvr_get_image_data(image);
+    dvr_vk_release_mipgen(img);
     vkDestroyImageView(DVR_DEVICE, img->vk.view, NULL);
     vkDestroyImage(DVR_DEVICE, img->vk.image, NULL);
     vkFreeMemory(DVR_DEVICE, img->vk.memory, NULL);
@@ -1287,6 +2304,7 @@ DVR_RESULT(dvr_render_pass) dvr_create_render_pass(dvr_render_pass_desc* desc) {
 
     dvr_render_pass_data pass = {
         .vk.render_pass = render_pass,
+        .serial = ++g_dvr_state.res.next_serial,
     };
 
     u16 free_slot =
@@ -1320,17 +2338,86 @@ dvr_get_descriptor_set_layout_data(dvr_descriptor_set_layout layout) {
     return &g_dvr_state.res.descriptor_set_layouts[layout.id];
 }
 
-DVR_RESULT(dvr_descriptor_set_layout)
-dvr_create_descriptor_set_layout(dvr_descriptor_set_layout_desc* desc) {
-    VkDescriptorSetLayoutBinding bindings[desc->num_bindings];
-    for (u32 i = 0; i < desc->num_bindings; i++) {
-        bindings[i] = (VkDescriptorSetLayoutBinding){
-            .binding = desc->bindings[i].binding,
-            .descriptorType = desc->bindings[i].type,
-            .descriptorCount = desc->bindings[i].count,
-            .stageFlags = desc->bindings[i].stage_flags,
-            .pImmutableSamplers = NULL,
-        };
+static int dvr_compare_layout_bindings(const void* a, const void* b) {
+    const dvr_descriptor_set_layout_binding_desc* binding_a = a;
+    const dvr_descriptor_set_layout_binding_desc* binding_b = b;
+    return binding_a->binding < binding_b->binding ? -1 : binding_a->binding > binding_b->binding;
+}
+
+#define DVR_HASH_SEED 0xCBF29CE484222325ull
+
+// FNV-1a, continuing from `hash`
+static u64 dvr_hash_bytes(u64 hash, const void* data, usize size) {
+    const u8* bytes = data;
+    for (usize i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static u64
+    dvr_hash_layout_bindings(const dvr_descriptor_set_layout_binding_desc* bindings, u32 num) {
+    // only the fields that make up the Vulkan layout
+    u64 hash = DVR_HASH_SEED;
+    for (u32 i = 0; i < num; i++) {
+        u32 fields[4] = {
+            bindings[i].binding,
+            (u32)bindings[i].type,
+            bindings[i].count,
+            (u32)bindings[i].stage_flags,
+        };
+        hash = dvr_hash_bytes(hash, fields, sizeof(fields));
+    }
+    return hash;
+}
+
+DVR_RESULT(dvr_descriptor_set_layout)
+dvr_create_descriptor_set_layout(dvr_descriptor_set_layout_desc* desc) {
+    dvr_descriptor_set_layout_binding_desc* sorted =
+        malloc(sizeof(dvr_descriptor_set_layout_binding_desc) * (desc->num_bindings + 1));
+    if (sorted == NULL) {
+        return DVR_ERROR(dvr_descriptor_set_layout, "failed to allocate layout bindings");
+    }
+    for (u32 i = 0; i < desc->num_bindings; i++) {
+        sorted[i] = desc->bindings[i];
+        // only used by descriptor writes
+        sorted[i].array_element = 0;
+    }
+    qsort(
+        sorted,
+        desc->num_bindings,
+        sizeof(dvr_descriptor_set_layout_binding_desc),
+        dvr_compare_layout_bindings
+    );
+    u64 hash = dvr_hash_layout_bindings(sorted, desc->num_bindings);
+
+    for (u16 i = 0; i < DVR_MAX_DESCRIPTOR_SET_LAYOUTS; i++) {
+        if (!dvr_is_slot_used(g_dvr_state.res.descriptor_set_layout_usage_map, i)) {
+            continue;
+        }
+
+        dvr_descriptor_set_layout_data* data = &g_dvr_state.res.descriptor_set_layouts[i];
+        if (data->hash == hash && data->num_bindings == desc->num_bindings &&
+            memcmp(
+                data->bindings,
+                sorted,
+                sizeof(dvr_descriptor_set_layout_binding_desc) * desc->num_bindings
+            ) == 0) {
+            free(sorted);
+            data->refs++;
+            return DVR_OK(dvr_descriptor_set_layout, (dvr_descriptor_set_layout){ .id = i });
+        }
+    }
+
+    VkDescriptorSetLayoutBinding bindings[desc->num_bindings + 1];
+    for (u32 i = 0; i < desc->num_bindings; i++) {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = sorted[i].binding,
+            .descriptorType = sorted[i].type,
+            .descriptorCount = sorted[i].count,
+            .stageFlags = sorted[i].stage_flags,
+            .pImmutableSamplers = NULL,
+        };
     }
 
     VkDescriptorSetLayoutCreateInfo layout_info = {
@@ -1341,11 +2428,16 @@ dvr_create_descriptor_set_layout(dvr_descriptor_set_layout_desc* desc) {
 
     VkDescriptorSetLayout layout;
     if (vkCreateDescriptorSetLayout(DVR_DEVICE, &layout_info, NULL, &layout) != VK_SUCCESS) {
+        free(sorted);
         return DVR_ERROR(dvr_descriptor_set_layout, "failed to create descriptor set layout");
     }
 
     dvr_descriptor_set_layout_data layout_data = {
         .vk.layout = layout,
+        .refs = 1,
+        .hash = hash,
+        .num_bindings = desc->num_bindings,
+        .bindings = sorted,
     };
 
     u16 free_slot = dvr_find_free_slot(
@@ -1361,9 +2453,16 @@ dvr_create_descriptor_set_layout(dvr_descriptor_set_layout_desc* desc) {
 static void dvr_vk_destroy_descriptor_set_layout(dvr_descriptor_set_layout layout) {
     dvr_descriptor_set_layout_data* data = dvr_get_descriptor_set_layout_data(layout);
     vkDestroyDescriptorSetLayout(DVR_DEVICE, data->vk.layout, NULL);
+    free(data->bindings);
+    data->bindings = NULL;
 }
 
 void dvr_destroy_descriptor_set_layout(dvr_descriptor_set_layout layout) {
+    dvr_descriptor_set_layout_data* data = dvr_get_descriptor_set_layout_data(layout);
+    if (--data->refs > 0) {
+        return;
+    }
+
     dvr_vk_destroy_descriptor_set_layout(layout);
 
     dvr_set_slot_free(g_dvr_state.res.descriptor_set_layout_usage_map, layout.id);
@@ -1407,9 +2506,482 @@ void dvr_begin_render_pass(
 }
 
 void dvr_end_render_pass() {
+    // dvr_begin_swapchain_render_pass uses dynamic rendering when it is enabled
+    if (g_dvr_state.vk.rendering_active) {
+        dvr_end_rendering();
+        return;
+    }
+
     vkCmdEndRenderPass(DVR_COMMAND_BUFFER);
 }
 
+// DVR_RENDERING FUNCTIONS
+
+static VkImageAspectFlags dvr_vk_barrier_aspect(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+static void dvr_vk_layout_sync(
+    VkImageLayout layout,
+    VkPipelineStageFlags* stage,
+    VkAccessFlags* access
+) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+            *stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            *access = 0;
+            break;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            *stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            *access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            *stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                     VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            *access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+            *stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            *access = VK_ACCESS_SHADER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            *access = VK_ACCESS_TRANSFER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            *access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            *stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            *access = 0;
+            break;
+        default:
+            *stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            *access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            break;
+    }
+}
+
+static void dvr_vk_set_image_layout(dvr_image_data* img, VkImageLayout layout) {
+    if (g_dvr_state.frame.skipped) {
+        arrput(
+            g_dvr_state.frame.layout_journal,
+            ((dvr_image_layout_change){ .image = img, .layout = img->layout })
+        );
+    }
+    img->layout = layout;
+}
+
+/// Records a barrier moving `img` into `layout`. With `discard` the previous contents are
+/// not needed, which lets the driver skip the layout conversion.
+static void dvr_vk_cmd_transition_image(
+    VkCommandBuffer command_buffer,
+    dvr_image_data* img,
+    VkImageLayout layout,
+    bool discard
+) {
+    // reads don't need ordering against each other
+    if (img->layout == layout && (layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ||
+                                  layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL)) {
+        return;
+    }
+
+    VkImageLayout old_layout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : img->layout;
+
+    VkPipelineStageFlags src_stage, dst_stage;
+    VkAccessFlags src_access, dst_access;
+    dvr_vk_layout_sync(img->layout, &src_stage, &src_access);
+    dvr_vk_layout_sync(layout, &dst_stage, &dst_access);
+
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = img->vk.image,
+        .subresourceRange = {
+            .aspectMask = dvr_vk_barrier_aspect(img->vk.format),
+            .baseMipLevel = 0,
+            .levelCount = img->mip_level,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+    g_dvr_state.stats.current.barriers++;
+
+    dvr_vk_set_image_layout(img, layout);
+}
+
+DVR_RESULT(dvr_none) dvr_generate_mipmaps(dvr_image image) {
+    dvr_image_data* img = dvr_get_image_data(image);
+    if (img->mip_level < 2) {
+        return DVR_ERROR(dvr_none, "image has no mip levels to generate");
+    }
+
+    if (img->compute_mipgen) {
+        // per frame targets keep their views and descriptor sets
+        if (arrlenu(img->mipgen_sets) == 0) {
+            DVR_RESULT(dvr_none) res = dvr_vk_prepare_mipgen(img);
+            DVR_BUBBLE(res);
+        }
+        dvr_vk_cmd_compute_mipmaps(DVR_COMMAND_BUFFER, img, img->layout);
+    } else {
+        if (!dvr_vk_blit_mipmaps_supported(img->vk.format)) {
+            return DVR_ERROR(dvr_none, "image format does not support linear filtering");
+        }
+        dvr_vk_cmd_transition_image(
+            DVR_COMMAND_BUFFER,
+            img,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            false
+        );
+        dvr_vk_cmd_blit_mipmaps(DVR_COMMAND_BUFFER, img);
+    }
+
+    dvr_vk_set_image_layout(img, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+void dvr_transition_image(dvr_image image, VkImageLayout layout) {
+    dvr_vk_cmd_transition_image(DVR_COMMAND_BUFFER, dvr_get_image_data(image), layout, false);
+}
+
+// DVR_UPLOAD FUNCTIONS
+
+#define DVR_UPLOAD_ARENA_MIN_SIZE (32ull * 1024 * 1024)
+// satisfies the texel block and 4 byte alignment of buffer to image copies
+#define DVR_UPLOAD_ALIGNMENT 16
+
+static void dvr_defer_destroy(dvr_deferred_destroy entry, u64 extra_frames);
+
+static void dvr_vk_destroy_upload_arena(bool deferred) {
+    if (g_dvr_state.upload.buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkUnmapMemory(DVR_DEVICE, g_dvr_state.upload.memory);
+    if (deferred) {
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_BUFFER,
+                .buffer = {
+                    .buffer = g_dvr_state.upload.buffer,
+                    .memory = g_dvr_state.upload.memory,
+                },
+            },
+            0
+        );
+    } else {
+        vkDestroyBuffer(DVR_DEVICE, g_dvr_state.upload.buffer, NULL);
+        vkFreeMemory(DVR_DEVICE, g_dvr_state.upload.memory, NULL);
+    }
+    g_dvr_state.upload.buffer = VK_NULL_HANDLE;
+    g_dvr_state.upload.memory = VK_NULL_HANDLE;
+    g_dvr_state.upload.mapped = NULL;
+    g_dvr_state.upload.size = 0;
+    g_dvr_state.upload.head = 0;
+}
+
+/// Copies `data` into the upload arena and returns its offset. A full arena is retired with
+/// the current frame and replaced by a larger one.
+static DVR_RESULT(dvr_none) dvr_vk_stage_upload(dvr_range data, usize* offset) {
+    usize head = (g_dvr_state.upload.head + DVR_UPLOAD_ALIGNMENT - 1) &
+                 ~(usize)(DVR_UPLOAD_ALIGNMENT - 1);
+    if (g_dvr_state.upload.buffer == VK_NULL_HANDLE || head + data.size > g_dvr_state.upload.size) {
+        usize size = g_dvr_state.upload.size * 2;
+        size = size > DVR_UPLOAD_ARENA_MIN_SIZE ? size : DVR_UPLOAD_ARENA_MIN_SIZE;
+        size = size > data.size ? size : data.size;
+        dvr_vk_destroy_upload_arena(true);
+
+        DVR_RESULT(dvr_none)
+        res = dvr_vk_create_buffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &g_dvr_state.upload.buffer,
+            &g_dvr_state.upload.memory
+        );
+        DVR_BUBBLE(res);
+
+        void* mapped;
+        vkMapMemory(DVR_DEVICE, g_dvr_state.upload.memory, 0, size, 0, &mapped);
+        g_dvr_state.upload.mapped = mapped;
+        g_dvr_state.upload.size = size;
+        head = 0;
+    }
+
+    memcpy(g_dvr_state.upload.mapped + head, data.base, data.size);
+    g_dvr_state.upload.head = head + data.size;
+    g_dvr_state.stats.current.staging_bytes_uploaded += data.size;
+    *offset = head;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+bool dvr_frame_skipped(void) {
+    return g_dvr_state.frame.skipped;
+}
+
+u64 dvr_frame_index(void) {
+    return g_dvr_state.stats.current.frame_index;
+}
+
+DVR_RESULT(dvr_none) dvr_upload_image(
+    dvr_image image,
+    dvr_range data,
+    u32 num_levels,
+    const dvr_image_level* levels
+) {
+    if (g_dvr_state.frame.skipped) {
+        return DVR_ERROR(dvr_none, "uploads recorded into a skipped frame would be dropped");
+    }
+
+    dvr_image_data* img = dvr_get_image_data(image);
+    if (num_levels == 0 || num_levels > img->mip_level) {
+        return DVR_ERROR(dvr_none, "image doesn't have that many levels");
+    }
+
+    VkBufferImageCopy regions[32];
+    usize upload_begin, upload_end;
+    DVR_RESULT(u32)
+    regions_res = dvr_vk_image_upload_regions(
+        img->vk.format,
+        img->width,
+        img->height,
+        data,
+        num_levels,
+        levels,
+        regions,
+        &upload_begin,
+        &upload_end
+    );
+    DVR_BUBBLE_INTO(dvr_none, regions_res);
+
+    usize offset;
+    dvr_range span = {
+        .base = (u8*)data.base + upload_begin,
+        .size = upload_end - upload_begin,
+    };
+    DVR_RESULT(dvr_none) stage_res = dvr_vk_stage_upload(span, &offset);
+    DVR_BUBBLE(stage_res);
+    for (u32 i = 0; i < num_levels; i++) {
+        regions[i].bufferOffset += offset;
+    }
+
+    // every level is either written here or generated from the first one later
+    dvr_vk_cmd_transition_image(
+        DVR_COMMAND_BUFFER,
+        img,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        true
+    );
+    vkCmdCopyBufferToImage(
+        DVR_COMMAND_BUFFER,
+        g_dvr_state.upload.buffer,
+        img->vk.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        num_levels,
+        regions
+    );
+    dvr_vk_cmd_transition_image(
+        DVR_COMMAND_BUFFER,
+        img,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        false
+    );
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_upload_buffer(dvr_buffer buffer, dvr_range data, u64 offset) {
+    if (g_dvr_state.frame.skipped) {
+        return DVR_ERROR(dvr_none, "uploads recorded into a skipped frame would be dropped");
+    }
+
+    usize staging_offset;
+    DVR_RESULT(dvr_none) stage_res = dvr_vk_stage_upload(data, &staging_offset);
+    DVR_BUBBLE(stage_res);
+
+    VkBufferCopy region = {
+        .srcOffset = staging_offset,
+        .dstOffset = offset,
+        .size = data.size,
+    };
+    vkCmdCopyBuffer(
+        DVR_COMMAND_BUFFER,
+        g_dvr_state.upload.buffer,
+        dvr_get_buffer_data(buffer)->vk.buffer,
+        1,
+        &region
+    );
+
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+    };
+    vkCmdPipelineBarrier(
+        DVR_COMMAND_BUFFER,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        NULL,
+        0,
+        NULL
+    );
+    g_dvr_state.stats.current.barriers++;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static VkRenderingAttachmentInfoKHR dvr_vk_rendering_attachment(
+    dvr_rendering_attachment_desc* desc,
+    VkImageLayout layout,
+    VkResolveModeFlagBits resolve_mode,
+    bool transition
+) {
+    dvr_image_data* img = dvr_get_image_data(desc->image);
+    if (transition) {
+        dvr_vk_cmd_transition_image(
+            DVR_COMMAND_BUFFER,
+            img,
+            layout,
+            desc->load_op != VK_ATTACHMENT_LOAD_OP_LOAD
+        );
+    }
+
+    VkRenderingAttachmentInfoKHR info = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .imageView = img->vk.view,
+        .imageLayout = layout,
+        .resolveMode = VK_RESOLVE_MODE_NONE,
+        .loadOp = desc->load_op,
+        .storeOp = desc->store_op,
+        .clearValue = desc->clear_value,
+    };
+
+    if (desc->resolve) {
+        dvr_image_data* resolve_img = dvr_get_image_data(desc->resolve_image);
+        // the resolve overwrites the whole image
+        if (transition) {
+            dvr_vk_cmd_transition_image(DVR_COMMAND_BUFFER, resolve_img, layout, true);
+        }
+
+        info.resolveMode = resolve_mode;
+        info.resolveImageView = resolve_img->vk.view;
+        info.resolveImageLayout = layout;
+    }
+
+    return info;
+}
+
+/// With `transition` unset the caller already moved the attachments into attachment layouts.
+static void dvr_vk_begin_rendering(dvr_rendering_desc* desc, bool transition) {
+    VkRenderingAttachmentInfoKHR color_attachments[DVR_MAX_RENDER_PASS_COLOR_ATTACHMENTS];
+    VkRenderingAttachmentInfoKHR depth_attachment;
+
+    u32 width = desc->width;
+    u32 height = desc->height;
+
+    for (u32 i = 0; i < desc->num_color_attachments; i++) {
+        color_attachments[i] = dvr_vk_rendering_attachment(
+            &desc->color_attachments[i],
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_RESOLVE_MODE_AVERAGE_BIT,
+            transition
+        );
+
+        if (width == 0 || height == 0) {
+            dvr_image_data* img = dvr_get_image_data(desc->color_attachments[i].image);
+            width = img->width;
+            height = img->height;
+        }
+    }
+
+    bool has_stencil = false;
+    if (desc->has_depth_attachment) {
+        // depth can't be averaged, resolve to the first sample
+        depth_attachment = dvr_vk_rendering_attachment(
+            &desc->depth_attachment,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_RESOLVE_MODE_SAMPLE_ZERO_BIT,
+            transition
+        );
+
+        dvr_image_data* img = dvr_get_image_data(desc->depth_attachment.image);
+        has_stencil = (dvr_vk_barrier_aspect(img->vk.format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+        if (width == 0 || height == 0) {
+            width = img->width;
+            height = img->height;
+        }
+    }
+
+    VkRect2D render_area = {
+        .offset = { 0, 0 },
+        .extent = { width, height },
+    };
+
+    VkRenderingInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+        .renderArea = render_area,
+        .layerCount = 1,
+        .colorAttachmentCount = desc->num_color_attachments,
+        .pColorAttachments = color_attachments,
+        .pDepthAttachment = desc->has_depth_attachment ? &depth_attachment : NULL,
+        .pStencilAttachment = has_stencil ? &depth_attachment : NULL,
+    };
+
+    g_dvr_state.vk.cmd_begin_rendering(DVR_COMMAND_BUFFER, &rendering_info);
+    g_dvr_state.vk.rendering_active = true;
+
+    vkCmdSetViewport(
+        DVR_COMMAND_BUFFER,
+        0,
+        1,
+        &(VkViewport){
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = (f32)width,
+            .height = (f32)height,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+        }
+    );
+    vkCmdSetScissor(DVR_COMMAND_BUFFER, 0, 1, &render_area);
+}
+
+void dvr_begin_rendering(dvr_rendering_desc* desc) {
+    dvr_vk_begin_rendering(desc, true);
+}
+
+void dvr_end_rendering(void) {
+    g_dvr_state.vk.cmd_end_rendering(DVR_COMMAND_BUFFER);
+    g_dvr_state.vk.rendering_active = false;
+}
+
 // DVR_DESCRIPTOR_SET FUNCTIONS
 
 static dvr_descriptor_set_data* dvr_get_descriptor_set_data(dvr_descriptor_set set) {
@@ -1550,6 +3122,7 @@ void dvr_bind_descriptor_set(dvr_pipeline pipeline, dvr_descriptor_set set) {
         0,
         NULL
     );
+    g_dvr_state.stats.current.descriptor_set_binds++;
 }
 
 void dvr_bind_descriptor_set_compute(dvr_compute_pipeline pipeline, dvr_descriptor_set set) {
@@ -1566,6 +3139,7 @@ void dvr_bind_descriptor_set_compute(dvr_compute_pipeline pipeline, dvr_descript
         0,
         NULL
     );
+    g_dvr_state.stats.current.descriptor_set_binds++;
 }
 
 // DVR_SHADER_MODULE FUNCTIONS
@@ -1592,7 +3166,14 @@ DVR_RESULT(dvr_shader_module) dvr_create_shader_module(dvr_shader_module_desc* d
 
     dvr_shader_module_data mod = {
         .vk.module = shader_module,
+        .serial = ++g_dvr_state.res.next_serial,
     };
+    DVR_RESULT(dvr_none) reflect_res = dvr_reflect_shader(desc->code, &mod.reflection);
+    if (reflect_res.is_ok) {
+        mod.reflected = true;
+    } else {
+        DVRLOG_WARNING("failed to reflect shader module: %s", reflect_res.error.message);
+    }
 
     u16 free_slot =
         dvr_find_free_slot(g_dvr_state.res.shader_module_usage_map, DVR_MAX_SHADER_MODULES);
@@ -1613,30 +3194,162 @@ void dvr_destroy_shader_module(dvr_shader_module module) {
     dvr_set_slot_free(g_dvr_state.res.shader_module_usage_map, module.id);
 }
 
-// DVR_PIPELINE FUNCTIONS
+const dvr_shader_reflection* dvr_get_shader_reflection(dvr_shader_module module) {
+    dvr_shader_module_data* data = dvr_get_shader_module_data(module);
+    return data->reflected ? &data->reflection : NULL;
+}
 
-static dvr_pipeline_data* dvr_get_pipeline_data(dvr_pipeline pipeline) {
-    if (pipeline.id >= DVR_MAX_PIPELINES) {
-        DVRLOG_ERROR("pipeline id out of range: %u", pipeline.id);
-        return NULL;
+static void dvr_release_reflected_layout(dvr_reflected_layout* layout) {
+    for (u32 i = 0; i < layout->num_set_layouts; i++) {
+        dvr_destroy_descriptor_set_layout(layout->set_layouts[i]);
     }
-
-    return &g_dvr_state.res.pipelines[pipeline.id];
+    layout->num_set_layouts = 0;
 }
 
-DVR_RESULT(dvr_pipeline) dvr_create_pipeline(dvr_pipeline_desc* desc) {
-    VkPipelineShaderStageCreateInfo shader_stages[desc->num_stages];
+// a vertex input without an attribute reads undefined values, which is easy to miss
+static void dvr_check_reflected_vertex_input(const dvr_pipeline_desc* desc) {
     for (u32 i = 0; i < desc->num_stages; i++) {
-        shader_stages[i] = (VkPipelineShaderStageCreateInfo){
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = desc->stages[i].stage,
-            .module = dvr_get_shader_module_data(desc->stages[i].shader_module)->vk.module,
-            .pName = desc->stages[i].entry_point,
-        };
+        const dvr_shader_reflection* reflection =
+            dvr_get_shader_reflection(desc->stages[i].shader_module);
+        if (reflection == NULL || reflection->stage != VK_SHADER_STAGE_VERTEX_BIT) {
+            continue;
+        }
+
+        for (u32 j = 0; j < reflection->num_vertex_inputs; j++) {
+            u32 location = reflection->vertex_inputs[j].location;
+            bool found = false;
+            for (u32 k = 0; k < desc->vertex_input.num_attributes; k++) {
+                found |= desc->vertex_input.attributes[k].location == location;
+            }
+            if (!found) {
+                DVRLOG_WARNING("vertex shader input at location %u has no attribute", location);
+            }
+        }
     }
+}
 
-    VkDynamicState dynamic_states[2] = {
-        VK_DYNAMIC_STATE_VIEWPORT,
+/// Merge the reflection of every stage into set layouts and a single push constant range.
+static DVR_RESULT(dvr_none) dvr_reflect_layout(
+    const dvr_shader_module* modules,
+    u32 num_modules,
+    dvr_reflected_layout* layout
+) {
+    *layout = (dvr_reflected_layout){ 0 };
+
+    dvr_descriptor_set_layout_binding_desc
+        bindings[DVR_SHADER_MAX_DESCRIPTOR_SETS][DVR_SHADER_MAX_BINDINGS];
+    u32 num_bindings[DVR_SHADER_MAX_DESCRIPTOR_SETS] = { 0 };
+    u32 num_sets = 0;
+    u32 push_constant_end = 0;
+    for (u32 i = 0; i < num_modules; i++) {
+        const dvr_shader_reflection* reflection = dvr_get_shader_reflection(modules[i]);
+        if (reflection == NULL) {
+            return DVR_ERROR(dvr_none, "shader module has no reflection");
+        }
+
+        for (u32 j = 0; j < reflection->num_bindings; j++) {
+            const dvr_shader_binding* binding = &reflection->bindings[j];
+            dvr_descriptor_set_layout_binding_desc* set_bindings = bindings[binding->set];
+            u32 k = 0;
+            while (k < num_bindings[binding->set] && set_bindings[k].binding != binding->binding) {
+                k++;
+            }
+
+            if (k == num_bindings[binding->set]) {
+                if (k == DVR_SHADER_MAX_BINDINGS) {
+                    return DVR_ERROR(dvr_none, "shader stages use too many bindings in a set");
+                }
+                set_bindings[k] = (dvr_descriptor_set_layout_binding_desc){
+                    .binding = binding->binding,
+                    .type = binding->type,
+                    .count = binding->count,
+                };
+                num_bindings[binding->set]++;
+            } else if (set_bindings[k].type != binding->type ||
+                       set_bindings[k].count != binding->count) {
+                return DVR_ERROR(dvr_none, "shader stages disagree on a descriptor binding");
+            }
+            set_bindings[k].stage_flags |= reflection->stage;
+            num_sets = binding->set + 1 > num_sets ? binding->set + 1 : num_sets;
+        }
+
+        if (reflection->push_constant_size > 0) {
+            VkPushConstantRange* range = &layout->push_constant_range;
+            u32 end = reflection->push_constant_offset + reflection->push_constant_size;
+            if (layout->num_push_constant_ranges == 0 ||
+                reflection->push_constant_offset < range->offset) {
+                range->offset = reflection->push_constant_offset;
+            }
+            push_constant_end = end > push_constant_end ? end : push_constant_end;
+            range->stageFlags |= reflection->stage;
+            layout->num_push_constant_ranges = 1;
+        }
+    }
+    layout->push_constant_range.size = push_constant_end - layout->push_constant_range.offset;
+
+    // sets without bindings below the last used one still need a layout
+    for (u32 set = 0; set < num_sets; set++) {
+        DVR_RESULT(dvr_descriptor_set_layout)
+        set_layout_res = dvr_create_descriptor_set_layout(&(dvr_descriptor_set_layout_desc){
+            .num_bindings = num_bindings[set],
+            .bindings = bindings[set],
+        });
+        if (!set_layout_res.is_ok) {
+            dvr_release_reflected_layout(layout);
+            DVR_BUBBLE_INTO(dvr_none, set_layout_res);
+        }
+        layout->set_layouts[layout->num_set_layouts++] = DVR_UNWRAP(set_layout_res);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_descriptor_set_layout)
+    dvr_reflected_set_layout(const dvr_reflected_layout* layout, u32 set) {
+    if (set >= layout->num_set_layouts) {
+        return DVR_ERROR(dvr_descriptor_set_layout, "pipeline has no reflected layout for the set");
+    }
+
+    return DVR_OK(dvr_descriptor_set_layout, layout->set_layouts[set]);
+}
+
+// DVR_PIPELINE FUNCTIONS
+
+static dvr_pipeline_data* dvr_get_pipeline_data(dvr_pipeline pipeline) {
+    if (pipeline.id >= DVR_MAX_PIPELINES) {
+        DVRLOG_ERROR("pipeline id out of range: %u", pipeline.id);
+        return NULL;
+    }
+
+    return &g_dvr_state.res.pipelines[pipeline.id];
+}
+
+static VkSpecializationInfo dvr_vk_specialization_info(const dvr_specialization_desc* desc) {
+    return (VkSpecializationInfo){
+        .mapEntryCount = desc->num_entries,
+        .pMapEntries = desc->entries,
+        .dataSize = desc->data.size,
+        .pData = desc->data.base,
+    };
+}
+
+static DVR_RESULT(dvr_pipeline) dvr_vk_create_pipeline(dvr_pipeline_desc* desc) {
+    VkPipelineShaderStageCreateInfo shader_stages[desc->num_stages];
+    VkSpecializationInfo specialization_infos[desc->num_stages];
+    for (u32 i = 0; i < desc->num_stages; i++) {
+        specialization_infos[i] = dvr_vk_specialization_info(&desc->stages[i].specialization);
+        shader_stages[i] = (VkPipelineShaderStageCreateInfo){
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = desc->stages[i].stage,
+            .module = dvr_get_shader_module_data(desc->stages[i].shader_module)->vk.module,
+            .pName = desc->stages[i].entry_point,
+            .pSpecializationInfo =
+                desc->stages[i].specialization.num_entries > 0 ? &specialization_infos[i] : NULL,
+        };
+    }
+
+    VkDynamicState dynamic_states[2] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
         VK_DYNAMIC_STATE_SCISSOR,
     };
 
@@ -1735,25 +3448,46 @@ DVR_RESULT(dvr_pipeline) dvr_create_pipeline(dvr_pipeline_desc* desc) {
         .blendConstants = { 0.0f, 0.0f, 0.0f, 0.0f },
     };
 
-    VkDescriptorSetLayout layouts[desc->layout.num_desc_set_layouts];
+    u32 num_set_layouts = desc->layout.num_desc_set_layouts;
+    dvr_descriptor_set_layout* set_layouts = desc->layout.desc_set_layouts;
+    u32 num_push_constant_ranges = desc->layout.num_push_constant_ranges;
+    VkPushConstantRange* push_constant_ranges = desc->layout.push_constant_ranges;
+    dvr_reflected_layout reflected = { 0 };
+    if (desc->layout.reflect) {
+        dvr_shader_module modules[desc->num_stages];
+        for (u32 i = 0; i < desc->num_stages; i++) {
+            modules[i] = desc->stages[i].shader_module;
+        }
+        DVR_RESULT(dvr_none)
+        reflect_res = dvr_reflect_layout(modules, desc->num_stages, &reflected);
+        DVR_BUBBLE_INTO(dvr_pipeline, reflect_res);
+        dvr_check_reflected_vertex_input(desc);
+
+        num_set_layouts = reflected.num_set_layouts;
+        set_layouts = reflected.set_layouts;
+        num_push_constant_ranges = reflected.num_push_constant_ranges;
+        push_constant_ranges = &reflected.push_constant_range;
+    }
+
+    VkDescriptorSetLayout layouts[num_set_layouts + 1];
 
-    for (u32 i = 0; i < desc->layout.num_desc_set_layouts; i++) {
-        layouts[i] =
-            dvr_get_descriptor_set_layout_data(desc->layout.desc_set_layouts[i])->vk.layout;
+    for (u32 i = 0; i < num_set_layouts; i++) {
+        layouts[i] = dvr_get_descriptor_set_layout_data(set_layouts[i])->vk.layout;
     }
 
     VkPipelineLayoutCreateInfo pipeline_layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = desc->layout.num_desc_set_layouts,
+        .setLayoutCount = num_set_layouts,
         .pSetLayouts = layouts,
-        .pushConstantRangeCount = desc->layout.num_push_constant_ranges,
-        .pPushConstantRanges = desc->layout.push_constant_ranges,
+        .pushConstantRangeCount = num_push_constant_ranges,
+        .pPushConstantRanges = push_constant_ranges,
     };
 
     VkPipelineLayout pipeline_layout;
 
     if (vkCreatePipelineLayout(DVR_DEVICE, &pipeline_layout_info, NULL, &pipeline_layout) !=
         VK_SUCCESS) {
+        dvr_release_reflected_layout(&reflected);
         return DVR_ERROR(dvr_pipeline, "failed to create pipeline layout");
     }
 
@@ -1770,27 +3504,47 @@ DVR_RESULT(dvr_pipeline) dvr_create_pipeline(dvr_pipeline_desc* desc) {
         .pColorBlendState = &color_blending,
         .pDynamicState = &dynamic_state,
         .layout = pipeline_layout,
-        .renderPass = dvr_get_render_pass_data(desc->render_pass)->vk.render_pass,
         .subpass = 0,
         .basePipelineHandle = VK_NULL_HANDLE,
     };
 
+    VkFormat depth_format = desc->rendering.depth_format;
+    VkPipelineRenderingCreateInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+        .colorAttachmentCount = desc->rendering.num_color_formats,
+        .pColorAttachmentFormats = desc->rendering.color_formats,
+        .depthAttachmentFormat = depth_format,
+        .stencilAttachmentFormat =
+            (dvr_vk_barrier_aspect(depth_format) & VK_IMAGE_ASPECT_STENCIL_BIT)
+                ? depth_format
+                : VK_FORMAT_UNDEFINED,
+    };
+
+    if (desc->rendering.num_color_formats > 0 || depth_format != VK_FORMAT_UNDEFINED) {
+        pipeline_info.pNext = &rendering_info;
+        pipeline_info.renderPass = VK_NULL_HANDLE;
+    } else {
+        pipeline_info.renderPass = dvr_get_render_pass_data(desc->render_pass)->vk.render_pass;
+    }
+
     VkPipeline pipeline;
     if (vkCreateGraphicsPipelines(
             DVR_DEVICE,
-            VK_NULL_HANDLE,
+            g_dvr_state.vk.pipeline_cache,
             1,
             &pipeline_info,
             NULL,
             &pipeline
         ) != VK_SUCCESS) {
         vkDestroyPipelineLayout(DVR_DEVICE, pipeline_layout, NULL);
+        dvr_release_reflected_layout(&reflected);
         return DVR_ERROR(dvr_pipeline, "failed to create graphics pipeline");
     }
 
     dvr_pipeline_data pipe = {
         .vk.pipeline = pipeline,
         .vk.layout = pipeline_layout,
+        .reflected = reflected,
     };
 
     u16 free_slot = dvr_find_free_slot(g_dvr_state.res.pipeline_usage_map, DVR_MAX_PIPELINES);
@@ -1800,21 +3554,379 @@ DVR_RESULT(dvr_pipeline) dvr_create_pipeline(dvr_pipeline_desc* desc) {
     return DVR_OK(dvr_pipeline, (dvr_pipeline){ .id = free_slot });
 }
 
+static void dvr_key_put(u8** key, const void* data, usize size) {
+    if (size > 0) {
+        memcpy(arraddnptr(*key, size), data, size);
+    }
+}
+
+static void dvr_key_put_u32(u8** key, u32 value) {
+    dvr_key_put(key, &value, sizeof(value));
+}
+
+static void dvr_key_put_u64(u8** key, u64 value) {
+    dvr_key_put(key, &value, sizeof(value));
+}
+
+/// Serialize everything that makes two pipelines differ, field by field so that padding and
+/// pointers don't matter. Objects are identified by serials or contents rather than their
+/// slots, which get reused. Viewport and scissor are dynamic state and left out.
+static u8* dvr_pipeline_key(const dvr_pipeline_desc* desc) {
+    u8* key = NULL;
+
+    dvr_key_put_u32(&key, desc->num_stages);
+    for (u32 i = 0; i < desc->num_stages; i++) {
+        const dvr_pipeline_stage_desc* stage = &desc->stages[i];
+        dvr_key_put_u32(&key, stage->stage);
+        dvr_key_put_u64(&key, dvr_get_shader_module_data(stage->shader_module)->serial);
+        dvr_key_put(&key, stage->entry_point, strlen(stage->entry_point) + 1);
+
+        const dvr_specialization_desc* specialization = &stage->specialization;
+        dvr_key_put_u32(&key, specialization->num_entries);
+        for (u32 j = 0; j < specialization->num_entries; j++) {
+            dvr_key_put_u32(&key, specialization->entries[j].constantID);
+            dvr_key_put_u32(&key, specialization->entries[j].offset);
+            dvr_key_put_u64(&key, specialization->entries[j].size);
+        }
+        dvr_key_put_u64(&key, specialization->num_entries > 0 ? specialization->data.size : 0);
+        if (specialization->num_entries > 0) {
+            dvr_key_put(&key, specialization->data.base, specialization->data.size);
+        }
+    }
+
+    // same check as pipeline creation for which of the two is used
+    if (desc->rendering.num_color_formats > 0 ||
+        desc->rendering.depth_format != VK_FORMAT_UNDEFINED) {
+        dvr_key_put_u32(&key, 1);
+        dvr_key_put_u32(&key, desc->rendering.num_color_formats);
+        for (u32 i = 0; i < desc->rendering.num_color_formats; i++) {
+            dvr_key_put_u32(&key, desc->rendering.color_formats[i]);
+        }
+        dvr_key_put_u32(&key, desc->rendering.depth_format);
+    } else {
+        dvr_key_put_u32(&key, 0);
+        dvr_key_put_u64(&key, dvr_get_render_pass_data(desc->render_pass)->serial);
+        dvr_key_put_u32(&key, desc->subpass);
+    }
+
+    dvr_key_put_u32(&key, desc->vertex_input.num_bindings);
+    for (u32 i = 0; i < desc->vertex_input.num_bindings; i++) {
+        const VkVertexInputBindingDescription* binding = &desc->vertex_input.bindings[i];
+        dvr_key_put_u32(&key, binding->binding);
+        dvr_key_put_u32(&key, binding->stride);
+        dvr_key_put_u32(&key, binding->inputRate);
+    }
+    dvr_key_put_u32(&key, desc->vertex_input.num_attributes);
+    for (u32 i = 0; i < desc->vertex_input.num_attributes; i++) {
+        const VkVertexInputAttributeDescription* attribute = &desc->vertex_input.attributes[i];
+        dvr_key_put_u32(&key, attribute->location);
+        dvr_key_put_u32(&key, attribute->binding);
+        dvr_key_put_u32(&key, attribute->format);
+        dvr_key_put_u32(&key, attribute->offset);
+    }
+
+    dvr_key_put_u32(&key, desc->rasterization.topology);
+    dvr_key_put_u32(&key, desc->rasterization.polygon_mode);
+    dvr_key_put_u32(&key, desc->rasterization.primitive_restart_enable);
+    dvr_key_put_u32(&key, desc->rasterization.rasterizer_discard_enable);
+    dvr_key_put(&key, &desc->rasterization.line_width, sizeof(f32));
+    dvr_key_put_u32(&key, desc->rasterization.cull_mode);
+    dvr_key_put_u32(&key, desc->rasterization.front_face);
+
+    dvr_key_put_u32(&key, desc->depth_stencil.depth_test_enable);
+    dvr_key_put_u32(&key, desc->depth_stencil.depth_write_enable);
+    dvr_key_put_u32(&key, desc->depth_stencil.depth_bias_enable);
+    dvr_key_put_u32(&key, desc->depth_stencil.depth_clamp_enable);
+    dvr_key_put(&key, &desc->depth_stencil.depth_bias_constant_factor, sizeof(f32));
+    dvr_key_put(&key, &desc->depth_stencil.depth_bias_clamp, sizeof(f32));
+    dvr_key_put(&key, &desc->depth_stencil.depth_bias_slope_factor, sizeof(f32));
+    dvr_key_put_u32(&key, desc->depth_stencil.depth_compare_op);
+    dvr_key_put_u32(&key, desc->depth_stencil.depth_bounds_test_enable);
+    dvr_key_put(&key, &desc->depth_stencil.min_depth_bounds, sizeof(f32));
+    dvr_key_put(&key, &desc->depth_stencil.max_depth_bounds, sizeof(f32));
+    dvr_key_put_u32(&key, desc->depth_stencil.stencil_test_enable);
+    // all 32-bit members, no padding
+    dvr_key_put(&key, &desc->depth_stencil.front, sizeof(VkStencilOpState));
+    dvr_key_put(&key, &desc->depth_stencil.back, sizeof(VkStencilOpState));
+
+    dvr_key_put_u32(&key, desc->multisample.sample_shading_enable);
+    dvr_key_put(&key, &desc->multisample.min_sample_shading, sizeof(f32));
+    dvr_key_put_u32(&key, desc->multisample.rasterization_samples);
+    dvr_key_put_u32(&key, desc->multisample.sample_mask != NULL);
+    if (desc->multisample.sample_mask != NULL) {
+        dvr_key_put(
+            &key,
+            desc->multisample.sample_mask,
+            ((desc->multisample.rasterization_samples + 31u) / 32u) * sizeof(VkSampleMask)
+        );
+    }
+    dvr_key_put_u32(&key, desc->multisample.alpha_to_coverage_enable);
+    dvr_key_put_u32(&key, desc->multisample.alpha_to_one_enable);
+
+    dvr_key_put_u32(&key, desc->color_blend.blend_enable);
+    dvr_key_put_u32(&key, desc->color_blend.num_attachments);
+    dvr_key_put_u32(&key, desc->color_blend.src_color_blend_factor);
+    dvr_key_put_u32(&key, desc->color_blend.dst_color_blend_factor);
+    dvr_key_put_u32(&key, desc->color_blend.color_blend_op);
+    dvr_key_put_u32(&key, desc->color_blend.src_alpha_blend_factor);
+    dvr_key_put_u32(&key, desc->color_blend.dst_alpha_blend_factor);
+    dvr_key_put_u32(&key, desc->color_blend.alpha_blend_op);
+
+    // reflected layouts follow from the shader modules, set layouts are deduplicated by
+    // contents so their hashes identify them
+    dvr_key_put_u32(&key, desc->layout.reflect);
+    if (!desc->layout.reflect) {
+        dvr_key_put_u32(&key, desc->layout.num_desc_set_layouts);
+        for (u32 i = 0; i < desc->layout.num_desc_set_layouts; i++) {
+            dvr_descriptor_set_layout_data* layout =
+                dvr_get_descriptor_set_layout_data(desc->layout.desc_set_layouts[i]);
+            dvr_key_put_u64(&key, layout->hash);
+            dvr_key_put_u32(&key, layout->num_bindings);
+            for (u32 j = 0; j < layout->num_bindings; j++) {
+                dvr_key_put_u32(&key, layout->bindings[j].binding);
+                dvr_key_put_u32(&key, layout->bindings[j].type);
+                dvr_key_put_u32(&key, layout->bindings[j].count);
+                dvr_key_put_u32(&key, layout->bindings[j].stage_flags);
+            }
+        }
+        dvr_key_put_u32(&key, desc->layout.num_push_constant_ranges);
+        for (u32 i = 0; i < desc->layout.num_push_constant_ranges; i++) {
+            dvr_key_put_u32(&key, desc->layout.push_constant_ranges[i].stageFlags);
+            dvr_key_put_u32(&key, desc->layout.push_constant_ranges[i].offset);
+            dvr_key_put_u32(&key, desc->layout.push_constant_ranges[i].size);
+        }
+    }
+
+    return key;
+}
+
+static void* dvr_pipeline_desc_dup(dvr_pipeline_desc_copy* copy, const void* data, usize size) {
+    if (data == NULL || size == 0) {
+        return NULL;
+    }
+
+    void* dup = malloc(size);
+    memcpy(dup, data, size);
+    arrput(copy->allocations, dup);
+    return dup;
+}
+
+static dvr_pipeline_desc_copy* dvr_copy_pipeline_desc(const dvr_pipeline_desc* desc) {
+    dvr_pipeline_desc_copy* copy = malloc(sizeof(dvr_pipeline_desc_copy));
+    *copy = (dvr_pipeline_desc_copy){ .desc = *desc };
+
+    dvr_pipeline_stage_desc* stages = dvr_pipeline_desc_dup(
+        copy,
+        desc->stages,
+        desc->num_stages * sizeof(dvr_pipeline_stage_desc)
+    );
+    for (u32 i = 0; i < desc->num_stages; i++) {
+        arrput(
+            copy->module_serials,
+            dvr_get_shader_module_data(stages[i].shader_module)->serial
+        );
+
+        dvr_specialization_desc* specialization = &stages[i].specialization;
+        stages[i].entry_point =
+            dvr_pipeline_desc_dup(copy, stages[i].entry_point, strlen(stages[i].entry_point) + 1);
+        specialization->entries = dvr_pipeline_desc_dup(
+            copy,
+            specialization->entries,
+            specialization->num_entries * sizeof(VkSpecializationMapEntry)
+        );
+        specialization->data.base =
+            dvr_pipeline_desc_dup(copy, specialization->data.base, specialization->data.size);
+    }
+    copy->desc.stages = stages;
+
+    copy->desc.vertex_input.bindings = dvr_pipeline_desc_dup(
+        copy,
+        desc->vertex_input.bindings,
+        desc->vertex_input.num_bindings * sizeof(VkVertexInputBindingDescription)
+    );
+    copy->desc.vertex_input.attributes = dvr_pipeline_desc_dup(
+        copy,
+        desc->vertex_input.attributes,
+        desc->vertex_input.num_attributes * sizeof(VkVertexInputAttributeDescription)
+    );
+    copy->desc.multisample.sample_mask = dvr_pipeline_desc_dup(
+        copy,
+        desc->multisample.sample_mask,
+        ((desc->multisample.rasterization_samples + 31u) / 32u) * sizeof(VkSampleMask)
+    );
+    copy->desc.layout.desc_set_layouts = dvr_pipeline_desc_dup(
+        copy,
+        desc->layout.desc_set_layouts,
+        desc->layout.num_desc_set_layouts * sizeof(dvr_descriptor_set_layout)
+    );
+    copy->desc.layout.push_constant_ranges = dvr_pipeline_desc_dup(
+        copy,
+        desc->layout.push_constant_ranges,
+        desc->layout.num_push_constant_ranges * sizeof(VkPushConstantRange)
+    );
+
+    return copy;
+}
+
+static void dvr_free_pipeline_desc(dvr_pipeline_desc_copy* copy) {
+    if (copy == NULL) {
+        return;
+    }
+
+    for (usize i = 0; i < arrlenu(copy->allocations); i++) {
+        free(copy->allocations[i]);
+    }
+    arrfree(copy->allocations);
+    arrfree(copy->module_serials);
+    free(copy);
+}
+
+DVR_RESULT(dvr_pipeline) dvr_create_pipeline(dvr_pipeline_desc* desc) {
+    u8* key = dvr_pipeline_key(desc);
+    u64 hash = dvr_hash_bytes(DVR_HASH_SEED, key, arrlenu(key));
+
+    for (u16 i = 0; i < DVR_MAX_PIPELINES; i++) {
+        if (!dvr_is_slot_used(g_dvr_state.res.pipeline_usage_map, i)) {
+            continue;
+        }
+
+        dvr_pipeline_data* data = &g_dvr_state.res.pipelines[i];
+        if (data->hash == hash && arrlenu(data->key) == arrlenu(key) &&
+            memcmp(data->key, key, arrlenu(key)) == 0) {
+            arrfree(key);
+            data->refs++;
+            return DVR_OK(dvr_pipeline, (dvr_pipeline){ .id = i });
+        }
+    }
+
+    DVR_RESULT(dvr_pipeline) pipeline_res = dvr_vk_create_pipeline(desc);
+    if (!pipeline_res.is_ok) {
+        arrfree(key);
+        return pipeline_res;
+    }
+
+    dvr_pipeline_data* data = dvr_get_pipeline_data(DVR_UNWRAP(pipeline_res));
+    data->refs = 1;
+    data->hash = hash;
+    data->key = key;
+    data->desc = dvr_copy_pipeline_desc(desc);
+
+    return pipeline_res;
+}
+
+DVR_RESULT(dvr_pipeline)
+dvr_create_pipeline_variant(dvr_pipeline base, const dvr_pipeline_variant_desc* variant) {
+    dvr_pipeline_desc_copy* base_desc = dvr_get_pipeline_data(base)->desc;
+    dvr_pipeline_desc desc = base_desc->desc;
+    dvr_pipeline_stage_desc stages[desc.num_stages + 1];
+    for (u32 i = 0; i < desc.num_stages; i++) {
+        stages[i] = desc.stages[i];
+
+        dvr_shader_module module = stages[i].shader_module;
+        if (!dvr_is_slot_used(g_dvr_state.res.shader_module_usage_map, module.id) ||
+            dvr_get_shader_module_data(module)->serial != base_desc->module_serials[i]) {
+            return DVR_ERROR(dvr_pipeline, "the shader modules of the base pipeline are destroyed");
+        }
+    }
+    desc.stages = stages;
+
+    if (variant->flags & DVR_PIPELINE_VARIANT_TOPOLOGY) {
+        desc.rasterization.topology = variant->topology;
+    }
+    if (variant->flags & DVR_PIPELINE_VARIANT_POLYGON_MODE) {
+        desc.rasterization.polygon_mode = variant->polygon_mode;
+    }
+    if (variant->flags & DVR_PIPELINE_VARIANT_CULL_MODE) {
+        desc.rasterization.cull_mode = variant->cull_mode;
+        desc.rasterization.front_face = variant->front_face;
+    }
+    if (variant->flags & DVR_PIPELINE_VARIANT_DEPTH) {
+        desc.depth_stencil.depth_test_enable = variant->depth_test_enable;
+        desc.depth_stencil.depth_write_enable = variant->depth_write_enable;
+        desc.depth_stencil.depth_compare_op = variant->depth_compare_op;
+    }
+    if (variant->flags & DVR_PIPELINE_VARIANT_BLEND) {
+        desc.color_blend.blend_enable = variant->blend_enable;
+        desc.color_blend.src_color_blend_factor = variant->src_color_blend_factor;
+        desc.color_blend.dst_color_blend_factor = variant->dst_color_blend_factor;
+        desc.color_blend.color_blend_op = variant->color_blend_op;
+        desc.color_blend.src_alpha_blend_factor = variant->src_alpha_blend_factor;
+        desc.color_blend.dst_alpha_blend_factor = variant->dst_alpha_blend_factor;
+        desc.color_blend.alpha_blend_op = variant->alpha_blend_op;
+    }
+    if (variant->flags & DVR_PIPELINE_VARIANT_SPECIALIZATION) {
+        for (u32 i = 0; i < desc.num_stages; i++) {
+            stages[i].specialization = variant->specializations[i];
+        }
+    }
+
+    return dvr_create_pipeline(&desc);
+}
+
 static void dvr_vk_destroy_pipeline(dvr_pipeline pipeline) {
     dvr_pipeline_data* data = dvr_get_pipeline_data(pipeline);
     vkDestroyPipeline(DVR_DEVICE, data->vk.pipeline, NULL);
     vkDestroyPipelineLayout(DVR_DEVICE, data->vk.layout, NULL);
+    dvr_release_reflected_layout(&data->reflected);
+    arrfree(data->key);
+    dvr_free_pipeline_desc(data->desc);
+    data->desc = NULL;
 }
 
 void dvr_destroy_pipeline(dvr_pipeline pipeline) {
+    dvr_pipeline_data* data = dvr_get_pipeline_data(pipeline);
+    if (--data->refs > 0) {
+        return;
+    }
+
     dvr_vk_destroy_pipeline(pipeline);
 
     dvr_set_slot_free(g_dvr_state.res.pipeline_usage_map, pipeline.id);
 }
 
+static void dvr_defer_destroy(dvr_deferred_destroy entry, u64 extra_frames);
+
+DVR_RESULT(dvr_none) dvr_replace_pipeline(dvr_pipeline pipeline, dvr_pipeline replacement) {
+    dvr_pipeline_data* data = dvr_get_pipeline_data(pipeline);
+    dvr_pipeline_data* replacement_data = dvr_get_pipeline_data(replacement);
+    if (replacement_data->refs > 1) {
+        return DVR_ERROR(
+            dvr_none,
+            "can't replace a pipeline with one that is shared through the cache"
+        );
+    }
+
+    // the frame being recorded may have bound the old pipeline already
+    dvr_defer_destroy(
+        (dvr_deferred_destroy){
+            .kind = DVR_DEFERRED_DESTROY_PIPELINE,
+            .pipeline.pipeline = data->vk.pipeline,
+            .pipeline.layout = data->vk.layout,
+        },
+        0
+    );
+    // the replacement holds its own references to shared set layouts
+    dvr_release_reflected_layout(&data->reflected);
+    arrfree(data->key);
+    dvr_free_pipeline_desc(data->desc);
+    // everyone sharing the slot gets the replacement, and its desc is what the slot caches now
+    u32 refs = data->refs;
+    *data = *replacement_data;
+    data->refs = refs;
+
+    dvr_set_slot_free(g_dvr_state.res.pipeline_usage_map, replacement.id);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_descriptor_set_layout) dvr_get_pipeline_set_layout(dvr_pipeline pipeline, u32 set) {
+    return dvr_reflected_set_layout(&dvr_get_pipeline_data(pipeline)->reflected, set);
+}
+
 void dvr_bind_pipeline(dvr_pipeline pipeline) {
     dvr_pipeline_data* data = dvr_get_pipeline_data(pipeline);
     vkCmdBindPipeline(DVR_COMMAND_BUFFER, VK_PIPELINE_BIND_POINT_GRAPHICS, data->vk.pipeline);
+    g_dvr_state.stats.current.pipeline_binds++;
 }
 
 void dvr_push_constants(
@@ -1834,6 +3946,35 @@ void dvr_push_constants(
     );
 }
 
+void dvr_draw(u32 vertex_count, u32 instance_count, u32 first_vertex, u32 first_instance) {
+    vkCmdDraw(DVR_COMMAND_BUFFER, vertex_count, instance_count, first_vertex, first_instance);
+    g_dvr_state.stats.current.draw_calls++;
+}
+
+void dvr_draw_indexed(
+    u32 index_count,
+    u32 instance_count,
+    u32 first_index,
+    i32 vertex_offset,
+    u32 first_instance
+) {
+    vkCmdDrawIndexed(
+        DVR_COMMAND_BUFFER,
+        index_count,
+        instance_count,
+        first_index,
+        vertex_offset,
+        first_instance
+    );
+    g_dvr_state.stats.current.draw_calls++;
+}
+
+void dvr_draw_indexed_indirect(dvr_buffer buffer, u64 offset, u32 draw_count, u32 stride) {
+    dvr_buffer_data* buf = dvr_get_buffer_data(buffer);
+    vkCmdDrawIndexedIndirect(DVR_COMMAND_BUFFER, buf->vk.buffer, offset, draw_count, stride);
+    g_dvr_state.stats.current.draw_calls++;
+}
+
 // DVR_FRAMEBUFFER FUNCTIONS
 
 static dvr_framebuffer_data* dvr_get_framebuffer_data(dvr_framebuffer framebuffer) {
@@ -1912,31 +4053,95 @@ static dvr_compute_pipeline_data* dvr_get_compute_pipeline_data(dvr_compute_pipe
     return &g_dvr_state.res.compute_pipelines[pipeline.id];
 }
 
+/// Validate the workgroup size the specialization gives a reflected compute shader against the
+/// device limits, drivers aren't required to reject oversized workgroups.
+static DVR_RESULT(dvr_none) dvr_check_workgroup_size(
+    dvr_shader_module module,
+    const dvr_specialization_desc* specialization
+) {
+    const dvr_shader_reflection* reflection = dvr_get_shader_reflection(module);
+    if (reflection == NULL) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    u32 size[3];
+    memcpy(size, reflection->workgroup_size, sizeof(size));
+    for (u32 i = 0; i < specialization->num_entries; i++) {
+        const VkSpecializationMapEntry* entry = &specialization->entries[i];
+        if (entry->size != sizeof(u32) || entry->offset + sizeof(u32) > specialization->data.size) {
+            continue;
+        }
+        for (u32 j = 0; j < 3; j++) {
+            if (reflection->workgroup_size_spec_ids[j] == entry->constantID) {
+                memcpy(&size[j], (const u8*)specialization->data.base + entry->offset, sizeof(u32));
+            }
+        }
+    }
+
+    const VkPhysicalDeviceLimits* limits = &g_dvr_state.vk.physical_device_props.limits;
+    if (size[0] > limits->maxComputeWorkGroupSize[0] ||
+        size[1] > limits->maxComputeWorkGroupSize[1] ||
+        size[2] > limits->maxComputeWorkGroupSize[2] ||
+        (u64)size[0] * size[1] * size[2] > limits->maxComputeWorkGroupInvocations) {
+        DVRLOG_ERROR(
+            "workgroup size %ux%ux%u exceeds the device limits",
+            size[0],
+            size[1],
+            size[2]
+        );
+        return DVR_ERROR(dvr_none, "workgroup size exceeds the device limits");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
 DVR_RESULT(dvr_compute_pipeline) dvr_create_compute_pipeline(dvr_compute_pipeline_desc* desc) {
+    DVR_RESULT(dvr_none) workgroup_res =
+        dvr_check_workgroup_size(desc->shader_module, &desc->specialization);
+    DVR_BUBBLE_INTO(dvr_compute_pipeline, workgroup_res);
+
+    VkSpecializationInfo specialization_info = dvr_vk_specialization_info(&desc->specialization);
     VkPipelineShaderStageCreateInfo shader_stage = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_COMPUTE_BIT,
         .module = dvr_get_shader_module_data(desc->shader_module)->vk.module,
         .pName = desc->entry_point,
+        .pSpecializationInfo = desc->specialization.num_entries > 0 ? &specialization_info : NULL,
     };
 
-    VkDescriptorSetLayout layouts[desc->num_desc_set_layouts];
+    u32 num_set_layouts = desc->num_desc_set_layouts;
+    dvr_descriptor_set_layout* set_layouts = desc->desc_set_layouts;
+    u32 num_push_constant_ranges = desc->num_push_constant_ranges;
+    VkPushConstantRange* push_constant_ranges = desc->push_constant_ranges;
+    dvr_reflected_layout reflected = { 0 };
+    if (desc->reflect_layout) {
+        DVR_RESULT(dvr_none) reflect_res = dvr_reflect_layout(&desc->shader_module, 1, &reflected);
+        DVR_BUBBLE_INTO(dvr_compute_pipeline, reflect_res);
+
+        num_set_layouts = reflected.num_set_layouts;
+        set_layouts = reflected.set_layouts;
+        num_push_constant_ranges = reflected.num_push_constant_ranges;
+        push_constant_ranges = &reflected.push_constant_range;
+    }
+
+    VkDescriptorSetLayout layouts[num_set_layouts + 1];
 
-    for (u32 i = 0; i < desc->num_desc_set_layouts; i++) {
-        layouts[i] = dvr_get_descriptor_set_layout_data(desc->desc_set_layouts[i])->vk.layout;
+    for (u32 i = 0; i < num_set_layouts; i++) {
+        layouts[i] = dvr_get_descriptor_set_layout_data(set_layouts[i])->vk.layout;
     }
 
     VkPipelineLayoutCreateInfo pipeline_layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = desc->num_desc_set_layouts,
+        .setLayoutCount = num_set_layouts,
         .pSetLayouts = layouts,
-        .pushConstantRangeCount = desc->num_push_constant_ranges,
-        .pPushConstantRanges = desc->push_constant_ranges,
+        .pushConstantRangeCount = num_push_constant_ranges,
+        .pPushConstantRanges = push_constant_ranges,
     };
 
     VkPipelineLayout pipeline_layout;
     if (vkCreatePipelineLayout(DVR_DEVICE, &pipeline_layout_info, NULL, &pipeline_layout) !=
         VK_SUCCESS) {
+        dvr_release_reflected_layout(&reflected);
         return DVR_ERROR(dvr_compute_pipeline, "failed to create pipeline layout");
     }
 
@@ -1949,19 +4154,21 @@ DVR_RESULT(dvr_compute_pipeline) dvr_create_compute_pipeline(dvr_compute_pipelin
     VkPipeline pipeline;
     if (vkCreateComputePipelines(
             DVR_DEVICE,
-            VK_NULL_HANDLE,
+            g_dvr_state.vk.pipeline_cache,
             1,
             &pipeline_info,
             NULL,
             &pipeline
         ) != VK_SUCCESS) {
         vkDestroyPipelineLayout(DVR_DEVICE, pipeline_layout, NULL);
+        dvr_release_reflected_layout(&reflected);
         return DVR_ERROR(dvr_compute_pipeline, "failed to create compute pipeline");
     }
 
     dvr_compute_pipeline_data pipe = {
         .vk.pipeline = pipeline,
         .vk.layout = pipeline_layout,
+        .reflected = reflected,
     };
 
     u16 free_slot = dvr_find_free_slot(
@@ -1978,10 +4185,37 @@ void dvr_destroy_compute_pipeline(dvr_compute_pipeline pipeline) {
     dvr_compute_pipeline_data* data = dvr_get_compute_pipeline_data(pipeline);
     vkDestroyPipeline(DVR_DEVICE, data->vk.pipeline, NULL);
     vkDestroyPipelineLayout(DVR_DEVICE, data->vk.layout, NULL);
+    dvr_release_reflected_layout(&data->reflected);
 
     dvr_set_slot_free(g_dvr_state.res.compute_pipeline_usage_map, pipeline.id);
 }
 
+void dvr_replace_compute_pipeline(
+    dvr_compute_pipeline pipeline,
+    dvr_compute_pipeline replacement
+) {
+    dvr_compute_pipeline_data* data = dvr_get_compute_pipeline_data(pipeline);
+    dvr_compute_pipeline_data* replacement_data = dvr_get_compute_pipeline_data(replacement);
+
+    dvr_defer_destroy(
+        (dvr_deferred_destroy){
+            .kind = DVR_DEFERRED_DESTROY_PIPELINE,
+            .pipeline.pipeline = data->vk.pipeline,
+            .pipeline.layout = data->vk.layout,
+        },
+        0
+    );
+    dvr_release_reflected_layout(&data->reflected);
+    *data = *replacement_data;
+
+    dvr_set_slot_free(g_dvr_state.res.compute_pipeline_usage_map, replacement.id);
+}
+
+DVR_RESULT(dvr_descriptor_set_layout)
+dvr_get_compute_pipeline_set_layout(dvr_compute_pipeline pipeline, u32 set) {
+    return dvr_reflected_set_layout(&dvr_get_compute_pipeline_data(pipeline)->reflected, set);
+}
+
 void dvr_bind_compute_pipeline(dvr_compute_pipeline pipeline) {
     dvr_compute_pipeline_data* data = dvr_get_compute_pipeline_data(pipeline);
     vkCmdBindPipeline(
@@ -1989,10 +4223,12 @@ void dvr_bind_compute_pipeline(dvr_compute_pipeline pipeline) {
         VK_PIPELINE_BIND_POINT_COMPUTE,
         data->vk.pipeline
     );
+    g_dvr_state.stats.current.pipeline_binds++;
 }
 
 void dvr_dispatch_compute(u32 group_count_x, u32 group_count_y, u32 group_count_z) {
     vkCmdDispatch(DVR_COMPUTE_COMMAND_BUFFER, group_count_x, group_count_y, group_count_z);
+    g_dvr_state.stats.current.dispatches++;
 }
 
 void dvr_push_constants_compute(dvr_compute_pipeline pipeline, u32 offset, dvr_range data) {
@@ -2042,12 +4278,17 @@ static bool dvr_check_validation_layer_support(void) {
 
 static const char** dvr_get_required_instance_extensions(u32* count) {
     u32 glfw_extension_count = 0;
-    const char** glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    const char** glfw_extensions = NULL;
+    if (!g_dvr_state.config.headless) {
+        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    }
 
     *count = glfw_extension_count;
     const char** extensions = NULL;
     arrsetlen(extensions, glfw_extension_count);
-    memcpy(extensions, glfw_extensions, glfw_extension_count * sizeof(const char*));
+    if (glfw_extension_count > 0) {
+        memcpy(extensions, glfw_extensions, glfw_extension_count * sizeof(const char*));
+    }
 
     if (DVR_ENABLE_VALIDATION_LAYERS) {
         arrput(extensions, VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -2068,7 +4309,7 @@ static DVR_RESULT(dvr_none) dvr_vk_create_instance(void) {
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName = "dvr",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_0,
+        .apiVersion = VK_API_VERSION_1_1,
     };
 
     VkInstanceCreateInfo create_info = {
@@ -2200,6 +4441,7 @@ typedef struct queue_family_indices {
 static queue_family_indices find_queue_families(VkPhysicalDevice dev) {
     queue_family_indices indices;
     indices.graphics_family_found = false;
+    indices.present_family_found = false;
 
     u32 queue_family_count = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(dev, &queue_family_count, NULL);
@@ -2214,6 +4456,9 @@ static queue_family_indices find_queue_families(VkPhysicalDevice dev) {
             indices.graphics_family = i;
             indices.graphics_family_found = true;
         }
+        if (g_dvr_state.config.headless) {
+            continue;
+        }
         VkBool32 present_support = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, g_dvr_state.vk.surface, &present_support);
         if (present_support) {
@@ -2222,6 +4467,14 @@ static queue_family_indices find_queue_families(VkPhysicalDevice dev) {
         }
     }
 
+    free(queue_families);
+
+    // nothing is ever presented without a surface, pretend the graphics queue can
+    if (g_dvr_state.config.headless && indices.graphics_family_found) {
+        indices.present_family = indices.graphics_family;
+        indices.present_family_found = true;
+    }
+
     return indices;
 }
 
@@ -2297,6 +4550,38 @@ static const VkPresentModeKHR dvr_preferred_present_mode_order[] = {
 };
 
 static VkPresentModeKHR choose_present_mode(const VkPresentModeKHR* present_modes, usize n) {
+    VkPresentModeKHR requested;
+    switch (g_dvr_state.config.present_mode) {
+        case DVR_PRESENT_MODE_IMMEDIATE:
+            requested = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            break;
+        case DVR_PRESENT_MODE_MAILBOX:
+            requested = VK_PRESENT_MODE_MAILBOX_KHR;
+            break;
+        case DVR_PRESENT_MODE_FIFO:
+            requested = VK_PRESENT_MODE_FIFO_KHR;
+            break;
+        case DVR_PRESENT_MODE_FIFO_RELAXED:
+            requested = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            break;
+        case DVR_PRESENT_MODE_DEFAULT:
+        default:
+            requested = VK_PRESENT_MODE_MAX_ENUM_KHR;
+            break;
+    }
+
+    if (requested != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+        for (usize i = 0; i < n; i++) {
+            if (present_modes[i] == requested) {
+                return requested;
+            }
+        }
+
+        // FIFO is the only mode that is guaranteed to be supported
+        DVRLOG_WARNING("requested present mode not supported, falling back to fifo");
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
     for (usize i = 0; i < sizeof(dvr_preferred_present_mode_order) /
                               sizeof(dvr_preferred_present_mode_order[0]);
          i++) {
@@ -2336,6 +4621,15 @@ static VkExtent2D choose_swap_extent(VkSurfaceCapabilitiesKHR capabilities) {
 
 const char* dvr_required_device_extensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+static u32 dvr_required_device_extension_count(void) {
+    // the swapchain is the only required extension, headless mode does not need it
+    if (g_dvr_state.config.headless) {
+        return 0;
+    }
+
+    return sizeof(dvr_required_device_extensions) / sizeof(dvr_required_device_extensions[0]);
+}
+
 static bool check_device_extension_support(VkPhysicalDevice dev) {
     u32 extension_count;
     vkEnumerateDeviceExtensionProperties(dev, NULL, &extension_count, NULL);
@@ -2344,9 +4638,7 @@ static bool check_device_extension_support(VkPhysicalDevice dev) {
         malloc(sizeof(VkExtensionProperties) * extension_count);
     vkEnumerateDeviceExtensionProperties(dev, NULL, &extension_count, available_extensions);
 
-    for (usize i = 0;
-         i < sizeof(dvr_required_device_extensions) / sizeof(dvr_required_device_extensions[0]);
-         i++) {
+    for (usize i = 0; i < dvr_required_device_extension_count(); i++) {
         bool found = false;
         for (usize e = 0; e < extension_count; e++) {
             VkExtensionProperties* extension = &available_extensions[e];
@@ -2367,6 +4659,54 @@ static bool check_device_extension_support(VkPhysicalDevice dev) {
     return true;
 }
 
+static bool dvr_device_supports_extension(VkPhysicalDevice dev, const char* name) {
+    u32 extension_count;
+    vkEnumerateDeviceExtensionProperties(dev, NULL, &extension_count, NULL);
+
+    VkExtensionProperties* available_extensions =
+        malloc(sizeof(VkExtensionProperties) * extension_count);
+    vkEnumerateDeviceExtensionProperties(dev, NULL, &extension_count, available_extensions);
+
+    bool found = false;
+    for (usize e = 0; e < extension_count; e++) {
+        if (strncmp(name, available_extensions[e].extensionName, 256) == 0) {
+            found = true;
+            break;
+        }
+    }
+
+    free(available_extensions);
+    return found;
+}
+
+// VK_KHR_dynamic_rendering and its dependencies that are not core in vulkan 1.1
+const char* dvr_dynamic_rendering_extensions[] = {
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+    VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+    VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+};
+
+static bool dvr_device_supports_dynamic_rendering(VkPhysicalDevice dev) {
+    for (usize i = 0; i < sizeof(dvr_dynamic_rendering_extensions) /
+                              sizeof(dvr_dynamic_rendering_extensions[0]);
+         i++) {
+        if (!dvr_device_supports_extension(dev, dvr_dynamic_rendering_extensions[i])) {
+            return false;
+        }
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+    };
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &dynamic_rendering_features,
+    };
+    vkGetPhysicalDeviceFeatures2(dev, &features);
+
+    return dynamic_rendering_features.dynamicRendering;
+}
+
 static usize rate_device(VkPhysicalDevice dev) {
     VkPhysicalDeviceProperties device_properties;
     vkGetPhysicalDeviceProperties(dev, &device_properties);
@@ -2400,12 +4740,15 @@ static usize rate_device(VkPhysicalDevice dev) {
         );
         return 0;
     }
-    swapchain_support_details details = query_swapchain_support(dev);
-    bool swapchain_ok = arrlen(details.present_modes) != 0 && arrlen(details.formats) != 0;
-    arrfree(details.formats);
-    arrfree(details.present_modes);
-    if (!swapchain_ok) {
-        return 0;
+    if (!g_dvr_state.config.headless) {
+        swapchain_support_details details = query_swapchain_support(dev);
+        bool swapchain_ok =
+            arrlen(details.present_modes) != 0 && arrlen(details.formats) != 0;
+        arrfree(details.formats);
+        arrfree(details.present_modes);
+        if (!swapchain_ok) {
+            return 0;
+        }
     }
 
     if (!check_device_extension_support(dev)) {
@@ -2416,6 +4759,11 @@ static usize rate_device(VkPhysicalDevice dev) {
         return 0;
     }
 
+    if (g_dvr_state.config.dynamic_rendering && !dvr_device_supports_dynamic_rendering(dev)) {
+        DVRLOG_WARNING("%s does not support dynamic rendering", device_properties.deviceName);
+        return 0;
+    }
+
     DVRLOG_INFO("%s score: %zu", device_properties.deviceName, score);
     return score;
 }
@@ -2484,9 +4832,21 @@ static DVR_RESULT(dvr_none) dvr_vk_pick_physical_device(void) {
         &g_dvr_state.vk.physical_device_props
     );
     DVRLOG_INFO("selected GPU: %s", g_dvr_state.vk.physical_device_props.deviceName);
-    g_dvr_state.vk.max_msaa_samples = _dvr_vk_get_max_usable_sample_count();
 
-    free(devices);
+    VkPhysicalDeviceSubgroupProperties subgroup_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+    };
+    vkGetPhysicalDeviceProperties2(
+        g_dvr_state.vk.physical_device,
+        &(VkPhysicalDeviceProperties2){
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &subgroup_props,
+        }
+    );
+    g_dvr_state.vk.subgroup_size = subgroup_props.subgroupSize;
+    g_dvr_state.vk.max_msaa_samples = _dvr_vk_get_max_usable_sample_count();
+
+    free(devices);
     free(device_scores);
 
     return DVR_OK(dvr_none, DVR_NONE);
@@ -2514,19 +4874,83 @@ static DVR_RESULT(dvr_none) dvr_vk_create_logical_device(void) {
         arrput(queue_create_infos, qci);
     }
 
-    VkPhysicalDeviceFeatures device_features = {
-        .samplerAnisotropy = VK_TRUE,
-        .fillModeNonSolid = VK_TRUE,
+    const char** extensions = NULL;
+    for (u32 i = 0; i < dvr_required_device_extension_count(); i++) {
+        arrput(extensions, dvr_required_device_extensions[i]);
+    }
+
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(g_dvr_state.vk.physical_device, &supported_features);
+    g_dvr_state.mipgen.write_without_format =
+        supported_features.shaderStorageImageWriteWithoutFormat;
+
+    VkPhysicalDeviceFeatures2 device_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .features = {
+            .samplerAnisotropy = VK_TRUE,
+            .fillModeNonSolid = VK_TRUE,
+            .shaderStorageImageWriteWithoutFormat =
+                supported_features.shaderStorageImageWriteWithoutFormat,
+            .textureCompressionBC = supported_features.textureCompressionBC,
+            .pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery,
+        },
+    };
+
+    // present wait is optional, it is only used for frame pacing
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+    };
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = &present_wait_features,
+    };
+
+    if (!g_dvr_state.config.headless &&
+        dvr_device_supports_extension(
+            g_dvr_state.vk.physical_device,
+            VK_KHR_PRESENT_ID_EXTENSION_NAME
+        ) &&
+        dvr_device_supports_extension(
+            g_dvr_state.vk.physical_device,
+            VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+        )) {
+        VkPhysicalDeviceFeatures2 supported = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &present_id_features,
+        };
+        vkGetPhysicalDeviceFeatures2(g_dvr_state.vk.physical_device, &supported);
+
+        if (present_id_features.presentId && present_wait_features.presentWait) {
+            arrput(extensions, VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            arrput(extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            device_features.pNext = &present_id_features;
+            g_dvr_state.pacing.present_wait_enabled = true;
+        }
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+        .dynamicRendering = VK_TRUE,
     };
 
+    if (g_dvr_state.config.dynamic_rendering) {
+        for (usize i = 0; i < sizeof(dvr_dynamic_rendering_extensions) /
+                                  sizeof(dvr_dynamic_rendering_extensions[0]);
+             i++) {
+            arrput(extensions, dvr_dynamic_rendering_extensions[i]);
+        }
+        dynamic_rendering_features.pNext = device_features.pNext;
+        device_features.pNext = &dynamic_rendering_features;
+    }
+
     VkDeviceCreateInfo device_create_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &device_features,
         .pQueueCreateInfos = queue_create_infos,
         .queueCreateInfoCount = (u32)arrlenu(queue_create_infos),
-        .pEnabledFeatures = &device_features,
-        .enabledExtensionCount =
-            sizeof(dvr_required_device_extensions) / sizeof(dvr_required_device_extensions[0]),
-        .ppEnabledExtensionNames = dvr_required_device_extensions,
+        .pEnabledFeatures = NULL,
+        .enabledExtensionCount = (u32)arrlenu(extensions),
+        .ppEnabledExtensionNames = extensions,
     };
 
     if (DVR_ENABLE_VALIDATION_LAYERS) {
@@ -2543,9 +4967,32 @@ static DVR_RESULT(dvr_none) dvr_vk_create_logical_device(void) {
             NULL,
             &DVR_DEVICE
         ) != VK_SUCCESS) {
+        arrfree(extensions);
         return DVR_ERROR(dvr_none, "failed to create logical device");
     }
 
+    arrfree(extensions);
+
+    if (g_dvr_state.pacing.present_wait_enabled) {
+        g_dvr_state.pacing.wait_for_present =
+            (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(DVR_DEVICE, "vkWaitForPresentKHR");
+        if (g_dvr_state.pacing.wait_for_present == NULL) {
+            g_dvr_state.pacing.present_wait_enabled = false;
+        }
+    }
+    DVRLOG_INFO("present wait: %s", g_dvr_state.pacing.present_wait_enabled ? "yes" : "no");
+
+    if (g_dvr_state.config.dynamic_rendering) {
+        g_dvr_state.vk.cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR
+        )vkGetDeviceProcAddr(DVR_DEVICE, "vkCmdBeginRenderingKHR");
+        g_dvr_state.vk.cmd_end_rendering =
+            (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(DVR_DEVICE, "vkCmdEndRenderingKHR");
+        if (g_dvr_state.vk.cmd_begin_rendering == NULL ||
+            g_dvr_state.vk.cmd_end_rendering == NULL) {
+            return DVR_ERROR(dvr_none, "failed to load dynamic rendering functions");
+        }
+    }
+
     vkGetDeviceQueue(DVR_DEVICE, indices.graphics_family, 0, &g_dvr_state.vk.graphics_queue);
     vkGetDeviceQueue(DVR_DEVICE, indices.present_family, 0, &g_dvr_state.vk.present_queue);
     vkGetDeviceQueue(DVR_DEVICE, indices.graphics_family, 0, &g_dvr_state.vk.compute_queue);
@@ -2561,7 +5008,7 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain(void) {
         choose_swapchain_format(swapchain_support.formats, arrlenu(swapchain_support.formats));
     VkPresentModeKHR present_mode = choose_present_mode(
         swapchain_support.present_modes,
-        arrlenu(swapchain_support.formats)
+        arrlenu(swapchain_support.present_modes)
     );
     VkExtent2D extent = choose_swap_extent(swapchain_support.capabilities);
 
@@ -2587,7 +5034,7 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain(void) {
         .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode = present_mode,
         .clipped = VK_TRUE,
-        .oldSwapchain = VK_NULL_HANDLE,
+        .oldSwapchain = g_dvr_state.vk.swapchain,
     };
 
     queue_family_indices indices = find_queue_families(g_dvr_state.vk.physical_device);
@@ -2624,6 +5071,48 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain(void) {
     return DVR_OK(dvr_none, DVR_NONE);
 }
 
+#define DVR_HEADLESS_IMAGE_COUNT 2
+
+static DVR_RESULT(dvr_none) dvr_vk_create_headless_swapchain(void) {
+    // stand-in for the swapchain: plain images that are rendered to but never presented
+    VkExtent2D extent = {
+        .width = g_dvr_state.config.width,
+        .height = g_dvr_state.config.height,
+    };
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+    arrsetlen(g_dvr_state.vk.swapchain_images, DVR_HEADLESS_IMAGE_COUNT);
+    arrsetlen(g_dvr_state.vk.swapchain_image_views, DVR_HEADLESS_IMAGE_COUNT);
+    arrsetlen(g_dvr_state.defaults.swapchain_images, DVR_HEADLESS_IMAGE_COUNT);
+
+    for (usize i = 0; i < DVR_HEADLESS_IMAGE_COUNT; i++) {
+        DVR_RESULT(dvr_image)
+        image_res = dvr_create_image(&(dvr_image_desc){
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .width = extent.width,
+            .height = extent.height,
+            .format = format,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        });
+        DVR_BUBBLE_INTO(dvr_none, image_res);
+
+        dvr_image image = DVR_UNWRAP(image_res);
+        dvr_image_data* data = dvr_get_image_data(image);
+
+        g_dvr_state.vk.swapchain_images[i] = data->vk.image;
+        g_dvr_state.vk.swapchain_image_views[i] = data->vk.view;
+        g_dvr_state.defaults.swapchain_images[i] = image;
+    }
+
+    g_dvr_state.vk.swapchain_format = format;
+    g_dvr_state.vk.swapchain_extent = extent;
+    g_dvr_state.vk.swapchain_image_count = DVR_HEADLESS_IMAGE_COUNT;
+    g_dvr_state.vk.present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
 static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_image_views(void) {
     arrsetlen(g_dvr_state.vk.swapchain_image_views, arrlen(g_dvr_state.vk.swapchain_images));
     arrsetlen(g_dvr_state.defaults.swapchain_images, arrlen(g_dvr_state.vk.swapchain_images));
@@ -2642,8 +5131,12 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_image_views(void) {
         dvr_image_data data = {
             .vk.image = g_dvr_state.vk.swapchain_images[i],
             .vk.view = g_dvr_state.vk.swapchain_image_views[i],
+            .vk.format = g_dvr_state.vk.swapchain_format,
             .width = g_dvr_state.vk.swapchain_extent.width,
             .height = g_dvr_state.vk.swapchain_extent.height,
+            .mip_level = 1,
+            .serial = ++g_dvr_state.res.next_serial,
+            .layout = VK_IMAGE_LAYOUT_UNDEFINED,
         };
 
         u16 free_slot = dvr_find_free_slot(g_dvr_state.res.image_usage_map, DVR_MAX_IMAGES);
@@ -2656,7 +5149,20 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_image_views(void) {
     return DVR_OK(dvr_none, DVR_NONE);
 }
 
+static bool dvr_vk_swapchain_resolves(void) {
+    return g_dvr_state.vk.swapchain_samples != VK_SAMPLE_COUNT_1_BIT;
+}
+
+static bool dvr_vk_swapchain_has_depth(void) {
+    return g_dvr_state.vk.swapchain_depth_format != VK_FORMAT_UNDEFINED;
+}
+
 static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_render_pass(void) {
+    VkImageLayout present_layout = g_dvr_state.config.headless
+                                       ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                       : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    bool resolve = dvr_vk_swapchain_resolves();
+
     DVR_RESULT(dvr_render_pass)
     rp_res = dvr_create_render_pass(&(dvr_render_pass_desc){
         .num_color_attachments = 1,
@@ -2664,18 +5170,20 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_render_pass(void) {
             (dvr_render_pass_attachment_desc){
                 .enable = true,
                 .format = g_dvr_state.vk.swapchain_format,
-                .samples = g_dvr_state.vk.max_msaa_samples,
+                .samples = g_dvr_state.vk.swapchain_samples,
                 .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                // the multisampled image is only needed until it is resolved
+                .store_op = resolve ? VK_ATTACHMENT_STORE_OP_DONT_CARE
+                                    : VK_ATTACHMENT_STORE_OP_STORE,
                 .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
                 .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
                 .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .final_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                .final_layout = resolve ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : present_layout,
             },
-        .num_resolve_attachments = 1,
+        .num_resolve_attachments = resolve ? 1 : 0,
         .resolve_attachments[0] =
             (dvr_render_pass_attachment_desc){
-                .enable = true,
+                .enable = resolve,
                 .format = g_dvr_state.vk.swapchain_format,
                 .samples = VK_SAMPLE_COUNT_1_BIT,
                 .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
@@ -2683,15 +5191,16 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_render_pass(void) {
                 .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
                 .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
                 .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                .final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                .final_layout = present_layout,
             },
         .depth_stencil_attachment =
             (dvr_render_pass_attachment_desc){
-                .enable = true,
-                .format = VK_FORMAT_D32_SFLOAT,
-                .samples = g_dvr_state.vk.max_msaa_samples,
+                .enable = dvr_vk_swapchain_has_depth(),
+                .format = g_dvr_state.vk.swapchain_depth_format,
+                .samples = g_dvr_state.vk.swapchain_samples,
                 .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .store_op = g_dvr_state.config.depth_pyramid ? VK_ATTACHMENT_STORE_OP_STORE
+                                                             : VK_ATTACHMENT_STORE_OP_DONT_CARE,
                 .stencil_load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
                 .stencil_store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
                 .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -2706,630 +5215,2823 @@ static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_render_pass(void) {
     return DVR_OK(dvr_none, DVR_NONE);
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_create_render_targets(void) {
-    DVR_RESULT(dvr_image) res;
-
-    res = dvr_create_image(&(dvr_image_desc){
-        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-        .width = g_dvr_state.vk.swapchain_extent.width,
-        .height = g_dvr_state.vk.swapchain_extent.height,
-        .format = g_dvr_state.vk.swapchain_format,
-        .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        .num_samples = g_dvr_state.vk.max_msaa_samples,
-    });
-    DVR_BUBBLE_INTO(dvr_none, res);
-
-    g_dvr_state.defaults.swapchain_render_image = DVR_UNWRAP(res);
-
-    res = dvr_create_image(&(dvr_image_desc){
-        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        .width = g_dvr_state.vk.swapchain_extent.width,
-        .height = g_dvr_state.vk.swapchain_extent.height,
-        .format = VK_FORMAT_D32_SFLOAT,
-        .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        .num_samples = g_dvr_state.vk.max_msaa_samples,
-    });
-    DVR_BUBBLE_INTO(dvr_none, res);
-
-    g_dvr_state.defaults.swapchain_depth_image = DVR_UNWRAP(res);
-
-    return DVR_OK(dvr_none, DVR_NONE);
+static void dvr_defer_destroy(dvr_deferred_destroy entry, u64 extra_frames) {
+    entry.retire_frame = g_dvr_state.frame.submitted + extra_frames;
+    arrput(g_dvr_state.frame.deferred_destroys, entry);
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_framebuffers(void) {
-    arrsetlen(
-        g_dvr_state.defaults.swapchain_framebuffers,
-        arrlen(g_dvr_state.vk.swapchain_images)
-    );
-
-    for (usize i = 0; i < arrlenu(g_dvr_state.vk.swapchain_images); i++) {
-        DVR_RESULT(dvr_framebuffer)
-        fb_res = dvr_create_framebuffer(&(dvr_framebuffer_desc){
-            .render_pass = g_dvr_state.defaults.swapchain_render_pass,
-            .width = g_dvr_state.vk.swapchain_extent.width,
-            .height = g_dvr_state.vk.swapchain_extent.height,
-            .num_attachments = 3,
-            .attachments =
-                (dvr_image[]){
-                    g_dvr_state.defaults.swapchain_render_image,
-                    g_dvr_state.defaults.swapchain_images[i],
-                    g_dvr_state.defaults.swapchain_depth_image,
-                },
-        });
-        DVR_BUBBLE_INTO(dvr_none, fb_res);
-
-        g_dvr_state.defaults.swapchain_framebuffers[i] = DVR_UNWRAP(fb_res);
+static void dvr_destroy_deferred(dvr_deferred_destroy* entry) {
+    switch (entry->kind) {
+    case DVR_DEFERRED_DESTROY_IMAGE:
+        dvr_destroy_image(entry->image);
+        break;
+    case DVR_DEFERRED_DESTROY_FRAMEBUFFER:
+        dvr_destroy_framebuffer(entry->framebuffer);
+        break;
+    case DVR_DEFERRED_DESTROY_RENDER_PASS:
+        dvr_destroy_render_pass(entry->render_pass);
+        break;
+    case DVR_DEFERRED_DESTROY_SWAPCHAIN_IMAGE:
+        // the image itself is owned by the swapchain
+        vkDestroyImageView(DVR_DEVICE, entry->swapchain_image.view, NULL);
+        dvr_set_slot_free(g_dvr_state.res.image_usage_map, entry->swapchain_image.image.id);
+        break;
+    case DVR_DEFERRED_DESTROY_SWAPCHAIN:
+        vkDestroySwapchainKHR(DVR_DEVICE, entry->swapchain, NULL);
+        break;
+    case DVR_DEFERRED_DESTROY_MEMORY:
+        vkFreeMemory(DVR_DEVICE, entry->memory, NULL);
+        break;
+    case DVR_DEFERRED_DESTROY_BUFFER:
+        vkDestroyBuffer(DVR_DEVICE, entry->buffer.buffer, NULL);
+        vkFreeMemory(DVR_DEVICE, entry->buffer.memory, NULL);
+        break;
+    case DVR_DEFERRED_DESTROY_DEPTH_PYRAMID:
+        vkFreeDescriptorSets(
+            DVR_DEVICE,
+            g_dvr_state.depth_pyramid.pool,
+            (u32)arrlenu(entry->depth_pyramid.sets),
+            entry->depth_pyramid.sets
+        );
+        arrfree(entry->depth_pyramid.sets);
+        dvr_destroy_image(entry->depth_pyramid.image);
+        break;
+    case DVR_DEFERRED_DESTROY_PIPELINE:
+        vkDestroyPipeline(DVR_DEVICE, entry->pipeline.pipeline, NULL);
+        vkDestroyPipelineLayout(DVR_DEVICE, entry->pipeline.layout, NULL);
+        break;
     }
-
-    return DVR_OK(dvr_none, DVR_NONE);
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_create_command_pool(void) {
-    queue_family_indices indices = find_queue_families(g_dvr_state.vk.physical_device);
-
-    VkCommandPoolCreateInfo pool_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-        .queueFamilyIndex = indices.graphics_family,
-    };
-
-    if (vkCreateCommandPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.vk.command_pool) !=
-        VK_SUCCESS) {
-        return DVR_OK(dvr_none, DVR_NONE);
+/// Destroys every deferred resource whose frame has completed, or all of them if `flush` is
+/// set. Flushing is only valid once the device is idle.
+static void dvr_process_deferred_destroys(bool flush) {
+    usize i = 0;
+    while (i < arrlenu(g_dvr_state.frame.deferred_destroys)) {
+        dvr_deferred_destroy* entry = &g_dvr_state.frame.deferred_destroys[i];
+        if (flush || entry->retire_frame <= g_dvr_state.frame.completed) {
+            dvr_destroy_deferred(entry);
+            arrdel(g_dvr_state.frame.deferred_destroys, i);
+        } else {
+            i++;
+        }
     }
+}
 
-    return DVR_OK(dvr_none, DVR_NONE);
+void dvr_retire_image(dvr_image image) {
+    dvr_defer_destroy(
+        (dvr_deferred_destroy){
+            .kind = DVR_DEFERRED_DESTROY_IMAGE,
+            .image = image,
+        },
+        0
+    );
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_create_command_buffer(void) {
-    VkCommandBufferAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = g_dvr_state.vk.command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
+void dvr_retire_buffer(dvr_buffer buffer) {
+    dvr_buffer_data* buf = dvr_get_buffer_data(buffer);
+    dvr_defer_destroy(
+        (dvr_deferred_destroy){
+            .kind = DVR_DEFERRED_DESTROY_BUFFER,
+            .buffer = {
+                .buffer = buf->vk.buffer,
+                .memory = buf->vk.memory,
+            },
+        },
+        0
+    );
+    dvr_set_slot_free(g_dvr_state.res.buffer_usage_map, buffer.id);
+}
 
-    if (vkAllocateCommandBuffers(DVR_DEVICE, &alloc_info, &g_dvr_state.vk.command_buffer) !=
-        VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to allocate command buffer");
+// DVR_DEPTH_PYRAMID FUNCTIONS
+
+// matches dvr_depth_pyramid_cs.glsl
+#define DVR_DEPTH_PYRAMID_GROUP_SIZE 8
+#define DVR_DEPTH_PYRAMID_MAX_LEVELS 16
+// a resize allocates the new sets while the old ones wait for their frame to retire
+#define DVR_DEPTH_PYRAMID_MAX_SETS (4 * DVR_DEPTH_PYRAMID_MAX_LEVELS)
+
+typedef struct dvr_depth_pyramid_push_constants {
+    u32 src_width;
+    u32 src_height;
+    u32 dst_width;
+    u32 dst_height;
+} dvr_depth_pyramid_push_constants;
+
+static DVR_RESULT(dvr_none) dvr_vk_create_depth_pyramid_pipeline(void) {
+    VkShaderModuleCreateInfo module_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = sizeof(dvr_depth_pyramid_cs_spv),
+        .pCode = dvr_depth_pyramid_cs_spv,
+    };
+    VkShaderModule module;
+    if (vkCreateShaderModule(DVR_DEVICE, &module_info, NULL, &module) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create depth pyramid shader module");
     }
 
-    VkCommandBufferAllocateInfo compute_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = g_dvr_state.vk.command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 2,
+        .pBindings =
+            (VkDescriptorSetLayoutBinding[]){
+                {
+                    .binding = 0,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .descriptorCount = 1,
+                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                },
+                {
+                    .binding = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .descriptorCount = 1,
+                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                },
+            },
     };
-
-    if (vkAllocateCommandBuffers(
+    if (vkCreateDescriptorSetLayout(
             DVR_DEVICE,
-            &compute_alloc_info,
-            &g_dvr_state.vk.compute_command_buffer
+            &set_layout_info,
+            NULL,
+            &g_dvr_state.depth_pyramid.set_layout
         ) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to allocate compute command buffer");
+        vkDestroyShaderModule(DVR_DEVICE, module, NULL);
+        return DVR_ERROR(dvr_none, "failed to create depth pyramid descriptor set layout");
     }
 
-    return DVR_OK(dvr_none, DVR_NONE);
-}
-
-static DVR_RESULT(dvr_none) dvr_vk_create_descriptor_pool(void) {
-    VkDescriptorPoolSize ubo_size = {
-        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = DVR_POOL_MAX_UBOS,
-    };
-
-    VkDescriptorPoolSize image_sampler_size = {
-        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .descriptorCount = DVR_POOL_MAX_SAMPLERS,
-    };
-
-    VkDescriptorPoolSize storage_buffer_size = {
-        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-        .descriptorCount = 256,
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &g_dvr_state.depth_pyramid.set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges =
+            &(VkPushConstantRange){
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(dvr_depth_pyramid_push_constants),
+            },
     };
+    if (vkCreatePipelineLayout(
+            DVR_DEVICE,
+            &layout_info,
+            NULL,
+            &g_dvr_state.depth_pyramid.layout
+        ) != VK_SUCCESS) {
+        vkDestroyShaderModule(DVR_DEVICE, module, NULL);
+        return DVR_ERROR(dvr_none, "failed to create depth pyramid pipeline layout");
+    }
 
-    VkDescriptorPoolSize storage_image_size = {
-        .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-        .descriptorCount = 256,
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = module,
+            .pName = "main",
+        },
+        .layout = g_dvr_state.depth_pyramid.layout,
     };
+    VkResult result = vkCreateComputePipelines(
+        DVR_DEVICE,
+        g_dvr_state.vk.pipeline_cache,
+        1,
+        &pipeline_info,
+        NULL,
+        &g_dvr_state.depth_pyramid.pipeline
+    );
+    vkDestroyShaderModule(DVR_DEVICE, module, NULL);
+    if (result != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create depth pyramid pipeline");
+    }
 
-    VkDescriptorPoolSize pool_sizes[] = {
-        ubo_size,
-        image_sampler_size,
-        storage_buffer_size,
-        storage_image_size,
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
     };
+    if (vkCreateSampler(DVR_DEVICE, &sampler_info, NULL, &g_dvr_state.depth_pyramid.sampler) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create depth pyramid sampler");
+    }
 
     VkDescriptorPoolCreateInfo pool_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .poolSizeCount = 4,
-        .pPoolSizes = pool_sizes,
-        .maxSets = 256,
         .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .maxSets = DVR_DEPTH_PYRAMID_MAX_SETS,
+        .poolSizeCount = 2,
+        .pPoolSizes =
+            (VkDescriptorPoolSize[]){
+                {
+                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .descriptorCount = DVR_DEPTH_PYRAMID_MAX_SETS,
+                },
+                {
+                    .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    .descriptorCount = DVR_DEPTH_PYRAMID_MAX_SETS,
+                },
+            },
     };
-
-    if (vkCreateDescriptorPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.vk.descriptor_pool) !=
+    if (vkCreateDescriptorPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.depth_pyramid.pool) !=
         VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to create descriptor pool");
+        return DVR_ERROR(dvr_none, "failed to create depth pyramid descriptor pool");
     }
 
     return DVR_OK(dvr_none, DVR_NONE);
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_create_sync_objects(void) {
-    VkSemaphoreCreateInfo sem_info = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-    };
-
-    VkFenceCreateInfo fence_info = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-    };
+static void dvr_vk_destroy_depth_pyramid_pipeline(void) {
+    if (!g_dvr_state.config.depth_pyramid) {
+        return;
+    }
 
-    if (vkCreateSemaphore(
-            DVR_DEVICE,
-            &sem_info,
-            nullptr,
-            &g_dvr_state.vk.image_available_sem
-        ) != VK_SUCCESS ||
-        vkCreateSemaphore(
-            DVR_DEVICE,
-            &sem_info,
-            nullptr,
-            &g_dvr_state.vk.render_finished_sem
-        ) != VK_SUCCESS ||
-        vkCreateSemaphore(
-            DVR_DEVICE,
-            &sem_info,
-            nullptr,
-            &g_dvr_state.vk.compute_finished_sem
-        ) != VK_SUCCESS ||
-        vkCreateFence(DVR_DEVICE, &fence_info, nullptr, &g_dvr_state.vk.in_flight_fence) !=
-            VK_SUCCESS ||
-        vkCreateFence(DVR_DEVICE, &fence_info, nullptr, &g_dvr_state.vk.compute_fence) !=
-            VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to create sync objects");
+    // destroying the pool frees the sets
+    arrfree(g_dvr_state.depth_pyramid.sets);
+    if (g_dvr_state.depth_pyramid.num_levels > 0) {
+        dvr_destroy_image(g_dvr_state.depth_pyramid.image);
     }
 
-    return DVR_OK(dvr_none, DVR_NONE);
+    vkDestroyDescriptorPool(DVR_DEVICE, g_dvr_state.depth_pyramid.pool, NULL);
+    vkDestroySampler(DVR_DEVICE, g_dvr_state.depth_pyramid.sampler, NULL);
+    vkDestroyPipeline(DVR_DEVICE, g_dvr_state.depth_pyramid.pipeline, NULL);
+    vkDestroyPipelineLayout(DVR_DEVICE, g_dvr_state.depth_pyramid.layout, NULL);
+    vkDestroyDescriptorSetLayout(DVR_DEVICE, g_dvr_state.depth_pyramid.set_layout, NULL);
 }
 
-static DVR_RESULT(dvr_none) dvr_vk_setup(dvr_setup_desc* desc) {
-    (void)desc;
-    DVR_RESULT(dvr_none) res;
-    res = dvr_vk_create_instance();
-    DVR_BUBBLE(res);
+/// (Re)creates the pyramid, its level views and descriptor sets once the swapchain depth or
+/// the extent it is rendered at changed.
+static DVR_RESULT(dvr_none) dvr_vk_prepare_depth_pyramid(void) {
+    dvr_image depth = g_dvr_state.defaults.swapchain_depth_image;
+    VkExtent2D extent = g_dvr_state.vk.swapchain_extent;
+    if (g_dvr_state.depth_pyramid.num_levels > 0 &&
+        g_dvr_state.depth_pyramid.source.id == depth.id &&
+        g_dvr_state.depth_pyramid.source_extent.width == extent.width &&
+        g_dvr_state.depth_pyramid.source_extent.height == extent.height) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
 
-    dvr_vk_create_debug_messenger();
+    if (g_dvr_state.depth_pyramid.num_levels > 0) {
+        // the last frame's culling may still read it
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_DEPTH_PYRAMID,
+                .depth_pyramid.image = g_dvr_state.depth_pyramid.image,
+                .depth_pyramid.sets = g_dvr_state.depth_pyramid.sets,
+            },
+            0
+        );
+        g_dvr_state.depth_pyramid.sets = NULL;
+        g_dvr_state.depth_pyramid.num_levels = 0;
+        g_dvr_state.depth_pyramid.valid = false;
+    }
 
-    res = dvr_vk_create_surface();
-    DVR_BUBBLE(res);
+    // power of two sizes keep every texel of a level exactly 2x2 texels of the level above,
+    // only the first level has uneven footprints over the depth
+    u32 width = 1;
+    u32 height = 1;
+    while (width * 2 <= extent.width) {
+        width *= 2;
+    }
+    while (height * 2 <= extent.height) {
+        height *= 2;
+    }
+    u32 num_levels = 1;
+    while (num_levels < DVR_DEPTH_PYRAMID_MAX_LEVELS &&
+           ((width | height) >> (num_levels - 1)) > 1) {
+        num_levels++;
+    }
 
-    res = dvr_vk_pick_physical_device();
-    DVR_BUBBLE(res);
+    DVR_RESULT(dvr_image)
+    image_res = dvr_create_image(&(dvr_image_desc){
+        .width = width,
+        .height = height,
+        .mip_levels = num_levels,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .num_samples = VK_SAMPLE_COUNT_1_BIT,
+    });
+    DVR_BUBBLE_INTO(dvr_none, image_res);
+    dvr_image image = DVR_UNWRAP(image_res);
+    dvr_image_data* img = dvr_get_image_data(image);
 
-    res = dvr_vk_create_logical_device();
-    DVR_BUBBLE(res);
+    // released with the image
+    for (u32 level = 0; level < num_levels; level++) {
+        DVR_RESULT(VkImageView)
+        view_res = dvr_vk_create_image_level_view(img->vk.image, img->vk.format, level);
+        if (!view_res.is_ok) {
+            dvr_destroy_image(image);
+            return DVR_ERROR(dvr_none, view_res.error.message);
+        }
+        arrput(img->mip_views, DVR_UNWRAP(view_res));
+    }
 
-    res = dvr_vk_create_swapchain();
-    DVR_BUBBLE(res);
+    VkDescriptorSetLayout set_layouts[DVR_DEPTH_PYRAMID_MAX_LEVELS];
+    VkDescriptorSet sets[DVR_DEPTH_PYRAMID_MAX_LEVELS];
+    for (u32 level = 0; level < num_levels; level++) {
+        set_layouts[level] = g_dvr_state.depth_pyramid.set_layout;
+    }
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = g_dvr_state.depth_pyramid.pool,
+        .descriptorSetCount = num_levels,
+        .pSetLayouts = set_layouts,
+    };
+    if (vkAllocateDescriptorSets(DVR_DEVICE, &alloc_info, sets) != VK_SUCCESS) {
+        dvr_destroy_image(image);
+        return DVR_ERROR(dvr_none, "failed to allocate depth pyramid descriptor sets");
+    }
+
+    for (u32 level = 0; level < num_levels; level++) {
+        VkDescriptorImageInfo src_info = {
+            .sampler = g_dvr_state.depth_pyramid.sampler,
+            .imageView = level == 0 ? dvr_get_image_data(depth)->vk.view
+                                    : img->mip_views[level - 1],
+            .imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                      : VK_IMAGE_LAYOUT_GENERAL,
+        };
+        VkDescriptorImageInfo dst_info = {
+            .imageView = img->mip_views[level],
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+        };
+        VkWriteDescriptorSet writes[2] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = sets[level],
+                .dstBinding = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &src_info,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = sets[level],
+                .dstBinding = 1,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = &dst_info,
+            },
+        };
+        vkUpdateDescriptorSets(DVR_DEVICE, 2, writes, 0, NULL);
+        arrput(g_dvr_state.depth_pyramid.sets, sets[level]);
+    }
 
-    res = dvr_vk_create_swapchain_image_views();
-    DVR_BUBBLE(res);
+    g_dvr_state.depth_pyramid.source = depth;
+    g_dvr_state.depth_pyramid.source_extent = extent;
+    g_dvr_state.depth_pyramid.image = image;
+    g_dvr_state.depth_pyramid.width = width;
+    g_dvr_state.depth_pyramid.height = height;
+    g_dvr_state.depth_pyramid.num_levels = num_levels;
+    g_dvr_state.depth_pyramid.generation++;
 
-    res = dvr_vk_create_swapchain_render_pass();
-    DVR_BUBBLE(res);
+    return DVR_OK(dvr_none, DVR_NONE);
+}
 
-    res = dvr_vk_create_render_targets();
-    DVR_BUBBLE(res);
+static void dvr_vk_cmd_depth_pyramid_barrier(
+    VkCommandBuffer command_buffer,
+    VkPipelineStageFlags src_stage,
+    VkAccessFlags src_access,
+    VkPipelineStageFlags dst_stage,
+    VkAccessFlags dst_access
+) {
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+    };
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 1, &barrier, 0, NULL, 0, NULL);
+    g_dvr_state.stats.current.barriers++;
+}
 
-    res = dvr_vk_create_swapchain_framebuffers();
-    DVR_BUBBLE(res);
+DVR_RESULT(dvr_none) dvr_build_depth_pyramid(void) {
+    if (!g_dvr_state.config.depth_pyramid) {
+        return DVR_ERROR(dvr_none, "the depth pyramid is not enabled");
+    }
 
-    res = dvr_vk_create_command_pool();
+    DVR_RESULT(dvr_none) res = dvr_vk_prepare_depth_pyramid();
     DVR_BUBBLE(res);
 
-    res = dvr_vk_create_command_buffer();
-    DVR_BUBBLE(res);
+    VkCommandBuffer command_buffer = DVR_COMMAND_BUFFER;
+    dvr_image_data* depth = dvr_get_image_data(g_dvr_state.defaults.swapchain_depth_image);
+    // the swapchain render pass leaves depth in its final layout without tracking it
+    if (!g_dvr_state.config.dynamic_rendering) {
+        dvr_vk_set_image_layout(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    }
+    dvr_vk_cmd_transition_image(
+        command_buffer,
+        depth,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+        false
+    );
+    // culling earlier in the frame read the previous pyramid
+    dvr_vk_cmd_depth_pyramid_barrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT
+    );
 
-    res = dvr_vk_create_descriptor_pool();
-    DVR_BUBBLE(res);
+    vkCmdBindPipeline(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        g_dvr_state.depth_pyramid.pipeline
+    );
 
-    res = dvr_vk_create_sync_objects();
-    DVR_BUBBLE(res);
+    u32 src_width = g_dvr_state.depth_pyramid.source_extent.width;
+    u32 src_height = g_dvr_state.depth_pyramid.source_extent.height;
+    for (u32 level = 0; level < g_dvr_state.depth_pyramid.num_levels; level++) {
+        if (level > 0) {
+            // every level reads the one written before it
+            dvr_vk_cmd_depth_pyramid_barrier(
+                command_buffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT
+            );
+        }
+
+        u32 dst_width = g_dvr_state.depth_pyramid.width >> level;
+        u32 dst_height = g_dvr_state.depth_pyramid.height >> level;
+        dst_width = dst_width > 0 ? dst_width : 1;
+        dst_height = dst_height > 0 ? dst_height : 1;
+
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            g_dvr_state.depth_pyramid.layout,
+            0,
+            1,
+            &g_dvr_state.depth_pyramid.sets[level],
+            0,
+            NULL
+        );
+        dvr_depth_pyramid_push_constants push_constants = {
+            .src_width = src_width,
+            .src_height = src_height,
+            .dst_width = dst_width,
+            .dst_height = dst_height,
+        };
+        vkCmdPushConstants(
+            command_buffer,
+            g_dvr_state.depth_pyramid.layout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(push_constants),
+            &push_constants
+        );
+        vkCmdDispatch(
+            command_buffer,
+            (dst_width + DVR_DEPTH_PYRAMID_GROUP_SIZE - 1) / DVR_DEPTH_PYRAMID_GROUP_SIZE,
+            (dst_height + DVR_DEPTH_PYRAMID_GROUP_SIZE - 1) / DVR_DEPTH_PYRAMID_GROUP_SIZE,
+            1
+        );
+        g_dvr_state.stats.current.dispatches++;
+
+        src_width = dst_width;
+        src_height = dst_height;
+    }
+
+    dvr_vk_cmd_depth_pyramid_barrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT
+    );
+    g_dvr_state.depth_pyramid.valid = true;
 
     return DVR_OK(dvr_none, DVR_NONE);
 }
 
-static void dvr_glfw_resize(GLFWwindow* window, int width, int height) {
-    (void)window;
-    (void)width;
-    (void)height;
-    g_dvr_state.window.just_resized = true;
+DVR_RESULT(dvr_depth_pyramid) dvr_get_depth_pyramid(void) {
+    if (!g_dvr_state.config.depth_pyramid) {
+        return DVR_ERROR(dvr_depth_pyramid, "the depth pyramid is not enabled");
+    }
+
+    DVR_RESULT(dvr_none) res = dvr_vk_prepare_depth_pyramid();
+    DVR_BUBBLE_INTO(dvr_depth_pyramid, res);
+
+    dvr_depth_pyramid pyramid = {
+        .image = g_dvr_state.depth_pyramid.image,
+        .width = g_dvr_state.depth_pyramid.width,
+        .height = g_dvr_state.depth_pyramid.height,
+        .num_levels = g_dvr_state.depth_pyramid.num_levels,
+        .generation = g_dvr_state.depth_pyramid.generation,
+        .valid = g_dvr_state.depth_pyramid.valid,
+    };
+    return DVR_OK(dvr_depth_pyramid, pyramid);
 }
 
-static DVR_RESULT(dvr_none) dvr_glfw_setup(dvr_setup_desc* desc) {
-    glfwInit();
+// DVR_RENDER_TARGET_POOL FUNCTIONS
 
-    if (!glfwVulkanSupported()) {
-        return DVR_ERROR(dvr_none, "glfw does not support vulkan");
+// frames a pooled render target may stay unused before it is destroyed
+#define DVR_RENDER_TARGET_POOL_MAX_AGE 8
+
+DVR_RESULT(dvr_image) dvr_acquire_render_target(dvr_image_desc* desc) {
+    if (desc->data.base != NULL || desc->generate_mipmaps) {
+        return DVR_ERROR(dvr_image, "pooled render targets can't have data or mipmaps");
     }
 
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
-    glfwWindowHint(GLFW_DECORATED, GLFW_TRUE);
-    if (glfwPlatformSupported(GLFW_PLATFORM_WAYLAND)) {
-        DVRLOG_INFO("using wayland");
-        glfwWindowHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
+    dvr_render_target_key key = {
+        .width = desc->width,
+        .height = desc->height,
+        .format = desc->format,
+        .samples = desc->num_samples,
+        .tiling = desc->tiling,
+        .usage = desc->usage,
+        .properties = desc->properties,
+        .render_target = desc->render_target,
+    };
+    usize hash = stbds_hash_bytes(&key, sizeof(key), 0);
+    u64 frame = g_dvr_state.stats.current.frame_index;
+
+    for (usize i = 0; i < arrlenu(g_dvr_state.render_target_pool.images); i++) {
+        dvr_pooled_render_target* entry = &g_dvr_state.render_target_pool.images[i];
+        if (!entry->in_use && entry->hash == hash &&
+            memcmp(&entry->key, &key, sizeof(key)) == 0) {
+            entry->in_use = true;
+            entry->last_used_frame = frame;
+            return DVR_OK(dvr_image, entry->image);
+        }
     }
-    g_dvr_state.window.window = glfwCreateWindow(
-        (i32)desc->initial_width,
-        (i32)desc->initial_height,
-        desc->app_name,
-        NULL,
-        NULL
+
+    DVR_RESULT(dvr_image) image_res = dvr_create_image(desc);
+    DVR_BUBBLE(image_res);
+
+    arrput(
+        g_dvr_state.render_target_pool.images,
+        ((dvr_pooled_render_target){
+            .hash = hash,
+            .key = key,
+            .image = DVR_UNWRAP(image_res),
+            .last_used_frame = frame,
+            .in_use = true,
+        })
     );
 
-    glfwSetFramebufferSizeCallback(g_dvr_state.window.window, dvr_glfw_resize);
+    return image_res;
+}
 
-    return DVR_OK(dvr_none, DVR_NONE);
+void dvr_release_render_target(dvr_image image) {
+    for (usize i = 0; i < arrlenu(g_dvr_state.render_target_pool.images); i++) {
+        dvr_pooled_render_target* entry = &g_dvr_state.render_target_pool.images[i];
+        if (entry->image.id == image.id) {
+            entry->in_use = false;
+            return;
+        }
+    }
+
+    DVRLOG_WARNING("image %u does not belong to the render target pool", image.id);
 }
 
-DVR_RESULT(dvr_none) dvr_setup(dvr_setup_desc* desc) {
-    dvr_log_init();
+DVR_RESULT(dvr_framebuffer) dvr_acquire_framebuffer(dvr_framebuffer_desc* desc) {
+    if (desc->num_attachments > DVR_POOLED_FRAMEBUFFER_MAX_ATTACHMENTS) {
+        return DVR_ERROR(dvr_framebuffer, "too many attachments for a pooled framebuffer");
+    }
 
-    DVRLOG_INFO("initializing dvr...");
+    dvr_framebuffer_key key = {
+        .render_pass = dvr_get_render_pass_data(desc->render_pass)->serial,
+        .width = desc->width,
+        .height = desc->height,
+        .num_attachments = desc->num_attachments,
+    };
+    for (u32 i = 0; i < desc->num_attachments; i++) {
+        key.attachments[i] = dvr_get_image_data(desc->attachments[i])->serial;
+    }
+    usize hash = stbds_hash_bytes(&key, sizeof(key), 0);
+    u64 frame = g_dvr_state.stats.current.frame_index;
 
-    memset(&g_dvr_state, 0, sizeof(g_dvr_state));
+    for (usize i = 0; i < arrlenu(g_dvr_state.render_target_pool.framebuffers); i++) {
+        dvr_pooled_framebuffer* entry = &g_dvr_state.render_target_pool.framebuffers[i];
+        if (entry->hash == hash && memcmp(&entry->key, &key, sizeof(key)) == 0) {
+            entry->last_used_frame = frame;
+            return DVR_OK(dvr_framebuffer, entry->framebuffer);
+        }
+    }
 
-    DVR_RESULT(dvr_none) res;
+    DVR_RESULT(dvr_framebuffer) framebuffer_res = dvr_create_framebuffer(desc);
+    DVR_BUBBLE(framebuffer_res);
 
-    res = dvr_glfw_setup(desc);
-    DVR_BUBBLE(res);
+    arrput(
+        g_dvr_state.render_target_pool.framebuffers,
+        ((dvr_pooled_framebuffer){
+            .hash = hash,
+            .key = key,
+            .framebuffer = DVR_UNWRAP(framebuffer_res),
+            .last_used_frame = frame,
+        })
+    );
 
-    DVRLOG_INFO("glfw setup complete");
+    return framebuffer_res;
+}
 
-    res = dvr_vk_setup(desc);
-    DVR_BUBBLE(res);
+static bool dvr_pooled_framebuffer_uses(dvr_pooled_framebuffer* entry, dvr_image image) {
+    u64 serial = dvr_get_image_data(image)->serial;
+    for (u32 i = 0; i < entry->key.num_attachments; i++) {
+        if (entry->key.attachments[i] == serial) {
+            return true;
+        }
+    }
 
-    DVRLOG_INFO("vulkan initialized");
+    return false;
+}
 
-    return DVR_OK(dvr_none, DVR_NONE);
+static void dvr_evict_pooled_framebuffer(usize index) {
+    dvr_defer_destroy(
+        (dvr_deferred_destroy){
+            .kind = DVR_DEFERRED_DESTROY_FRAMEBUFFER,
+            .framebuffer = g_dvr_state.render_target_pool.framebuffers[index].framebuffer,
+        },
+        0
+    );
+    arrdel(g_dvr_state.render_target_pool.framebuffers, index);
 }
 
-static void dvr_vk_cleanup_swapchain(void) {
-    dvr_destroy_image(g_dvr_state.defaults.swapchain_render_image);
-    dvr_destroy_image(g_dvr_state.defaults.swapchain_depth_image);
-    for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_framebuffers); i++) {
-        dvr_destroy_framebuffer(g_dvr_state.defaults.swapchain_framebuffers[i]);
-    }
-    for (usize i = 0; i < arrlenu(g_dvr_state.vk.swapchain_image_views); i++) {
-        vkDestroyImageView(DVR_DEVICE, g_dvr_state.vk.swapchain_image_views[i], NULL);
-    }
-    // free slots
-    for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_images); i++) {
-        dvr_set_slot_free(
-            g_dvr_state.res.image_usage_map,
-            g_dvr_state.defaults.swapchain_images[i].id
+/// Returns every pooled render target and destroys the ones that went unused for too long.
+static void dvr_render_target_pool_end_frame(void) {
+    u64 frame = g_dvr_state.stats.current.frame_index;
+
+    usize i = 0;
+    while (i < arrlenu(g_dvr_state.render_target_pool.images)) {
+        dvr_pooled_render_target* entry = &g_dvr_state.render_target_pool.images[i];
+        entry->in_use = false;
+        if (frame - entry->last_used_frame < DVR_RENDER_TARGET_POOL_MAX_AGE) {
+            i++;
+            continue;
+        }
+
+        // framebuffers referencing the image can't outlive it
+        usize j = 0;
+        while (j < arrlenu(g_dvr_state.render_target_pool.framebuffers)) {
+            if (dvr_pooled_framebuffer_uses(
+                    &g_dvr_state.render_target_pool.framebuffers[j],
+                    entry->image
+                )) {
+                dvr_evict_pooled_framebuffer(j);
+            } else {
+                j++;
+            }
+        }
+
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_IMAGE,
+                .image = entry->image,
+            },
+            0
         );
+        arrdel(g_dvr_state.render_target_pool.images, i);
     }
-    arrsetlen(g_dvr_state.vk.swapchain_image_views, 0);
-    arrsetlen(g_dvr_state.defaults.swapchain_images, 0);
-    arrsetlen(g_dvr_state.defaults.swapchain_framebuffers, 0);
-    dvr_destroy_render_pass(g_dvr_state.defaults.swapchain_render_pass);
-    vkDestroySwapchainKHR(DVR_DEVICE, g_dvr_state.vk.swapchain, NULL);
-}
 
-static void dvr_vk_shutdown(void) {
-    vkDeviceWaitIdle(DVR_DEVICE);
+    i = 0;
+    while (i < arrlenu(g_dvr_state.render_target_pool.framebuffers)) {
+        dvr_pooled_framebuffer* entry = &g_dvr_state.render_target_pool.framebuffers[i];
+        if (frame - entry->last_used_frame >= DVR_RENDER_TARGET_POOL_MAX_AGE) {
+            dvr_evict_pooled_framebuffer(i);
+        } else {
+            i++;
+        }
+    }
+}
 
-    dvr_vk_cleanup_swapchain();
+static void dvr_render_target_pool_shutdown(void) {
+    for (usize i = 0; i < arrlenu(g_dvr_state.render_target_pool.framebuffers); i++) {
+        dvr_destroy_framebuffer(g_dvr_state.render_target_pool.framebuffers[i].framebuffer);
+    }
+    for (usize i = 0; i < arrlenu(g_dvr_state.render_target_pool.images); i++) {
+        dvr_destroy_image(g_dvr_state.render_target_pool.images[i].image);
+    }
 
-    vkDestroySemaphore(DVR_DEVICE, g_dvr_state.vk.render_finished_sem, NULL);
-    vkDestroySemaphore(DVR_DEVICE, g_dvr_state.vk.image_available_sem, NULL);
-    vkDestroySemaphore(DVR_DEVICE, g_dvr_state.vk.compute_finished_sem, NULL);
-    vkDestroyFence(DVR_DEVICE, g_dvr_state.vk.in_flight_fence, NULL);
-    vkDestroyFence(DVR_DEVICE, g_dvr_state.vk.compute_fence, NULL);
+    arrfree(g_dvr_state.render_target_pool.framebuffers);
+    arrfree(g_dvr_state.render_target_pool.images);
+}
 
-    vkDestroyDescriptorPool(DVR_DEVICE, g_dvr_state.vk.descriptor_pool, NULL);
+static bool dvr_vk_render_target_fits(dvr_image image, VkFormat format) {
+    dvr_image_data* data = dvr_get_image_data(image);
+    VkExtent2D extent = g_dvr_state.vk.swapchain_extent;
 
-    vkFreeCommandBuffers(
-        DVR_DEVICE,
-        g_dvr_state.vk.command_pool,
-        1,
-        &g_dvr_state.vk.command_buffer
-    );
-    vkFreeCommandBuffers(
-        DVR_DEVICE,
-        g_dvr_state.vk.command_pool,
-        1,
-        &g_dvr_state.vk.compute_command_buffer
-    );
-    vkDestroyCommandPool(DVR_DEVICE, g_dvr_state.vk.command_pool, NULL);
+    // framebuffers may be smaller than their attachments, only reallocate when growing or
+    // when the targets became much larger than needed
+    return data->vk.format == format && data->width >= extent.width &&
+           data->height >= extent.height &&
+           (u64)data->width * data->height <= 2 * (u64)extent.width * extent.height;
+}
 
-    vkDestroyDevice(DVR_DEVICE, NULL);
+static bool dvr_vk_render_targets_fit(void) {
+    if (dvr_vk_swapchain_resolves() &&
+        !dvr_vk_render_target_fits(
+            g_dvr_state.defaults.swapchain_render_image,
+            g_dvr_state.vk.swapchain_format
+        )) {
+        return false;
+    }
 
-    if (DVR_ENABLE_VALIDATION_LAYERS) {
-        PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT =
-            (PFN_vkDestroyDebugUtilsMessengerEXT
-            )vkGetInstanceProcAddr(g_dvr_state.vk.instance, "vkDestroyDebugUtilsMessengerEXT");
-        if (vkDestroyDebugUtilsMessengerEXT != NULL) {
-            vkDestroyDebugUtilsMessengerEXT(
-                g_dvr_state.vk.instance,
-                g_dvr_state.vk.debug_messenger,
-                NULL
-            );
-        }
+    if (dvr_vk_swapchain_has_depth() &&
+        !dvr_vk_render_target_fits(
+            g_dvr_state.defaults.swapchain_depth_image,
+            g_dvr_state.vk.swapchain_depth_format
+        )) {
+        return false;
     }
 
-    vkDestroySurfaceKHR(g_dvr_state.vk.instance, g_dvr_state.vk.surface, NULL);
-    vkDestroyInstance(g_dvr_state.vk.instance, NULL);
+    return true;
 }
 
-static void dvr_glfw_shutdown(void) {
-    glfwDestroyWindow(g_dvr_state.window.window);
-    glfwTerminate();
+/// With `keep` the contents are read after the pass, e.g. depth by the depth pyramid.
+static DVR_RESULT(dvr_image)
+    dvr_vk_create_render_target(VkImageUsageFlags usage, VkFormat format, bool keep) {
+    if (keep) {
+        return dvr_create_image(&(dvr_image_desc){
+            .usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT,
+            .width = g_dvr_state.vk.swapchain_extent.width,
+            .height = g_dvr_state.vk.swapchain_extent.height,
+            .format = format,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .num_samples = g_dvr_state.vk.swapchain_samples,
+        });
+    }
+
+    // the render targets never outlive a render pass, on tiled GPUs they can stay in tile
+    // memory without ever being backed by real allocations
+    return dvr_create_image(&(dvr_image_desc){
+        .usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        .width = g_dvr_state.vk.swapchain_extent.width,
+        .height = g_dvr_state.vk.swapchain_extent.height,
+        .format = format,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .properties = g_dvr_state.vk.lazy_memory ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+                                                 : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .num_samples = g_dvr_state.vk.swapchain_samples,
+    });
 }
 
-void dvr_shutdown(void) {
-    dvr_vk_shutdown();
-    dvr_glfw_shutdown();
-    dvr_log_close();
+static DVR_RESULT(dvr_none) dvr_vk_create_render_targets(void) {
+    DVR_RESULT(dvr_image) res;
+
+    if (dvr_vk_swapchain_resolves()) {
+        res = dvr_vk_create_render_target(
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+            g_dvr_state.vk.swapchain_format,
+            false
+        );
+        DVR_BUBBLE_INTO(dvr_none, res);
+
+        g_dvr_state.defaults.swapchain_render_image = DVR_UNWRAP(res);
+    }
+
+    if (dvr_vk_swapchain_has_depth()) {
+        res = dvr_vk_create_render_target(
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            g_dvr_state.vk.swapchain_depth_format,
+            g_dvr_state.config.depth_pyramid
+        );
+        DVR_BUBBLE_INTO(dvr_none, res);
+
+        g_dvr_state.defaults.swapchain_depth_image = DVR_UNWRAP(res);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
 }
 
-VkFormat dvr_swapchain_format(void) {
-    return g_dvr_state.vk.swapchain_format;
+static void dvr_vk_destroy_render_targets(bool deferred) {
+    dvr_image targets[2];
+    u32 num_targets = 0;
+    if (dvr_vk_swapchain_resolves()) {
+        targets[num_targets++] = g_dvr_state.defaults.swapchain_render_image;
+    }
+    if (dvr_vk_swapchain_has_depth()) {
+        targets[num_targets++] = g_dvr_state.defaults.swapchain_depth_image;
+    }
+
+    for (u32 i = 0; i < num_targets; i++) {
+        if (deferred) {
+            dvr_defer_destroy(
+                (dvr_deferred_destroy){
+                    .kind = DVR_DEFERRED_DESTROY_IMAGE,
+                    .image = targets[i],
+                },
+                0
+            );
+        } else {
+            dvr_destroy_image(targets[i]);
+        }
+    }
 }
 
-VkSampleCountFlags dvr_max_msaa_samples(void) {
-    return g_dvr_state.vk.max_msaa_samples;
+static DVR_RESULT(dvr_none) dvr_vk_recreate_render_targets(void) {
+    if (dvr_vk_render_targets_fit()) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    dvr_vk_destroy_render_targets(true);
+
+    return dvr_vk_create_render_targets();
 }
 
-dvr_framebuffer dvr_swapchain_framebuffer(void) {
-    return g_dvr_state.defaults.swapchain_framebuffers[g_dvr_state.vk.image_index];
+static DVR_RESULT(dvr_none) dvr_vk_create_swapchain_framebuffers(void) {
+    arrsetlen(
+        g_dvr_state.defaults.swapchain_framebuffers,
+        arrlen(g_dvr_state.vk.swapchain_images)
+    );
+
+    for (usize i = 0; i < arrlenu(g_dvr_state.vk.swapchain_images); i++) {
+        // attachment order matches the swapchain render pass: color, resolve, depth
+        dvr_image attachments[3];
+        u32 num_attachments = 0;
+        if (dvr_vk_swapchain_resolves()) {
+            attachments[num_attachments++] = g_dvr_state.defaults.swapchain_render_image;
+        }
+        attachments[num_attachments++] = g_dvr_state.defaults.swapchain_images[i];
+        if (dvr_vk_swapchain_has_depth()) {
+            attachments[num_attachments++] = g_dvr_state.defaults.swapchain_depth_image;
+        }
+
+        DVR_RESULT(dvr_framebuffer)
+        fb_res = dvr_create_framebuffer(&(dvr_framebuffer_desc){
+            .render_pass = g_dvr_state.defaults.swapchain_render_pass,
+            .width = g_dvr_state.vk.swapchain_extent.width,
+            .height = g_dvr_state.vk.swapchain_extent.height,
+            .num_attachments = num_attachments,
+            .attachments = attachments,
+        });
+        DVR_BUBBLE_INTO(dvr_none, fb_res);
+
+        g_dvr_state.defaults.swapchain_framebuffers[i] = DVR_UNWRAP(fb_res);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_command_pool(void) {
+    queue_family_indices indices = find_queue_families(g_dvr_state.vk.physical_device);
+
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = indices.graphics_family,
+    };
+
+    if (vkCreateCommandPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.vk.command_pool) !=
+        VK_SUCCESS) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_command_buffer(void) {
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = g_dvr_state.vk.command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    if (vkAllocateCommandBuffers(DVR_DEVICE, &alloc_info, &g_dvr_state.vk.command_buffer) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to allocate command buffer");
+    }
+
+    VkCommandBufferAllocateInfo compute_alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = g_dvr_state.vk.command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    if (vkAllocateCommandBuffers(
+            DVR_DEVICE,
+            &compute_alloc_info,
+            &g_dvr_state.vk.compute_command_buffer
+        ) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to allocate compute command buffer");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_descriptor_pool(void) {
+    VkDescriptorPoolSize ubo_size = {
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorCount = DVR_POOL_MAX_UBOS,
+    };
+
+    VkDescriptorPoolSize image_sampler_size = {
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = DVR_POOL_MAX_SAMPLERS,
+    };
+
+    VkDescriptorPoolSize storage_buffer_size = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 256,
+    };
+
+    VkDescriptorPoolSize storage_image_size = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .descriptorCount = 256,
+    };
+
+    VkDescriptorPoolSize pool_sizes[] = {
+        ubo_size,
+        image_sampler_size,
+        storage_buffer_size,
+        storage_image_size,
+    };
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .poolSizeCount = 4,
+        .pPoolSizes = pool_sizes,
+        .maxSets = 256,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+    };
+
+    if (vkCreateDescriptorPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.vk.descriptor_pool) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create descriptor pool");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_pipeline_statistics_pool(void) {
+    VkPhysicalDeviceFeatures supported_features;
+    vkGetPhysicalDeviceFeatures(g_dvr_state.vk.physical_device, &supported_features);
+    if (!supported_features.pipelineStatisticsQuery) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    VkQueryPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount = 1,
+        .pipelineStatistics = DVR_PIPELINE_STATISTICS_FLAGS,
+    };
+
+    if (vkCreateQueryPool(DVR_DEVICE, &pool_info, NULL, &g_dvr_state.pipeline_statistics.pool) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create pipeline statistics query pool");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_sync_objects(void) {
+    VkSemaphoreCreateInfo sem_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+    };
+
+    VkFenceCreateInfo fence_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+    };
+
+    if (vkCreateSemaphore(
+            DVR_DEVICE,
+            &sem_info,
+            nullptr,
+            &g_dvr_state.vk.image_available_sem
+        ) != VK_SUCCESS ||
+        vkCreateSemaphore(
+            DVR_DEVICE,
+            &sem_info,
+            nullptr,
+            &g_dvr_state.vk.render_finished_sem
+        ) != VK_SUCCESS ||
+        vkCreateSemaphore(
+            DVR_DEVICE,
+            &sem_info,
+            nullptr,
+            &g_dvr_state.vk.compute_finished_sem
+        ) != VK_SUCCESS ||
+        vkCreateFence(DVR_DEVICE, &fence_info, nullptr, &g_dvr_state.vk.in_flight_fence) !=
+            VK_SUCCESS ||
+        vkCreateFence(DVR_DEVICE, &fence_info, nullptr, &g_dvr_state.vk.compute_fence) !=
+            VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create sync objects");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_create_pipeline_cache(void) {
+    VkPipelineCacheCreateInfo cache_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = 0,
+        .pInitialData = NULL,
+    };
+
+    if (vkCreatePipelineCache(DVR_DEVICE, &cache_info, NULL, &g_dvr_state.vk.pipeline_cache) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to create pipeline cache");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_reset_pipeline_cache(void) {
+    vkDestroyPipelineCache(DVR_DEVICE, g_dvr_state.vk.pipeline_cache, NULL);
+    g_dvr_state.vk.pipeline_cache = VK_NULL_HANDLE;
+
+    return dvr_vk_create_pipeline_cache();
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_configure_render_targets(dvr_setup_desc* desc) {
+    VkSampleCountFlagBits samples =
+        desc->msaa_samples == 0 ? g_dvr_state.vk.max_msaa_samples : desc->msaa_samples;
+    if (samples > g_dvr_state.vk.max_msaa_samples) {
+        DVRLOG_WARNING(
+            "%d msaa samples requested, device supports up to %d",
+            samples,
+            g_dvr_state.vk.max_msaa_samples
+        );
+        samples = g_dvr_state.vk.max_msaa_samples;
+    }
+    if (desc->depth_pyramid) {
+        if (desc->no_depth) {
+            return DVR_ERROR(dvr_none, "the depth pyramid needs the swapchain pass to have depth");
+        }
+        if (desc->msaa_samples > VK_SAMPLE_COUNT_1_BIT) {
+            DVRLOG_WARNING("%d msaa samples requested, the depth pyramid needs 1", samples);
+        }
+        samples = VK_SAMPLE_COUNT_1_BIT;
+    }
+    g_dvr_state.vk.swapchain_samples = samples;
+
+    VkFormat depth_format = VK_FORMAT_UNDEFINED;
+    if (!desc->no_depth) {
+        depth_format =
+            desc->depth_format == VK_FORMAT_UNDEFINED ? VK_FORMAT_D32_SFLOAT : desc->depth_format;
+
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(g_dvr_state.vk.physical_device, depth_format, &props);
+        if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)) {
+            return DVR_ERROR(dvr_none, "requested depth format is not supported");
+        }
+        if (desc->depth_pyramid &&
+            !(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            return DVR_ERROR(dvr_none, "requested depth format can't be sampled");
+        }
+    }
+    g_dvr_state.vk.swapchain_depth_format = depth_format;
+
+    VkPhysicalDeviceMemoryProperties mem_props;
+    vkGetPhysicalDeviceMemoryProperties(g_dvr_state.vk.physical_device, &mem_props);
+    g_dvr_state.vk.lazy_memory = false;
+    for (u32 i = 0; i < mem_props.memoryTypeCount; i++) {
+        if (mem_props.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            g_dvr_state.vk.lazy_memory = true;
+        }
+    }
+
+    DVRLOG_INFO(
+        "swapchain pass: %d samples, %s depth, %s memory",
+        samples,
+        depth_format == VK_FORMAT_UNDEFINED ? "no" : "with",
+        g_dvr_state.vk.lazy_memory ? "lazily allocated" : "device local"
+    );
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_setup(dvr_setup_desc* desc) {
+    DVR_RESULT(dvr_none) res;
+    res = dvr_vk_create_instance();
+    DVR_BUBBLE(res);
+
+    dvr_vk_create_debug_messenger();
+
+    if (!g_dvr_state.config.headless) {
+        res = dvr_vk_create_surface();
+        DVR_BUBBLE(res);
+    }
+
+    res = dvr_vk_pick_physical_device();
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_configure_render_targets(desc);
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_create_logical_device();
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_create_pipeline_cache();
+    DVR_BUBBLE(res);
+
+    if (g_dvr_state.config.headless) {
+        res = dvr_vk_create_headless_swapchain();
+        DVR_BUBBLE(res);
+    } else {
+        res = dvr_vk_create_swapchain();
+        DVR_BUBBLE(res);
+
+        res = dvr_vk_create_swapchain_image_views();
+        DVR_BUBBLE(res);
+    }
+
+    // dynamic rendering draws straight into the images, no render pass or framebuffers
+    if (!g_dvr_state.config.dynamic_rendering) {
+        res = dvr_vk_create_swapchain_render_pass();
+        DVR_BUBBLE(res);
+    }
+
+    res = dvr_vk_create_render_targets();
+    DVR_BUBBLE(res);
+
+    if (!g_dvr_state.config.dynamic_rendering) {
+        res = dvr_vk_create_swapchain_framebuffers();
+        DVR_BUBBLE(res);
+    }
+
+    res = dvr_vk_create_command_pool();
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_create_command_buffer();
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_create_descriptor_pool();
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_create_mipgen_pipeline();
+    DVR_BUBBLE(res);
+
+    if (g_dvr_state.config.depth_pyramid) {
+        res = dvr_vk_create_depth_pyramid_pipeline();
+        DVR_BUBBLE(res);
+    }
+
+    res = dvr_vk_create_pipeline_statistics_pool();
+    DVR_BUBBLE(res);
+
+    res = dvr_vk_create_sync_objects();
+    DVR_BUBBLE(res);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static void dvr_glfw_resize(GLFWwindow* window, int width, int height) {
+    (void)window;
+    (void)width;
+    (void)height;
+    g_dvr_state.window.just_resized = true;
+}
+
+static DVR_RESULT(dvr_none) dvr_glfw_setup(dvr_setup_desc* desc) {
+    if (desc->headless) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    glfwInit();
+
+    if (!glfwVulkanSupported()) {
+        return DVR_ERROR(dvr_none, "glfw does not support vulkan");
+    }
+
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    glfwWindowHint(GLFW_DECORATED, GLFW_TRUE);
+    if (glfwPlatformSupported(GLFW_PLATFORM_WAYLAND)) {
+        DVRLOG_INFO("using wayland");
+        glfwWindowHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
+    }
+    g_dvr_state.window.window = glfwCreateWindow(
+        (i32)desc->initial_width,
+        (i32)desc->initial_height,
+        desc->app_name,
+        NULL,
+        NULL
+    );
+
+    glfwSetFramebufferSizeCallback(g_dvr_state.window.window, dvr_glfw_resize);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_setup(dvr_setup_desc* desc) {
+    dvr_log_init();
+
+    DVRLOG_INFO("initializing dvr...");
+
+    memset(&g_dvr_state, 0, sizeof(g_dvr_state));
+
+    g_dvr_state.config.headless = desc->headless;
+    g_dvr_state.config.width = desc->initial_width;
+    g_dvr_state.config.height = desc->initial_height;
+    g_dvr_state.config.present_mode = desc->present_mode;
+    g_dvr_state.config.target_frame_interval = desc->target_frame_interval;
+    g_dvr_state.config.max_frame_latency = desc->max_frame_latency;
+    g_dvr_state.config.dynamic_rendering = desc->dynamic_rendering;
+    g_dvr_state.config.depth_pyramid = desc->depth_pyramid;
+
+    DVR_RESULT(dvr_none) res;
+
+    res = dvr_glfw_setup(desc);
+    DVR_BUBBLE(res);
+
+    DVRLOG_INFO("glfw setup complete");
+
+    res = dvr_vk_setup(desc);
+    DVR_BUBBLE(res);
+
+    DVRLOG_INFO("vulkan initialized");
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static void dvr_vk_cleanup_swapchain(void) {
+    dvr_vk_destroy_render_targets(false);
+    for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_framebuffers); i++) {
+        dvr_destroy_framebuffer(g_dvr_state.defaults.swapchain_framebuffers[i]);
+    }
+    if (g_dvr_state.config.headless) {
+        // headless images own their memory
+        for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_images); i++) {
+            dvr_destroy_image(g_dvr_state.defaults.swapchain_images[i]);
+        }
+    } else {
+        for (usize i = 0; i < arrlenu(g_dvr_state.vk.swapchain_image_views); i++) {
+            vkDestroyImageView(DVR_DEVICE, g_dvr_state.vk.swapchain_image_views[i], NULL);
+        }
+        // free slots
+        for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_images); i++) {
+            dvr_set_slot_free(
+                g_dvr_state.res.image_usage_map,
+                g_dvr_state.defaults.swapchain_images[i].id
+            );
+        }
+    }
+    arrsetlen(g_dvr_state.vk.swapchain_images, 0);
+    arrsetlen(g_dvr_state.vk.swapchain_image_views, 0);
+    arrsetlen(g_dvr_state.defaults.swapchain_images, 0);
+    arrsetlen(g_dvr_state.defaults.swapchain_framebuffers, 0);
+    if (!g_dvr_state.config.dynamic_rendering) {
+        dvr_destroy_render_pass(g_dvr_state.defaults.swapchain_render_pass);
+    }
+    if (!g_dvr_state.config.headless) {
+        vkDestroySwapchainKHR(DVR_DEVICE, g_dvr_state.vk.swapchain, NULL);
+    }
+}
+
+static void dvr_render_graph_shutdown(void);
+
+static void dvr_vk_shutdown(void) {
+    vkDeviceWaitIdle(DVR_DEVICE);
+
+    dvr_render_graph_shutdown();
+    dvr_render_target_pool_shutdown();
+    dvr_vk_destroy_upload_arena(false);
+    dvr_process_deferred_destroys(true);
+    arrfree(g_dvr_state.frame.deferred_destroys);
+    arrfree(g_dvr_state.frame.layout_journal);
+
+    dvr_vk_cleanup_swapchain();
+
+    vkDestroySemaphore(DVR_DEVICE, g_dvr_state.vk.render_finished_sem, NULL);
+    vkDestroySemaphore(DVR_DEVICE, g_dvr_state.vk.image_available_sem, NULL);
+    vkDestroySemaphore(DVR_DEVICE, g_dvr_state.vk.compute_finished_sem, NULL);
+    vkDestroyFence(DVR_DEVICE, g_dvr_state.vk.in_flight_fence, NULL);
+    vkDestroyFence(DVR_DEVICE, g_dvr_state.vk.compute_fence, NULL);
+
+    vkDestroyDescriptorPool(DVR_DEVICE, g_dvr_state.vk.descriptor_pool, NULL);
+    dvr_vk_destroy_mipgen_pipeline();
+    dvr_vk_destroy_depth_pyramid_pipeline();
+    if (g_dvr_state.pipeline_statistics.pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(DVR_DEVICE, g_dvr_state.pipeline_statistics.pool, NULL);
+    }
+    vkDestroyPipelineCache(DVR_DEVICE, g_dvr_state.vk.pipeline_cache, NULL);
+
+    vkFreeCommandBuffers(
+        DVR_DEVICE,
+        g_dvr_state.vk.command_pool,
+        1,
+        &g_dvr_state.vk.command_buffer
+    );
+    vkFreeCommandBuffers(
+        DVR_DEVICE,
+        g_dvr_state.vk.command_pool,
+        1,
+        &g_dvr_state.vk.compute_command_buffer
+    );
+    vkDestroyCommandPool(DVR_DEVICE, g_dvr_state.vk.command_pool, NULL);
+
+    vkDestroyDevice(DVR_DEVICE, NULL);
+
+    if (DVR_ENABLE_VALIDATION_LAYERS) {
+        PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT =
+            (PFN_vkDestroyDebugUtilsMessengerEXT
+            )vkGetInstanceProcAddr(g_dvr_state.vk.instance, "vkDestroyDebugUtilsMessengerEXT");
+        if (vkDestroyDebugUtilsMessengerEXT != NULL) {
+            vkDestroyDebugUtilsMessengerEXT(
+                g_dvr_state.vk.instance,
+                g_dvr_state.vk.debug_messenger,
+                NULL
+            );
+        }
+    }
+
+    if (!g_dvr_state.config.headless) {
+        vkDestroySurfaceKHR(g_dvr_state.vk.instance, g_dvr_state.vk.surface, NULL);
+    }
+    vkDestroyInstance(g_dvr_state.vk.instance, NULL);
+}
+
+static void dvr_glfw_shutdown(void) {
+    if (g_dvr_state.config.headless) {
+        return;
+    }
+
+    glfwDestroyWindow(g_dvr_state.window.window);
+    glfwTerminate();
+}
+
+void dvr_shutdown(void) {
+    dvr_vk_shutdown();
+    dvr_glfw_shutdown();
+    dvr_log_close();
+}
+
+VkFormat dvr_swapchain_format(void) {
+    return g_dvr_state.vk.swapchain_format;
+}
+
+VkFormat dvr_swapchain_depth_format(void) {
+    return g_dvr_state.vk.swapchain_depth_format;
+}
+
+VkSampleCountFlags dvr_max_msaa_samples(void) {
+    return g_dvr_state.vk.max_msaa_samples;
+}
+
+u32 dvr_subgroup_size(void) {
+    return g_dvr_state.vk.subgroup_size;
+}
+
+u32 dvr_max_compute_workgroup_size(void) {
+    const VkPhysicalDeviceLimits* limits = &g_dvr_state.vk.physical_device_props.limits;
+    return limits->maxComputeWorkGroupSize[0] < limits->maxComputeWorkGroupInvocations
+               ? limits->maxComputeWorkGroupSize[0]
+               : limits->maxComputeWorkGroupInvocations;
+}
+
+VkSampleCountFlagBits dvr_swapchain_samples(void) {
+    return g_dvr_state.vk.swapchain_samples;
+}
+
+dvr_framebuffer dvr_swapchain_framebuffer(void) {
+    if (g_dvr_state.config.dynamic_rendering) {
+        DVRLOG_ERROR("the swapchain has no framebuffers with dynamic rendering enabled");
+        return (dvr_framebuffer){ 0 };
+    }
+
+    return g_dvr_state.defaults.swapchain_framebuffers[g_dvr_state.vk.image_index];
+}
+
+dvr_render_pass dvr_swapchain_render_pass(void) {
+    return g_dvr_state.defaults.swapchain_render_pass;
+}
+
+void dvr_begin_swapchain_render_pass(void) {
+    dvr_image swapchain_image = g_dvr_state.defaults.swapchain_images[g_dvr_state.vk.image_index];
+    VkClearValue clear_color = { .color = { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+    VkClearValue clear_depth = { .depthStencil = { 1.0f, 0 } };
+
+    if (g_dvr_state.config.dynamic_rendering) {
+        dvr_rendering_attachment_desc color_attachment = {
+            .image = swapchain_image,
+            .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+            .clear_value = clear_color,
+        };
+        if (dvr_vk_swapchain_resolves()) {
+            color_attachment.image = g_dvr_state.defaults.swapchain_render_image;
+            color_attachment.resolve = true;
+            color_attachment.resolve_image = swapchain_image;
+            color_attachment.store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        }
+
+        dvr_begin_rendering(&(dvr_rendering_desc){
+            .width = g_dvr_state.vk.swapchain_extent.width,
+            .height = g_dvr_state.vk.swapchain_extent.height,
+            .num_color_attachments = 1,
+            .color_attachments[0] = color_attachment,
+            .has_depth_attachment = dvr_vk_swapchain_has_depth(),
+            .depth_attachment =
+                (dvr_rendering_attachment_desc){
+                    .image = g_dvr_state.defaults.swapchain_depth_image,
+                    .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                    .store_op = g_dvr_state.config.depth_pyramid
+                                    ? VK_ATTACHMENT_STORE_OP_STORE
+                                    : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                    .clear_value = clear_depth,
+                },
+        });
+        return;
+    }
+
+    // one clear value per framebuffer attachment, the resolve attachment's is ignored
+    VkClearValue clear_values[3];
+    u32 num_clear_values = 0;
+    clear_values[num_clear_values++] = clear_color;
+    if (dvr_vk_swapchain_resolves()) {
+        clear_values[num_clear_values++] = clear_color;
+    }
+    if (dvr_vk_swapchain_has_depth()) {
+        clear_values[num_clear_values++] = clear_depth;
+    }
+
+    dvr_begin_render_pass(
+        dvr_swapchain_render_pass(),
+        dvr_swapchain_framebuffer(),
+        clear_values,
+        num_clear_values
+    );
+}
+
+VkPhysicalDevice dvr_physical_device(void) {
+    return g_dvr_state.vk.physical_device;
+}
+
+VkDevice dvr_device(void) {
+    return DVR_DEVICE;
+}
+
+VkCommandBuffer dvr_command_buffer(void) {
+    return g_dvr_state.vk.command_buffer;
+}
+
+VkCommandBuffer dvr_compute_command_buffer(void) {
+    if (g_dvr_state.graph.recording) {
+        return g_dvr_state.vk.command_buffer;
+    }
+
+    return g_dvr_state.vk.compute_command_buffer;
+}
+
+static bool dvr_window_minimized(void) {
+    i32 width = 0;
+    i32 height = 0;
+    glfwGetFramebufferSize(g_dvr_state.window.window, &width, &height);
+    return width == 0 || height == 0;
+}
+
+static void dvr_vk_retire_swapchain(void) {
+    // frames in flight may still reference these, destroy them once those frames are done
+    for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_framebuffers); i++) {
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_FRAMEBUFFER,
+                .framebuffer = g_dvr_state.defaults.swapchain_framebuffers[i],
+            },
+            0
+        );
+    }
+    for (usize i = 0; i < arrlenu(g_dvr_state.defaults.swapchain_images); i++) {
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_SWAPCHAIN_IMAGE,
+                .swapchain_image.image = g_dvr_state.defaults.swapchain_images[i],
+                .swapchain_image.view = g_dvr_state.vk.swapchain_image_views[i],
+            },
+            0
+        );
+    }
+    arrsetlen(g_dvr_state.vk.swapchain_images, 0);
+    arrsetlen(g_dvr_state.vk.swapchain_image_views, 0);
+    arrsetlen(g_dvr_state.defaults.swapchain_images, 0);
+    arrsetlen(g_dvr_state.defaults.swapchain_framebuffers, 0);
+}
+
+static DVR_RESULT(dvr_none) dvr_vk_recreate_swapchain(void) {
+    if (dvr_window_minimized()) {
+        // nothing to render to, try again once the window is restored
+        g_dvr_state.window.just_resized = true;
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+    g_dvr_state.window.just_resized = false;
+
+    VkSwapchainKHR old_swapchain = g_dvr_state.vk.swapchain;
+    VkFormat old_format = g_dvr_state.vk.swapchain_format;
+    u32 old_image_count = g_dvr_state.vk.swapchain_image_count;
+
+    dvr_vk_retire_swapchain();
+
+    // the old swapchain is handed to the new one as oldSwapchain so in-flight presents can
+    // finish, there is no fence for presentation so give it a full round of images
+    DVR_RESULT(dvr_none) res = dvr_vk_create_swapchain();
+    dvr_defer_destroy(
+        (dvr_deferred_destroy){
+            .kind = DVR_DEFERRED_DESTROY_SWAPCHAIN,
+            .swapchain = old_swapchain,
+        },
+        old_image_count
+    );
+    DVR_BUBBLE(res);
+    g_dvr_state.pacing.present_id_base = g_dvr_state.pacing.present_id;
+
+    res = dvr_vk_create_swapchain_image_views();
+    DVR_BUBBLE(res);
+
+    if (!g_dvr_state.config.dynamic_rendering && g_dvr_state.vk.swapchain_format != old_format) {
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_RENDER_PASS,
+                .render_pass = g_dvr_state.defaults.swapchain_render_pass,
+            },
+            0
+        );
+        res = dvr_vk_create_swapchain_render_pass();
+        DVR_BUBBLE(res);
+    }
+
+    res = dvr_vk_recreate_render_targets();
+    DVR_BUBBLE(res);
+
+    if (!g_dvr_state.config.dynamic_rendering) {
+        res = dvr_vk_create_swapchain_framebuffers();
+        DVR_BUBBLE(res);
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static f64 dvr_time_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (f64)t.tv_sec + (f64)t.tv_nsec / 1.0e9;
+#endif
+}
+
+static void dvr_sleep(f64 seconds) {
+#ifdef _WIN32
+    Sleep((DWORD)(seconds * 1.0e3));
+#else
+    struct timespec t = {
+        .tv_sec = (time_t)seconds,
+        .tv_nsec = (long)((seconds - floor(seconds)) * 1.0e9),
+    };
+    nanosleep(&t, NULL);
+#endif
+}
+
+// os sleeps overshoot, the last bit of the wait is spent spinning instead
+#define DVR_FRAME_LIMITER_SPIN_TIME 0.002
+
+static void dvr_limit_frame_rate(void) {
+    f64 interval = g_dvr_state.config.target_frame_interval;
+    if (interval <= 0.0) {
+        return;
+    }
+
+    f64 target = g_dvr_state.pacing.next_frame_time;
+    f64 now = dvr_time_now();
+    if (now < target) {
+        if (target - now > DVR_FRAME_LIMITER_SPIN_TIME) {
+            dvr_sleep(target - now - DVR_FRAME_LIMITER_SPIN_TIME);
+        }
+        while ((now = dvr_time_now()) < target) {
+        }
+    }
+
+    // after a long frame, restart from now instead of bursting to catch up
+    if (now - target > interval) {
+        g_dvr_state.pacing.next_frame_time = now + interval;
+    } else {
+        g_dvr_state.pacing.next_frame_time = target + interval;
+    }
+}
+
+#define DVR_PRESENT_WAIT_TIMEOUT_NS 100000000ULL
+
+static void dvr_wait_for_frame_latency(void) {
+    u64 latency = g_dvr_state.config.max_frame_latency;
+    if (!g_dvr_state.pacing.present_wait_enabled || latency == 0) {
+        return;
+    }
+
+    if (g_dvr_state.pacing.present_id <= g_dvr_state.pacing.present_id_base + latency) {
+        return;
+    }
+
+    VkResult result = g_dvr_state.pacing.wait_for_present(
+        DVR_DEVICE,
+        g_dvr_state.vk.swapchain,
+        g_dvr_state.pacing.present_id - latency,
+        DVR_PRESENT_WAIT_TIMEOUT_NS
+    );
+    if (result != VK_SUCCESS && result != VK_TIMEOUT && result != VK_SUBOPTIMAL_KHR &&
+        result != VK_ERROR_OUT_OF_DATE_KHR) {
+        DVRLOG_WARNING("vkWaitForPresentKHR failed: %d", result);
+    }
+}
+
+void dvr_set_target_frame_interval(f64 seconds) {
+    g_dvr_state.config.target_frame_interval = seconds;
+}
+
+#define DVR_MINIMIZED_WAIT_TIMEOUT 0.1
+#define DVR_ACQUIRE_MAX_ATTEMPTS 3
+
+DVR_RESULT(dvr_none) dvr_begin_frame(void) {
+    dvr_wait_for_frame_latency();
+    dvr_limit_frame_rate();
+
+    vkWaitForFences(DVR_DEVICE, 1, &g_dvr_state.vk.in_flight_fence, VK_TRUE, UINT64_MAX);
+    g_dvr_state.frame.completed = g_dvr_state.frame.submitted;
+    dvr_process_deferred_destroys(false);
+    g_dvr_state.upload.head = 0;
+
+    g_dvr_state.frame.skipped = false;
+    if (g_dvr_state.config.headless) {
+        g_dvr_state.vk.image_index =
+            (g_dvr_state.vk.image_index + 1) % g_dvr_state.vk.swapchain_image_count;
+    } else if (dvr_window_minimized()) {
+        // keep recording so callers don't need to special case this, end_frame drops it
+        g_dvr_state.window.just_resized = true;
+        g_dvr_state.frame.skipped = true;
+        glfwWaitEventsTimeout(DVR_MINIMIZED_WAIT_TIMEOUT);
+    } else {
+        for (u32 attempt = 0;; attempt++) {
+            VkResult result = vkAcquireNextImageKHR(
+                DVR_DEVICE,
+                g_dvr_state.vk.swapchain,
+                UINT64_MAX,
+                g_dvr_state.vk.image_available_sem,
+                VK_NULL_HANDLE,
+                &g_dvr_state.vk.image_index
+            );
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR && attempt < DVR_ACQUIRE_MAX_ATTEMPTS) {
+                DVR_RESULT(dvr_none) res = dvr_vk_recreate_swapchain();
+                DVR_BUBBLE(res);
+                if (g_dvr_state.window.just_resized) {
+                    g_dvr_state.frame.skipped = true;
+                    break;
+                }
+            } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                return DVR_ERROR(dvr_none, "failed to acquire swapchain image");
+            } else {
+                break;
+            }
+        }
+    }
+
+    // a skipped frame submits nothing that would signal the fence
+    if (!g_dvr_state.frame.skipped) {
+        vkResetFences(DVR_DEVICE, 1, &g_dvr_state.vk.in_flight_fence);
+
+        // the contents of an acquired image are undefined
+        dvr_get_image_data(g_dvr_state.defaults.swapchain_images[g_dvr_state.vk.image_index])
+            ->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    vkResetCommandBuffer(g_dvr_state.vk.command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = 0,
+        .pInheritanceInfo = NULL,
+    };
+
+    if (vkBeginCommandBuffer(g_dvr_state.vk.command_buffer, &begin_info) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to begin recording command buffer");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static void dvr_roll_frame_stats(void) {
+    g_dvr_state.stats.last = g_dvr_state.stats.current;
+    g_dvr_state.stats.current = (dvr_frame_stats){
+        .frame_index = g_dvr_state.stats.last.frame_index + 1,
+    };
+}
+
+static DVR_RESULT(dvr_none) dvr_end_skipped_frame(void) {
+    // the recorded commands reference a swapchain image that was never acquired, so they
+    // are dropped. a pending compute signal still has to be consumed.
+    if (g_dvr_state.vk.compute_pending) {
+        vkResetFences(DVR_DEVICE, 1, &g_dvr_state.vk.in_flight_fence);
+
+        VkSubmitInfo submit_info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &g_dvr_state.vk.compute_finished_sem,
+            .pWaitDstStageMask =
+                (VkPipelineStageFlags[]){
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                },
+        };
+
+        if (vkQueueSubmit(
+                g_dvr_state.vk.graphics_queue,
+                1,
+                &submit_info,
+                g_dvr_state.vk.in_flight_fence
+            ) != VK_SUCCESS) {
+            return DVR_ERROR(dvr_none, "failed to submit skipped frame");
+        }
+        g_dvr_state.frame.submitted++;
+        g_dvr_state.vk.compute_pending = false;
+    }
+
+    for (usize i = arrlenu(g_dvr_state.frame.layout_journal); i > 0; i--) {
+        dvr_image_layout_change* change = &g_dvr_state.frame.layout_journal[i - 1];
+        change->image->layout = change->layout;
+    }
+    arrsetlen(g_dvr_state.frame.layout_journal, 0);
+
+    dvr_render_target_pool_end_frame();
+    dvr_roll_frame_stats();
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_end_frame(void) {
+    if (g_dvr_state.config.dynamic_rendering && !g_dvr_state.frame.skipped) {
+        // render passes handle this through their final layout
+        dvr_vk_cmd_transition_image(
+            g_dvr_state.vk.command_buffer,
+            dvr_get_image_data(g_dvr_state.defaults.swapchain_images[g_dvr_state.vk.image_index]),
+            g_dvr_state.config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                        : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            false
+        );
+    }
+
+    if (vkEndCommandBuffer(g_dvr_state.vk.command_buffer) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to record command buffer");
+    }
+
+    if (g_dvr_state.frame.skipped) {
+        return dvr_end_skipped_frame();
+    }
+
+    // only wait on what was actually signaled this frame, a binary semaphore that is never
+    // signaled would block the queue forever
+    VkSemaphore wait_sems[2];
+    VkPipelineStageFlags wait_stages[2];
+    u32 wait_count = 0;
+    if (g_dvr_state.vk.compute_pending) {
+        wait_sems[wait_count] = g_dvr_state.vk.compute_finished_sem;
+        // compute may produce indirect draw parameters as well as vertex data
+        wait_stages[wait_count] =
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        wait_count++;
+    }
+    if (!g_dvr_state.config.headless) {
+        wait_sems[wait_count] = g_dvr_state.vk.image_available_sem;
+        wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        wait_count++;
+    }
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &g_dvr_state.vk.command_buffer,
+        .waitSemaphoreCount = wait_count,
+        .pWaitSemaphores = wait_sems,
+        .pWaitDstStageMask = wait_stages,
+        .signalSemaphoreCount = g_dvr_state.config.headless ? 0 : 1,
+        .pSignalSemaphores =
+            (VkSemaphore[]){
+                g_dvr_state.vk.render_finished_sem,
+            },
+    };
+
+    if (vkQueueSubmit(
+            g_dvr_state.vk.graphics_queue,
+            1,
+            &submit_info,
+            g_dvr_state.vk.in_flight_fence
+        ) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to submit draw command buffer");
+    }
+    g_dvr_state.frame.submitted++;
+
+    g_dvr_state.vk.compute_pending = false;
+
+    dvr_render_target_pool_end_frame();
+    dvr_roll_frame_stats();
+
+    if (g_dvr_state.config.headless) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    VkPresentInfoKHR present_info = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores =
+            (VkSemaphore[]){
+                g_dvr_state.vk.render_finished_sem,
+            },
+        .swapchainCount = 1,
+        .pSwapchains =
+            (VkSwapchainKHR[]){
+                g_dvr_state.vk.swapchain,
+            },
+        .pImageIndices = &g_dvr_state.vk.image_index,
+        .pResults = NULL,
+    };
+
+    VkPresentIdKHR present_id_info = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &g_dvr_state.pacing.present_id,
+    };
+    if (g_dvr_state.pacing.present_wait_enabled) {
+        g_dvr_state.pacing.present_id++;
+        present_info.pNext = &present_id_info;
+    }
+
+    VkResult result = vkQueuePresentKHR(g_dvr_state.vk.present_queue, &present_info);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+        g_dvr_state.window.just_resized) {
+        DVR_RESULT(dvr_none) res = dvr_vk_recreate_swapchain();
+        DVR_BUBBLE(res);
+        return DVR_OK(dvr_none, DVR_NONE);
+    } else if (result != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to present swapchain image");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_begin_compute(void) {
+    vkWaitForFences(DVR_DEVICE, 1, &g_dvr_state.vk.compute_fence, VK_TRUE, UINT64_MAX);
+
+    vkResetFences(DVR_DEVICE, 1, &g_dvr_state.vk.compute_fence);
+
+    vkResetCommandBuffer(g_dvr_state.vk.compute_command_buffer, 0);
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = 0,
+        .pInheritanceInfo = NULL,
+    };
+
+    if (vkBeginCommandBuffer(g_dvr_state.vk.compute_command_buffer, &begin_info) !=
+        VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to begin recording compute command buffer");
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_end_compute(void) {
+    if (vkEndCommandBuffer(g_dvr_state.vk.compute_command_buffer) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to record compute command buffer");
+    }
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &g_dvr_state.vk.compute_command_buffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores =
+            (VkSemaphore[]){
+                g_dvr_state.vk.compute_finished_sem,
+            },
+    };
+
+    if (vkQueueSubmit(
+            g_dvr_state.vk.compute_queue,
+            1,
+            &submit_info,
+            g_dvr_state.vk.compute_fence
+        ) != VK_SUCCESS) {
+        return DVR_ERROR(dvr_none, "failed to submit compute command buffer");
+    }
+
+    g_dvr_state.vk.compute_pending = true;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+bool dvr_should_close(void) {
+    if (g_dvr_state.config.headless) {
+        return false;
+    }
+
+    return glfwWindowShouldClose(g_dvr_state.window.window);
+}
+
+void dvr_poll_events(void) {
+    if (g_dvr_state.config.headless) {
+        return;
+    }
+
+    glfwPollEvents();
+}
+
+void dvr_close(void) {
+    if (g_dvr_state.config.headless) {
+        return;
+    }
+
+    glfwSetWindowShouldClose(g_dvr_state.window.window, GLFW_TRUE);
+}
+
+void dvr_wait_idle(void) {
+    vkDeviceWaitIdle(DVR_DEVICE);
+    g_dvr_state.stats.current.queue_waits++;
+    g_dvr_state.frame.completed = g_dvr_state.frame.submitted;
+}
+
+void dvr_get_window_size(u32* width, u32* height) {
+    if (g_dvr_state.config.headless) {
+        *width = g_dvr_state.vk.swapchain_extent.width;
+        *height = g_dvr_state.vk.swapchain_extent.height;
+        return;
+    }
+
+    i32 w, h;
+    glfwGetFramebufferSize(g_dvr_state.window.window, &w, &h);
+    *width = (u32)w;
+    *height = (u32)h;
+}
+
+static u32 dvr_count_used_slots(u64* usage_map, u16 len) {
+    u32 count = 0;
+    for (u16 i = 0; i < len / 64; i++) {
+        u64 bits = usage_map[i];
+        while (bits != 0) {
+            bits &= bits - 1;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+dvr_frame_stats dvr_get_frame_stats(void) {
+    dvr_frame_stats stats = g_dvr_state.stats.last;
+
+    stats.live.buffers = dvr_count_used_slots(g_dvr_state.res.buffer_usage_map, DVR_MAX_BUFFERS);
+    stats.live.images = dvr_count_used_slots(g_dvr_state.res.image_usage_map, DVR_MAX_IMAGES);
+    stats.live.samplers =
+        dvr_count_used_slots(g_dvr_state.res.sampler_usage_map, DVR_MAX_SAMPLERS);
+    stats.live.render_passes =
+        dvr_count_used_slots(g_dvr_state.res.render_pass_usage_map, DVR_MAX_RENDER_PASSES);
+    stats.live.shader_modules =
+        dvr_count_used_slots(g_dvr_state.res.shader_module_usage_map, DVR_MAX_SHADER_MODULES);
+    stats.live.pipelines =
+        dvr_count_used_slots(g_dvr_state.res.pipeline_usage_map, DVR_MAX_PIPELINES);
+    stats.live.framebuffers =
+        dvr_count_used_slots(g_dvr_state.res.framebuffer_usage_map, DVR_MAX_FRAMEBUFFERS);
+    stats.live.descriptor_set_layouts = dvr_count_used_slots(
+        g_dvr_state.res.descriptor_set_layout_usage_map,
+        DVR_MAX_DESCRIPTOR_SET_LAYOUTS
+    );
+    stats.live.descriptor_sets =
+        dvr_count_used_slots(g_dvr_state.res.descriptor_set_usage_map, DVR_MAX_DESCRIPTOR_SETS);
+    stats.live.compute_pipelines = dvr_count_used_slots(
+        g_dvr_state.res.compute_pipeline_usage_map,
+        DVR_MAX_COMPUTE_PIPELINES
+    );
+
+    return stats;
+}
+
+bool dvr_pipeline_statistics_supported(void) {
+    return g_dvr_state.pipeline_statistics.pool != VK_NULL_HANDLE;
+}
+
+void dvr_begin_pipeline_statistics(void) {
+    if (!dvr_pipeline_statistics_supported() || g_dvr_state.pipeline_statistics.active) {
+        return;
+    }
+
+    vkCmdResetQueryPool(DVR_COMMAND_BUFFER, g_dvr_state.pipeline_statistics.pool, 0, 1);
+    vkCmdBeginQuery(DVR_COMMAND_BUFFER, g_dvr_state.pipeline_statistics.pool, 0, 0);
+    g_dvr_state.pipeline_statistics.active = true;
+}
+
+void dvr_end_pipeline_statistics(void) {
+    if (!g_dvr_state.pipeline_statistics.active) {
+        return;
+    }
+
+    vkCmdEndQuery(DVR_COMMAND_BUFFER, g_dvr_state.pipeline_statistics.pool, 0);
+    g_dvr_state.pipeline_statistics.active = false;
+    g_dvr_state.pipeline_statistics.recorded = !g_dvr_state.frame.skipped;
+    g_dvr_state.pipeline_statistics.frame = g_dvr_state.frame.submitted + 1;
+}
+
+DVR_RESULT(dvr_pipeline_statistics) dvr_get_pipeline_statistics(void) {
+    if (!dvr_pipeline_statistics_supported()) {
+        return DVR_ERROR(dvr_pipeline_statistics, "pipeline statistics are not supported");
+    }
+    if (!g_dvr_state.pipeline_statistics.recorded) {
+        return DVR_ERROR(dvr_pipeline_statistics, "no pipeline statistics were recorded");
+    }
+    if (g_dvr_state.pipeline_statistics.frame > g_dvr_state.frame.completed) {
+        return DVR_ERROR(dvr_pipeline_statistics, "pipeline statistics frame is still in flight");
+    }
+
+    u64 values[5];
+    VkResult result = vkGetQueryPoolResults(
+        DVR_DEVICE,
+        g_dvr_state.pipeline_statistics.pool,
+        0,
+        1,
+        sizeof(values),
+        values,
+        sizeof(values),
+        VK_QUERY_RESULT_64_BIT
+    );
+    if (result != VK_SUCCESS) {
+        return DVR_ERROR(dvr_pipeline_statistics, "failed to read pipeline statistics");
+    }
+
+    dvr_pipeline_statistics statistics = {
+        .input_assembly_vertices = values[0],
+        .input_assembly_primitives = values[1],
+        .vertex_shader_invocations = values[2],
+        .clipping_primitives = values[3],
+        .fragment_shader_invocations = values[4],
+    };
+
+    return DVR_OK(dvr_pipeline_statistics, statistics);
+}
+
+// DVR_RENDER_GRAPH FUNCTIONS
+
+static dvr_render_graph_resource_data* dvr_get_render_graph_resource_data(
+    dvr_render_graph_resource resource
+) {
+    if (resource.id >= arrlenu(g_dvr_state.graph.resources)) {
+        DVRLOG_ERROR("render graph resource id out of range: %u", resource.id);
+        return NULL;
+    }
+
+    return &g_dvr_state.graph.resources[resource.id];
+}
+
+static dvr_render_graph_resource dvr_render_graph_add_resource(
+    dvr_render_graph_resource_data data
+) {
+    data.transient = -1;
+    arrput(g_dvr_state.graph.resources, data);
+    return (dvr_render_graph_resource){ .id = (u16)(arrlenu(g_dvr_state.graph.resources) - 1) };
+}
+
+void dvr_render_graph_begin(void) {
+    arrsetlen(g_dvr_state.graph.resources, 0);
+    arrsetlen(g_dvr_state.graph.passes, 0);
+    arrsetlen(g_dvr_state.graph.uses, 0);
+}
+
+dvr_render_graph_resource dvr_render_graph_import_image(dvr_image image) {
+    return dvr_render_graph_add_resource((dvr_render_graph_resource_data){
+        .is_image = true,
+        .imported = true,
+        .image = image,
+    });
+}
+
+dvr_render_graph_resource dvr_render_graph_import_buffer(dvr_buffer buffer) {
+    return dvr_render_graph_add_resource((dvr_render_graph_resource_data){
+        .is_image = false,
+        .imported = true,
+        .buffer = buffer,
+    });
+}
+
+dvr_render_graph_resource dvr_render_graph_import_swapchain(void) {
+    return dvr_render_graph_import_image(
+        g_dvr_state.defaults.swapchain_images[g_dvr_state.vk.image_index]
+    );
+}
+
+dvr_render_graph_resource dvr_render_graph_create_image(dvr_render_graph_image_desc* desc) {
+    dvr_render_graph_resource_data data = {
+        .is_image = true,
+        .imported = false,
+        .desc = *desc,
+    };
+    if (data.desc.samples == 0) {
+        data.desc.samples = VK_SAMPLE_COUNT_1_BIT;
+    }
+
+    return dvr_render_graph_add_resource(data);
+}
+
+void dvr_render_graph_add_pass(dvr_render_graph_pass_desc* desc) {
+    dvr_render_graph_pass_data pass = {
+        .desc = *desc,
+        .first_use = (u32)arrlenu(g_dvr_state.graph.uses),
+    };
+
+    for (u32 i = 0; i < desc->num_uses; i++) {
+        arrput(g_dvr_state.graph.uses, desc->uses[i]);
+    }
+    pass.desc.uses = NULL;
+
+    arrput(g_dvr_state.graph.passes, pass);
+}
+
+dvr_image dvr_render_graph_image(dvr_render_graph_resource resource) {
+    return dvr_get_render_graph_resource_data(resource)->image;
+}
+
+dvr_buffer dvr_render_graph_buffer(dvr_render_graph_resource resource) {
+    return dvr_get_render_graph_resource_data(resource)->buffer;
+}
+
+static dvr_render_graph_use* dvr_render_graph_pass_uses(dvr_render_graph_pass_data* pass) {
+    return &g_dvr_state.graph.uses[pass->first_use];
+}
+
+typedef struct dvr_render_graph_access_info {
+    VkPipelineStageFlags stage;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    VkImageUsageFlags usage;
+    bool write;
+} dvr_render_graph_access_info;
+
+static dvr_render_graph_access_info
+dvr_render_graph_get_access_info(dvr_render_graph_access access, dvr_render_graph_pass_type type) {
+    VkPipelineStageFlags shader_stages = type == DVR_RENDER_GRAPH_PASS_COMPUTE
+                                             ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                             : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    switch (access) {
+        case DVR_RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                .access =
+                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                .write = true,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                .access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                .write = true,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_DEPTH_READ:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | shader_stages,
+                .access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+                .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_SAMPLED:
+            return (dvr_render_graph_access_info){
+                .stage = shader_stages,
+                .access = VK_ACCESS_SHADER_READ_BIT,
+                .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_STORAGE_READ:
+            return (dvr_render_graph_access_info){
+                .stage = shader_stages,
+                .access = VK_ACCESS_SHADER_READ_BIT,
+                .layout = VK_IMAGE_LAYOUT_GENERAL,
+                .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_STORAGE_WRITE:
+            return (dvr_render_graph_access_info){
+                .stage = shader_stages,
+                .access = VK_ACCESS_SHADER_WRITE_BIT,
+                .layout = VK_IMAGE_LAYOUT_GENERAL,
+                .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+                .write = true,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_STORAGE_READ_WRITE:
+            return (dvr_render_graph_access_info){
+                .stage = shader_stages,
+                .access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                .layout = VK_IMAGE_LAYOUT_GENERAL,
+                .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+                .write = true,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_TRANSFER_SRC:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .access = VK_ACCESS_TRANSFER_READ_BIT,
+                .layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_TRANSFER_DST:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                .write = true,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_VERTEX_BUFFER:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                .access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_INDEX_BUFFER:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                .access = VK_ACCESS_INDEX_READ_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_UNIFORM_BUFFER:
+            return (dvr_render_graph_access_info){
+                .stage = shader_stages,
+                .access = VK_ACCESS_UNIFORM_READ_BIT,
+            };
+        case DVR_RENDER_GRAPH_ACCESS_INDIRECT_BUFFER:
+            return (dvr_render_graph_access_info){
+                .stage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                .access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            };
+    }
+
+    return (dvr_render_graph_access_info){
+        .stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        .access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+        .layout = VK_IMAGE_LAYOUT_GENERAL,
+        .write = true,
+    };
+}
+
+static bool dvr_render_graph_is_attachment(dvr_render_graph_access access) {
+    return access == DVR_RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT ||
+           access == DVR_RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT;
+}
+
+/// Whether the use depends on the previous contents of the resource.
+static bool dvr_render_graph_use_reads(dvr_render_graph_use* use) {
+    if (dvr_render_graph_is_attachment(use->access)) {
+        return use->load_op == VK_ATTACHMENT_LOAD_OP_LOAD;
+    }
+
+    return use->access != DVR_RENDER_GRAPH_ACCESS_STORAGE_WRITE &&
+           use->access != DVR_RENDER_GRAPH_ACCESS_TRANSFER_DST;
+}
+
+static void dvr_render_graph_cull(void) {
+    // walk backwards, a pass is needed if it has side effects or writes something a later
+    // needed pass reads
+    for (usize p = arrlenu(g_dvr_state.graph.passes); p > 0; p--) {
+        dvr_render_graph_pass_data* pass = &g_dvr_state.graph.passes[p - 1];
+        dvr_render_graph_use* uses = dvr_render_graph_pass_uses(pass);
+
+        bool kept = pass->desc.side_effects;
+        for (u32 i = 0; i < pass->desc.num_uses && !kept; i++) {
+            dvr_render_graph_resource_data* res =
+                dvr_get_render_graph_resource_data(uses[i].resource);
+            bool write = dvr_render_graph_get_access_info(uses[i].access, pass->desc.type).write;
+            if (write && (res->imported || res->needed)) {
+                kept = true;
+            }
+            if (uses[i].resolve) {
+                dvr_render_graph_resource_data* target =
+                    dvr_get_render_graph_resource_data(uses[i].resolve_target);
+                kept = kept || target->imported || target->needed;
+            }
+        }
+
+        pass->kept = kept;
+        if (!kept) {
+            continue;
+        }
+
+        // contents written without being read are not needed by earlier passes
+        for (u32 i = 0; i < pass->desc.num_uses; i++) {
+            if (!dvr_render_graph_use_reads(&uses[i])) {
+                dvr_get_render_graph_resource_data(uses[i].resource)->needed = false;
+            }
+            if (uses[i].resolve) {
+                dvr_get_render_graph_resource_data(uses[i].resolve_target)->needed = false;
+            }
+        }
+        for (u32 i = 0; i < pass->desc.num_uses; i++) {
+            if (dvr_render_graph_use_reads(&uses[i])) {
+                dvr_get_render_graph_resource_data(uses[i].resource)->needed = true;
+            }
+        }
+    }
+}
+
+static void dvr_render_graph_touch(
+    dvr_render_graph_resource_data* res,
+    u32 pass_index,
+    VkImageUsageFlags usage
+) {
+    if (!res->touched) {
+        res->first_pass = pass_index;
+        res->touched = true;
+    }
+    res->last_pass = pass_index;
+    res->usage |= usage;
+}
+
+static void dvr_render_graph_compute_lifetimes(void) {
+    for (u32 p = 0; p < arrlenu(g_dvr_state.graph.passes); p++) {
+        dvr_render_graph_pass_data* pass = &g_dvr_state.graph.passes[p];
+        if (!pass->kept) {
+            continue;
+        }
+
+        dvr_render_graph_use* uses = dvr_render_graph_pass_uses(pass);
+        for (u32 i = 0; i < pass->desc.num_uses; i++) {
+            dvr_render_graph_touch(
+                dvr_get_render_graph_resource_data(uses[i].resource),
+                p,
+                dvr_render_graph_get_access_info(uses[i].access, pass->desc.type).usage
+            );
+            if (uses[i].resolve) {
+                dvr_render_graph_touch(
+                    dvr_get_render_graph_resource_data(uses[i].resolve_target),
+                    p,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                );
+            }
+        }
+    }
 }
 
-dvr_render_pass dvr_swapchain_render_pass(void) {
-    return g_dvr_state.defaults.swapchain_render_pass;
+static bool dvr_render_graph_transient_matches(
+    dvr_render_graph_transient* transient,
+    dvr_render_graph_resource_data* res
+) {
+    return transient->desc.width == res->desc.width &&
+           transient->desc.height == res->desc.height &&
+           transient->desc.format == res->desc.format &&
+           transient->desc.samples == res->desc.samples && transient->usage == res->usage &&
+           transient->first_pass == res->first_pass && transient->last_pass == res->last_pass;
 }
 
-void dvr_begin_swapchain_render_pass(void) {
-    dvr_begin_render_pass(
-        dvr_swapchain_render_pass(),
-        dvr_swapchain_framebuffer(),
-        (VkClearValue[]){
-            {
-                .color = { { 0.0f, 0.0f, 0.0f, 1.0f } },
+static void dvr_render_graph_release_transients(void) {
+    for (usize i = 0; i < arrlenu(g_dvr_state.graph.transients); i++) {
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_IMAGE,
+                .image = g_dvr_state.graph.transients[i].image,
             },
-            {
-                .color = { { 0.0f, 0.0f, 0.0f, 1.0f } },
-            },
-            {
-                .depthStencil = { 1.0f, 0 },
+            0
+        );
+    }
+    for (usize i = 0; i < arrlenu(g_dvr_state.graph.blocks); i++) {
+        dvr_defer_destroy(
+            (dvr_deferred_destroy){
+                .kind = DVR_DEFERRED_DESTROY_MEMORY,
+                .memory = g_dvr_state.graph.blocks[i].memory,
             },
-        },
-        3
-    );
+            0
+        );
+    }
+    arrsetlen(g_dvr_state.graph.transients, 0);
+    arrsetlen(g_dvr_state.graph.blocks, 0);
 }
 
-VkDevice dvr_device(void) {
-    return DVR_DEVICE;
-}
+static DVR_RESULT(dvr_none) dvr_render_graph_allocate_transients(void) {
+    // transients in order of first use, they are already sorted by creation order which is
+    // close enough, lifetimes are what matters for aliasing
+    u32* wanted = NULL;
+    for (u32 r = 0; r < arrlenu(g_dvr_state.graph.resources); r++) {
+        dvr_render_graph_resource_data* res = &g_dvr_state.graph.resources[r];
+        if (!res->imported && res->touched) {
+            arrput(wanted, r);
+        }
+    }
 
-VkCommandBuffer dvr_command_buffer(void) {
-    return g_dvr_state.vk.command_buffer;
-}
+    // the graph usually looks the same every frame, reuse last frame's images if so
+    bool reuse = arrlenu(wanted) == arrlenu(g_dvr_state.graph.transients);
+    for (u32 i = 0; reuse && i < arrlenu(wanted); i++) {
+        reuse = dvr_render_graph_transient_matches(
+            &g_dvr_state.graph.transients[i],
+            &g_dvr_state.graph.resources[wanted[i]]
+        );
+    }
 
-VkCommandBuffer dvr_compute_command_buffer(void) {
-    return g_dvr_state.vk.compute_command_buffer;
-}
+    if (!reuse) {
+        dvr_render_graph_release_transients();
+
+        for (u32 i = 0; i < arrlenu(wanted); i++) {
+            dvr_render_graph_resource_data* res = &g_dvr_state.graph.resources[wanted[i]];
+
+            VkImageCreateInfo image_info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .extent = { res->desc.width, res->desc.height, 1 },
+                .mipLevels = 1,
+                .arrayLayers = 1,
+                .format = res->desc.format,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .usage = res->usage,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .samples = res->desc.samples,
+            };
 
-static DVR_RESULT(dvr_none) dvr_vk_recreate_swapchain(void) {
-    i32 width = 0;
-    i32 height = 0;
-    glfwGetFramebufferSize(g_dvr_state.window.window, &width, &height);
-    while (width == 0 || height == 0) {
-        glfwGetFramebufferSize(g_dvr_state.window.window, &width, &height);
-        glfwWaitEvents();
-    }
+            VkImage image;
+            if (vkCreateImage(DVR_DEVICE, &image_info, NULL, &image) != VK_SUCCESS) {
+                arrfree(wanted);
+                return DVR_ERROR(dvr_none, "failed to create transient image");
+            }
 
-    vkDeviceWaitIdle(DVR_DEVICE);
+            VkMemoryRequirements mem_reqs;
+            vkGetImageMemoryRequirements(DVR_DEVICE, image, &mem_reqs);
+
+            // first block that is free again before this image is needed
+            u32 block = (u32)arrlenu(g_dvr_state.graph.blocks);
+            for (u32 b = 0; b < arrlenu(g_dvr_state.graph.blocks); b++) {
+                dvr_render_graph_memory_block* candidate = &g_dvr_state.graph.blocks[b];
+                if (candidate->free_after < res->first_pass &&
+                    (candidate->type_bits & mem_reqs.memoryTypeBits) != 0) {
+                    block = b;
+                    break;
+                }
+            }
+            if (block == arrlenu(g_dvr_state.graph.blocks)) {
+                arrput(
+                    g_dvr_state.graph.blocks,
+                    ((dvr_render_graph_memory_block){
+                        .type_bits = mem_reqs.memoryTypeBits,
+                        .last_transient = -1,
+                    })
+                );
+            }
 
-    dvr_vk_cleanup_swapchain();
+            dvr_render_graph_memory_block* b = &g_dvr_state.graph.blocks[block];
+            // blocks are bound at offset 0, so the largest size is enough for every occupant
+            b->size = b->size > mem_reqs.size ? b->size : mem_reqs.size;
+            b->type_bits &= mem_reqs.memoryTypeBits;
+            b->free_after = res->last_pass;
+
+            dvr_image_data img = {
+                .vk.image = image,
+                .vk.memory = VK_NULL_HANDLE,
+                .vk.format = res->desc.format,
+                .width = res->desc.width,
+                .height = res->desc.height,
+                .mip_level = 1,
+                .serial = ++g_dvr_state.res.next_serial,
+                .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+            };
+            u16 slot = dvr_find_free_slot(g_dvr_state.res.image_usage_map, DVR_MAX_IMAGES);
+            g_dvr_state.res.images[slot] = img;
+            dvr_set_slot_used(g_dvr_state.res.image_usage_map, slot);
+
+            arrput(
+                g_dvr_state.graph.transients,
+                ((dvr_render_graph_transient){
+                    .desc = res->desc,
+                    .usage = res->usage,
+                    .first_pass = res->first_pass,
+                    .last_pass = res->last_pass,
+                    .image = (dvr_image){ .id = slot },
+                    .block = block,
+                    .alias_prev = b->last_transient,
+                })
+            );
+            b->last_transient = (i32)i;
+        }
 
-    DVR_RESULT(dvr_none) res = dvr_vk_create_swapchain();
-    DVR_BUBBLE(res);
+        for (u32 b = 0; b < arrlenu(g_dvr_state.graph.blocks); b++) {
+            dvr_render_graph_memory_block* block = &g_dvr_state.graph.blocks[b];
 
-    res = dvr_vk_create_swapchain_image_views();
-    DVR_BUBBLE(res);
+            DVR_RESULT(u32)
+            memory_type_res =
+                dvr_vk_find_memory_type(block->type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            if (DVR_RESULT_IS_ERROR(memory_type_res)) {
+                arrfree(wanted);
+                return DVR_ERROR(dvr_none, "failed to find memory type for transient images");
+            }
 
-    res = dvr_vk_create_swapchain_render_pass();
-    DVR_BUBBLE(res);
+            VkMemoryAllocateInfo alloc_info = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .allocationSize = block->size,
+                .memoryTypeIndex = DVR_UNWRAP(memory_type_res),
+            };
+            if (vkAllocateMemory(DVR_DEVICE, &alloc_info, NULL, &block->memory) != VK_SUCCESS) {
+                arrfree(wanted);
+                return DVR_ERROR(dvr_none, "failed to allocate transient image memory");
+            }
+        }
 
-    res = dvr_vk_create_render_targets();
-    DVR_BUBBLE(res);
+        for (u32 i = 0; i < arrlenu(g_dvr_state.graph.transients); i++) {
+            dvr_render_graph_transient* transient = &g_dvr_state.graph.transients[i];
+            dvr_image_data* img = dvr_get_image_data(transient->image);
 
-    res = dvr_vk_create_swapchain_framebuffers();
-    DVR_BUBBLE(res);
+            vkBindImageMemory(
+                DVR_DEVICE,
+                img->vk.image,
+                g_dvr_state.graph.blocks[transient->block].memory,
+                0
+            );
+
+            DVR_RESULT(VkImageView)
+            view_res = dvr_vk_create_image_view(img->vk.image, img->vk.format, 1);
+            if (DVR_RESULT_IS_ERROR(view_res)) {
+                arrfree(wanted);
+                return DVR_ERROR(dvr_none, "failed to create transient image view");
+            }
+            img->vk.view = DVR_UNWRAP(view_res);
+        }
+    }
+
+    for (u32 i = 0; i < arrlenu(wanted); i++) {
+        dvr_render_graph_resource_data* res = &g_dvr_state.graph.resources[wanted[i]];
+        res->transient = (i32)i;
+        res->image = g_dvr_state.graph.transients[i].image;
+        g_dvr_state.graph.transients[i].resource = wanted[i];
+    }
 
+    arrfree(wanted);
     return DVR_OK(dvr_none, DVR_NONE);
 }
 
-DVR_RESULT(dvr_none) dvr_begin_frame(void) {
-    vkWaitForFences(DVR_DEVICE, 1, &g_dvr_state.vk.in_flight_fence, VK_TRUE, UINT64_MAX);
-
-    VkResult result = vkAcquireNextImageKHR(
-        DVR_DEVICE,
-        g_dvr_state.vk.swapchain,
-        UINT64_MAX,
-        g_dvr_state.vk.image_available_sem,
-        VK_NULL_HANDLE,
-        &g_dvr_state.vk.image_index
-    );
+typedef struct dvr_render_graph_barrier_batch {
+    VkPipelineStageFlags src_stage;
+    VkPipelineStageFlags dst_stage;
+    VkImageMemoryBarrier* image_barriers;
+    VkBufferMemoryBarrier* buffer_barriers;
+} dvr_render_graph_barrier_batch;
+
+static void dvr_render_graph_first_use(dvr_render_graph_resource_data* res) {
+    res->recorded = true;
+
+    if (res->imported) {
+        // whatever happened to the resource before the graph is unknown, wait for all of it
+        res->write_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        res->write_access = VK_ACCESS_MEMORY_WRITE_BIT;
+        if (res->is_image) {
+            res->layout = dvr_get_image_data(res->image)->layout;
+        }
+        return;
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        DVR_RESULT(dvr_none) res = dvr_vk_recreate_swapchain();
-        DVR_BUBBLE(res);
-        return DVR_OK(dvr_none, DVR_NONE);
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        return DVR_ERROR(dvr_none, "failed to acquire swapchain image");
+    // transient contents start out undefined, only accesses to aliased memory need to finish
+    res->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    i32 prev = g_dvr_state.graph.transients[res->transient].alias_prev;
+    if (prev >= 0) {
+        dvr_render_graph_resource_data* prev_res =
+            &g_dvr_state.graph.resources[g_dvr_state.graph.transients[prev].resource];
+        res->write_stage = prev_res->write_stage | prev_res->read_stages;
+        res->write_access = prev_res->write_access;
     }
+}
 
-    vkResetFences(DVR_DEVICE, 1, &g_dvr_state.vk.in_flight_fence);
+static void dvr_render_graph_sync(
+    dvr_render_graph_resource_data* res,
+    dvr_render_graph_access_info info,
+    bool discard,
+    dvr_render_graph_barrier_batch* batch
+) {
+    VkImageLayout layout = res->is_image ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+    bool layout_change = res->is_image && res->layout != layout;
+
+    VkPipelineStageFlags src_stage = 0;
+    VkAccessFlags src_access = 0;
+    bool needs_barrier = false;
+
+    if (info.write || layout_change) {
+        // write after write needs a memory dependency, write after read only an execution
+        // dependency, layout transitions are writes
+        src_stage = res->write_stage | res->read_stages;
+        src_access = res->write_access;
+        needs_barrier = src_stage != 0 || layout_change;
+    } else if ((res->read_stages & info.stage) != info.stage ||
+               (res->read_access & info.access) != info.access) {
+        // read after write, unless this kind of read already waited for the write
+        src_stage = res->write_stage;
+        src_access = res->write_access;
+        needs_barrier = src_stage != 0;
+    }
+
+    if (needs_barrier) {
+        batch->src_stage |= src_stage != 0 ? src_stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        batch->dst_stage |= info.stage;
+
+        if (res->is_image) {
+            dvr_image_data* img = dvr_get_image_data(res->image);
+            VkImageMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = src_access,
+                .dstAccessMask = info.access,
+                .oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : res->layout,
+                .newLayout = layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = img->vk.image,
+                .subresourceRange = {
+                    .aspectMask = dvr_vk_barrier_aspect(img->vk.format),
+                    .baseMipLevel = 0,
+                    .levelCount = img->mip_level,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+            };
+            arrput(batch->image_barriers, barrier);
+        } else {
+            VkBufferMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .srcAccessMask = src_access,
+                .dstAccessMask = info.access,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = dvr_get_buffer_data(res->buffer)->vk.buffer,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+            };
+            arrput(batch->buffer_barriers, barrier);
+        }
+    }
 
-    vkResetCommandBuffer(g_dvr_state.vk.command_buffer, 0);
+    if (info.write) {
+        res->write_stage = info.stage;
+        res->write_access = info.access;
+        res->read_stages = 0;
+        res->read_access = 0;
+    } else if (layout_change) {
+        // earlier readers were waited on by the transition
+        res->write_stage = info.stage;
+        res->write_access = 0;
+        res->read_stages = info.stage;
+        res->read_access = info.access;
+    } else {
+        res->read_stages |= info.stage;
+        res->read_access |= info.access;
+    }
 
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = 0,
-        .pInheritanceInfo = NULL,
-    };
+    if (res->is_image) {
+        res->layout = layout;
+        dvr_vk_set_image_layout(dvr_get_image_data(res->image), layout);
+    }
+}
 
-    if (vkBeginCommandBuffer(g_dvr_state.vk.command_buffer, &begin_info) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to begin recording command buffer");
+static void dvr_render_graph_flush_barriers(dvr_render_graph_barrier_batch* batch) {
+    if (arrlenu(batch->image_barriers) == 0 && arrlenu(batch->buffer_barriers) == 0) {
+        return;
     }
 
-    return DVR_OK(dvr_none, DVR_NONE);
+    vkCmdPipelineBarrier(
+        DVR_COMMAND_BUFFER,
+        batch->src_stage,
+        batch->dst_stage,
+        0,
+        0,
+        NULL,
+        (u32)arrlenu(batch->buffer_barriers),
+        batch->buffer_barriers,
+        (u32)arrlenu(batch->image_barriers),
+        batch->image_barriers
+    );
+    g_dvr_state.stats.current.barriers++;
+
+    batch->src_stage = 0;
+    batch->dst_stage = 0;
+    arrsetlen(batch->image_barriers, 0);
+    arrsetlen(batch->buffer_barriers, 0);
 }
 
-DVR_RESULT(dvr_none) dvr_end_frame(void) {
-    if (vkEndCommandBuffer(g_dvr_state.vk.command_buffer) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to record command buffer");
+static bool dvr_render_graph_begin_pass_rendering(u32 pass_index) {
+    dvr_render_graph_pass_data* pass = &g_dvr_state.graph.passes[pass_index];
+    if (!g_dvr_state.config.dynamic_rendering || pass->desc.type != DVR_RENDER_GRAPH_PASS_GRAPHICS) {
+        return false;
     }
 
-    VkSubmitInfo submit_info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &g_dvr_state.vk.command_buffer,
-        .waitSemaphoreCount = 2,
-        .pWaitSemaphores =
-            (VkSemaphore[]){
-                g_dvr_state.vk.compute_finished_sem,
-                g_dvr_state.vk.image_available_sem,
-            },
-        .pWaitDstStageMask =
-            (VkPipelineStageFlags[]){
-                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            },
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores =
-            (VkSemaphore[]){
-                g_dvr_state.vk.render_finished_sem,
-            },
-    };
+    dvr_rendering_desc rendering = { 0 };
+    dvr_render_graph_use* uses = dvr_render_graph_pass_uses(pass);
+    for (u32 i = 0; i < pass->desc.num_uses; i++) {
+        if (!dvr_render_graph_is_attachment(uses[i].access)) {
+            continue;
+        }
 
-    if (vkQueueSubmit(
-            g_dvr_state.vk.graphics_queue,
-            1,
-            &submit_info,
-            g_dvr_state.vk.in_flight_fence
-        ) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to submit draw command buffer");
-    }
+        dvr_render_graph_resource_data* res = dvr_get_render_graph_resource_data(uses[i].resource);
+        // nobody reads a transient after its last pass, don't bother storing it
+        bool store = res->imported || res->last_pass != pass_index;
+        dvr_rendering_attachment_desc attachment = {
+            .image = res->image,
+            .load_op = uses[i].load_op,
+            .store_op = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .clear_value = uses[i].clear_value,
+            .resolve = uses[i].resolve,
+        };
+        if (uses[i].resolve) {
+            attachment.resolve_image =
+                dvr_get_render_graph_resource_data(uses[i].resolve_target)->image;
+        }
 
-    VkPresentInfoKHR present_info = {
-        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores =
-            (VkSemaphore[]){
-                g_dvr_state.vk.render_finished_sem,
-            },
-        .swapchainCount = 1,
-        .pSwapchains =
-            (VkSwapchainKHR[]){
-                g_dvr_state.vk.swapchain,
-            },
-        .pImageIndices = &g_dvr_state.vk.image_index,
-        .pResults = NULL,
-    };
+        if (uses[i].access == DVR_RENDER_GRAPH_ACCESS_DEPTH_ATTACHMENT) {
+            rendering.has_depth_attachment = true;
+            rendering.depth_attachment = attachment;
+        } else if (rendering.num_color_attachments < DVR_MAX_RENDER_PASS_COLOR_ATTACHMENTS) {
+            rendering.color_attachments[rendering.num_color_attachments++] = attachment;
+        }
+    }
 
-    VkResult result = vkQueuePresentKHR(g_dvr_state.vk.present_queue, &present_info);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-        g_dvr_state.window.just_resized) {
-        g_dvr_state.window.just_resized = false;
-        DVR_RESULT(dvr_none) res = dvr_vk_recreate_swapchain();
-        DVR_BUBBLE(res);
-        return DVR_OK(dvr_none, DVR_NONE);
-    } else if (result != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to present swapchain image");
+    if (rendering.num_color_attachments == 0 && !rendering.has_depth_attachment) {
+        return false;
     }
 
-    return DVR_OK(dvr_none, DVR_NONE);
+    dvr_vk_begin_rendering(&rendering, false);
+    return true;
 }
 
-DVR_RESULT(dvr_none) dvr_begin_compute(void) {
-    vkWaitForFences(DVR_DEVICE, 1, &g_dvr_state.vk.compute_fence, VK_TRUE, UINT64_MAX);
-
-    vkResetFences(DVR_DEVICE, 1, &g_dvr_state.vk.compute_fence);
+DVR_RESULT(dvr_none) dvr_render_graph_execute(void) {
+    dvr_render_graph_cull();
+    dvr_render_graph_compute_lifetimes();
 
-    vkResetCommandBuffer(g_dvr_state.vk.compute_command_buffer, 0);
+    DVR_RESULT(dvr_none) res = dvr_render_graph_allocate_transients();
+    DVR_BUBBLE(res);
 
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = 0,
-        .pInheritanceInfo = NULL,
-    };
+    dvr_render_graph_barrier_batch batch = { 0 };
 
-    if (vkBeginCommandBuffer(g_dvr_state.vk.compute_command_buffer, &begin_info) !=
-        VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to begin recording compute command buffer");
-    }
+    for (u32 p = 0; p < arrlenu(g_dvr_state.graph.passes); p++) {
+        dvr_render_graph_pass_data* pass = &g_dvr_state.graph.passes[p];
+        if (!pass->kept) {
+            continue;
+        }
 
-    return DVR_OK(dvr_none, DVR_NONE);
-}
+        // all barriers of a pass go out in a single call
+        dvr_render_graph_use* uses = dvr_render_graph_pass_uses(pass);
+        for (u32 i = 0; i < pass->desc.num_uses; i++) {
+            dvr_render_graph_resource_data* resource =
+                dvr_get_render_graph_resource_data(uses[i].resource);
+            if (!resource->recorded) {
+                dvr_render_graph_first_use(resource);
+            }
 
-DVR_RESULT(dvr_none) dvr_end_compute(void) {
-    if (vkEndCommandBuffer(g_dvr_state.vk.compute_command_buffer) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to record compute command buffer");
-    }
+            dvr_render_graph_sync(
+                resource,
+                dvr_render_graph_get_access_info(uses[i].access, pass->desc.type),
+                !dvr_render_graph_use_reads(&uses[i]) &&
+                    dvr_render_graph_is_attachment(uses[i].access),
+                &batch
+            );
 
-    VkSubmitInfo submit_info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &g_dvr_state.vk.compute_command_buffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores =
-            (VkSemaphore[]){
-                g_dvr_state.vk.compute_finished_sem,
-            },
-    };
+            if (uses[i].resolve) {
+                dvr_render_graph_resource_data* target =
+                    dvr_get_render_graph_resource_data(uses[i].resolve_target);
+                if (!target->recorded) {
+                    dvr_render_graph_first_use(target);
+                }
+                dvr_render_graph_sync(
+                    target,
+                    dvr_render_graph_get_access_info(
+                        DVR_RENDER_GRAPH_ACCESS_COLOR_ATTACHMENT,
+                        pass->desc.type
+                    ),
+                    true,
+                    &batch
+                );
+            }
+        }
+        dvr_render_graph_flush_barriers(&batch);
 
-    if (vkQueueSubmit(
-            g_dvr_state.vk.compute_queue,
-            1,
-            &submit_info,
-            g_dvr_state.vk.compute_fence
-        ) != VK_SUCCESS) {
-        return DVR_ERROR(dvr_none, "failed to submit compute command buffer");
-    }
+        bool rendering = dvr_render_graph_begin_pass_rendering(p);
 
-    return DVR_OK(dvr_none, DVR_NONE);
-}
+        g_dvr_state.graph.recording = true;
+        if (pass->desc.execute != NULL) {
+            pass->desc.execute(pass->desc.user_data);
+        }
+        g_dvr_state.graph.recording = false;
 
-bool dvr_should_close(void) {
-    return glfwWindowShouldClose(g_dvr_state.window.window);
-}
+        if (rendering) {
+            dvr_end_rendering();
+        }
+    }
 
-void dvr_poll_events(void) {
-    glfwPollEvents();
-}
+    arrfree(batch.image_barriers);
+    arrfree(batch.buffer_barriers);
 
-void dvr_close(void) {
-    glfwSetWindowShouldClose(g_dvr_state.window.window, GLFW_TRUE);
+    return DVR_OK(dvr_none, DVR_NONE);
 }
 
-void dvr_wait_idle(void) {
-    vkDeviceWaitIdle(DVR_DEVICE);
-}
+static void dvr_render_graph_shutdown(void) {
+    for (usize i = 0; i < arrlenu(g_dvr_state.graph.transients); i++) {
+        dvr_destroy_image(g_dvr_state.graph.transients[i].image);
+    }
+    for (usize i = 0; i < arrlenu(g_dvr_state.graph.blocks); i++) {
+        vkFreeMemory(DVR_DEVICE, g_dvr_state.graph.blocks[i].memory, NULL);
+    }
 
-void dvr_get_window_size(u32* width, u32* height) {
-    i32 w, h;
-    glfwGetFramebufferSize(g_dvr_state.window.window, &w, &h);
-    *width = (u32)w;
-    *height = (u32)h;
+    arrfree(g_dvr_state.graph.transients);
+    arrfree(g_dvr_state.graph.blocks);
+    arrfree(g_dvr_state.graph.resources);
+    arrfree(g_dvr_state.graph.passes);
+    arrfree(g_dvr_state.graph.uses);
 }
 
 #ifdef DVR_ENABLE_IMGUI
@@ -3390,6 +8092,10 @@ static const VkDescriptorPoolSize k_imgui_pool_sizes[] = {
 };
 
 DVR_RESULT(dvr_none) dvr_imgui_setup(void) {
+    if (g_dvr_state.config.headless) {
+        return DVR_ERROR(dvr_none, "imgui needs a window, it is not available in headless mode");
+    }
+
     igCreateContext(NULL);
     ImGuiIO* io = igGetIO();
     io->ConfigFlags |= ImGuiConfigFlags_DockingEnable;
@@ -3412,8 +8118,11 @@ DVR_RESULT(dvr_none) dvr_imgui_setup(void) {
         return DVR_ERROR(dvr_none, "failed to create imgui descriptor pool");
     }
 
-    VkRenderPass swapchain_render_pass =
-        dvr_get_render_pass_data(g_dvr_state.defaults.swapchain_render_pass)->vk.render_pass;
+    VkRenderPass swapchain_render_pass = VK_NULL_HANDLE;
+    if (!g_dvr_state.config.dynamic_rendering) {
+        swapchain_render_pass =
+            dvr_get_render_pass_data(g_dvr_state.defaults.swapchain_render_pass)->vk.render_pass;
+    }
 
     ImGui_ImplVulkan_InitInfo init_info = {
         .Instance = g_dvr_state.vk.instance,
@@ -3421,13 +8130,20 @@ DVR_RESULT(dvr_none) dvr_imgui_setup(void) {
         .Device = DVR_DEVICE,
         .QueueFamily = find_queue_families(g_dvr_state.vk.physical_device).graphics_family,
         .Queue = g_dvr_state.vk.graphics_queue,
-        .PipelineCache = VK_NULL_HANDLE,
+        .PipelineCache = g_dvr_state.vk.pipeline_cache,
         .DescriptorPool = g_dvr_state.imgui.pool,
         .MinImageCount = 2,
         .ImageCount = (u32)arrlenu(g_dvr_state.vk.swapchain_images),
-        .MSAASamples = g_dvr_state.vk.max_msaa_samples,
+        .MSAASamples = g_dvr_state.vk.swapchain_samples,
         .RenderPass = swapchain_render_pass,
         .Subpass = 0,
+        .UseDynamicRendering = g_dvr_state.config.dynamic_rendering,
+        .PipelineRenderingCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &g_dvr_state.vk.swapchain_format,
+            .depthAttachmentFormat = g_dvr_state.vk.swapchain_depth_format,
+        },
     };
 
     if (!ImGui_ImplVulkan_Init(&init_info)) {
@@ -3476,6 +8192,7 @@ void dvr_imgui_info(void) {
         igText("physical device: %p", g_dvr_state.vk.physical_device);
         igText("physical device name: %s", g_dvr_state.vk.physical_device_props.deviceName);
         igText("max msaa samples: %d", g_dvr_state.vk.max_msaa_samples);
+        igText("swapchain msaa samples: %d", g_dvr_state.vk.swapchain_samples);
         igUnindent(16.0f);
     }
 
@@ -3553,6 +8270,9 @@ void dvr_imgui_info(void) {
         }
         igText("present mode: %s", present_mode_str);
         igText("swapchain image count: %d", g_dvr_state.vk.swapchain_image_count);
+        igText("present wait: %s", g_dvr_state.pacing.present_wait_enabled ? "yes" : "no");
+        igText("dynamic rendering: %s", g_dvr_state.config.dynamic_rendering ? "yes" : "no");
+        igText("target frame interval: %.3f ms", g_dvr_state.config.target_frame_interval * 1e3);
 
         igUnindent(16.0f);
     }
@@ -3930,4 +8650,50 @@ void dvr_imgui_info(void) {
 
     igEnd();
 }
+
+void dvr_imgui_frame_stats(void) {
+    dvr_frame_stats stats = dvr_get_frame_stats();
+
+    igBegin("dvr frame stats", NULL, 0);
+
+    igText("frame: %llu", (unsigned long long)stats.frame_index);
+
+    if (igCollapsingHeader_TreeNodeFlags("submission", ImGuiTreeNodeFlags_DefaultOpen)) {
+        igIndent(16.0f);
+        igText("draw calls: %u", stats.draw_calls);
+        igText("dispatches: %u", stats.dispatches);
+        igText("pipeline binds: %u", stats.pipeline_binds);
+        igText("descriptor set binds: %u", stats.descriptor_set_binds);
+        igText("barriers: %u", stats.barriers);
+        igText("staging bytes uploaded: %llu", (unsigned long long)stats.staging_bytes_uploaded);
+        igText("transient submits: %u", stats.transient_submits);
+        igText("queue waits: %u", stats.queue_waits);
+        igUnindent(16.0f);
+    }
+
+    if (igCollapsingHeader_TreeNodeFlags("live resources", ImGuiTreeNodeFlags_DefaultOpen)) {
+        igIndent(16.0f);
+        igText("buffers: %u / %u", stats.live.buffers, DVR_MAX_BUFFERS);
+        igText("images: %u / %u", stats.live.images, DVR_MAX_IMAGES);
+        igText("samplers: %u / %u", stats.live.samplers, DVR_MAX_SAMPLERS);
+        igText("render passes: %u / %u", stats.live.render_passes, DVR_MAX_RENDER_PASSES);
+        igText("shader modules: %u / %u", stats.live.shader_modules, DVR_MAX_SHADER_MODULES);
+        igText("pipelines: %u / %u", stats.live.pipelines, DVR_MAX_PIPELINES);
+        igText("framebuffers: %u / %u", stats.live.framebuffers, DVR_MAX_FRAMEBUFFERS);
+        igText(
+            "descriptor set layouts: %u / %u",
+            stats.live.descriptor_set_layouts,
+            DVR_MAX_DESCRIPTOR_SET_LAYOUTS
+        );
+        igText("descriptor sets: %u / %u", stats.live.descriptor_sets, DVR_MAX_DESCRIPTOR_SETS);
+        igText(
+            "compute pipelines: %u / %u",
+            stats.live.compute_pipelines,
+            DVR_MAX_COMPUTE_PIPELINES
+        );
+        igUnindent(16.0f);
+    }
+
+    igEnd();
+}
 #endif
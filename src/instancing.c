@@ -0,0 +1,146 @@
+#include "dvr_instancing.h"
+
+void dvr_vertex_input_append(dvr_vertex_input* input, dvr_vertex_input_state_desc desc) {
+    u32 base_binding = input->num_bindings;
+    for (u32 i = 0; i < desc.num_bindings; i++) {
+        if (input->num_bindings == DVR_VERTEX_INPUT_MAX_BINDINGS) {
+            DVRLOG_ERROR("too many vertex input bindings");
+            return;
+        }
+        VkVertexInputBindingDescription binding = desc.bindings[i];
+        binding.binding += base_binding;
+        input->bindings[input->num_bindings++] = binding;
+    }
+    for (u32 i = 0; i < desc.num_attributes; i++) {
+        if (input->num_attributes == DVR_VERTEX_INPUT_MAX_ATTRIBUTES) {
+            DVRLOG_ERROR("too many vertex input attributes");
+            return;
+        }
+        VkVertexInputAttributeDescription attribute = desc.attributes[i];
+        attribute.binding += base_binding;
+        input->attributes[input->num_attributes++] = attribute;
+    }
+}
+
+u32 dvr_vertex_input_add_instance_binding(dvr_vertex_input* input, u32 stride) {
+    if (input->num_bindings == DVR_VERTEX_INPUT_MAX_BINDINGS) {
+        DVRLOG_ERROR("too many vertex input bindings");
+        return DVR_VERTEX_INPUT_MAX_BINDINGS - 1;
+    }
+
+    u32 binding = input->num_bindings++;
+    input->bindings[binding] = (VkVertexInputBindingDescription){
+        .binding = binding,
+        .stride = stride,
+        .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+    };
+    return binding;
+}
+
+void dvr_vertex_input_add_attribute(
+    dvr_vertex_input* input,
+    u32 binding,
+    u32 location,
+    VkFormat format,
+    u32 offset
+) {
+    if (input->num_attributes == DVR_VERTEX_INPUT_MAX_ATTRIBUTES) {
+        DVRLOG_ERROR("too many vertex input attributes");
+        return;
+    }
+
+    input->attributes[input->num_attributes++] = (VkVertexInputAttributeDescription){
+        .location = location,
+        .binding = binding,
+        .format = format,
+        .offset = offset,
+    };
+}
+
+void dvr_vertex_input_add_mat4(dvr_vertex_input* input, u32 binding, u32 location, u32 offset) {
+    for (u32 i = 0; i < 4; i++) {
+        dvr_vertex_input_add_attribute(
+            input,
+            binding,
+            location + i,
+            VK_FORMAT_R32G32B32A32_SFLOAT,
+            offset + i * 4 * (u32)sizeof(f32)
+        );
+    }
+}
+
+dvr_vertex_input_state_desc dvr_vertex_input_desc(dvr_vertex_input* input) {
+    return (dvr_vertex_input_state_desc){
+        .num_bindings = input->num_bindings,
+        .bindings = input->bindings,
+        .num_attributes = input->num_attributes,
+        .attributes = input->attributes,
+    };
+}
+
+DVR_RESULT(dvr_instance_buffer) dvr_create_instance_buffer(dvr_instance_buffer_desc* desc) {
+    if (desc->stride == 0 || desc->capacity == 0) {
+        return DVR_ERROR(dvr_instance_buffer, "instance buffer needs a stride and a capacity");
+    }
+
+    DVR_RESULT(dvr_buffer)
+    buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .data = {
+            .base = NULL,
+            .size = (usize)desc->stride * desc->capacity,
+        },
+        .usage = DVR_BUFFER_USAGE_VERTEX,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+    });
+    DVR_BUBBLE_INTO(dvr_instance_buffer, buffer_res);
+
+    dvr_instance_buffer instances = {
+        .buffer = DVR_UNWRAP(buffer_res),
+        .stride = desc->stride,
+        .capacity = desc->capacity,
+        .binding = desc->binding,
+        .count = 0,
+        .frame_index = dvr_frame_index(),
+    };
+    return DVR_OK(dvr_instance_buffer, instances);
+}
+
+void dvr_destroy_instance_buffer(dvr_instance_buffer* instances) {
+    dvr_destroy_buffer(instances->buffer);
+    *instances = (dvr_instance_buffer){};
+}
+
+DVR_RESULT(dvr_instance_range)
+dvr_push_instances(dvr_instance_buffer* instances, const void* data, u32 count) {
+    // with one frame in flight the previous frame finished reading once a new one began
+    u64 frame_index = dvr_frame_index();
+    if (instances->frame_index != frame_index) {
+        instances->frame_index = frame_index;
+        instances->count = 0;
+    }
+
+    if (count > instances->capacity - instances->count) {
+        return DVR_ERROR(dvr_instance_range, "instance buffer is full");
+    }
+
+    dvr_instance_range range = {
+        .first_instance = instances->count,
+        .instance_count = count,
+    };
+    dvr_write_buffer(
+        instances->buffer,
+        (dvr_range){ .base = (void*)data, .size = (usize)instances->stride * count },
+        instances->count * instances->stride
+    );
+    instances->count += count;
+
+    return DVR_OK(dvr_instance_range, range);
+}
+
+void dvr_bind_instance_buffer(const dvr_instance_buffer* instances) {
+    dvr_bind_vertex_buffer(instances->buffer, instances->binding);
+}
+
+void dvr_draw_instanced(const dvr_mesh* mesh, u32 submesh, u32 lod, dvr_instance_range range) {
+    dvr_draw_submesh_instances(mesh, submesh, lod, range.instance_count, range.first_instance);
+}
@@ -0,0 +1,386 @@
+#include "dvr_loader.h"
+
+#include "dvr_texture.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include <stb/stb_ds.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define DVR_MAX_LOADS 1024
+#define DVR_LOADER_MAX_THREADS 16
+#define DVR_LOADER_DEFAULT_UPLOAD_BUDGET (64ull * 1024 * 1024)
+
+typedef enum dvr_load_stage {
+    DVR_LOAD_STAGE_FREE,
+    DVR_LOAD_STAGE_QUEUED,
+    DVR_LOAD_STAGE_WORKING,
+    // read and decoded, waiting for the main thread to upload it
+    DVR_LOAD_STAGE_DECODED,
+    DVR_LOAD_STAGE_DONE,
+} dvr_load_stage;
+
+typedef struct dvr_load_data {
+    // guarded by the loader mutex
+    dvr_load_stage stage;
+    bool released;
+
+    // only touched by the main thread
+    dvr_load_state state;
+    dvr_image image;
+    dvr_buffer buffer;
+
+    // owned by the worker while WORKING, by the main thread afterwards
+    dvr_load_desc desc;
+    const char* error;
+    dvr_mapped_file file;
+    // malloc'd contents, from a compressed archive entry or `decode`
+    dvr_range owned;
+    dvr_range contents;
+    dvr_texture_file texture;
+} dvr_load_data;
+
+static struct {
+    bool running;
+    bool quit;
+    mtx_t mutex;
+    cnd_t wake;
+    thrd_t threads[DVR_LOADER_MAX_THREADS];
+    u32 num_threads;
+    usize upload_budget;
+    dvr_load_data loads[DVR_MAX_LOADS];
+    // FIFOs of load ids
+    u16* queued;
+    u16* decoded;
+} g_dvr_loader;
+
+static dvr_load_data* dvr_get_load_data(dvr_load load) {
+    if (load.id >= DVR_MAX_LOADS) {
+        DVRLOG_ERROR("load id out of range: %u", load.id);
+        return NULL;
+    }
+
+    return &g_dvr_loader.loads[load.id];
+}
+
+static void dvr_load_free_contents(dvr_load_data* data) {
+    dvr_unmap_file(&data->file);
+    free(data->owned.base);
+    free((char*)data->desc.path);
+    data->owned = DVR_RANGE_NULL;
+    data->contents = DVR_RANGE_NULL;
+    data->desc.path = NULL;
+}
+
+/// Worker side of a load: read, decompress and decode, nothing here touches Vulkan.
+static void dvr_load_process(dvr_load_data* data) {
+    if (data->desc.archive != NULL) {
+        DVR_RESULT(dvr_range) view_res = dvr_archive_view(data->desc.archive, data->desc.path);
+        if (view_res.is_ok) {
+            data->contents = view_res.ok;
+        } else {
+            DVR_RESULT(dvr_range) read_res =
+                dvr_archive_read(data->desc.archive, data->desc.path);
+            if (!read_res.is_ok) {
+                data->error = read_res.error.message;
+                return;
+            }
+            data->owned = read_res.ok;
+            data->contents = read_res.ok;
+        }
+    } else {
+        DVR_RESULT(dvr_mapped_file)
+        file_res = dvr_map_file(data->desc.path, 0, 0, DVR_FILE_ACCESS_SEQUENTIAL);
+        if (!file_res.is_ok) {
+            data->error = file_res.error.message;
+            return;
+        }
+        data->file = file_res.ok;
+        data->contents = file_res.ok.range;
+    }
+
+    if (data->desc.decode != NULL) {
+        DVR_RESULT(dvr_range) decode_res = data->desc.decode(data->contents, data->desc.user_data);
+        dvr_unmap_file(&data->file);
+        free(data->owned.base);
+        data->owned = DVR_RANGE_NULL;
+        data->contents = DVR_RANGE_NULL;
+        if (!decode_res.is_ok) {
+            data->error = decode_res.error.message;
+            return;
+        }
+        data->owned = decode_res.ok;
+        data->contents = decode_res.ok;
+    }
+
+    if (data->desc.kind == DVR_LOAD_KIND_TEXTURE) {
+        DVR_RESULT(dvr_texture_file) texture_res = dvr_parse_texture(data->contents);
+        if (!texture_res.is_ok) {
+            data->error = texture_res.error.message;
+            return;
+        }
+        data->texture = texture_res.ok;
+    }
+}
+
+static int dvr_loader_worker(void* arg) {
+    (void)arg;
+
+    mtx_lock(&g_dvr_loader.mutex);
+    while (true) {
+        while (!g_dvr_loader.quit && arrlenu(g_dvr_loader.queued) == 0) {
+            cnd_wait(&g_dvr_loader.wake, &g_dvr_loader.mutex);
+        }
+        if (g_dvr_loader.quit) {
+            break;
+        }
+
+        u16 id = g_dvr_loader.queued[0];
+        arrdel(g_dvr_loader.queued, 0);
+        dvr_load_data* data = &g_dvr_loader.loads[id];
+        data->stage = DVR_LOAD_STAGE_WORKING;
+        mtx_unlock(&g_dvr_loader.mutex);
+
+        dvr_load_process(data);
+
+        mtx_lock(&g_dvr_loader.mutex);
+        data->stage = DVR_LOAD_STAGE_DECODED;
+        arrput(g_dvr_loader.decoded, id);
+    }
+    mtx_unlock(&g_dvr_loader.mutex);
+
+    return 0;
+}
+
+static u32 dvr_loader_default_threads(void) {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    i64 cores = (i64)system_info.dwNumberOfProcessors;
+#else
+    i64 cores = (i64)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    // leave a core to the render loop
+    return cores > 2 ? (u32)(cores - 1) : 1;
+}
+
+DVR_RESULT(dvr_none) dvr_loader_setup(dvr_loader_desc* desc) {
+    if (g_dvr_loader.running) {
+        return DVR_ERROR(dvr_none, "loader is already running");
+    }
+
+    u32 num_threads = desc->num_threads > 0 ? desc->num_threads : dvr_loader_default_threads();
+    num_threads = num_threads < DVR_LOADER_MAX_THREADS ? num_threads : DVR_LOADER_MAX_THREADS;
+    g_dvr_loader.upload_budget =
+        desc->upload_budget > 0 ? desc->upload_budget : DVR_LOADER_DEFAULT_UPLOAD_BUDGET;
+    g_dvr_loader.quit = false;
+
+    if (mtx_init(&g_dvr_loader.mutex, mtx_plain) != thrd_success ||
+        cnd_init(&g_dvr_loader.wake) != thrd_success) {
+        return DVR_ERROR(dvr_none, "failed to create loader synchronization");
+    }
+
+    for (u32 i = 0; i < num_threads; i++) {
+        if (thrd_create(&g_dvr_loader.threads[i], dvr_loader_worker, NULL) != thrd_success) {
+            g_dvr_loader.num_threads = i;
+            g_dvr_loader.running = true;
+            dvr_loader_shutdown();
+            return DVR_ERROR(dvr_none, "failed to create loader thread");
+        }
+    }
+    g_dvr_loader.num_threads = num_threads;
+    g_dvr_loader.running = true;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+void dvr_loader_shutdown(void) {
+    if (!g_dvr_loader.running) {
+        return;
+    }
+
+    mtx_lock(&g_dvr_loader.mutex);
+    g_dvr_loader.quit = true;
+    cnd_broadcast(&g_dvr_loader.wake);
+    mtx_unlock(&g_dvr_loader.mutex);
+
+    for (u32 i = 0; i < g_dvr_loader.num_threads; i++) {
+        thrd_join(g_dvr_loader.threads[i], NULL);
+    }
+
+    for (u32 i = 0; i < DVR_MAX_LOADS; i++) {
+        dvr_load_free_contents(&g_dvr_loader.loads[i]);
+        g_dvr_loader.loads[i] = (dvr_load_data){};
+    }
+    arrfree(g_dvr_loader.queued);
+    arrfree(g_dvr_loader.decoded);
+
+    cnd_destroy(&g_dvr_loader.wake);
+    mtx_destroy(&g_dvr_loader.mutex);
+    g_dvr_loader.num_threads = 0;
+    g_dvr_loader.running = false;
+}
+
+DVR_RESULT(dvr_load) dvr_load_async(dvr_load_desc* desc) {
+    if (!g_dvr_loader.running) {
+        return DVR_ERROR(dvr_load, "loader is not running");
+    }
+
+    mtx_lock(&g_dvr_loader.mutex);
+    u16 id = DVR_MAX_LOADS;
+    for (u16 i = 0; i < DVR_MAX_LOADS; i++) {
+        if (g_dvr_loader.loads[i].stage == DVR_LOAD_STAGE_FREE) {
+            id = i;
+            break;
+        }
+    }
+    if (id == DVR_MAX_LOADS) {
+        mtx_unlock(&g_dvr_loader.mutex);
+        return DVR_ERROR(dvr_load, "too many loads in flight");
+    }
+
+    dvr_load_data* data = &g_dvr_loader.loads[id];
+    *data = (dvr_load_data){
+        .stage = DVR_LOAD_STAGE_QUEUED,
+        .state = DVR_LOAD_STATE_PENDING,
+        .desc = *desc,
+    };
+    usize path_size = strlen(desc->path) + 1;
+    char* path = malloc(path_size);
+    memcpy(path, desc->path, path_size);
+    data->desc.path = path;
+    arrput(g_dvr_loader.queued, id);
+    cnd_signal(&g_dvr_loader.wake);
+    mtx_unlock(&g_dvr_loader.mutex);
+
+    return DVR_OK(dvr_load, (dvr_load){ .id = id });
+}
+
+/// Main thread side of a load, creates the resource and records its upload.
+static DVR_RESULT(dvr_none) dvr_load_finish(dvr_load_data* data) {
+    if (data->desc.kind == DVR_LOAD_KIND_TEXTURE) {
+        dvr_texture_file* texture = &data->texture;
+        DVR_RESULT(dvr_image)
+        image_res = dvr_create_image(&(dvr_image_desc){
+            .width = texture->width,
+            .height = texture->height,
+            .generate_mipmaps = texture->generate_mipmaps,
+            .mip_levels = texture->generate_mipmaps ? 0 : texture->mip_levels,
+            .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .format = texture->format,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        });
+        DVR_BUBBLE_INTO(dvr_none, image_res);
+        data->image = DVR_UNWRAP(image_res);
+
+        DVR_RESULT(dvr_none)
+        upload_res = dvr_upload_image(
+            data->image,
+            texture->file,
+            texture->generate_mipmaps ? 1 : texture->mip_levels,
+            texture->levels
+        );
+        if (upload_res.is_ok && texture->generate_mipmaps) {
+            upload_res = dvr_generate_mipmaps(data->image);
+        }
+        // the copy may already be recorded into the frame
+        if (!upload_res.is_ok) {
+            dvr_retire_image(data->image);
+        }
+        return upload_res;
+    }
+
+    DVR_RESULT(dvr_buffer)
+    buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+        .data = { .base = NULL, .size = data->contents.size },
+        .usage = data->desc.buffer_usage | DVR_BUFFER_USAGE_TRANSFER_DST,
+        .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+    });
+    DVR_BUBBLE_INTO(dvr_none, buffer_res);
+    data->buffer = DVR_UNWRAP(buffer_res);
+
+    DVR_RESULT(dvr_none) upload_res = dvr_upload_buffer(data->buffer, data->contents, 0);
+    if (!upload_res.is_ok) {
+        dvr_retire_buffer(data->buffer);
+    }
+    return upload_res;
+}
+
+void dvr_loader_update(void) {
+    // commands recorded now would be dropped
+    if (!g_dvr_loader.running || dvr_frame_skipped()) {
+        return;
+    }
+
+    usize uploaded = 0;
+    mtx_lock(&g_dvr_loader.mutex);
+    while (arrlenu(g_dvr_loader.decoded) > 0 && uploaded < g_dvr_loader.upload_budget) {
+        u16 id = g_dvr_loader.decoded[0];
+        arrdel(g_dvr_loader.decoded, 0);
+        dvr_load_data* data = &g_dvr_loader.loads[id];
+        bool released = data->released;
+        mtx_unlock(&g_dvr_loader.mutex);
+
+        if (!released) {
+            if (data->error != NULL) {
+                data->state = DVR_LOAD_STATE_FAILED;
+            } else {
+                DVR_RESULT(dvr_none) finish_res = dvr_load_finish(data);
+                data->state = finish_res.is_ok ? DVR_LOAD_STATE_READY : DVR_LOAD_STATE_FAILED;
+                data->error = finish_res.is_ok ? NULL : finish_res.error.message;
+                uploaded += data->contents.size;
+            }
+        }
+        dvr_load_free_contents(data);
+
+        mtx_lock(&g_dvr_loader.mutex);
+        data->stage = released ? DVR_LOAD_STAGE_FREE : DVR_LOAD_STAGE_DONE;
+    }
+    mtx_unlock(&g_dvr_loader.mutex);
+}
+
+dvr_load_state dvr_load_get_state(dvr_load load) {
+    return dvr_get_load_data(load)->state;
+}
+
+dvr_image dvr_load_get_image(dvr_load load) {
+    return dvr_get_load_data(load)->image;
+}
+
+dvr_buffer dvr_load_get_buffer(dvr_load load) {
+    return dvr_get_load_data(load)->buffer;
+}
+
+const char* dvr_load_get_error(dvr_load load) {
+    return dvr_get_load_data(load)->error;
+}
+
+void dvr_release_load(dvr_load load) {
+    dvr_load_data* data = dvr_get_load_data(load);
+
+    mtx_lock(&g_dvr_loader.mutex);
+    if (data->stage == DVR_LOAD_STAGE_QUEUED) {
+        for (usize i = 0; i < arrlenu(g_dvr_loader.queued); i++) {
+            if (g_dvr_loader.queued[i] == load.id) {
+                arrdel(g_dvr_loader.queued, i);
+                break;
+            }
+        }
+        dvr_load_free_contents(data);
+        data->stage = DVR_LOAD_STAGE_FREE;
+    } else if (data->stage == DVR_LOAD_STAGE_DONE) {
+        data->stage = DVR_LOAD_STAGE_FREE;
+    } else {
+        // a worker or the upload still owns it, freed once it reaches the main thread
+        data->released = true;
+    }
+    mtx_unlock(&g_dvr_loader.mutex);
+}
@@ -0,0 +1,458 @@
+#include "dvr_mesh.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(dvr_dvrm_header) == 128, "unexpected padding in dvr_dvrm_header");
+_Static_assert(sizeof(dvr_dvrm_attribute) == 16, "unexpected padding in dvr_dvrm_attribute");
+_Static_assert(sizeof(dvr_dvrm_stream) == 16, "unexpected padding in dvr_dvrm_stream");
+_Static_assert(sizeof(dvr_dvrm_submesh) == 48, "unexpected padding in dvr_dvrm_submesh");
+_Static_assert(sizeof(dvr_dvrm_lod) == 16, "unexpected padding in dvr_dvrm_lod");
+_Static_assert(sizeof(dvr_packed_vertex) == 20, "unexpected padding in dvr_packed_vertex");
+
+/// Size of one element of the vertex formats DVRM attributes can use, 0 for any other format.
+static u32 dvr_mesh_format_size(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R16G16_UNORM:
+        case VK_FORMAT_R16G16_SNORM:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32_SFLOAT:
+            return 12;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+static bool dvr_mesh_section_fits(dvr_range file, u64 offset, u64 size) {
+    return offset <= file.size && size <= file.size - offset;
+}
+
+/// Whether every index of the range addresses one of the `vertex_count` vertices it is drawn
+/// with, the range itself has to be validated already.
+static bool dvr_mesh_indices_fit(
+    const dvr_mesh_file* mesh,
+    u32 first_index,
+    u32 index_count,
+    u32 vertex_count
+) {
+    const u8* indices = mesh->indices.base;
+    for (u32 i = first_index; i < first_index + index_count; i++) {
+        u32 index;
+        if (mesh->index_type == VK_INDEX_TYPE_UINT16) {
+            u16 index16;
+            memcpy(&index16, indices + (usize)i * sizeof(u16), sizeof(u16));
+            index = index16;
+        } else {
+            memcpy(&index, indices + (usize)i * sizeof(u32), sizeof(u32));
+        }
+        if (index >= vertex_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+DVR_RESULT(dvr_mesh_file) dvr_parse_mesh(dvr_range file) {
+    const u8* bytes = file.base;
+    if (file.size < sizeof(dvr_dvrm_header)) {
+        return DVR_ERROR(dvr_mesh_file, "not a DVRM file");
+    }
+
+    dvr_dvrm_header header;
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != DVR_DVRM_MAGIC) {
+        return DVR_ERROR(dvr_mesh_file, "not a DVRM file");
+    }
+    if (header.version != DVR_DVRM_VERSION) {
+        return DVR_ERROR(dvr_mesh_file, "unsupported DVRM version, recook the mesh");
+    }
+    if ((header.index_size != 2 && header.index_size != 4) || header.num_streams == 0 ||
+        header.num_streams > DVR_MESH_MAX_STREAMS || header.num_attributes == 0 ||
+        header.num_attributes > DVR_MESH_MAX_ATTRIBUTES) {
+        return DVR_ERROR(dvr_mesh_file, "invalid DVRM header");
+    }
+    if (!dvr_mesh_section_fits(
+            file,
+            header.attributes_offset,
+            header.num_attributes * sizeof(dvr_dvrm_attribute)
+        ) ||
+        !dvr_mesh_section_fits(
+            file,
+            header.streams_offset,
+            header.num_streams * sizeof(dvr_dvrm_stream)
+        ) ||
+        !dvr_mesh_section_fits(
+            file,
+            header.submeshes_offset,
+            (u64)header.num_submeshes * sizeof(dvr_dvrm_submesh)
+        ) ||
+        header.submeshes_offset % sizeof(u32) != 0 ||
+        !dvr_mesh_section_fits(
+            file,
+            header.lods_offset,
+            (u64)header.num_lods * sizeof(dvr_dvrm_lod)
+        ) ||
+        header.lods_offset % sizeof(u32) != 0 ||
+        !dvr_mesh_section_fits(
+            file,
+            header.indices_offset,
+            (u64)header.num_indices * header.index_size
+        )) {
+        return DVR_ERROR(dvr_mesh_file, "DVRM table lies outside of the file");
+    }
+
+    dvr_mesh_file mesh = {
+        .file = file,
+        .num_vertices = header.num_vertices,
+        .num_indices = header.num_indices,
+        .index_type = header.index_size == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+        .indices = {
+            .base = (u8*)bytes + header.indices_offset,
+            .size = (usize)header.num_indices * header.index_size,
+        },
+        .num_streams = header.num_streams,
+        .num_attributes = header.num_attributes,
+        .num_submeshes = header.num_submeshes,
+        .submeshes = (const dvr_dvrm_submesh*)(bytes + header.submeshes_offset),
+        .num_lods = header.num_lods,
+        .lods = (const dvr_dvrm_lod*)(bytes + header.lods_offset),
+    };
+    memcpy(mesh.bounds_min, header.bounds_min, sizeof(mesh.bounds_min));
+    memcpy(mesh.bounds_max, header.bounds_max, sizeof(mesh.bounds_max));
+    memcpy(mesh.position_scale, header.position_scale, sizeof(mesh.position_scale));
+    memcpy(mesh.position_offset, header.position_offset, sizeof(mesh.position_offset));
+
+    for (u32 i = 0; i < header.num_streams; i++) {
+        dvr_dvrm_stream stream;
+        memcpy(
+            &stream,
+            bytes + header.streams_offset + i * sizeof(stream),
+            sizeof(stream)
+        );
+        u64 stream_size = (u64)stream.stride * header.num_vertices;
+        if (stream.stride == 0 || !dvr_mesh_section_fits(file, stream.offset, stream_size)) {
+            return DVR_ERROR(dvr_mesh_file, "DVRM stream lies outside of the file");
+        }
+
+        mesh.streams[i] = (dvr_range){
+            .base = (u8*)bytes + stream.offset,
+            .size = (usize)stream_size,
+        };
+        mesh.strides[i] = stream.stride;
+    }
+
+    for (u32 i = 0; i < header.num_attributes; i++) {
+        dvr_dvrm_attribute* attribute = &mesh.attributes[i];
+        memcpy(
+            attribute,
+            bytes + header.attributes_offset + i * sizeof(*attribute),
+            sizeof(*attribute)
+        );
+        u32 format_size = dvr_mesh_format_size((VkFormat)attribute->format);
+        if (attribute->semantic >= DVR_MESH_ATTRIBUTE_COUNT || format_size == 0 ||
+            attribute->stream >= header.num_streams ||
+            attribute->offset + format_size > mesh.strides[attribute->stream]) {
+            return DVR_ERROR(dvr_mesh_file, "invalid DVRM attribute");
+        }
+    }
+
+    for (u32 i = 0; i < header.num_submeshes; i++) {
+        const dvr_dvrm_submesh* submesh = &mesh.submeshes[i];
+        if ((u64)submesh->first_index + submesh->index_count > header.num_indices ||
+            (u64)submesh->vertex_offset + submesh->vertex_count > header.num_vertices ||
+            submesh->num_lods == 0 ||
+            (u64)submesh->first_lod + submesh->num_lods > header.num_lods) {
+            return DVR_ERROR(dvr_mesh_file, "DVRM submesh lies outside of the mesh");
+        }
+    }
+
+    for (u32 i = 0; i < header.num_lods; i++) {
+        const dvr_dvrm_lod* lod = &mesh.lods[i];
+        if ((u64)lod->first_index + lod->index_count > header.num_indices) {
+            return DVR_ERROR(dvr_mesh_file, "DVRM LOD lies outside of the mesh");
+        }
+    }
+
+    // indices are relative to the vertex offset of their submesh, checking them once here keeps
+    // the draws from reading another submesh's or unmapped vertices
+    for (u32 i = 0; i < header.num_submeshes; i++) {
+        const dvr_dvrm_submesh* submesh = &mesh.submeshes[i];
+        bool fits = dvr_mesh_indices_fit(
+            &mesh,
+            submesh->first_index,
+            submesh->index_count,
+            submesh->vertex_count
+        );
+        for (u32 j = 0; fits && j < submesh->num_lods; j++) {
+            const dvr_dvrm_lod* lod = &mesh.lods[submesh->first_lod + j];
+            fits = dvr_mesh_indices_fit(
+                &mesh,
+                lod->first_index,
+                lod->index_count,
+                submesh->vertex_count
+            );
+        }
+        if (!fits) {
+            return DVR_ERROR(dvr_mesh_file, "DVRM index addresses a vertex outside its submesh");
+        }
+    }
+
+    return DVR_OK(dvr_mesh_file, mesh);
+}
+
+DVR_RESULT(dvr_mesh) dvr_create_mesh(const dvr_mesh_file* mesh_file) {
+    dvr_mesh mesh = {
+        .num_streams = mesh_file->num_streams,
+        .index_type = mesh_file->index_type,
+        .num_indices = mesh_file->num_indices,
+        .num_submeshes = mesh_file->num_submeshes,
+        .num_lods = mesh_file->num_lods,
+        .num_attributes = mesh_file->num_attributes,
+    };
+    memcpy(mesh.bounds_min, mesh_file->bounds_min, sizeof(mesh.bounds_min));
+    memcpy(mesh.bounds_max, mesh_file->bounds_max, sizeof(mesh.bounds_max));
+    memcpy(mesh.position_scale, mesh_file->position_scale, sizeof(mesh.position_scale));
+    memcpy(mesh.position_offset, mesh_file->position_offset, sizeof(mesh.position_offset));
+
+    for (u32 i = 0; i < mesh.num_streams; i++) {
+        mesh.bindings[i] = (VkVertexInputBindingDescription){
+            .binding = i,
+            .stride = mesh_file->strides[i],
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+        };
+    }
+    for (u32 i = 0; i < mesh.num_attributes; i++) {
+        const dvr_dvrm_attribute* attribute = &mesh_file->attributes[i];
+        mesh.attributes[i] = (VkVertexInputAttributeDescription){
+            .location = attribute->semantic,
+            .binding = attribute->stream,
+            .format = (VkFormat)attribute->format,
+            .offset = attribute->offset,
+        };
+    }
+
+    // the file ranges are staged straight from the mapping, nothing is converted
+    const char* error = NULL;
+    u32 num_vertex_buffers = 0;
+    for (; num_vertex_buffers < mesh.num_streams; num_vertex_buffers++) {
+        DVR_RESULT(dvr_buffer)
+        vertex_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+            .data = mesh_file->streams[num_vertex_buffers],
+            .usage = DVR_BUFFER_USAGE_VERTEX,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+        });
+        if (!vertex_buffer_res.is_ok) {
+            error = vertex_buffer_res.error.message;
+            break;
+        }
+        mesh.vertex_buffers[num_vertex_buffers] = DVR_UNWRAP(vertex_buffer_res);
+    }
+
+    if (error == NULL) {
+        DVR_RESULT(dvr_buffer)
+        index_buffer_res = dvr_create_buffer(&(dvr_buffer_desc){
+            .data = mesh_file->indices,
+            .usage = DVR_BUFFER_USAGE_INDEX,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+        });
+        if (index_buffer_res.is_ok) {
+            mesh.index_buffer = DVR_UNWRAP(index_buffer_res);
+        } else {
+            error = index_buffer_res.error.message;
+        }
+    }
+
+    if (error == NULL) {
+        usize submeshes_size = mesh.num_submeshes * sizeof(dvr_dvrm_submesh);
+        usize lods_size = mesh.num_lods * sizeof(dvr_dvrm_lod);
+        mesh.submeshes = malloc(submeshes_size > 0 ? submeshes_size : 1);
+        mesh.lods = malloc(lods_size > 0 ? lods_size : 1);
+        if (mesh.submeshes == NULL || mesh.lods == NULL) {
+            free(mesh.submeshes);
+            free(mesh.lods);
+            dvr_destroy_buffer(mesh.index_buffer);
+            error = "failed to allocate submeshes";
+        } else {
+            memcpy(mesh.submeshes, mesh_file->submeshes, submeshes_size);
+            memcpy(mesh.lods, mesh_file->lods, lods_size);
+        }
+    }
+
+    if (error != NULL) {
+        for (u32 i = 0; i < num_vertex_buffers; i++) {
+            dvr_destroy_buffer(mesh.vertex_buffers[i]);
+        }
+        return DVR_ERROR(dvr_mesh, error);
+    }
+
+    return DVR_OK(dvr_mesh, mesh);
+}
+
+DVR_RESULT(dvr_mesh) dvr_load_mesh_from_memory(dvr_range data) {
+    DVR_RESULT(dvr_mesh_file) mesh_file_res = dvr_parse_mesh(data);
+    DVR_BUBBLE_INTO(dvr_mesh, mesh_file_res);
+
+    dvr_mesh_file mesh_file = DVR_UNWRAP(mesh_file_res);
+    return dvr_create_mesh(&mesh_file);
+}
+
+DVR_RESULT(dvr_mesh) dvr_load_mesh(const char* path) {
+    DVR_RESULT(dvr_mapped_file) file_res = dvr_map_file(path, 0, 0, DVR_FILE_ACCESS_SEQUENTIAL);
+    DVR_BUBBLE_INTO(dvr_mesh, file_res);
+    dvr_mapped_file file = DVR_UNWRAP(file_res);
+
+    DVR_RESULT(dvr_mesh) mesh_res = dvr_load_mesh_from_memory(file.range);
+    dvr_unmap_file(&file);
+
+    return mesh_res;
+}
+
+void dvr_destroy_mesh(dvr_mesh* mesh) {
+    for (u32 i = 0; i < mesh->num_streams; i++) {
+        dvr_destroy_buffer(mesh->vertex_buffers[i]);
+    }
+    dvr_destroy_buffer(mesh->index_buffer);
+    free(mesh->submeshes);
+    free(mesh->lods);
+    *mesh = (dvr_mesh){};
+}
+
+dvr_vertex_input_state_desc dvr_mesh_vertex_input(dvr_mesh* mesh) {
+    return (dvr_vertex_input_state_desc){
+        .num_bindings = mesh->num_streams,
+        .bindings = mesh->bindings,
+        .num_attributes = mesh->num_attributes,
+        .attributes = mesh->attributes,
+    };
+}
+
+static VkVertexInputBindingDescription dvr_packed_vertex_bindings[] = {
+    {
+        .binding = 0,
+        .stride = sizeof(dvr_packed_vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    },
+};
+
+static VkVertexInputAttributeDescription dvr_packed_vertex_attributes[] = {
+    {
+        .location = DVR_MESH_ATTRIBUTE_POSITION,
+        .format = VK_FORMAT_R16G16B16A16_UNORM,
+        .offset = offsetof(dvr_packed_vertex, position),
+    },
+    {
+        .location = DVR_MESH_ATTRIBUTE_COLOR,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .offset = offsetof(dvr_packed_vertex, color),
+    },
+    {
+        .location = DVR_MESH_ATTRIBUTE_UV,
+        .format = VK_FORMAT_R16G16_SFLOAT,
+        .offset = offsetof(dvr_packed_vertex, uv),
+    },
+    {
+        .location = DVR_MESH_ATTRIBUTE_NORMAL,
+        .format = VK_FORMAT_R16G16_SNORM,
+        .offset = offsetof(dvr_packed_vertex, normal),
+    },
+};
+
+dvr_vertex_input_state_desc dvr_packed_vertex_input(void) {
+    return (dvr_vertex_input_state_desc){
+        .num_bindings =
+            sizeof(dvr_packed_vertex_bindings) / sizeof(dvr_packed_vertex_bindings[0]),
+        .bindings = dvr_packed_vertex_bindings,
+        .num_attributes =
+            sizeof(dvr_packed_vertex_attributes) / sizeof(dvr_packed_vertex_attributes[0]),
+        .attributes = dvr_packed_vertex_attributes,
+    };
+}
+
+void dvr_mesh_position_transform(const dvr_mesh* mesh, mat4 dst) {
+    memset(dst, 0, sizeof(mat4));
+    for (u32 i = 0; i < 3; i++) {
+        dst[i][i] = mesh->position_scale[i];
+        dst[3][i] = mesh->position_offset[i];
+    }
+    dst[3][3] = 1.0f;
+}
+
+f32 dvr_lod_pixel_scale(f32 fov_y, f32 viewport_height) {
+    return viewport_height / (2.0f * tanf(fov_y * 0.5f));
+}
+
+u32 dvr_select_mesh_lod(
+    const dvr_mesh* mesh,
+    u32 submesh,
+    f32 distance,
+    f32 pixel_scale,
+    f32 max_pixel_error
+) {
+    const dvr_dvrm_submesh* s = &mesh->submeshes[submesh];
+    // errors only grow along the chain, so the first LOD over the limit ends the search
+    f32 max_error = max_pixel_error * (distance > 0.0f ? distance : 0.0f) / pixel_scale;
+    u32 lod = 0;
+    while (lod + 1 < s->num_lods && mesh->lods[s->first_lod + lod + 1].error <= max_error) {
+        lod++;
+    }
+    return lod;
+}
+
+void dvr_bind_mesh(const dvr_mesh* mesh) {
+    for (u32 i = 0; i < mesh->num_streams; i++) {
+        dvr_bind_vertex_buffer(mesh->vertex_buffers[i], i);
+    }
+    dvr_bind_index_buffer(mesh->index_buffer, mesh->index_type);
+}
+
+void dvr_draw_mesh(const dvr_mesh* mesh, u32 instance_count) {
+    for (u32 i = 0; i < mesh->num_submeshes; i++) {
+        const dvr_dvrm_submesh* submesh = &mesh->submeshes[i];
+        dvr_draw_indexed(
+            submesh->index_count,
+            instance_count,
+            submesh->first_index,
+            (i32)submesh->vertex_offset,
+            0
+        );
+    }
+}
+
+void dvr_draw_submesh(const dvr_mesh* mesh, u32 submesh, u32 lod, u32 instance_count) {
+    dvr_draw_submesh_instances(mesh, submesh, lod, instance_count, 0);
+}
+
+void dvr_draw_submesh_instances(
+    const dvr_mesh* mesh,
+    u32 submesh,
+    u32 lod,
+    u32 instance_count,
+    u32 first_instance
+) {
+    const dvr_dvrm_submesh* s = &mesh->submeshes[submesh];
+    u32 first_index = s->first_index;
+    u32 index_count = s->index_count;
+    if (lod < s->num_lods) {
+        first_index = mesh->lods[s->first_lod + lod].first_index;
+        index_count = mesh->lods[s->first_lod + lod].index_count;
+    }
+    dvr_draw_indexed(
+        index_count,
+        instance_count,
+        first_index,
+        (i32)s->vertex_offset,
+        first_instance
+    );
+}
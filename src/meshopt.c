@@ -0,0 +1,954 @@
+#include "dvr_meshopt.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// Triangles using each vertex, as a compact list with one range per vertex.
+typedef struct dvr_vertex_triangles {
+    u32* offsets;
+    u32* counts;
+    u32* triangles;
+} dvr_vertex_triangles;
+
+static dvr_vertex_triangles dvr_build_vertex_triangles(
+    const u32* indices,
+    usize index_count,
+    usize vertex_count
+) {
+    dvr_vertex_triangles adjacency = {
+        .offsets = malloc((vertex_count + 1) * sizeof(u32)),
+        .counts = calloc(vertex_count + 1, sizeof(u32)),
+        .triangles = malloc((index_count + 1) * sizeof(u32)),
+    };
+
+    for (usize i = 0; i < index_count; i++) {
+        adjacency.counts[indices[i]]++;
+    }
+
+    u32 offset = 0;
+    for (usize v = 0; v < vertex_count; v++) {
+        adjacency.offsets[v] = offset;
+        offset += adjacency.counts[v];
+    }
+
+    // counts are rebuilt while filling the lists
+    memset(adjacency.counts, 0, vertex_count * sizeof(u32));
+    for (usize i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        adjacency.triangles[adjacency.offsets[v] + adjacency.counts[v]++] = (u32)(i / 3);
+    }
+
+    return adjacency;
+}
+
+static void dvr_free_vertex_triangles(dvr_vertex_triangles* adjacency) {
+    free(adjacency->offsets);
+    free(adjacency->counts);
+    free(adjacency->triangles);
+}
+
+dvr_vertex_cache_stats dvr_analyze_vertex_cache(
+    const u32* indices,
+    usize index_count,
+    usize vertex_count,
+    u32 cache_size
+) {
+    dvr_vertex_cache_stats stats = { 0 };
+    if (index_count == 0 || vertex_count == 0) {
+        return stats;
+    }
+
+    // a vertex is cached while fewer than cache_size misses happened since it was loaded
+    u32* cache_time = calloc(vertex_count, sizeof(u32));
+    u32 time = cache_size + 1;
+    for (usize i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if (time - cache_time[v] > cache_size) {
+            cache_time[v] = time++;
+            stats.vertices_transformed++;
+        }
+    }
+    free(cache_time);
+
+    stats.acmr = (f32)stats.vertices_transformed / (f32)(index_count / 3);
+    stats.atvr = (f32)stats.vertices_transformed / (f32)vertex_count;
+    return stats;
+}
+
+static u32 dvr_tipsify_next_vertex(
+    const u32* candidates,
+    usize num_candidates,
+    const u32* live,
+    const u32* cache_time,
+    u32 time,
+    u32 cache_size,
+    u32* dead_end,
+    usize* dead_end_top,
+    u32* cursor,
+    usize vertex_count
+) {
+    // prefer the candidate that stays in the cache longest while its fan gets emitted
+    u32 best = UINT32_MAX;
+    i64 best_priority = -1;
+    for (usize i = 0; i < num_candidates; i++) {
+        u32 v = candidates[i];
+        if (live[v] == 0) {
+            continue;
+        }
+
+        i64 priority = 0;
+        if (time - cache_time[v] + 2 * live[v] <= cache_size) {
+            priority = time - cache_time[v];
+        }
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = v;
+        }
+    }
+    if (best != UINT32_MAX) {
+        return best;
+    }
+
+    // dead end, fall back to recently used vertices and then to the input order
+    while (*dead_end_top > 0) {
+        u32 v = dead_end[--*dead_end_top];
+        if (live[v] > 0) {
+            return v;
+        }
+    }
+    while (*cursor < vertex_count) {
+        if (live[*cursor] > 0) {
+            return *cursor;
+        }
+        (*cursor)++;
+    }
+
+    return UINT32_MAX;
+}
+
+void dvr_optimize_vertex_cache(
+    u32* dst,
+    const u32* indices,
+    usize index_count,
+    usize vertex_count
+) {
+    usize triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // dst may alias indices
+    u32* source = malloc(index_count * sizeof(u32));
+    memcpy(source, indices, index_count * sizeof(u32));
+
+    dvr_vertex_triangles adjacency = dvr_build_vertex_triangles(source, index_count, vertex_count);
+    u32* live = malloc(vertex_count * sizeof(u32));
+    memcpy(live, adjacency.counts, vertex_count * sizeof(u32));
+    u32* cache_time = calloc(vertex_count, sizeof(u32));
+    bool* emitted = calloc(triangle_count, sizeof(bool));
+    u32* dead_end = malloc(index_count * sizeof(u32));
+    u32* candidates = malloc(index_count * sizeof(u32));
+
+    const u32 cache_size = DVR_VERTEX_CACHE_SIZE;
+    u32 time = cache_size + 1;
+    usize dead_end_top = 0;
+    u32 cursor = 0;
+    usize written = 0;
+
+    u32 fan = 0;
+    while (live[fan] == 0 && fan + 1 < vertex_count) {
+        fan++;
+    }
+
+    while (fan != UINT32_MAX) {
+        usize num_candidates = 0;
+
+        u32 begin = adjacency.offsets[fan];
+        u32 end = begin + adjacency.counts[fan];
+        for (u32 i = begin; i < end; i++) {
+            u32 triangle = adjacency.triangles[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+
+            for (u32 k = 0; k < 3; k++) {
+                u32 v = source[triangle * 3 + k];
+                dst[written++] = v;
+                dead_end[dead_end_top++] = v;
+                candidates[num_candidates++] = v;
+                live[v]--;
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time++;
+                }
+            }
+        }
+
+        fan = dvr_tipsify_next_vertex(
+            candidates,
+            num_candidates,
+            live,
+            cache_time,
+            time,
+            cache_size,
+            dead_end,
+            &dead_end_top,
+            &cursor,
+            vertex_count
+        );
+    }
+
+    free(candidates);
+    free(dead_end);
+    free(emitted);
+    free(cache_time);
+    free(live);
+    dvr_free_vertex_triangles(&adjacency);
+    free(source);
+}
+
+/// Simulated cache misses of one triangle, `time` advances with every miss.
+static u32 dvr_cache_misses(const u32* triangle, u32* cache_time, u32* time, u32 cache_size) {
+    u32 misses = 0;
+    for (u32 k = 0; k < 3; k++) {
+        u32 v = triangle[k];
+        if (*time - cache_time[v] > cache_size) {
+            cache_time[v] = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+typedef struct dvr_overdraw_cluster {
+    u32 first_triangle;
+    u32 triangle_count;
+    f32 sort_key;
+} dvr_overdraw_cluster;
+
+static int dvr_compare_overdraw_clusters(const void* a, const void* b) {
+    const dvr_overdraw_cluster* ca = a;
+    const dvr_overdraw_cluster* cb = b;
+    // descending, the clusters facing out the most are drawn first
+    return ca->sort_key > cb->sort_key ? -1 : ca->sort_key < cb->sort_key;
+}
+
+void dvr_optimize_overdraw(
+    u32* dst,
+    const u32* indices,
+    usize index_count,
+    const f32* positions,
+    usize vertex_count,
+    usize position_stride,
+    f32 threshold
+) {
+    usize triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    u32* source = malloc(index_count * sizeof(u32));
+    memcpy(source, indices, index_count * sizeof(u32));
+
+    const u32 cache_size = DVR_VERTEX_CACHE_SIZE;
+    u32* cache_time = calloc(vertex_count, sizeof(u32));
+    u32 time = cache_size + 1;
+
+    // hard boundaries: triangles missing the cache entirely start a new cluster, reordering
+    // between those doesn't cost any cache efficiency
+    u32* hard = malloc((triangle_count + 1) * sizeof(u32));
+    usize num_hard = 0;
+    for (usize t = 0; t < triangle_count; t++) {
+        if (dvr_cache_misses(&source[t * 3], cache_time, &time, cache_size) == 3 || t == 0) {
+            hard[num_hard++] = (u32)t;
+        }
+    }
+    hard[num_hard] = (u32)triangle_count;
+
+    // soft boundaries: split hard clusters further wherever the cache efficiency of the part
+    // so far stays within the threshold of the whole cluster
+    dvr_overdraw_cluster* clusters = malloc(triangle_count * sizeof(dvr_overdraw_cluster));
+    usize num_clusters = 0;
+    for (usize h = 0; h < num_hard; h++) {
+        u32 begin = hard[h];
+        u32 end = hard[h + 1];
+
+        time += cache_size + 1;
+        u32 cluster_misses = 0;
+        for (u32 t = begin; t < end; t++) {
+            cluster_misses += dvr_cache_misses(&source[t * 3], cache_time, &time, cache_size);
+        }
+        f32 cluster_threshold = threshold * (f32)cluster_misses / (f32)(end - begin);
+
+        time += cache_size + 1;
+        u32 start = begin;
+        u32 misses = 0;
+        for (u32 t = begin; t < end; t++) {
+            misses += dvr_cache_misses(&source[t * 3], cache_time, &time, cache_size);
+            if (t + 1 != end && (f32)misses / (f32)(t + 1 - start) <= cluster_threshold) {
+                clusters[num_clusters++] = (dvr_overdraw_cluster){
+                    .first_triangle = start,
+                    .triangle_count = t + 1 - start,
+                };
+                start = t + 1;
+                misses = 0;
+                time += cache_size + 1;
+            }
+        }
+        clusters[num_clusters++] = (dvr_overdraw_cluster){
+            .first_triangle = start,
+            .triangle_count = end - start,
+        };
+    }
+
+    // mesh centroid, weighted by triangle area like the cluster centroids
+    f32 mesh_centroid[3] = { 0.0f, 0.0f, 0.0f };
+    f32 mesh_area = 0.0f;
+    f32* cluster_data = calloc(num_clusters * 7, sizeof(f32));
+    for (usize c = 0; c < num_clusters; c++) {
+        f32* centroid = &cluster_data[c * 7];
+        f32* normal = &cluster_data[c * 7 + 3];
+        f32* area = &cluster_data[c * 7 + 6];
+
+        u32 end = clusters[c].first_triangle + clusters[c].triangle_count;
+        for (u32 t = clusters[c].first_triangle; t < end; t++) {
+            const f32* p[3];
+            for (u32 k = 0; k < 3; k++) {
+                p[k] = (const f32*)((const u8*)positions + source[t * 3 + k] * position_stride);
+            }
+
+            f32 e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            f32 e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            f32 n[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0],
+            };
+            f32 triangle_area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (u32 k = 0; k < 3; k++) {
+                f32 center = (p[0][k] + p[1][k] + p[2][k]) / 3.0f;
+                centroid[k] += center * triangle_area;
+                mesh_centroid[k] += center * triangle_area;
+                // the unnormalized cross product already weights by area
+                normal[k] += n[k];
+            }
+            *area += triangle_area;
+        }
+        mesh_area += *area;
+    }
+
+    for (u32 k = 0; k < 3; k++) {
+        mesh_centroid[k] = mesh_area > 0.0f ? mesh_centroid[k] / mesh_area : 0.0f;
+    }
+
+    for (usize c = 0; c < num_clusters; c++) {
+        f32* centroid = &cluster_data[c * 7];
+        f32* normal = &cluster_data[c * 7 + 3];
+        f32 area = cluster_data[c * 7 + 6];
+
+        f32 length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        f32 key = 0.0f;
+        for (u32 k = 0; k < 3; k++) {
+            f32 c_k = area > 0.0f ? centroid[k] / area : 0.0f;
+            f32 n_k = length > 0.0f ? normal[k] / length : 0.0f;
+            key += (c_k - mesh_centroid[k]) * n_k;
+        }
+        clusters[c].sort_key = key;
+    }
+
+    qsort(clusters, num_clusters, sizeof(dvr_overdraw_cluster), dvr_compare_overdraw_clusters);
+
+    usize written = 0;
+    for (usize c = 0; c < num_clusters; c++) {
+        usize count = (usize)clusters[c].triangle_count * 3;
+        memcpy(&dst[written], &source[clusters[c].first_triangle * 3], count * sizeof(u32));
+        written += count;
+    }
+
+    free(cluster_data);
+    free(clusters);
+    free(hard);
+    free(cache_time);
+    free(source);
+}
+
+usize dvr_optimize_vertex_fetch_remap(
+    u32* remap,
+    const u32* indices,
+    usize index_count,
+    usize vertex_count
+) {
+    memset(remap, 0xFF, vertex_count * sizeof(u32));
+
+    u32 next = 0;
+    for (usize i = 0; i < index_count; i++) {
+        u32 v = indices[i];
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = next++;
+        }
+    }
+
+    return next;
+}
+
+void dvr_remap_index_buffer(u32* dst, const u32* indices, usize index_count, const u32* remap) {
+    for (usize i = 0; i < index_count; i++) {
+        dst[i] = remap[indices[i]];
+    }
+}
+
+void dvr_remap_vertex_buffer(
+    void* dst,
+    const void* vertices,
+    usize vertex_count,
+    usize vertex_size,
+    const u32* remap
+) {
+    for (usize v = 0; v < vertex_count; v++) {
+        if (remap[v] != UINT32_MAX) {
+            memcpy(
+                (u8*)dst + (usize)remap[v] * vertex_size,
+                (const u8*)vertices + v * vertex_size,
+                vertex_size
+            );
+        }
+    }
+}
+
+/// Sum of squared distances to the planes of the triangles around a vertex, area weighted.
+typedef struct dvr_quadric {
+    f32 a00, a11, a22;
+    f32 a10, a20, a21;
+    f32 b0, b1, b2;
+    f32 c;
+    f32 weight;
+} dvr_quadric;
+
+static void dvr_quadric_add(dvr_quadric* q, const dvr_quadric* other) {
+    q->a00 += other->a00;
+    q->a11 += other->a11;
+    q->a22 += other->a22;
+    q->a10 += other->a10;
+    q->a20 += other->a20;
+    q->a21 += other->a21;
+    q->b0 += other->b0;
+    q->b1 += other->b1;
+    q->b2 += other->b2;
+    q->c += other->c;
+    q->weight += other->weight;
+}
+
+static dvr_quadric dvr_plane_quadric(const f32 n[3], f32 d, f32 weight) {
+    return (dvr_quadric){
+        .a00 = weight * n[0] * n[0],
+        .a11 = weight * n[1] * n[1],
+        .a22 = weight * n[2] * n[2],
+        .a10 = weight * n[1] * n[0],
+        .a20 = weight * n[2] * n[0],
+        .a21 = weight * n[2] * n[1],
+        .b0 = weight * n[0] * d,
+        .b1 = weight * n[1] * d,
+        .b2 = weight * n[2] * d,
+        .c = weight * d * d,
+        .weight = weight,
+    };
+}
+
+/// Mean squared distance of `p` to the planes of the quadric.
+static f32 dvr_quadric_error(const dvr_quadric* q, const f32 p[3]) {
+    f32 rx = q->a00 * p[0] + q->a10 * p[1] + q->a20 * p[2] + 2.0f * q->b0;
+    f32 ry = q->a10 * p[0] + q->a11 * p[1] + q->a21 * p[2] + 2.0f * q->b1;
+    f32 rz = q->a20 * p[0] + q->a21 * p[1] + q->a22 * p[2] + 2.0f * q->b2;
+    f32 error = rx * p[0] + ry * p[1] + rz * p[2] + q->c;
+    return q->weight > 0.0f ? fabsf(error) / q->weight : 0.0f;
+}
+
+static void dvr_triangle_normal(const f32* a, const f32* b, const f32* c, f32 n[3]) {
+    f32 e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    f32 e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+    n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+    n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+}
+
+static u64 dvr_hash_u64(u64 key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    return key;
+}
+
+/// Open addressing set of directed edges, sized for every edge of the index buffer.
+typedef struct dvr_edge_set {
+    u64* keys;
+    usize mask;
+} dvr_edge_set;
+
+#define DVR_EDGE_EMPTY UINT64_MAX
+
+static dvr_edge_set dvr_create_edge_set(usize edge_count) {
+    usize capacity = 16;
+    while (capacity < edge_count * 2) {
+        capacity *= 2;
+    }
+    dvr_edge_set set = { .keys = malloc(capacity * sizeof(u64)), .mask = capacity - 1 };
+    memset(set.keys, 0xFF, capacity * sizeof(u64));
+    return set;
+}
+
+static bool dvr_edge_set_find(const dvr_edge_set* set, u32 a, u32 b) {
+    u64 key = (u64)a << 32 | b;
+    for (usize slot = dvr_hash_u64(key) & set->mask;; slot = (slot + 1) & set->mask) {
+        if (set->keys[slot] == key) {
+            return true;
+        } else if (set->keys[slot] == DVR_EDGE_EMPTY) {
+            return false;
+        }
+    }
+}
+
+static void dvr_edge_set_insert(dvr_edge_set* set, u32 a, u32 b) {
+    u64 key = (u64)a << 32 | b;
+    usize slot = dvr_hash_u64(key) & set->mask;
+    while (set->keys[slot] != DVR_EDGE_EMPTY && set->keys[slot] != key) {
+        slot = (slot + 1) & set->mask;
+    }
+    set->keys[slot] = key;
+}
+
+/// Index of the first vertex at the same position as each vertex, so UV and normal seams don't
+/// split the topology.
+static u32* dvr_build_position_remap(
+    const f32* positions,
+    usize vertex_count,
+    usize position_stride
+) {
+    usize capacity = 16;
+    while (capacity < vertex_count * 2) {
+        capacity *= 2;
+    }
+    u32* table = malloc(capacity * sizeof(u32));
+    memset(table, 0xFF, capacity * sizeof(u32));
+    u32* remap = malloc((vertex_count > 0 ? vertex_count : 1) * sizeof(u32));
+
+    for (usize v = 0; v < vertex_count; v++) {
+        const f32* p = (const f32*)((const u8*)positions + v * position_stride);
+        u32 bits[3];
+        memcpy(bits, p, sizeof(bits));
+        u64 key = (u64)bits[0] * 73856093u ^ (u64)bits[1] * 19349663u ^ (u64)bits[2] * 83492791u;
+
+        usize slot = dvr_hash_u64(key) & (capacity - 1);
+        for (;; slot = (slot + 1) & (capacity - 1)) {
+            if (table[slot] == UINT32_MAX) {
+                table[slot] = (u32)v;
+                remap[v] = (u32)v;
+                break;
+            }
+            const f32* other = (const f32*)((const u8*)positions + table[slot] * position_stride);
+            if (memcmp(other, p, 3 * sizeof(f32)) == 0) {
+                remap[v] = table[slot];
+                break;
+            }
+        }
+    }
+
+    free(table);
+    return remap;
+}
+
+typedef struct dvr_collapse {
+    u32 from;
+    u32 to;
+    f32 error;
+} dvr_collapse;
+
+static int dvr_compare_collapses(const void* a, const void* b) {
+    const dvr_collapse* ca = a;
+    const dvr_collapse* cb = b;
+    return ca->error < cb->error ? -1 : ca->error > cb->error;
+}
+
+/// Whether moving `from` onto `to` keeps every remaining triangle around it facing the same way.
+static bool dvr_collapse_keeps_orientation(
+    const dvr_vertex_triangles* adjacency,
+    const u32* indices,
+    const u32* position_remap,
+    const f32* positions,
+    u32 from,
+    u32 to
+) {
+    const f32* target = &positions[to * 3];
+    for (u32 i = 0; i < adjacency->counts[from]; i++) {
+        const u32* triangle = &indices[adjacency->triangles[adjacency->offsets[from] + i] * 3];
+        const f32* corners[3];
+        const f32* moved[3];
+        bool collapses = false;
+        for (u32 k = 0; k < 3; k++) {
+            u32 v = position_remap[triangle[k]];
+            collapses |= v == to;
+            corners[k] = &positions[v * 3];
+            moved[k] = v == from ? target : corners[k];
+        }
+        if (collapses) {
+            continue;
+        }
+
+        f32 before[3];
+        f32 after[3];
+        dvr_triangle_normal(corners[0], corners[1], corners[2], before);
+        dvr_triangle_normal(moved[0], moved[1], moved[2], after);
+        // turning more than ~75 degrees counts as a flip, which also rejects slivers
+        f32 dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        f32 before_length = before[0] * before[0] + before[1] * before[1] + before[2] * before[2];
+        f32 after_length = after[0] * after[0] + after[1] * after[1] + after[2] * after[2];
+        if (dot <= 0.0f || dot * dot <= 0.0625f * before_length * after_length) {
+            return false;
+        }
+    }
+    return true;
+}
+
+usize dvr_simplify(
+    u32* dst,
+    const u32* indices,
+    usize index_count,
+    const f32* positions,
+    usize vertex_count,
+    usize position_stride,
+    usize target_index_count,
+    f32 target_error,
+    f32* result_error
+) {
+    if (dst != indices) {
+        memcpy(dst, indices, index_count * sizeof(u32));
+    }
+    f32 max_error = 0.0f;
+    if (index_count == 0 || vertex_count == 0) {
+        if (result_error != NULL) {
+            *result_error = 0.0f;
+        }
+        return index_count;
+    }
+
+    // positions are normalized into the unit cube to keep the quadrics well conditioned
+    f32 bounds_min[3] = { INFINITY, INFINITY, INFINITY };
+    f32 bounds_max[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (usize v = 0; v < vertex_count; v++) {
+        const f32* p = (const f32*)((const u8*)positions + v * position_stride);
+        for (u32 k = 0; k < 3; k++) {
+            bounds_min[k] = fminf(bounds_min[k], p[k]);
+            bounds_max[k] = fmaxf(bounds_max[k], p[k]);
+        }
+    }
+    f32 extent = fmaxf(
+        fmaxf(bounds_max[0] - bounds_min[0], bounds_max[1] - bounds_min[1]),
+        bounds_max[2] - bounds_min[2]
+    );
+    f32 scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    f32* normalized = malloc(vertex_count * 3 * sizeof(f32));
+    for (usize v = 0; v < vertex_count; v++) {
+        const f32* p = (const f32*)((const u8*)positions + v * position_stride);
+        for (u32 k = 0; k < 3; k++) {
+            normalized[v * 3 + k] = (p[k] - bounds_min[k]) * scale;
+        }
+    }
+
+    // collapses only move a vertex onto a neighbour, so every LOD shares the vertex buffer.
+    // Vertices on borders and attribute seams stay where they are to keep the outline intact.
+    u32* position_remap = dvr_build_position_remap(positions, vertex_count, position_stride);
+    bool* locked = calloc(vertex_count, sizeof(bool));
+    for (usize v = 0; v < vertex_count; v++) {
+        if (position_remap[v] != v) {
+            locked[v] = true;
+            locked[position_remap[v]] = true;
+        }
+    }
+
+    dvr_edge_set edges = dvr_create_edge_set(index_count);
+    for (usize i = 0; i < index_count; i += 3) {
+        for (u32 k = 0; k < 3; k++) {
+            u32 a = position_remap[dst[i + k]];
+            u32 b = position_remap[dst[i + (k + 1) % 3]];
+            dvr_edge_set_insert(&edges, a, b);
+        }
+    }
+    for (usize i = 0; i < index_count; i += 3) {
+        for (u32 k = 0; k < 3; k++) {
+            u32 a = position_remap[dst[i + k]];
+            u32 b = position_remap[dst[i + (k + 1) % 3]];
+            if (!dvr_edge_set_find(&edges, b, a)) {
+                locked[a] = true;
+                locked[b] = true;
+            }
+        }
+    }
+    free(edges.keys);
+
+    dvr_quadric* quadrics = calloc(vertex_count, sizeof(dvr_quadric));
+    for (usize i = 0; i < index_count; i += 3) {
+        const f32* a = &normalized[position_remap[dst[i + 0]] * 3];
+        const f32* b = &normalized[position_remap[dst[i + 1]] * 3];
+        const f32* c = &normalized[position_remap[dst[i + 2]] * 3];
+        f32 n[3];
+        dvr_triangle_normal(a, b, c, n);
+        f32 length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f) {
+            continue;
+        }
+        for (u32 k = 0; k < 3; k++) {
+            n[k] /= length;
+        }
+
+        dvr_quadric q = dvr_plane_quadric(n, -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]), length);
+        for (u32 k = 0; k < 3; k++) {
+            dvr_quadric_add(&quadrics[position_remap[dst[i + k]]], &q);
+        }
+    }
+
+    f32 error_limit = target_error * scale * target_error * scale;
+    dvr_collapse* collapses = malloc(index_count * sizeof(dvr_collapse));
+    u32* remap = malloc(vertex_count * sizeof(u32));
+    bool* touched = malloc(vertex_count * sizeof(bool));
+
+    while (index_count > target_index_count) {
+        // every unlocked end of every edge is a candidate, against the unique position
+        usize num_collapses = 0;
+        for (usize i = 0; i < index_count; i += 3) {
+            for (u32 k = 0; k < 3; k++) {
+                u32 from = position_remap[dst[i + k]];
+                u32 to = position_remap[dst[i + (k + 1) % 3]];
+                if (locked[from] || from == to) {
+                    continue;
+                }
+                collapses[num_collapses++] = (dvr_collapse){
+                    .from = from,
+                    .to = dst[i + (k + 1) % 3],
+                    .error = dvr_quadric_error(&quadrics[from], &normalized[to * 3]),
+                };
+            }
+        }
+        qsort(collapses, num_collapses, sizeof(dvr_collapse), dvr_compare_collapses);
+
+        dvr_vertex_triangles adjacency =
+            dvr_build_vertex_triangles(dst, index_count, vertex_count);
+        for (usize v = 0; v < vertex_count; v++) {
+            remap[v] = (u32)v;
+            touched[v] = false;
+        }
+
+        // collapses within a pass never share a triangle, each removes about two
+        usize triangles_left = (index_count - target_index_count) / 3;
+        usize applied = 0;
+        for (usize i = 0; i < num_collapses && triangles_left > 0; i++) {
+            const dvr_collapse* collapse = &collapses[i];
+            u32 to = position_remap[collapse->to];
+            if (collapse->error > error_limit) {
+                break;
+            }
+            if (touched[collapse->from] || touched[to] ||
+                !dvr_collapse_keeps_orientation(
+                    &adjacency,
+                    dst,
+                    position_remap,
+                    normalized,
+                    collapse->from,
+                    to
+                )) {
+                continue;
+            }
+
+            // the orientation check assumed the neighbours stay put
+            for (u32 j = 0; j < adjacency.counts[collapse->from]; j++) {
+                u32 triangle = adjacency.triangles[adjacency.offsets[collapse->from] + j];
+                for (u32 k = 0; k < 3; k++) {
+                    touched[position_remap[dst[triangle * 3 + k]]] = true;
+                }
+            }
+            remap[collapse->from] = collapse->to;
+            dvr_quadric_add(&quadrics[to], &quadrics[collapse->from]);
+            max_error = fmaxf(max_error, collapse->error);
+            triangles_left = triangles_left > 2 ? triangles_left - 2 : 0;
+            applied++;
+        }
+        dvr_free_vertex_triangles(&adjacency);
+
+        if (applied == 0) {
+            break;
+        }
+
+        usize write = 0;
+        for (usize i = 0; i < index_count; i += 3) {
+            u32 a = remap[dst[i + 0]];
+            u32 b = remap[dst[i + 1]];
+            u32 c = remap[dst[i + 2]];
+            u32 pa = position_remap[a];
+            u32 pb = position_remap[b];
+            u32 pc = position_remap[c];
+            if (pa != pb && pb != pc && pc != pa) {
+                dst[write++] = a;
+                dst[write++] = b;
+                dst[write++] = c;
+            }
+        }
+        index_count = write;
+    }
+
+    free(touched);
+    free(remap);
+    free(collapses);
+    free(quadrics);
+    free(locked);
+    free(position_remap);
+    free(normalized);
+
+    if (result_error != NULL) {
+        *result_error = sqrtf(max_error) / scale;
+    }
+    return index_count;
+}
+
+usize dvr_build_meshlets_bound(usize index_count, usize max_vertices, usize max_triangles) {
+    // every triangle adds at most three vertices, a meshlet is only closed when full
+    usize triangle_count = index_count / 3;
+    usize by_vertices = (triangle_count * 3 + max_vertices - 3) / (max_vertices - 2);
+    usize by_triangles = (triangle_count + max_triangles - 1) / max_triangles;
+    return by_vertices > by_triangles ? by_vertices : by_triangles;
+}
+
+usize dvr_build_meshlets(
+    dvr_meshlet* meshlets,
+    u32* meshlet_vertices,
+    u8* meshlet_triangles,
+    const u32* indices,
+    usize index_count,
+    usize vertex_count,
+    usize max_vertices,
+    usize max_triangles
+) {
+    // local index of every vertex in the open meshlet, 0xFF when it isn't part of it
+    u8* local = malloc(vertex_count > 0 ? vertex_count : 1);
+    memset(local, 0xFF, vertex_count);
+
+    usize num_meshlets = 0;
+    dvr_meshlet meshlet = { 0 };
+    for (usize i = 0; i + 2 < index_count; i += 3) {
+        const u32* triangle = &indices[i];
+        u32 new_vertices = 0;
+        for (u32 k = 0; k < 3; k++) {
+            if (local[triangle[k]] == 0xFF) {
+                new_vertices++;
+            }
+        }
+        if (meshlet.vertex_count + new_vertices > max_vertices ||
+            meshlet.triangle_count + 1 > max_triangles) {
+            for (u32 j = 0; j < meshlet.vertex_count; j++) {
+                local[meshlet_vertices[meshlet.vertex_offset + j]] = 0xFF;
+            }
+            meshlets[num_meshlets++] = meshlet;
+            meshlet = (dvr_meshlet){
+                .vertex_offset = meshlet.vertex_offset + meshlet.vertex_count,
+                .triangle_offset = meshlet.triangle_offset + meshlet.triangle_count * 3,
+            };
+        }
+
+        for (u32 k = 0; k < 3; k++) {
+            u32 v = triangle[k];
+            if (local[v] == 0xFF) {
+                local[v] = (u8)meshlet.vertex_count;
+                meshlet_vertices[meshlet.vertex_offset + meshlet.vertex_count++] = v;
+            }
+            meshlet_triangles[meshlet.triangle_offset + meshlet.triangle_count * 3 + k] = local[v];
+        }
+        meshlet.triangle_count++;
+    }
+    if (meshlet.triangle_count > 0) {
+        meshlets[num_meshlets++] = meshlet;
+    }
+
+    free(local);
+    return num_meshlets;
+}
+
+dvr_meshlet_bounds dvr_compute_meshlet_bounds(
+    const dvr_meshlet* meshlet,
+    const u32* meshlet_vertices,
+    const u8* meshlet_triangles,
+    const f32* positions,
+    usize position_stride
+) {
+    dvr_meshlet_bounds bounds = { .cone_cutoff = 1.0f };
+    if (meshlet->vertex_count == 0) {
+        return bounds;
+    }
+
+    const u32* vertices = &meshlet_vertices[meshlet->vertex_offset];
+    const u8* triangles = &meshlet_triangles[meshlet->triangle_offset];
+#define DVR_MESHLET_POSITION(local_index)                                                      \
+    ((const f32*)((const u8*)positions + vertices[local_index] * position_stride))
+
+    // sphere around the center of the box, loose but cheap
+    f32 min[3] = { INFINITY, INFINITY, INFINITY };
+    f32 max[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (u32 i = 0; i < meshlet->vertex_count; i++) {
+        const f32* p = DVR_MESHLET_POSITION(i);
+        for (u32 k = 0; k < 3; k++) {
+            min[k] = fminf(min[k], p[k]);
+            max[k] = fmaxf(max[k], p[k]);
+        }
+    }
+    for (u32 k = 0; k < 3; k++) {
+        bounds.center[k] = (min[k] + max[k]) * 0.5f;
+    }
+    for (u32 i = 0; i < meshlet->vertex_count; i++) {
+        const f32* p = DVR_MESHLET_POSITION(i);
+        f32 d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+        bounds.radius = fmaxf(bounds.radius, sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+    }
+
+    // the cone axis averages the triangle normals, its cutoff comes from the widest one
+    f32 normals[DVR_MESHLET_MAX_TRIANGLES][3];
+    u32 num_normals = 0;
+    f32 axis[3] = { 0.0f, 0.0f, 0.0f };
+    for (u32 t = 0; t < meshlet->triangle_count && num_normals < DVR_MESHLET_MAX_TRIANGLES; t++) {
+        f32* n = normals[num_normals];
+        dvr_triangle_normal(
+            DVR_MESHLET_POSITION(triangles[t * 3 + 0]),
+            DVR_MESHLET_POSITION(triangles[t * 3 + 1]),
+            DVR_MESHLET_POSITION(triangles[t * 3 + 2]),
+            n
+        );
+        f32 length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f) {
+            continue;
+        }
+        for (u32 k = 0; k < 3; k++) {
+            n[k] /= length;
+            axis[k] += n[k];
+        }
+        num_normals++;
+    }
+#undef DVR_MESHLET_POSITION
+
+    f32 axis_length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (num_normals == 0 || axis_length == 0.0f) {
+        return bounds;
+    }
+    f32 min_dot = 1.0f;
+    for (u32 k = 0; k < 3; k++) {
+        bounds.cone_axis[k] = axis[k] / axis_length;
+    }
+    for (u32 i = 0; i < num_normals; i++) {
+        f32 dot = normals[i][0] * bounds.cone_axis[0] + normals[i][1] * bounds.cone_axis[1] +
+                  normals[i][2] * bounds.cone_axis[2];
+        min_dot = fminf(min_dot, dot);
+    }
+
+    // a cone wider than a half space can't be used for culling
+    if (min_dot > 0.1f) {
+        bounds.cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+    }
+    return bounds;
+}
@@ -0,0 +1,376 @@
+#include "dvr_occlusion.h"
+
+#include "dvr_cluster.h"
+
+#include <string.h>
+
+static const u32 dvr_occlusion_cull_cs_spv[] =
+#include "dvr_occlusion_cull_cs.spv.h"
+    ;
+
+// one instance per invocation, matches dvr_occlusion_cull_cs.glsl
+#define DVR_OCCLUSION_GROUP_SIZE 64
+#define DVR_OCCLUSION_MAX_INSTANCES (65535u * DVR_OCCLUSION_GROUP_SIZE)
+#define DVR_OCCLUSION_NUM_BINDINGS 6
+
+/// Uniform block of the culling shader, std140.
+typedef struct dvr_occlusion_uniforms {
+    f32 planes[6][4];
+    f32 pyramid_view_proj[16];
+    f32 pyramid_size[2];
+    u32 pyramid_levels;
+    u32 occlusion;
+    u32 instance_count;
+    u32 instance_words;
+    u32 num_draws;
+    u32 reserved;
+} dvr_occlusion_uniforms;
+
+_Static_assert(
+    sizeof(dvr_occlusion_uniforms) == 192,
+    "unexpected padding in dvr_occlusion_uniforms"
+);
+
+static struct {
+    bool running;
+    dvr_shader_module shader_module;
+    dvr_descriptor_set_layout layout;
+    dvr_compute_pipeline pipeline;
+    dvr_sampler sampler;
+} g_dvr_occlusion;
+
+DVR_RESULT(dvr_none) dvr_occlusion_setup(void) {
+    if (g_dvr_occlusion.running) {
+        return DVR_ERROR(dvr_none, "occlusion culling is already set up");
+    }
+
+    // fails early without `dvr_setup_desc.depth_pyramid`
+    DVR_RESULT(dvr_depth_pyramid) pyramid_res = dvr_get_depth_pyramid();
+    DVR_BUBBLE_INTO(dvr_none, pyramid_res);
+
+    DVR_RESULT(dvr_shader_module)
+    shader_module_res = dvr_create_shader_module(&(dvr_shader_module_desc){
+        .code = DVR_RANGE(dvr_occlusion_cull_cs_spv),
+    });
+    DVR_BUBBLE_INTO(dvr_none, shader_module_res);
+    g_dvr_occlusion.shader_module = DVR_UNWRAP(shader_module_res);
+
+    dvr_descriptor_set_layout_binding_desc bindings[DVR_OCCLUSION_NUM_BINDINGS];
+    for (u32 i = 0; i < DVR_OCCLUSION_NUM_BINDINGS; i++) {
+        bindings[i] = (dvr_descriptor_set_layout_binding_desc){
+            .binding = i,
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .count = 1,
+            .stage_flags = VK_SHADER_STAGE_COMPUTE_BIT,
+        };
+    }
+    bindings[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[5].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    DVR_RESULT(dvr_descriptor_set_layout)
+    layout_res = dvr_create_descriptor_set_layout(&(dvr_descriptor_set_layout_desc){
+        .num_bindings = DVR_OCCLUSION_NUM_BINDINGS,
+        .bindings = bindings,
+    });
+    if (!layout_res.is_ok) {
+        dvr_destroy_shader_module(g_dvr_occlusion.shader_module);
+        return DVR_ERROR(dvr_none, layout_res.error.message);
+    }
+    g_dvr_occlusion.layout = DVR_UNWRAP(layout_res);
+
+    DVR_RESULT(dvr_compute_pipeline)
+    pipeline_res = dvr_create_compute_pipeline(&(dvr_compute_pipeline_desc){
+        .shader_module = g_dvr_occlusion.shader_module,
+        .entry_point = "main",
+        .num_desc_set_layouts = 1,
+        .desc_set_layouts = &g_dvr_occlusion.layout,
+    });
+    if (!pipeline_res.is_ok) {
+        dvr_destroy_descriptor_set_layout(g_dvr_occlusion.layout);
+        dvr_destroy_shader_module(g_dvr_occlusion.shader_module);
+        return DVR_ERROR(dvr_none, pipeline_res.error.message);
+    }
+    g_dvr_occlusion.pipeline = DVR_UNWRAP(pipeline_res);
+
+    // the pyramid is only read with texelFetch
+    DVR_RESULT(dvr_sampler)
+    sampler_res = dvr_create_sampler(&(dvr_sampler_desc){
+        .mag_filter = VK_FILTER_NEAREST,
+        .min_filter = VK_FILTER_NEAREST,
+        .mipmap_mode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .address_mode_u = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .address_mode_v = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .address_mode_w = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .max_lod = VK_LOD_CLAMP_NONE,
+    });
+    if (!sampler_res.is_ok) {
+        dvr_destroy_compute_pipeline(g_dvr_occlusion.pipeline);
+        dvr_destroy_descriptor_set_layout(g_dvr_occlusion.layout);
+        dvr_destroy_shader_module(g_dvr_occlusion.shader_module);
+        return DVR_ERROR(dvr_none, sampler_res.error.message);
+    }
+    g_dvr_occlusion.sampler = DVR_UNWRAP(sampler_res);
+    g_dvr_occlusion.running = true;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+void dvr_occlusion_shutdown(void) {
+    if (!g_dvr_occlusion.running) {
+        return;
+    }
+
+    dvr_destroy_sampler(g_dvr_occlusion.sampler);
+    dvr_destroy_compute_pipeline(g_dvr_occlusion.pipeline);
+    dvr_destroy_descriptor_set_layout(g_dvr_occlusion.layout);
+    dvr_destroy_shader_module(g_dvr_occlusion.shader_module);
+    g_dvr_occlusion.running = false;
+}
+
+DVR_RESULT(dvr_occlusion_batch) dvr_create_occlusion_batch(dvr_occlusion_batch_desc* desc) {
+    if (!g_dvr_occlusion.running) {
+        return DVR_ERROR(dvr_occlusion_batch, "occlusion culling is not set up");
+    }
+    if (desc->max_instances == 0 || desc->max_instances > DVR_OCCLUSION_MAX_INSTANCES) {
+        return DVR_ERROR(dvr_occlusion_batch, "occlusion batch instance count out of range");
+    }
+    if (desc->instance_stride == 0 || desc->instance_stride % 4 != 0) {
+        return DVR_ERROR(dvr_occlusion_batch, "instance stride has to be a multiple of 4");
+    }
+    // the instance buffers are copied with u32 offsets
+    if ((u64)desc->instance_stride * desc->max_instances > UINT32_MAX) {
+        return DVR_ERROR(dvr_occlusion_batch, "occlusion batch instances don't fit in 4GiB");
+    }
+    if (desc->num_draws == 0 || desc->num_draws > DVR_OCCLUSION_MAX_DRAWS) {
+        return DVR_ERROR(dvr_occlusion_batch, "occlusion batch draw count out of range");
+    }
+
+    dvr_occlusion_batch batch = {
+        .max_instances = desc->max_instances,
+        .instance_stride = desc->instance_stride,
+        .binding = desc->binding,
+        .num_draws = desc->num_draws,
+        .frame_index = dvr_frame_index(),
+    };
+    memcpy(batch.draws, desc->draws, sizeof(batch.draws));
+
+    usize instances_size = (usize)desc->instance_stride * desc->max_instances;
+    DVR_RESULT(dvr_buffer) buffer_res[5] = {
+        dvr_create_buffer(&(dvr_buffer_desc){
+            .data = { .base = NULL, .size = sizeof(vec4) * desc->max_instances },
+            .usage = DVR_BUFFER_USAGE_STORAGE,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+        }),
+        dvr_create_buffer(&(dvr_buffer_desc){
+            .data = { .base = NULL, .size = instances_size },
+            .usage = DVR_BUFFER_USAGE_STORAGE,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+        }),
+        dvr_create_buffer(&(dvr_buffer_desc){
+            .data = { .base = NULL, .size = instances_size },
+            .usage = DVR_BUFFER_USAGE_STORAGE | DVR_BUFFER_USAGE_VERTEX,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_STATIC,
+        }),
+        dvr_create_buffer(&(dvr_buffer_desc){
+            .data = {
+                .base = NULL,
+                .size = sizeof(VkDrawIndexedIndirectCommand) * desc->num_draws,
+            },
+            .usage = DVR_BUFFER_USAGE_STORAGE | DVR_BUFFER_USAGE_INDIRECT,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+        }),
+        dvr_create_buffer(&(dvr_buffer_desc){
+            .data = { .base = NULL, .size = sizeof(dvr_occlusion_uniforms) },
+            .usage = DVR_BUFFER_USAGE_UNIFORM,
+            .lifecycle = DVR_BUFFER_LIFECYCLE_DYNAMIC,
+        }),
+    };
+
+    const char* error = NULL;
+    for (u32 i = 0; i < 5; i++) {
+        if (!buffer_res[i].is_ok) {
+            error = buffer_res[i].error.message;
+        }
+    }
+    if (error != NULL) {
+        for (u32 i = 0; i < 5; i++) {
+            if (buffer_res[i].is_ok) {
+                dvr_destroy_buffer(DVR_UNWRAP(buffer_res[i]));
+            }
+        }
+        return DVR_ERROR(dvr_occlusion_batch, error);
+    }
+
+    batch.bounds_buffer = DVR_UNWRAP(buffer_res[0]);
+    batch.instance_buffer = DVR_UNWRAP(buffer_res[1]);
+    batch.visible_buffer = DVR_UNWRAP(buffer_res[2]);
+    batch.draw_buffer = DVR_UNWRAP(buffer_res[3]);
+    batch.uniform_buffer = DVR_UNWRAP(buffer_res[4]);
+
+    return DVR_OK(dvr_occlusion_batch, batch);
+}
+
+void dvr_destroy_occlusion_batch(dvr_occlusion_batch* batch) {
+    if (batch->pyramid_generation != 0) {
+        dvr_destroy_descriptor_set(batch->descriptor_set);
+    }
+    dvr_destroy_buffer(batch->uniform_buffer);
+    dvr_destroy_buffer(batch->draw_buffer);
+    dvr_destroy_buffer(batch->visible_buffer);
+    dvr_destroy_buffer(batch->instance_buffer);
+    dvr_destroy_buffer(batch->bounds_buffer);
+    *batch = (dvr_occlusion_batch){};
+}
+
+DVR_RESULT(dvr_none) dvr_push_occlusion_instances(
+    dvr_occlusion_batch* batch,
+    const void* data,
+    const vec4* spheres,
+    u32 count
+) {
+    // with one frame in flight the previous frame finished reading once a new one began
+    u64 frame_index = dvr_frame_index();
+    if (batch->frame_index != frame_index) {
+        batch->frame_index = frame_index;
+        batch->count = 0;
+    }
+
+    if (count > batch->max_instances - batch->count) {
+        return DVR_ERROR(dvr_none, "occlusion batch is full");
+    }
+
+    dvr_write_buffer(
+        batch->bounds_buffer,
+        (dvr_range){ .base = (void*)spheres, .size = sizeof(vec4) * count },
+        batch->count * (u32)sizeof(vec4)
+    );
+    dvr_write_buffer(
+        batch->instance_buffer,
+        (dvr_range){ .base = (void*)data, .size = (usize)batch->instance_stride * count },
+        batch->count * batch->instance_stride
+    );
+    batch->count += count;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+/// Points the descriptor set at the current depth pyramid, which is recreated with the
+/// swapchain.
+static DVR_RESULT(dvr_none)
+    dvr_occlusion_update_descriptor_set(dvr_occlusion_batch* batch, dvr_depth_pyramid* pyramid) {
+    if (batch->pyramid_generation == pyramid->generation) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    dvr_buffer buffers[5] = {
+        batch->uniform_buffer,
+        batch->bounds_buffer,
+        batch->instance_buffer,
+        batch->visible_buffer,
+        batch->draw_buffer,
+    };
+    u32 sizes[5] = {
+        (u32)sizeof(dvr_occlusion_uniforms),
+        batch->max_instances * (u32)sizeof(vec4),
+        batch->max_instances * batch->instance_stride,
+        batch->max_instances * batch->instance_stride,
+        batch->num_draws * (u32)sizeof(VkDrawIndexedIndirectCommand),
+    };
+    dvr_descriptor_set_binding_desc bindings[DVR_OCCLUSION_NUM_BINDINGS];
+    for (u32 i = 0; i < 5; i++) {
+        bindings[i] = (dvr_descriptor_set_binding_desc){
+            .binding = i,
+            .type = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .buffer = { .buffer = buffers[i], .offset = 0, .size = sizes[i] },
+        };
+    }
+    bindings[5] = (dvr_descriptor_set_binding_desc){
+        .binding = 5,
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .image = {
+            .image = pyramid->image,
+            .sampler = g_dvr_occlusion.sampler,
+            .layout = VK_IMAGE_LAYOUT_GENERAL,
+        },
+    };
+
+    DVR_RESULT(dvr_descriptor_set)
+    descriptor_set_res = dvr_create_descriptor_set(&(dvr_descriptor_set_desc){
+        .layout = g_dvr_occlusion.layout,
+        .num_bindings = DVR_OCCLUSION_NUM_BINDINGS,
+        .bindings = bindings,
+    });
+    DVR_BUBBLE_INTO(dvr_none, descriptor_set_res);
+
+    // the last frame that used the old set has completed
+    if (batch->pyramid_generation != 0) {
+        dvr_destroy_descriptor_set(batch->descriptor_set);
+    }
+    batch->descriptor_set = DVR_UNWRAP(descriptor_set_res);
+    batch->pyramid_generation = pyramid->generation;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none)
+dvr_cull_occlusion_batch(dvr_occlusion_batch* batch, const dvr_occlusion_view* view) {
+    DVR_RESULT(dvr_depth_pyramid) pyramid_res = dvr_get_depth_pyramid();
+    DVR_BUBBLE_INTO(dvr_none, pyramid_res);
+    dvr_depth_pyramid pyramid = DVR_UNWRAP(pyramid_res);
+
+    DVR_RESULT(dvr_none) res = dvr_occlusion_update_descriptor_set(batch, &pyramid);
+    DVR_BUBBLE(res);
+
+    // nothing pushed this frame
+    if (batch->frame_index != dvr_frame_index()) {
+        batch->count = 0;
+    }
+
+    VkDrawIndexedIndirectCommand draws[DVR_OCCLUSION_MAX_DRAWS];
+    for (u32 i = 0; i < batch->num_draws; i++) {
+        draws[i] = (VkDrawIndexedIndirectCommand){
+            .indexCount = batch->draws[i].index_count,
+            .instanceCount = 0,
+            .firstIndex = batch->draws[i].first_index,
+            .vertexOffset = batch->draws[i].vertex_offset,
+            .firstInstance = 0,
+        };
+    }
+    usize draws_size = sizeof(VkDrawIndexedIndirectCommand) * batch->num_draws;
+    dvr_write_buffer(batch->draw_buffer, (dvr_range){ .base = draws, .size = draws_size }, 0);
+
+    dvr_occlusion_uniforms uniforms = {
+        .pyramid_size = { (f32)pyramid.width, (f32)pyramid.height },
+        .pyramid_levels = pyramid.num_levels,
+        .occlusion = pyramid.valid && !view->disable_occlusion,
+        .instance_count = batch->count,
+        .instance_words = batch->instance_stride / 4,
+        .num_draws = batch->num_draws,
+    };
+    dvr_frustum_planes(view->view_proj, uniforms.planes);
+    memcpy(uniforms.pyramid_view_proj, view->previous_view_proj, sizeof(mat4));
+    dvr_write_buffer(batch->uniform_buffer, DVR_RANGE(uniforms), 0);
+
+    if (batch->count == 0) {
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    dvr_bind_compute_pipeline(g_dvr_occlusion.pipeline);
+    dvr_bind_descriptor_set_compute(g_dvr_occlusion.pipeline, batch->descriptor_set);
+    dvr_dispatch_compute(
+        (batch->count + DVR_OCCLUSION_GROUP_SIZE - 1) / DVR_OCCLUSION_GROUP_SIZE,
+        1,
+        1
+    );
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+void dvr_draw_occlusion_batch(const dvr_occlusion_batch* batch) {
+    dvr_bind_vertex_buffer(batch->visible_buffer, batch->binding);
+    dvr_draw_indexed_indirect(
+        batch->draw_buffer,
+        0,
+        batch->num_draws,
+        sizeof(VkDrawIndexedIndirectCommand)
+    );
+}
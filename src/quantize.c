@@ -0,0 +1,132 @@
+#include "dvr_quantize.h"
+
+#include "dvr_utils.h"
+
+#include <math.h>
+#include <string.h>
+
+u16 dvr_quantize_half(f32 v) {
+    u32 bits;
+    memcpy(&bits, &v, sizeof(bits));
+    u32 sign = (bits >> 16) & 0x8000u;
+    u32 magnitude = bits & 0x7FFFFFFFu;
+
+    if (magnitude >= 0x7F800000u) {
+        // infinity stays infinity, NaN stays a quiet NaN
+        return (u16)(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (magnitude >= 0x477FF000u) {
+        // 65520 and above round past the largest half
+        return (u16)(sign | 0x7C00u);
+    }
+    if (magnitude < 0x38800000u) {
+        // below the smallest normal half, the subnormal mantissa is the value in units of 2^-24
+        f32 f;
+        memcpy(&f, &magnitude, sizeof(f));
+        return (u16)(sign | (u32)lrintf(f * 16777216.0f));
+    }
+
+    // rebias the exponent and round the mantissa to nearest even
+    u32 rounded = magnitude + 0xFFFu + ((magnitude >> 13) & 1u);
+    return (u16)(sign | ((rounded - 0x38000000u) >> 13));
+}
+
+f32 dvr_dequantize_half(u16 v) {
+    u32 sign = (u32)(v & 0x8000u) << 16;
+    u32 exponent = (v >> 10) & 0x1Fu;
+    u32 mantissa = v & 0x3FFu;
+
+    f32 magnitude;
+    if (exponent == 0) {
+        magnitude = ldexpf((f32)mantissa, -24);
+    } else if (exponent == 0x1F) {
+        magnitude = mantissa == 0 ? INFINITY : NAN;
+    } else {
+        magnitude = ldexpf((f32)(mantissa | 0x400u), (i32)exponent - 25);
+    }
+
+    u32 bits;
+    memcpy(&bits, &magnitude, sizeof(bits));
+    bits |= sign;
+    f32 result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+u16 dvr_quantize_unorm16(f32 v) {
+    return (u16)lrintf(dvr_clampf(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+i16 dvr_quantize_snorm16(f32 v) {
+    return (i16)lrintf(dvr_clampf(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+u8 dvr_quantize_unorm8(f32 v) {
+    return (u8)lrintf(dvr_clampf(v, 0.0f, 1.0f) * 255.0f);
+}
+
+i8 dvr_quantize_snorm8(f32 v) {
+    return (i8)lrintf(dvr_clampf(v, -1.0f, 1.0f) * 127.0f);
+}
+
+static f32 dvr_sign_not_zero(f32 v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+void dvr_encode_octahedral(const f32 normal[3], f32 dst[2]) {
+    f32 l1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+    if (l1 == 0.0f) {
+        dst[0] = 0.0f;
+        dst[1] = 0.0f;
+        return;
+    }
+
+    f32 x = normal[0] / l1;
+    f32 y = normal[1] / l1;
+    if (normal[2] < 0.0f) {
+        // fold the lower hemisphere over the diagonals
+        f32 folded_x = (1.0f - fabsf(y)) * dvr_sign_not_zero(x);
+        f32 folded_y = (1.0f - fabsf(x)) * dvr_sign_not_zero(y);
+        x = folded_x;
+        y = folded_y;
+    }
+    dst[0] = x;
+    dst[1] = y;
+}
+
+void dvr_decode_octahedral(const f32 encoded[2], f32 dst[3]) {
+    f32 x = encoded[0];
+    f32 y = encoded[1];
+    f32 z = 1.0f - fabsf(x) - fabsf(y);
+    f32 t = fmaxf(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    f32 length = sqrtf(x * x + y * y + z * z);
+    dst[0] = x / length;
+    dst[1] = y / length;
+    dst[2] = z / length;
+}
+
+dvr_position_quantization
+    dvr_position_quantization_from_bounds(const f32 bounds_min[3], const f32 bounds_max[3]) {
+    dvr_position_quantization quantization;
+    for (u32 i = 0; i < 3; i++) {
+        quantization.offset[i] = bounds_min[i];
+        quantization.scale[i] = fmaxf(bounds_max[i] - bounds_min[i], 0.0f);
+    }
+    return quantization;
+}
+
+void dvr_quantize_position(
+    const dvr_position_quantization* quantization,
+    const f32 position[3],
+    u16 dst[4]
+) {
+    for (u32 i = 0; i < 3; i++) {
+        f32 scale = quantization->scale[i];
+        f32 v = scale > 0.0f ? (position[i] - quantization->offset[i]) / scale : 0.0f;
+        dst[i] = dvr_quantize_unorm16(v);
+    }
+    dst[3] = UINT16_MAX;
+}
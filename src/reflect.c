@@ -0,0 +1,581 @@
+#include "dvr_reflect.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <stb/stb_ds.h>
+
+// the subset of the SPIR-V grammar the reflection reads
+enum {
+    DVR_SPV_MAGIC = 0x07230203,
+
+    DVR_SPV_OP_ENTRY_POINT = 15,
+    DVR_SPV_OP_EXECUTION_MODE = 16,
+    DVR_SPV_OP_TYPE_INT = 21,
+    DVR_SPV_OP_TYPE_FLOAT = 22,
+    DVR_SPV_OP_TYPE_VECTOR = 23,
+    DVR_SPV_OP_TYPE_MATRIX = 24,
+    DVR_SPV_OP_TYPE_IMAGE = 25,
+    DVR_SPV_OP_TYPE_SAMPLER = 26,
+    DVR_SPV_OP_TYPE_SAMPLED_IMAGE = 27,
+    DVR_SPV_OP_TYPE_ARRAY = 28,
+    DVR_SPV_OP_TYPE_RUNTIME_ARRAY = 29,
+    DVR_SPV_OP_TYPE_STRUCT = 30,
+    DVR_SPV_OP_TYPE_POINTER = 32,
+    DVR_SPV_OP_CONSTANT = 43,
+    DVR_SPV_OP_CONSTANT_COMPOSITE = 44,
+    DVR_SPV_OP_SPEC_CONSTANT = 50,
+    DVR_SPV_OP_SPEC_CONSTANT_COMPOSITE = 51,
+    DVR_SPV_OP_VARIABLE = 59,
+    DVR_SPV_OP_DECORATE = 71,
+    DVR_SPV_OP_MEMBER_DECORATE = 72,
+
+    DVR_SPV_DECORATION_SPEC_ID = 1,
+    DVR_SPV_DECORATION_BLOCK = 2,
+    DVR_SPV_DECORATION_BUFFER_BLOCK = 3,
+    DVR_SPV_DECORATION_ARRAY_STRIDE = 6,
+    DVR_SPV_DECORATION_MATRIX_STRIDE = 7,
+    DVR_SPV_DECORATION_BUILT_IN = 11,
+    DVR_SPV_DECORATION_LOCATION = 30,
+    DVR_SPV_DECORATION_BINDING = 33,
+    DVR_SPV_DECORATION_DESCRIPTOR_SET = 34,
+    DVR_SPV_DECORATION_OFFSET = 35,
+
+    DVR_SPV_STORAGE_UNIFORM_CONSTANT = 0,
+    DVR_SPV_STORAGE_INPUT = 1,
+    DVR_SPV_STORAGE_UNIFORM = 2,
+    DVR_SPV_STORAGE_PUSH_CONSTANT = 9,
+    DVR_SPV_STORAGE_STORAGE_BUFFER = 12,
+
+    DVR_SPV_DIM_BUFFER = 5,
+    DVR_SPV_DIM_SUBPASS_DATA = 6,
+
+    DVR_SPV_EXECUTION_MODE_LOCAL_SIZE = 17,
+
+    DVR_SPV_BUILT_IN_WORKGROUP_SIZE = 25,
+};
+
+enum {
+    DVR_SPV_HAS_SET = 1 << 0,
+    DVR_SPV_HAS_BINDING = 1 << 1,
+    DVR_SPV_HAS_LOCATION = 1 << 2,
+    DVR_SPV_BUILT_IN = 1 << 3,
+    DVR_SPV_BLOCK = 1 << 4,
+    DVR_SPV_BUFFER_BLOCK = 1 << 5,
+    DVR_SPV_HAS_SPEC_ID = 1 << 6,
+};
+
+typedef struct dvr_spv_id {
+    u32 opcode;
+    // word offset of the instruction defining the id
+    u32 offset;
+    u32 flags;
+    u32 built_in;
+    u32 set;
+    u32 binding;
+    u32 location;
+    u32 array_stride;
+    u32 spec_id;
+} dvr_spv_id;
+
+typedef struct dvr_spv_member {
+    u32 type;
+    u32 member;
+    u32 offset;
+    u32 matrix_stride;
+} dvr_spv_member;
+
+typedef struct dvr_spv {
+    const u32* words;
+    u32 num_words;
+    u32 bound;
+    dvr_spv_id* ids;
+    dvr_spv_member* members;
+} dvr_spv;
+
+static const u32* dvr_spv_operands(dvr_spv* spv, u32 id) {
+    return &spv->words[spv->ids[id].offset + 1];
+}
+
+static dvr_spv_member* dvr_spv_get_member(dvr_spv* spv, u32 type, u32 member) {
+    for (usize i = 0; i < arrlenu(spv->members); i++) {
+        if (spv->members[i].type == type && spv->members[i].member == member) {
+            return &spv->members[i];
+        }
+    }
+
+    arrput(spv->members, ((dvr_spv_member){ .type = type, .member = member }));
+    return &arrlast(spv->members);
+}
+
+static u32 dvr_spv_constant(dvr_spv* spv, u32 id) {
+    if (id >= spv->bound || (spv->ids[id].opcode != DVR_SPV_OP_CONSTANT &&
+                             spv->ids[id].opcode != DVR_SPV_OP_SPEC_CONSTANT)) {
+        return 0;
+    }
+
+    // the default value of spec constants
+    return dvr_spv_operands(spv, id)[2];
+}
+
+static u32 dvr_spv_type_size(dvr_spv* spv, u32 type, u32 matrix_stride, u32 depth) {
+    if (type >= spv->bound || depth > 16) {
+        return 0;
+    }
+
+    const u32* operands = dvr_spv_operands(spv, type);
+    switch (spv->ids[type].opcode) {
+        case DVR_SPV_OP_TYPE_INT:
+        case DVR_SPV_OP_TYPE_FLOAT:
+            return operands[1] / 8;
+        case DVR_SPV_OP_TYPE_VECTOR:
+            return operands[2] * dvr_spv_type_size(spv, operands[1], 0, depth + 1);
+        case DVR_SPV_OP_TYPE_MATRIX: {
+            u32 column_size = matrix_stride;
+            if (column_size == 0) {
+                column_size = dvr_spv_type_size(spv, operands[1], 0, depth + 1);
+            }
+            return operands[2] * column_size;
+        }
+        case DVR_SPV_OP_TYPE_ARRAY: {
+            u32 stride = spv->ids[type].array_stride;
+            if (stride == 0) {
+                stride = dvr_spv_type_size(spv, operands[1], matrix_stride, depth + 1);
+            }
+            return dvr_spv_constant(spv, operands[2]) * stride;
+        }
+        case DVR_SPV_OP_TYPE_STRUCT: {
+            u32 size = 0;
+            u32 num_members = (spv->words[spv->ids[type].offset] >> 16) - 2;
+            for (u32 i = 0; i < num_members; i++) {
+                dvr_spv_member* member = dvr_spv_get_member(spv, type, i);
+                u32 end = member->offset +
+                          dvr_spv_type_size(spv, operands[1 + i], member->matrix_stride, depth + 1);
+                size = end > size ? end : size;
+            }
+            return size;
+        }
+        default:
+            return 0;
+    }
+}
+
+static VkFormat dvr_spv_vertex_format(dvr_spv* spv, u32 type) {
+    u32 num_components = 1;
+    if (spv->ids[type].opcode == DVR_SPV_OP_TYPE_VECTOR) {
+        num_components = dvr_spv_operands(spv, type)[2];
+        type = dvr_spv_operands(spv, type)[1];
+        if (type >= spv->bound) {
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+    if (num_components < 1 || num_components > 4) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    const u32* operands = dvr_spv_operands(spv, type);
+    if (operands[1] != 32) {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    static const VkFormat float_formats[4] = {
+        VK_FORMAT_R32_SFLOAT,
+        VK_FORMAT_R32G32_SFLOAT,
+        VK_FORMAT_R32G32B32_SFLOAT,
+        VK_FORMAT_R32G32B32A32_SFLOAT,
+    };
+    static const VkFormat int_formats[4] = {
+        VK_FORMAT_R32_SINT,
+        VK_FORMAT_R32G32_SINT,
+        VK_FORMAT_R32G32B32_SINT,
+        VK_FORMAT_R32G32B32A32_SINT,
+    };
+    static const VkFormat uint_formats[4] = {
+        VK_FORMAT_R32_UINT,
+        VK_FORMAT_R32G32_UINT,
+        VK_FORMAT_R32G32B32_UINT,
+        VK_FORMAT_R32G32B32A32_UINT,
+    };
+    switch (spv->ids[type].opcode) {
+        case DVR_SPV_OP_TYPE_FLOAT:
+            return float_formats[num_components - 1];
+        case DVR_SPV_OP_TYPE_INT:
+            return operands[2] ? int_formats[num_components - 1] : uint_formats[num_components - 1];
+        default:
+            return VK_FORMAT_UNDEFINED;
+    }
+}
+
+/// Descriptor type of a resource variable, `type` being the type it points to.
+static DVR_RESULT(dvr_shader_binding)
+    dvr_spv_binding(dvr_spv* spv, u32 storage_class, u32 type) {
+    dvr_shader_binding binding = { .count = 1 };
+    while (spv->ids[type].opcode == DVR_SPV_OP_TYPE_ARRAY ||
+           spv->ids[type].opcode == DVR_SPV_OP_TYPE_RUNTIME_ARRAY) {
+        if (spv->ids[type].opcode == DVR_SPV_OP_TYPE_RUNTIME_ARRAY) {
+            return DVR_ERROR(dvr_shader_binding, "runtime descriptor arrays aren't supported");
+        }
+        binding.count *= dvr_spv_constant(spv, dvr_spv_operands(spv, type)[2]);
+        type = dvr_spv_operands(spv, type)[1];
+        if (type >= spv->bound) {
+            return DVR_ERROR(dvr_shader_binding, "invalid SPIR-V type id");
+        }
+    }
+
+    const u32* operands = dvr_spv_operands(spv, type);
+    switch (spv->ids[type].opcode) {
+        case DVR_SPV_OP_TYPE_SAMPLER:
+            binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            break;
+        case DVR_SPV_OP_TYPE_SAMPLED_IMAGE:
+            binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            break;
+        case DVR_SPV_OP_TYPE_IMAGE: {
+            u32 dim = operands[2];
+            u32 sampled = operands[6];
+            if (dim == DVR_SPV_DIM_SUBPASS_DATA) {
+                binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            } else if (dim == DVR_SPV_DIM_BUFFER) {
+                binding.type = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                                            : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            } else {
+                binding.type = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
+                                            : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            }
+            break;
+        }
+        case DVR_SPV_OP_TYPE_STRUCT:
+            if (storage_class == DVR_SPV_STORAGE_STORAGE_BUFFER ||
+                (spv->ids[type].flags & DVR_SPV_BUFFER_BLOCK)) {
+                binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            } else {
+                binding.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            }
+            break;
+        default:
+            return DVR_ERROR(dvr_shader_binding, "unsupported descriptor type");
+    }
+
+    return DVR_OK(dvr_shader_binding, binding);
+}
+
+static int dvr_spv_compare_bindings(const void* a, const void* b) {
+    const dvr_shader_binding* binding_a = a;
+    const dvr_shader_binding* binding_b = b;
+    if (binding_a->set != binding_b->set) {
+        return binding_a->set < binding_b->set ? -1 : 1;
+    }
+    return binding_a->binding < binding_b->binding ? -1 : binding_a->binding > binding_b->binding;
+}
+
+static int dvr_spv_compare_vertex_inputs(const void* a, const void* b) {
+    const dvr_shader_vertex_input* input_a = a;
+    const dvr_shader_vertex_input* input_b = b;
+    return input_a->location < input_b->location ? -1 : input_a->location > input_b->location;
+}
+
+/// Index ids and decorations, every id is defined by exactly one instruction.
+static DVR_RESULT(dvr_none) dvr_spv_parse(dvr_spv* spv, dvr_shader_reflection* reflection) {
+    bool has_entry_point = false;
+    u32 entry_point = 0;
+
+    for (u32 offset = 5; offset < spv->num_words;) {
+        u32 opcode = spv->words[offset] & 0xFFFFu;
+        u32 num_words = spv->words[offset] >> 16;
+        if (num_words == 0 || offset + num_words > spv->num_words) {
+            return DVR_ERROR(dvr_none, "truncated SPIR-V instruction");
+        }
+        const u32* operands = &spv->words[offset + 1];
+        u32 num_operands = num_words - 1;
+
+        // the result id is the first operand of types, the second of values
+        u32 result = UINT32_MAX;
+        switch (opcode) {
+            case DVR_SPV_OP_TYPE_INT:
+            case DVR_SPV_OP_TYPE_FLOAT:
+            case DVR_SPV_OP_TYPE_VECTOR:
+            case DVR_SPV_OP_TYPE_MATRIX:
+            case DVR_SPV_OP_TYPE_IMAGE:
+            case DVR_SPV_OP_TYPE_SAMPLER:
+            case DVR_SPV_OP_TYPE_SAMPLED_IMAGE:
+            case DVR_SPV_OP_TYPE_ARRAY:
+            case DVR_SPV_OP_TYPE_RUNTIME_ARRAY:
+            case DVR_SPV_OP_TYPE_STRUCT:
+            case DVR_SPV_OP_TYPE_POINTER:
+                result = num_operands >= 1 ? operands[0] : UINT32_MAX;
+                break;
+            case DVR_SPV_OP_CONSTANT:
+            case DVR_SPV_OP_SPEC_CONSTANT:
+            case DVR_SPV_OP_CONSTANT_COMPOSITE:
+            case DVR_SPV_OP_SPEC_CONSTANT_COMPOSITE:
+            case DVR_SPV_OP_VARIABLE:
+                result = num_operands >= 3 ? operands[1] : UINT32_MAX;
+                break;
+            case DVR_SPV_OP_ENTRY_POINT:
+                if (!has_entry_point && num_operands >= 2) {
+                    has_entry_point = true;
+                    entry_point = operands[1];
+                    static const VkShaderStageFlagBits stages[] = {
+                        VK_SHADER_STAGE_VERTEX_BIT,
+                        VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+                        VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+                        VK_SHADER_STAGE_GEOMETRY_BIT,
+                        VK_SHADER_STAGE_FRAGMENT_BIT,
+                        VK_SHADER_STAGE_COMPUTE_BIT,
+                    };
+                    if (operands[0] >= sizeof(stages) / sizeof(stages[0])) {
+                        return DVR_ERROR(dvr_none, "unsupported SPIR-V execution model");
+                    }
+                    reflection->stage = stages[operands[0]];
+                }
+                break;
+            case DVR_SPV_OP_EXECUTION_MODE:
+                if (num_operands >= 5 && has_entry_point && operands[0] == entry_point &&
+                    operands[1] == DVR_SPV_EXECUTION_MODE_LOCAL_SIZE) {
+                    memcpy(reflection->workgroup_size, &operands[2], sizeof(u32) * 3);
+                }
+                break;
+            case DVR_SPV_OP_DECORATE: {
+                if (num_operands < 2 || operands[0] >= spv->bound) {
+                    break;
+                }
+                dvr_spv_id* id = &spv->ids[operands[0]];
+                u32 value = num_operands >= 3 ? operands[2] : 0;
+                switch (operands[1]) {
+                    case DVR_SPV_DECORATION_SPEC_ID:
+                        id->flags |= DVR_SPV_HAS_SPEC_ID;
+                        id->spec_id = value;
+                        break;
+                    case DVR_SPV_DECORATION_BLOCK:
+                        id->flags |= DVR_SPV_BLOCK;
+                        break;
+                    case DVR_SPV_DECORATION_BUFFER_BLOCK:
+                        id->flags |= DVR_SPV_BUFFER_BLOCK;
+                        break;
+                    case DVR_SPV_DECORATION_ARRAY_STRIDE:
+                        id->array_stride = value;
+                        break;
+                    case DVR_SPV_DECORATION_BUILT_IN:
+                        id->flags |= DVR_SPV_BUILT_IN;
+                        id->built_in = value;
+                        break;
+                    case DVR_SPV_DECORATION_LOCATION:
+                        id->flags |= DVR_SPV_HAS_LOCATION;
+                        id->location = value;
+                        break;
+                    case DVR_SPV_DECORATION_BINDING:
+                        id->flags |= DVR_SPV_HAS_BINDING;
+                        id->binding = value;
+                        break;
+                    case DVR_SPV_DECORATION_DESCRIPTOR_SET:
+                        id->flags |= DVR_SPV_HAS_SET;
+                        id->set = value;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case DVR_SPV_OP_MEMBER_DECORATE:
+                if (num_operands < 4) {
+                    break;
+                }
+                if (operands[2] == DVR_SPV_DECORATION_OFFSET) {
+                    dvr_spv_get_member(spv, operands[0], operands[1])->offset = operands[3];
+                } else if (operands[2] == DVR_SPV_DECORATION_MATRIX_STRIDE) {
+                    dvr_spv_get_member(spv, operands[0], operands[1])->matrix_stride = operands[3];
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (result != UINT32_MAX) {
+            if (result >= spv->bound) {
+                return DVR_ERROR(dvr_none, "SPIR-V id out of bounds");
+            }
+            spv->ids[result].opcode = opcode;
+            spv->ids[result].offset = offset;
+        }
+        offset += num_words;
+    }
+
+    if (!has_entry_point) {
+        return DVR_ERROR(dvr_none, "SPIR-V module has no entry point");
+    }
+
+    // a WorkgroupSize constant overrides the execution mode, `local_size_x_id` declares one
+    for (u32 id = 0; id < spv->bound; id++) {
+        u32 opcode = spv->ids[id].opcode;
+        if ((opcode != DVR_SPV_OP_CONSTANT_COMPOSITE &&
+             opcode != DVR_SPV_OP_SPEC_CONSTANT_COMPOSITE) ||
+            !(spv->ids[id].flags & DVR_SPV_BUILT_IN) ||
+            spv->ids[id].built_in != DVR_SPV_BUILT_IN_WORKGROUP_SIZE ||
+            (spv->words[spv->ids[id].offset] >> 16) < 6) {
+            continue;
+        }
+
+        const u32* operands = dvr_spv_operands(spv, id);
+        for (u32 i = 0; i < 3; i++) {
+            u32 component = operands[2 + i];
+            reflection->workgroup_size[i] = dvr_spv_constant(spv, component);
+            if (component < spv->bound &&
+                spv->ids[component].opcode == DVR_SPV_OP_SPEC_CONSTANT &&
+                (spv->ids[component].flags & DVR_SPV_HAS_SPEC_ID)) {
+                reflection->workgroup_size_spec_ids[i] = spv->ids[component].spec_id;
+            }
+        }
+    }
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+/// Collect the interface variables, after every id is known.
+static DVR_RESULT(dvr_none) dvr_spv_reflect_variables(
+    dvr_spv* spv,
+    dvr_shader_reflection* reflection
+) {
+    u32 push_constant_begin = UINT32_MAX;
+    u32 push_constant_end = 0;
+
+    for (u32 id = 0; id < spv->bound; id++) {
+        if (spv->ids[id].opcode != DVR_SPV_OP_VARIABLE) {
+            continue;
+        }
+
+        const u32* operands = dvr_spv_operands(spv, id);
+        u32 pointer = operands[0];
+        u32 storage_class = operands[2];
+        if (pointer >= spv->bound || spv->ids[pointer].opcode != DVR_SPV_OP_TYPE_POINTER) {
+            return DVR_ERROR(dvr_none, "SPIR-V variable isn't a pointer");
+        }
+        u32 type = dvr_spv_operands(spv, pointer)[2];
+        if (type >= spv->bound) {
+            return DVR_ERROR(dvr_none, "invalid SPIR-V type id");
+        }
+
+        switch (storage_class) {
+            case DVR_SPV_STORAGE_UNIFORM_CONSTANT:
+            case DVR_SPV_STORAGE_UNIFORM:
+            case DVR_SPV_STORAGE_STORAGE_BUFFER: {
+                if (!(spv->ids[id].flags & DVR_SPV_HAS_BINDING)) {
+                    break;
+                }
+                if (reflection->num_bindings == DVR_SHADER_MAX_BINDINGS) {
+                    return DVR_ERROR(dvr_none, "too many descriptor bindings");
+                }
+
+                DVR_RESULT(dvr_shader_binding)
+                binding_res = dvr_spv_binding(spv, storage_class, type);
+                DVR_BUBBLE_INTO(dvr_none, binding_res);
+                dvr_shader_binding binding = DVR_UNWRAP(binding_res);
+                binding.set = spv->ids[id].set;
+                binding.binding = spv->ids[id].binding;
+                if (binding.set >= DVR_SHADER_MAX_DESCRIPTOR_SETS) {
+                    return DVR_ERROR(dvr_none, "descriptor set index too high");
+                }
+                reflection->bindings[reflection->num_bindings++] = binding;
+                break;
+            }
+            case DVR_SPV_STORAGE_PUSH_CONSTANT: {
+                if (spv->ids[type].opcode != DVR_SPV_OP_TYPE_STRUCT) {
+                    break;
+                }
+                u32 num_members = (spv->words[spv->ids[type].offset] >> 16) - 2;
+                const u32* members = dvr_spv_operands(spv, type) + 1;
+                for (u32 i = 0; i < num_members; i++) {
+                    dvr_spv_member* member = dvr_spv_get_member(spv, type, i);
+                    u32 size = dvr_spv_type_size(spv, members[i], member->matrix_stride, 0);
+                    if (member->offset < push_constant_begin) {
+                        push_constant_begin = member->offset;
+                    }
+                    if (member->offset + size > push_constant_end) {
+                        push_constant_end = member->offset + size;
+                    }
+                }
+                break;
+            }
+            case DVR_SPV_STORAGE_INPUT: {
+                if (reflection->stage != VK_SHADER_STAGE_VERTEX_BIT ||
+                    !(spv->ids[id].flags & DVR_SPV_HAS_LOCATION) ||
+                    (spv->ids[id].flags & DVR_SPV_BUILT_IN)) {
+                    break;
+                }
+                // matrices take a location per column
+                u32 num_locations = 1;
+                if (spv->ids[type].opcode == DVR_SPV_OP_TYPE_MATRIX) {
+                    num_locations = dvr_spv_operands(spv, type)[2];
+                    type = dvr_spv_operands(spv, type)[1];
+                    if (type >= spv->bound) {
+                        return DVR_ERROR(dvr_none, "invalid SPIR-V type id");
+                    }
+                }
+                for (u32 i = 0; i < num_locations; i++) {
+                    if (reflection->num_vertex_inputs == DVR_SHADER_MAX_VERTEX_INPUTS) {
+                        return DVR_ERROR(dvr_none, "too many vertex inputs");
+                    }
+                    reflection->vertex_inputs[reflection->num_vertex_inputs++] =
+                        (dvr_shader_vertex_input){
+                            .location = spv->ids[id].location + i,
+                            .format = dvr_spv_vertex_format(spv, type),
+                        };
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    if (push_constant_end > push_constant_begin) {
+        // push constant ranges are in multiples of 4 bytes
+        reflection->push_constant_offset = push_constant_begin & ~3u;
+        reflection->push_constant_size =
+            ((push_constant_end + 3u) & ~3u) - reflection->push_constant_offset;
+    }
+
+    qsort(
+        reflection->bindings,
+        reflection->num_bindings,
+        sizeof(dvr_shader_binding),
+        dvr_spv_compare_bindings
+    );
+    qsort(
+        reflection->vertex_inputs,
+        reflection->num_vertex_inputs,
+        sizeof(dvr_shader_vertex_input),
+        dvr_spv_compare_vertex_inputs
+    );
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_reflect_shader(dvr_range code, dvr_shader_reflection* reflection) {
+    *reflection = (dvr_shader_reflection){
+        .workgroup_size_spec_ids = { UINT32_MAX, UINT32_MAX, UINT32_MAX },
+    };
+
+    dvr_spv spv = {
+        .words = code.base,
+        .num_words = (u32)(code.size / sizeof(u32)),
+    };
+    if (spv.num_words < 5 || spv.words[0] != DVR_SPV_MAGIC) {
+        return DVR_ERROR(dvr_none, "not a SPIR-V module");
+    }
+
+    spv.bound = spv.words[3];
+    spv.ids = calloc(spv.bound, sizeof(dvr_spv_id));
+    if (spv.ids == NULL) {
+        return DVR_ERROR(dvr_none, "failed to allocate SPIR-V ids");
+    }
+
+    DVR_RESULT(dvr_none) res = dvr_spv_parse(&spv, reflection);
+    if (res.is_ok) {
+        res = dvr_spv_reflect_variables(&spv, reflection);
+    }
+
+    arrfree(spv.members);
+    free(spv.ids);
+
+    return res;
+}
@@ -0,0 +1,753 @@
+#include "dvr_shader_manager.h"
+
+#include "dvr_log.h"
+#include "dvr_utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include <stb/stb_ds.h>
+
+extern char** environ;
+
+// how long the watcher sleeps between checks for shutdown
+#define DVR_SHADER_MANAGER_POLL_MS 100
+// editors save with several writes and renames, compile once they settled
+#define DVR_SHADER_MANAGER_SETTLE_MS 30
+#define DVR_SHADER_MANAGER_MAX_ARGS 32
+
+typedef struct dvr_watched_source {
+    // guarded by the mutex, the watcher reads them while the main thread adds sources
+    char* path;
+    // file name in `path`, as inotify reports it for the watched directory
+    const char* name;
+    int watch;
+    VkShaderStageFlagBits stage;
+    bool dirty;
+
+    // only touched by the main thread, the latest successful compilation
+    dvr_shader_module module;
+    bool has_module;
+} dvr_watched_source;
+
+typedef struct dvr_compiled_source {
+    u32 source;
+    bool ok;
+    dvr_range spirv;
+    // NUL terminated compiler output
+    char* log;
+} dvr_compiled_source;
+
+typedef struct dvr_watched_pipeline {
+    bool compute;
+    dvr_pipeline pipeline;
+    dvr_compute_pipeline compute_pipeline;
+    // deep copies, the pointers of the descs point into the arrays below
+    dvr_pipeline_desc desc;
+    dvr_compute_pipeline_desc compute_desc;
+    dvr_pipeline_stage_desc stages[DVR_SHADER_MANAGER_MAX_STAGES];
+    char* entry_points[DVR_SHADER_MANAGER_MAX_STAGES];
+    void* specialization_entries[DVR_SHADER_MANAGER_MAX_STAGES];
+    void* specialization_data[DVR_SHADER_MANAGER_MAX_STAGES];
+    // index into the watched sources per stage, -1 when the stage isn't watched
+    i32 sources[DVR_SHADER_MANAGER_MAX_STAGES];
+    void* bindings;
+    void* attributes;
+    void* sample_mask;
+    void* desc_set_layouts;
+    void* push_constant_ranges;
+} dvr_watched_pipeline;
+
+static struct {
+    bool running;
+    bool quit;
+    int inotify;
+    mtx_t mutex;
+    thrd_t thread;
+    char* compiler;
+    char* output_dir;
+    char* args[DVR_SHADER_MANAGER_MAX_ARGS];
+    u32 num_args;
+    dvr_watched_source* sources;
+    // guarded by the mutex, handed to the main thread by `dvr_update_shaders`
+    dvr_compiled_source* compiled;
+    // only touched by the main thread
+    dvr_watched_pipeline* pipelines;
+} g_dvr_shader_manager;
+
+static const char* dvr_shader_stage_name(VkShaderStageFlagBits stage) {
+    switch (stage) {
+        case VK_SHADER_STAGE_VERTEX_BIT:
+            return "vert";
+        case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
+            return "tesc";
+        case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
+            return "tese";
+        case VK_SHADER_STAGE_GEOMETRY_BIT:
+            return "geom";
+        case VK_SHADER_STAGE_FRAGMENT_BIT:
+            return "frag";
+        case VK_SHADER_STAGE_COMPUTE_BIT:
+            return "comp";
+        default:
+            return NULL;
+    }
+}
+
+static void dvr_shader_manager_log(char** log, const char* text) {
+    usize size = strlen(text);
+    memcpy(arraddnptr(*log, size), text, size);
+}
+
+/// Run the compiler with its output piped into `log`, returns whether it succeeded.
+static bool dvr_shader_manager_spawn(char** argv, char** log) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        dvr_shader_manager_log(log, "failed to create the compiler output pipe");
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, pipe_fds[1]);
+
+    pid_t pid;
+    int spawn_result = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fds[1]);
+    if (spawn_result != 0) {
+        close(pipe_fds[0]);
+        dvr_shader_manager_log(log, "failed to start the compiler: ");
+        dvr_shader_manager_log(log, strerror(spawn_result));
+        return false;
+    }
+
+    char buffer[1024];
+    ssize_t read_size;
+    while ((read_size = read(pipe_fds[0], buffer, sizeof(buffer))) != 0) {
+        if (read_size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        memcpy(arraddnptr(*log, (usize)read_size), buffer, (usize)read_size);
+    }
+    close(pipe_fds[0]);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static dvr_compiled_source
+    dvr_shader_manager_compile(u32 source, const char* path, VkShaderStageFlagBits stage) {
+    dvr_compiled_source compiled = { .source = source };
+    char* log = NULL;
+
+    char stage_arg[32];
+    snprintf(stage_arg, sizeof(stage_arg), "-fshader-stage=%s", dvr_shader_stage_name(stage));
+    char output[4096];
+    snprintf(
+        output,
+        sizeof(output),
+        "%s/dvr_shader_%ld_%u.spv",
+        g_dvr_shader_manager.output_dir,
+        (long)getpid(),
+        source
+    );
+
+    char* argv[DVR_SHADER_MANAGER_MAX_ARGS + 6];
+    u32 argc = 0;
+    argv[argc++] = g_dvr_shader_manager.compiler;
+    argv[argc++] = stage_arg;
+    for (u32 i = 0; i < g_dvr_shader_manager.num_args; i++) {
+        argv[argc++] = g_dvr_shader_manager.args[i];
+    }
+    argv[argc++] = (char*)path;
+    argv[argc++] = "-o";
+    argv[argc++] = output;
+    argv[argc] = NULL;
+
+    if (dvr_shader_manager_spawn(argv, &log)) {
+        DVR_RESULT(dvr_range) spirv_res = dvr_read_file(output);
+        if (spirv_res.is_ok) {
+            compiled.ok = true;
+            compiled.spirv = DVR_UNWRAP(spirv_res);
+        } else {
+            dvr_shader_manager_log(&log, spirv_res.error.message);
+        }
+        unlink(output);
+    }
+
+    // the log is handed over as a plain malloc'd string
+    usize log_size = (usize)arrlen(log);
+    compiled.log = malloc(log_size + 1);
+    if (compiled.log != NULL) {
+        if (log_size > 0) {
+            memcpy(compiled.log, log, log_size);
+        }
+        compiled.log[log_size] = '\0';
+    }
+    arrfree(log);
+
+    return compiled;
+}
+
+/// Mark the sources matching a batch of inotify events, returns whether any matched.
+static bool dvr_shader_manager_mark_dirty(const char* events, ssize_t size) {
+    bool dirty = false;
+    mtx_lock(&g_dvr_shader_manager.mutex);
+    for (ssize_t offset = 0; offset < size;) {
+        const struct inotify_event* event = (const struct inotify_event*)&events[offset];
+        offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+        if (event->len == 0) {
+            continue;
+        }
+
+        for (usize i = 0; i < arrlenu(g_dvr_shader_manager.sources); i++) {
+            dvr_watched_source* source = &g_dvr_shader_manager.sources[i];
+            if (source->watch == event->wd && strcmp(source->name, event->name) == 0) {
+                source->dirty = true;
+                dirty = true;
+            }
+        }
+    }
+    mtx_unlock(&g_dvr_shader_manager.mutex);
+
+    return dirty;
+}
+
+static void dvr_shader_manager_compile_dirty(void) {
+    for (u32 i = 0;; i++) {
+        mtx_lock(&g_dvr_shader_manager.mutex);
+        if (i >= arrlenu(g_dvr_shader_manager.sources)) {
+            mtx_unlock(&g_dvr_shader_manager.mutex);
+            break;
+        }
+        dvr_watched_source* source = &g_dvr_shader_manager.sources[i];
+        bool dirty = source->dirty;
+        source->dirty = false;
+        // the array may grow while compiling
+        char* path = dirty ? strdup(source->path) : NULL;
+        VkShaderStageFlagBits stage = source->stage;
+        mtx_unlock(&g_dvr_shader_manager.mutex);
+
+        if (path == NULL) {
+            continue;
+        }
+
+        dvr_compiled_source compiled = dvr_shader_manager_compile(i, path, stage);
+        free(path);
+
+        mtx_lock(&g_dvr_shader_manager.mutex);
+        arrput(g_dvr_shader_manager.compiled, compiled);
+        mtx_unlock(&g_dvr_shader_manager.mutex);
+    }
+}
+
+static int dvr_shader_manager_worker(void* arg) {
+    (void)arg;
+
+    _Alignas(struct inotify_event) char events[4096];
+    bool pending = false;
+    while (true) {
+        mtx_lock(&g_dvr_shader_manager.mutex);
+        bool quit = g_dvr_shader_manager.quit;
+        mtx_unlock(&g_dvr_shader_manager.mutex);
+        if (quit) {
+            break;
+        }
+
+        struct pollfd poll_fd = {
+            .fd = g_dvr_shader_manager.inotify,
+            .events = POLLIN,
+        };
+        int timeout = pending ? DVR_SHADER_MANAGER_SETTLE_MS : DVR_SHADER_MANAGER_POLL_MS;
+        int ready = poll(&poll_fd, 1, timeout);
+        if (ready > 0) {
+            ssize_t size = read(g_dvr_shader_manager.inotify, events, sizeof(events));
+            if (size > 0 && dvr_shader_manager_mark_dirty(events, size)) {
+                pending = true;
+            }
+        } else if (ready == 0 && pending) {
+            pending = false;
+            dvr_shader_manager_compile_dirty();
+        }
+    }
+
+    return 0;
+}
+
+static void dvr_shader_manager_free_compiled(dvr_compiled_source* compiled) {
+    if (compiled->ok) {
+        dvr_free_file(compiled->spirv);
+    }
+    free(compiled->log);
+}
+
+DVR_RESULT(dvr_none) dvr_shader_manager_setup(dvr_shader_manager_desc* desc) {
+    if (g_dvr_shader_manager.running) {
+        return DVR_ERROR(dvr_none, "shader manager is already set up");
+    }
+    if (desc->num_args > DVR_SHADER_MANAGER_MAX_ARGS) {
+        return DVR_ERROR(dvr_none, "too many shader compiler arguments");
+    }
+
+    int inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify < 0) {
+        return DVR_ERROR(dvr_none, "failed to initialize inotify");
+    }
+
+    g_dvr_shader_manager.inotify = inotify;
+    g_dvr_shader_manager.quit = false;
+    g_dvr_shader_manager.compiler = strdup(desc->compiler != NULL ? desc->compiler : "glslc");
+    g_dvr_shader_manager.output_dir = strdup(desc->output_dir != NULL ? desc->output_dir : "/tmp");
+    g_dvr_shader_manager.num_args = desc->num_args;
+    for (u32 i = 0; i < desc->num_args; i++) {
+        g_dvr_shader_manager.args[i] = strdup(desc->args[i]);
+    }
+
+    if (mtx_init(&g_dvr_shader_manager.mutex, mtx_plain) != thrd_success) {
+        dvr_shader_manager_shutdown();
+        return DVR_ERROR(dvr_none, "failed to create shader manager mutex");
+    }
+    if (thrd_create(&g_dvr_shader_manager.thread, dvr_shader_manager_worker, NULL) !=
+        thrd_success) {
+        mtx_destroy(&g_dvr_shader_manager.mutex);
+        dvr_shader_manager_shutdown();
+        return DVR_ERROR(dvr_none, "failed to create shader manager thread");
+    }
+    g_dvr_shader_manager.running = true;
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+static void dvr_watched_pipeline_free(dvr_watched_pipeline* watched) {
+    for (u32 i = 0; i < DVR_SHADER_MANAGER_MAX_STAGES; i++) {
+        free(watched->entry_points[i]);
+        free(watched->specialization_entries[i]);
+        free(watched->specialization_data[i]);
+    }
+    free(watched->bindings);
+    free(watched->attributes);
+    free(watched->sample_mask);
+    free(watched->desc_set_layouts);
+    free(watched->push_constant_ranges);
+}
+
+void dvr_shader_manager_shutdown(void) {
+    if (g_dvr_shader_manager.running) {
+        mtx_lock(&g_dvr_shader_manager.mutex);
+        g_dvr_shader_manager.quit = true;
+        mtx_unlock(&g_dvr_shader_manager.mutex);
+        thrd_join(g_dvr_shader_manager.thread, NULL);
+        mtx_destroy(&g_dvr_shader_manager.mutex);
+    }
+
+    for (usize i = 0; i < arrlenu(g_dvr_shader_manager.compiled); i++) {
+        dvr_shader_manager_free_compiled(&g_dvr_shader_manager.compiled[i]);
+    }
+    for (usize i = 0; i < arrlenu(g_dvr_shader_manager.pipelines); i++) {
+        dvr_watched_pipeline_free(&g_dvr_shader_manager.pipelines[i]);
+    }
+    for (usize i = 0; i < arrlenu(g_dvr_shader_manager.sources); i++) {
+        dvr_watched_source* source = &g_dvr_shader_manager.sources[i];
+        if (source->has_module) {
+            dvr_destroy_shader_module(source->module);
+        }
+        free(source->path);
+    }
+    arrfree(g_dvr_shader_manager.compiled);
+    arrfree(g_dvr_shader_manager.pipelines);
+    arrfree(g_dvr_shader_manager.sources);
+
+    for (u32 i = 0; i < g_dvr_shader_manager.num_args; i++) {
+        free(g_dvr_shader_manager.args[i]);
+    }
+    free(g_dvr_shader_manager.compiler);
+    free(g_dvr_shader_manager.output_dir);
+    close(g_dvr_shader_manager.inotify);
+
+    g_dvr_shader_manager.compiler = NULL;
+    g_dvr_shader_manager.output_dir = NULL;
+    g_dvr_shader_manager.num_args = 0;
+    g_dvr_shader_manager.running = false;
+}
+
+/// Index of the watched source for `path`, watching its directory on first use. Directories
+/// are watched instead of files since editors often save by renaming a new file over the old.
+static DVR_RESULT(u32)
+    dvr_shader_manager_add_source(const char* path, VkShaderStageFlagBits stage) {
+    if (dvr_shader_stage_name(stage) == NULL) {
+        return DVR_ERROR(u32, "unsupported shader stage");
+    }
+
+    for (usize i = 0; i < arrlenu(g_dvr_shader_manager.sources); i++) {
+        dvr_watched_source* source = &g_dvr_shader_manager.sources[i];
+        if (source->stage == stage && strcmp(source->path, path) == 0) {
+            return DVR_OK(u32, (u32)i);
+        }
+    }
+
+    const char* slash = strrchr(path, '/');
+    char directory[4096];
+    if (slash == NULL) {
+        snprintf(directory, sizeof(directory), ".");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - path + 1), path);
+    }
+
+    int watch = inotify_add_watch(
+        g_dvr_shader_manager.inotify,
+        directory,
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE
+    );
+    if (watch < 0) {
+        return DVR_ERROR(u32, "failed to watch shader source directory");
+    }
+
+    char* owned_path = strdup(path);
+    dvr_watched_source source = {
+        .path = owned_path,
+        .name = slash == NULL ? owned_path : owned_path + (slash - path + 1),
+        .watch = watch,
+        .stage = stage,
+    };
+
+    mtx_lock(&g_dvr_shader_manager.mutex);
+    arrput(g_dvr_shader_manager.sources, source);
+    u32 index = (u32)arrlenu(g_dvr_shader_manager.sources) - 1;
+    mtx_unlock(&g_dvr_shader_manager.mutex);
+
+    return DVR_OK(u32, index);
+}
+
+static void* dvr_shader_manager_copy(const void* data, usize size) {
+    if (data == NULL || size == 0) {
+        return NULL;
+    }
+
+    void* copy = malloc(size);
+    if (copy != NULL) {
+        memcpy(copy, data, size);
+    }
+    return copy;
+}
+
+static dvr_specialization_desc dvr_shader_manager_copy_specialization(
+    dvr_watched_pipeline* watched,
+    u32 stage,
+    const dvr_specialization_desc* specialization
+) {
+    watched->specialization_entries[stage] = dvr_shader_manager_copy(
+        specialization->entries,
+        specialization->num_entries * sizeof(VkSpecializationMapEntry)
+    );
+    watched->specialization_data[stage] =
+        dvr_shader_manager_copy(specialization->data.base, specialization->data.size);
+
+    return (dvr_specialization_desc){
+        .num_entries = specialization->num_entries,
+        .entries = watched->specialization_entries[stage],
+        .data = {
+            .base = watched->specialization_data[stage],
+            .size = specialization->data.size,
+        },
+    };
+}
+
+DVR_RESULT(dvr_none) dvr_watch_pipeline(
+    dvr_pipeline pipeline,
+    const dvr_pipeline_desc* desc,
+    const char* const* sources
+) {
+    if (!g_dvr_shader_manager.running) {
+        return DVR_ERROR(dvr_none, "shader manager is not set up");
+    }
+    if (desc->num_stages > DVR_SHADER_MANAGER_MAX_STAGES) {
+        return DVR_ERROR(dvr_none, "pipeline has too many stages");
+    }
+
+    dvr_watched_pipeline watched = {
+        .pipeline = pipeline,
+        .desc = *desc,
+    };
+    for (u32 i = 0; i < DVR_SHADER_MANAGER_MAX_STAGES; i++) {
+        watched.sources[i] = -1;
+    }
+    for (u32 i = 0; i < desc->num_stages; i++) {
+        if (sources[i] == NULL) {
+            continue;
+        }
+
+        DVR_RESULT(u32)
+        source_res = dvr_shader_manager_add_source(sources[i], desc->stages[i].stage);
+        DVR_BUBBLE_INTO(dvr_none, source_res);
+        watched.sources[i] = (i32)DVR_UNWRAP(source_res);
+    }
+
+    for (u32 i = 0; i < desc->num_stages; i++) {
+        watched.stages[i] = desc->stages[i];
+        watched.entry_points[i] = strdup(desc->stages[i].entry_point);
+        watched.stages[i].entry_point = watched.entry_points[i];
+        watched.stages[i].specialization =
+            dvr_shader_manager_copy_specialization(&watched, i, &desc->stages[i].specialization);
+    }
+    watched.bindings = dvr_shader_manager_copy(
+        desc->vertex_input.bindings,
+        desc->vertex_input.num_bindings * sizeof(VkVertexInputBindingDescription)
+    );
+    watched.attributes = dvr_shader_manager_copy(
+        desc->vertex_input.attributes,
+        desc->vertex_input.num_attributes * sizeof(VkVertexInputAttributeDescription)
+    );
+    // one mask word per 32 samples
+    watched.sample_mask = dvr_shader_manager_copy(
+        desc->multisample.sample_mask,
+        ((desc->multisample.rasterization_samples + 31u) / 32u) * sizeof(VkSampleMask)
+    );
+    watched.desc_set_layouts = dvr_shader_manager_copy(
+        desc->layout.desc_set_layouts,
+        desc->layout.num_desc_set_layouts * sizeof(dvr_descriptor_set_layout)
+    );
+    watched.push_constant_ranges = dvr_shader_manager_copy(
+        desc->layout.push_constant_ranges,
+        desc->layout.num_push_constant_ranges * sizeof(VkPushConstantRange)
+    );
+
+    watched.desc.vertex_input.bindings = watched.bindings;
+    watched.desc.vertex_input.attributes = watched.attributes;
+    watched.desc.multisample.sample_mask = watched.sample_mask;
+    watched.desc.layout.desc_set_layouts = watched.desc_set_layouts;
+    watched.desc.layout.push_constant_ranges = watched.push_constant_ranges;
+    arrput(g_dvr_shader_manager.pipelines, watched);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+DVR_RESULT(dvr_none) dvr_watch_compute_pipeline(
+    dvr_compute_pipeline pipeline,
+    const dvr_compute_pipeline_desc* desc,
+    const char* source
+) {
+    if (!g_dvr_shader_manager.running) {
+        return DVR_ERROR(dvr_none, "shader manager is not set up");
+    }
+
+    DVR_RESULT(u32) source_res = dvr_shader_manager_add_source(source, VK_SHADER_STAGE_COMPUTE_BIT);
+    DVR_BUBBLE_INTO(dvr_none, source_res);
+
+    dvr_watched_pipeline watched = {
+        .compute = true,
+        .compute_pipeline = pipeline,
+        .compute_desc = *desc,
+        .entry_points = { strdup(desc->entry_point) },
+    };
+    for (u32 i = 0; i < DVR_SHADER_MANAGER_MAX_STAGES; i++) {
+        watched.sources[i] = -1;
+    }
+    watched.sources[0] = (i32)DVR_UNWRAP(source_res);
+    watched.desc_set_layouts = dvr_shader_manager_copy(
+        desc->desc_set_layouts,
+        desc->num_desc_set_layouts * sizeof(dvr_descriptor_set_layout)
+    );
+    watched.push_constant_ranges = dvr_shader_manager_copy(
+        desc->push_constant_ranges,
+        desc->num_push_constant_ranges * sizeof(VkPushConstantRange)
+    );
+
+    watched.compute_desc.entry_point = watched.entry_points[0];
+    watched.compute_desc.specialization =
+        dvr_shader_manager_copy_specialization(&watched, 0, &desc->specialization);
+    watched.compute_desc.desc_set_layouts = watched.desc_set_layouts;
+    watched.compute_desc.push_constant_ranges = watched.push_constant_ranges;
+    arrput(g_dvr_shader_manager.pipelines, watched);
+
+    return DVR_OK(dvr_none, DVR_NONE);
+}
+
+void dvr_unwatch_pipeline(dvr_pipeline pipeline) {
+    for (usize i = 0; i < arrlenu(g_dvr_shader_manager.pipelines); i++) {
+        dvr_watched_pipeline* watched = &g_dvr_shader_manager.pipelines[i];
+        if (!watched->compute && watched->pipeline.id == pipeline.id) {
+            dvr_watched_pipeline_free(watched);
+            arrdel(g_dvr_shader_manager.pipelines, i);
+            return;
+        }
+    }
+}
+
+void dvr_unwatch_compute_pipeline(dvr_compute_pipeline pipeline) {
+    for (usize i = 0; i < arrlenu(g_dvr_shader_manager.pipelines); i++) {
+        dvr_watched_pipeline* watched = &g_dvr_shader_manager.pipelines[i];
+        if (watched->compute && watched->compute_pipeline.id == pipeline.id) {
+            dvr_watched_pipeline_free(watched);
+            arrdel(g_dvr_shader_manager.pipelines, i);
+            return;
+        }
+    }
+}
+
+/// Recreate a pipeline with the latest module of every watched stage and swap it in.
+static DVR_RESULT(dvr_none) dvr_shader_manager_rebuild(dvr_watched_pipeline* watched) {
+    if (watched->compute) {
+        dvr_compute_pipeline_desc desc = watched->compute_desc;
+        desc.shader_module = g_dvr_shader_manager.sources[watched->sources[0]].module;
+
+        DVR_RESULT(dvr_compute_pipeline) pipeline_res = dvr_create_compute_pipeline(&desc);
+        DVR_BUBBLE_INTO(dvr_none, pipeline_res);
+        dvr_replace_compute_pipeline(watched->compute_pipeline, DVR_UNWRAP(pipeline_res));
+        return DVR_OK(dvr_none, DVR_NONE);
+    }
+
+    dvr_pipeline_stage_desc stages[DVR_SHADER_MANAGER_MAX_STAGES];
+    for (u32 i = 0; i < watched->desc.num_stages; i++) {
+        stages[i] = watched->stages[i];
+        if (watched->sources[i] >= 0 &&
+            g_dvr_shader_manager.sources[watched->sources[i]].has_module) {
+            stages[i].shader_module = g_dvr_shader_manager.sources[watched->sources[i]].module;
+        }
+    }
+    dvr_pipeline_desc desc = watched->desc;
+    desc.stages = stages;
+
+    DVR_RESULT(dvr_pipeline) pipeline_res = dvr_create_pipeline(&desc);
+    DVR_BUBBLE_INTO(dvr_none, pipeline_res);
+    dvr_pipeline replacement = DVR_UNWRAP(pipeline_res);
+
+    // an unchanged desc hits the cache, the extra reference has to be given back
+    DVR_RESULT(dvr_none) replace_res = dvr_replace_pipeline(watched->pipeline, replacement);
+    if (!replace_res.is_ok) {
+        dvr_destroy_pipeline(replacement);
+    }
+    return replace_res;
+}
+
+u32 dvr_update_shaders(void) {
+    if (!g_dvr_shader_manager.running) {
+        return 0;
+    }
+
+    mtx_lock(&g_dvr_shader_manager.mutex);
+    dvr_compiled_source* compiled = g_dvr_shader_manager.compiled;
+    g_dvr_shader_manager.compiled = NULL;
+    mtx_unlock(&g_dvr_shader_manager.mutex);
+
+    u32 num_replaced = 0;
+    for (usize i = 0; i < arrlenu(compiled); i++) {
+        dvr_watched_source* source = &g_dvr_shader_manager.sources[compiled[i].source];
+        if (!compiled[i].ok) {
+            DVRLOG_ERROR("failed to compile %s:\n%s", source->path, compiled[i].log);
+            dvr_shader_manager_free_compiled(&compiled[i]);
+            continue;
+        }
+
+        DVR_RESULT(dvr_shader_module)
+        module_res = dvr_create_shader_module(&(dvr_shader_module_desc){
+            .code = compiled[i].spirv,
+        });
+        dvr_shader_manager_free_compiled(&compiled[i]);
+        if (!module_res.is_ok) {
+            DVRLOG_ERROR("failed to reload %s: %s", source->path, module_res.error.message);
+            continue;
+        }
+
+        // pipelines don't reference their modules once created
+        if (source->has_module) {
+            dvr_destroy_shader_module(source->module);
+        }
+        source->module = DVR_UNWRAP(module_res);
+        source->has_module = true;
+
+        for (usize j = 0; j < arrlenu(g_dvr_shader_manager.pipelines); j++) {
+            dvr_watched_pipeline* watched = &g_dvr_shader_manager.pipelines[j];
+            bool uses_source = false;
+            for (u32 k = 0; k < DVR_SHADER_MANAGER_MAX_STAGES; k++) {
+                uses_source |= watched->sources[k] == (i32)compiled[i].source;
+            }
+            if (!uses_source) {
+                continue;
+            }
+
+            DVR_RESULT(dvr_none) res = dvr_shader_manager_rebuild(watched);
+            if (res.is_ok) {
+                num_replaced++;
+            } else {
+                DVRLOG_ERROR(
+                    "failed to recreate pipeline for %s: %s",
+                    source->path,
+                    res.error.message
+                );
+            }
+        }
+        DVRLOG_INFO("reloaded %s", source->path);
+    }
+    arrfree(compiled);
+
+    return num_replaced;
+}
+
+#else
+
+DVR_RESULT(dvr_none) dvr_shader_manager_setup(dvr_shader_manager_desc* desc) {
+    (void)desc;
+    return DVR_ERROR(dvr_none, "shader hot reload needs inotify, which is linux only");
+}
+
+void dvr_shader_manager_shutdown(void) {}
+
+DVR_RESULT(dvr_none) dvr_watch_pipeline(
+    dvr_pipeline pipeline,
+    const dvr_pipeline_desc* desc,
+    const char* const* sources
+) {
+    (void)pipeline;
+    (void)desc;
+    (void)sources;
+    return DVR_ERROR(dvr_none, "shader manager is not set up");
+}
+
+DVR_RESULT(dvr_none) dvr_watch_compute_pipeline(
+    dvr_compute_pipeline pipeline,
+    const dvr_compute_pipeline_desc* desc,
+    const char* source
+) {
+    (void)pipeline;
+    (void)desc;
+    (void)source;
+    return DVR_ERROR(dvr_none, "shader manager is not set up");
+}
+
+void dvr_unwatch_pipeline(dvr_pipeline pipeline) {
+    (void)pipeline;
+}
+
+void dvr_unwatch_compute_pipeline(dvr_compute_pipeline pipeline) {
+    (void)pipeline;
+}
+
+u32 dvr_update_shaders(void) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#version 450
+#pragma shader_stage(compute)
+
+// Culls one meshlet per workgroup against the frustum and its normal cone. The first
+// invocation reserves room for the indices of a visible meshlet in the compacted index buffer
+// with an atomic on the index count of the indirect draw, then the whole group copies them.
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct Meshlet {
+    vec4 sphere;
+    // axis and cutoff, see dvr_meshlet_bounds
+    vec4 cone;
+    uint first_index;
+    uint index_count;
+    uint pad0;
+    uint pad1;
+};
+
+layout(std430, binding = 0) readonly buffer Meshlets {
+    Meshlet meshlets[];
+};
+
+layout(std430, binding = 1) readonly buffer SourceIndices {
+    uint source_indices[];
+};
+
+layout(std430, binding = 2) writeonly buffer Indices {
+    uint indices[];
+};
+
+// VkDrawIndexedIndirectCommand
+layout(std430, binding = 3) buffer Draw {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+} draw;
+
+layout(push_constant) uniform PushConstants {
+    // normalized, in mesh space
+    vec4 planes[6];
+    // w enables cone culling
+    vec4 camera_position;
+    uint num_meshlets;
+} push_constants;
+
+shared uint base;
+
+bool visible(Meshlet meshlet)
+{
+    for (int i = 0; i < 6; i++) {
+        vec4 plane = push_constants.planes[i];
+        if (dot(plane.xyz, meshlet.sphere.xyz) + plane.w < -meshlet.sphere.w) {
+            return false;
+        }
+    }
+
+    if (push_constants.camera_position.w != 0.0) {
+        vec3 to_center = meshlet.sphere.xyz - push_constants.camera_position.xyz;
+        if (dot(to_center, meshlet.cone.xyz) >=
+            meshlet.cone.w * length(to_center) + meshlet.sphere.w) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void main()
+{
+    // large meshes spread their meshlets over a second dimension of workgroups
+    uint id = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    if (id >= push_constants.num_meshlets) {
+        return;
+    }
+
+    Meshlet meshlet = meshlets[id];
+    if (gl_LocalInvocationIndex == 0) {
+        base = visible(meshlet) ? atomicAdd(draw.index_count, meshlet.index_count) : ~0u;
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (base == ~0u) {
+        return;
+    }
+    for (uint i = gl_LocalInvocationIndex; i < meshlet.index_count; i += 64) {
+        indices[base + i] = source_indices[meshlet.first_index + i];
+    }
+}
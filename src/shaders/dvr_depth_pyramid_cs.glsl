@@ -0,0 +1,39 @@
+#version 450
+#pragma shader_stage(compute)
+
+// One level of the depth pyramid. Every texel keeps the farthest depth of the source texels
+// it covers, so a surface behind that depth is hidden everywhere under the texel. The first
+// level is reduced from the depth attachment, which is not a power of two, so footprints
+// cover up to three texels per axis.
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(binding = 0) uniform sampler2D src;
+layout(binding = 1, r32f) uniform writeonly image2D dst;
+
+layout(push_constant) uniform PushConstants {
+    uvec2 src_size;
+    uvec2 dst_size;
+} push_constants;
+
+void main()
+{
+    uvec2 texel = gl_GlobalInvocationID.xy;
+    if (any(greaterThanEqual(texel, push_constants.dst_size))) {
+        return;
+    }
+
+    uvec2 src_size = push_constants.src_size;
+    uvec2 dst_size = push_constants.dst_size;
+    uvec2 begin = texel * src_size / dst_size;
+    uvec2 end = max(((texel + 1u) * src_size + dst_size - 1u) / dst_size, begin + 1u);
+
+    float depth = 0.0;
+    for (uint y = begin.y; y < end.y; y++) {
+        for (uint x = begin.x; x < end.x; x++) {
+            depth = max(depth, texelFetch(src, ivec2(x, y), 0).r);
+        }
+    }
+
+    imageStore(dst, ivec2(texel), vec4(depth));
+}
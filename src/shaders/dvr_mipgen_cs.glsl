@@ -0,0 +1,101 @@
+#version 450
+#pragma shader_stage(compute)
+
+// Generates up to 6 mip levels below the source level in a single dispatch. Every workgroup
+// reduces a 64x64 tile of the source, the first two levels straight from the source and the
+// rest from shared memory, so only one barrier is needed per 6 levels.
+
+layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+
+layout(binding = 0) uniform sampler2D src;
+layout(binding = 1) uniform writeonly image2D dst[6];
+
+layout(push_constant) uniform PushConstants {
+    uint num_levels;
+    // the destination views are UNORM views of an sRGB image, encode manually
+    uint srgb;
+} push_constants;
+
+shared vec4 tile[16][16];
+
+vec4 encode(vec4 color)
+{
+    if (push_constants.srgb == 0) {
+        return color;
+    }
+
+    vec3 low = color.rgb * 12.92;
+    vec3 high = 1.055 * pow(color.rgb, vec3(1.0 / 2.4)) - 0.055;
+    return vec4(mix(high, low, lessThanEqual(color.rgb, vec3(0.0031308))), color.a);
+}
+
+// image arrays are only indexed with constants, dynamic indexing is an optional feature
+#define STORE_LEVEL(level, coords, color)                                                  \
+    if (all(lessThan(coords, imageSize(dst[level])))) {                                     \
+        imageStore(dst[level], coords, encode(color));                                      \
+    }
+
+void store(uint level, ivec2 coords, vec4 color)
+{
+    switch (level) {
+        case 0: STORE_LEVEL(0, coords, color); break;
+        case 1: STORE_LEVEL(1, coords, color); break;
+        case 2: STORE_LEVEL(2, coords, color); break;
+        case 3: STORE_LEVEL(3, coords, color); break;
+        case 4: STORE_LEVEL(4, coords, color); break;
+        case 5: STORE_LEVEL(5, coords, color); break;
+    }
+}
+
+vec4 fetch(ivec2 coords)
+{
+    return texelFetch(src, min(coords, textureSize(src, 0) - 1), 0);
+}
+
+void main()
+{
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 group = ivec2(gl_WorkGroupID.xy);
+
+    // first level, 32x32 per workgroup, every invocation reduces a 4x4 source block
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 2; x++) {
+            ivec2 coords = group * 32 + local * 2 + ivec2(x, y);
+            ivec2 s = coords * 2;
+            vec4 color = (fetch(s) + fetch(s + ivec2(1, 0)) + fetch(s + ivec2(0, 1)) +
+                          fetch(s + ivec2(1, 1))) * 0.25;
+            store(0, coords, color);
+            sum += color;
+        }
+    }
+
+    if (push_constants.num_levels < 2) {
+        return;
+    }
+
+    // second level, 16x16 per workgroup
+    vec4 color = sum * 0.25;
+    store(1, group * 16 + local, color);
+    tile[local.y][local.x] = color;
+
+    // remaining levels halve the active invocations each step
+    for (uint level = 2; level < 6; level++) {
+        int size = 32 >> level;
+        bool active = level < push_constants.num_levels && all(lessThan(local, ivec2(size)));
+
+        barrier();
+        if (active) {
+            ivec2 s = local * 2;
+            color = (tile[s.y][s.x] + tile[s.y][s.x + 1] + tile[s.y + 1][s.x] +
+                     tile[s.y + 1][s.x + 1]) * 0.25;
+        }
+
+        // everyone has read the previous level before it is overwritten
+        barrier();
+        if (active) {
+            tile[local.y][local.x] = color;
+            store(level, group * size + local, color);
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#version 450
+#pragma shader_stage(compute)
+
+// One instance per invocation. Instances outside the frustum or behind the depth pyramid of
+// the previous frame are dropped, the data of the others is compacted into the visible buffer
+// and counted into the instance count of every draw.
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(std140, binding = 0) uniform Cull {
+    vec4 planes[6];
+    // world to clip space of the frame the pyramid was built from
+    mat4 pyramid_view_proj;
+    vec2 pyramid_size;
+    uint pyramid_levels;
+    uint occlusion;
+    uint instance_count;
+    uint instance_words;
+    uint num_draws;
+} cull;
+
+layout(std430, binding = 1) readonly buffer Bounds {
+    vec4 spheres[];
+};
+
+layout(std430, binding = 2) readonly buffer Instances {
+    uint instances[];
+};
+
+layout(std430, binding = 3) writeonly buffer Visible {
+    uint visible[];
+};
+
+layout(std430, binding = 4) buffer Draws {
+    DrawCommand draws[];
+};
+
+layout(binding = 5) uniform sampler2D pyramid;
+
+bool occluded(vec4 sphere)
+{
+    // screen rectangle and nearest depth of the box around the sphere
+    vec2 rect_min = vec2(1.0);
+    vec2 rect_max = vec2(-1.0);
+    float nearest = 1.0;
+    for (uint i = 0; i < 8; i++) {
+        vec3 corner = vec3((i & 1u) != 0 ? 1.0 : -1.0,
+                           (i & 2u) != 0 ? 1.0 : -1.0,
+                           (i & 4u) != 0 ? 1.0 : -1.0);
+        vec4 clip = cull.pyramid_view_proj * vec4(sphere.xyz + sphere.w * corner, 1.0);
+        // crosses the near plane, the rectangle is unbounded
+        if (clip.w <= 1e-5) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        rect_min = min(rect_min, ndc.xy);
+        rect_max = max(rect_max, ndc.xy);
+        nearest = min(nearest, ndc.z);
+    }
+
+    // nothing is known about what was outside the previous view
+    if (any(lessThan(rect_min, vec2(-1.0))) || any(greaterThan(rect_max, vec2(1.0)))) {
+        return false;
+    }
+
+    vec2 uv_min = rect_min * 0.5 + 0.5;
+    vec2 uv_max = rect_max * 0.5 + 0.5;
+
+    // the level where the rectangle spans at most 2x2 texels
+    vec2 extent = (uv_max - uv_min) * cull.pyramid_size;
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    level = min(level, int(cull.pyramid_levels) - 1);
+
+    ivec2 size = textureSize(pyramid, level);
+    ivec2 texel_min = clamp(ivec2(uv_min * vec2(size)), ivec2(0), size - 1);
+    ivec2 texel_max = clamp(ivec2(uv_max * vec2(size)), ivec2(0), size - 1);
+
+    float farthest = 0.0;
+    for (int y = texel_min.y; y <= texel_max.y; y++) {
+        for (int x = texel_min.x; x <= texel_max.x; x++) {
+            farthest = max(farthest, texelFetch(pyramid, ivec2(x, y), level).r);
+        }
+    }
+
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= cull.instance_count) {
+        return;
+    }
+
+    vec4 sphere = spheres[index];
+    for (uint i = 0; i < 6; i++) {
+        if (dot(cull.planes[i].xyz, sphere.xyz) + cull.planes[i].w < -sphere.w) {
+            return;
+        }
+    }
+
+    if (cull.occlusion != 0 && occluded(sphere)) {
+        return;
+    }
+
+    uint slot = atomicAdd(draws[0].instance_count, 1u);
+    for (uint i = 1; i < cull.num_draws; i++) {
+        atomicAdd(draws[i].instance_count, 1u);
+    }
+
+    uint words = cull.instance_words;
+    for (uint i = 0; i < words; i++) {
+        visible[slot * words + i] = instances[index * words + i];
+    }
+}
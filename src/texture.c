@@ -0,0 +1,204 @@
+#include "dvr_texture.h"
+
+#include <string.h>
+
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+static const u8 dvr_ktx2_identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A,
+};
+
+typedef struct dvr_ktx2_header {
+    u8 identifier[12];
+    u32 vk_format;
+    u32 type_size;
+    u32 pixel_width;
+    u32 pixel_height;
+    u32 pixel_depth;
+    u32 layer_count;
+    u32 face_count;
+    u32 level_count;
+    u32 supercompression_scheme;
+    u32 dfd_byte_offset;
+    u32 dfd_byte_length;
+    u32 kvd_byte_offset;
+    u32 kvd_byte_length;
+    u64 sgd_byte_offset;
+    u64 sgd_byte_length;
+} dvr_ktx2_header;
+
+typedef struct dvr_ktx2_level {
+    u64 byte_offset;
+    u64 byte_length;
+    u64 uncompressed_byte_length;
+} dvr_ktx2_level;
+
+// the container is little endian and tightly packed, so both structs map onto it directly on
+// the platforms dvr supports
+_Static_assert(sizeof(dvr_ktx2_header) == 80, "unexpected padding in dvr_ktx2_header");
+_Static_assert(sizeof(dvr_ktx2_level) == 24, "unexpected padding in dvr_ktx2_level");
+_Static_assert(sizeof(dvr_dvrt_header) == 24, "unexpected padding in dvr_dvrt_header");
+_Static_assert(sizeof(dvr_dvrt_level) == 16, "unexpected padding in dvr_dvrt_level");
+
+DVR_RESULT(dvr_texture_file) dvr_parse_ktx2(dvr_range file) {
+    const u8* bytes = file.base;
+    usize header_end = sizeof(dvr_ktx2_header);
+    if (file.size < header_end) {
+        return DVR_ERROR(dvr_texture_file, "not a KTX2 file");
+    }
+
+    dvr_ktx2_header header;
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.identifier, dvr_ktx2_identifier, sizeof(dvr_ktx2_identifier)) != 0) {
+        return DVR_ERROR(dvr_texture_file, "not a KTX2 file");
+    }
+
+    if (header.vk_format == VK_FORMAT_UNDEFINED) {
+        return DVR_ERROR(dvr_texture_file, "KTX2 files without a Vulkan format are unsupported");
+    }
+    if (header.supercompression_scheme != 0) {
+        return DVR_ERROR(dvr_texture_file, "supercompressed KTX2 files are unsupported");
+    }
+    if (header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth > 1 ||
+        header.layer_count > 1 || header.face_count != 1) {
+        return DVR_ERROR(dvr_texture_file, "only single 2D KTX2 textures are supported");
+    }
+
+    // a level count of 0 asks the loader to generate the mip chain
+    u32 level_count = header.level_count > 0 ? header.level_count : 1;
+    if (level_count > DVR_TEXTURE_MAX_LEVELS) {
+        return DVR_ERROR(dvr_texture_file, "KTX2 file has too many levels");
+    }
+    if (file.size < header_end + level_count * sizeof(dvr_ktx2_level)) {
+        return DVR_ERROR(dvr_texture_file, "KTX2 level index is truncated");
+    }
+
+    dvr_texture_file texture = {
+        .file = file,
+        .format = (VkFormat)header.vk_format,
+        .width = header.pixel_width,
+        .height = header.pixel_height,
+        .mip_levels = level_count,
+        .generate_mipmaps = header.level_count == 0 &&
+                            !dvr_format_is_block_compressed((VkFormat)header.vk_format),
+    };
+
+    for (u32 i = 0; i < level_count; i++) {
+        dvr_ktx2_level level;
+        memcpy(&level, bytes + header_end + i * sizeof(level), sizeof(level));
+        if (level.byte_offset > file.size || level.byte_length > file.size - level.byte_offset) {
+            return DVR_ERROR(dvr_texture_file, "KTX2 level lies outside of the file");
+        }
+
+        u32 level_width = header.pixel_width >> i ? header.pixel_width >> i : 1;
+        u32 level_height = header.pixel_height >> i ? header.pixel_height >> i : 1;
+        if (level.byte_length != dvr_image_level_size(texture.format, level_width, level_height)) {
+            return DVR_ERROR(dvr_texture_file, "KTX2 level size doesn't match its format");
+        }
+
+        texture.levels[i] = (dvr_image_level){
+            .offset = (usize)level.byte_offset,
+            .size = (usize)level.byte_length,
+        };
+    }
+
+    return DVR_OK(dvr_texture_file, texture);
+}
+
+DVR_RESULT(dvr_texture_file) dvr_parse_dvrt(dvr_range file) {
+    const u8* bytes = file.base;
+    if (file.size < sizeof(dvr_dvrt_header)) {
+        return DVR_ERROR(dvr_texture_file, "not a DVRT file");
+    }
+
+    dvr_dvrt_header header;
+    memcpy(&header, bytes, sizeof(header));
+    if (header.magic != DVR_DVRT_MAGIC) {
+        return DVR_ERROR(dvr_texture_file, "not a DVRT file");
+    }
+    if (header.version != DVR_DVRT_VERSION) {
+        return DVR_ERROR(dvr_texture_file, "unsupported DVRT version, recook the texture");
+    }
+    if (header.width == 0 || header.height == 0 || header.mip_levels == 0 ||
+        header.mip_levels > DVR_TEXTURE_MAX_LEVELS) {
+        return DVR_ERROR(dvr_texture_file, "invalid DVRT header");
+    }
+    if (file.size < sizeof(header) + header.mip_levels * sizeof(dvr_dvrt_level)) {
+        return DVR_ERROR(dvr_texture_file, "DVRT level table is truncated");
+    }
+
+    dvr_texture_file texture = {
+        .file = file,
+        .format = (VkFormat)header.format,
+        .width = header.width,
+        .height = header.height,
+        .mip_levels = header.mip_levels,
+    };
+
+    for (u32 i = 0; i < header.mip_levels; i++) {
+        dvr_dvrt_level level;
+        memcpy(&level, bytes + sizeof(header) + i * sizeof(level), sizeof(level));
+        if (level.offset > file.size || level.size > file.size - level.offset) {
+            return DVR_ERROR(dvr_texture_file, "DVRT level lies outside of the file");
+        }
+
+        u32 level_width = header.width >> i ? header.width >> i : 1;
+        u32 level_height = header.height >> i ? header.height >> i : 1;
+        if (level.size != dvr_image_level_size(texture.format, level_width, level_height)) {
+            return DVR_ERROR(dvr_texture_file, "DVRT level size doesn't match its format");
+        }
+
+        texture.levels[i] = (dvr_image_level){
+            .offset = (usize)level.offset,
+            .size = (usize)level.size,
+        };
+    }
+
+    return DVR_OK(dvr_texture_file, texture);
+}
+
+DVR_RESULT(dvr_texture_file) dvr_parse_texture(dvr_range file) {
+    if (file.size >= sizeof(u32)) {
+        u32 magic;
+        memcpy(&magic, file.base, sizeof(magic));
+        if (magic == DVR_DVRT_MAGIC) {
+            return dvr_parse_dvrt(file);
+        }
+    }
+
+    return dvr_parse_ktx2(file);
+}
+
+DVR_RESULT(dvr_image) dvr_create_image_from_texture(const dvr_texture_file* texture) {
+    return dvr_create_image(&(dvr_image_desc){
+        .width = texture->width,
+        .height = texture->height,
+        .data = texture->file,
+        .generate_mipmaps = texture->generate_mipmaps,
+        .mip_levels = texture->generate_mipmaps ? 0 : texture->mip_levels,
+        .levels = texture->levels,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+        .format = texture->format,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+    });
+}
+
+DVR_RESULT(dvr_image) dvr_load_texture_from_memory(dvr_range data) {
+    DVR_RESULT(dvr_texture_file) texture_res = dvr_parse_texture(data);
+    DVR_BUBBLE_INTO(dvr_image, texture_res);
+
+    dvr_texture_file texture = DVR_UNWRAP(texture_res);
+    return dvr_create_image_from_texture(&texture);
+}
+
+DVR_RESULT(dvr_image) dvr_load_texture(const char* path) {
+    // the levels are copied once, from the mapping into the staging buffer
+    DVR_RESULT(dvr_mapped_file) file_res = dvr_map_file(path, 0, 0, DVR_FILE_ACCESS_SEQUENTIAL);
+    DVR_BUBBLE_INTO(dvr_image, file_res);
+    dvr_mapped_file file = DVR_UNWRAP(file_res);
+
+    DVR_RESULT(dvr_image) image_res = dvr_load_texture_from_memory(file.range);
+    dvr_unmap_file(&file);
+
+    return image_res;
+}
@@ -5,14 +5,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#define dvr_fseek64 _fseeki64
+#define dvr_ftell64 _ftelli64
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define dvr_fseek64 fseeko
+#define dvr_ftell64 ftello
+#endif
+
 DVR_RESULT(dvr_range) dvr_read_file(const char* path) {
     FILE* file = fopen(path, "rb");
     if (file == NULL) {
         return DVR_ERROR(dvr_range, "failed to open file");
     }
 
-    fseek(file, 0, SEEK_END);
-    usize file_size = (usize)ftell(file);
+    if (dvr_fseek64(file, 0, SEEK_END) != 0) {
+        fclose(file);
+        return DVR_ERROR(dvr_range, "failed to seek file");
+    }
+    usize file_size = (usize)dvr_ftell64(file);
     rewind(file);
 
     char* buffer = malloc(file_size);
@@ -37,13 +53,13 @@ DVR_RESULT(dvr_range) dvr_read_file(const char* path) {
     return DVR_OK(dvr_range, range);
 }
 
-DVR_RESULT(dvr_range) dvr_read_file_range(const char* path, usize offset, usize size) {
+DVR_RESULT(dvr_range) dvr_read_file_range(const char* path, u64 offset, usize size) {
     FILE* file = fopen(path, "rb");
     if (file == NULL) {
         return DVR_ERROR(dvr_range, "failed to open file");
     }
 
-    if (fseek(file, (u32)offset, SEEK_SET) != 0) {
+    if (dvr_fseek64(file, (i64)offset, SEEK_SET) != 0) {
         fclose(file);
         return DVR_ERROR(dvr_range, "failed to seek file");
     }
@@ -73,3 +89,149 @@ DVR_RESULT(dvr_range) dvr_read_file_range(const char* path, usize offset, usize
 void dvr_free_file(dvr_range range) {
     free(range.base);
 }
+
+#ifdef _WIN32
+DVR_RESULT(dvr_mapped_file)
+dvr_map_file(const char* path, u64 offset, u64 size, dvr_file_access access) {
+    // the memory manager does its own read-ahead, there is no hint to forward
+    (void)access;
+
+    HANDLE file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return DVR_ERROR(dvr_mapped_file, "failed to open file");
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return DVR_ERROR(dvr_mapped_file, "failed to query file size");
+    }
+    if (size == 0) {
+        size = offset < (u64)file_size.QuadPart ? (u64)file_size.QuadPart - offset : 0;
+    }
+    if (size == 0 || offset + size > (u64)file_size.QuadPart) {
+        CloseHandle(file);
+        return DVR_ERROR(dvr_mapped_file, "mapped range lies outside of the file");
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        return DVR_ERROR(dvr_mapped_file, "failed to create file mapping");
+    }
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    u64 aligned_offset = offset & ~((u64)system_info.dwAllocationGranularity - 1);
+    usize mapping_size = (usize)(size + offset - aligned_offset);
+
+    void* view = MapViewOfFile(
+        mapping,
+        FILE_MAP_READ,
+        (DWORD)(aligned_offset >> 32),
+        (DWORD)(aligned_offset & 0xFFFFFFFF),
+        mapping_size
+    );
+    // the view keeps the mapping object alive
+    CloseHandle(mapping);
+    if (view == NULL) {
+        return DVR_ERROR(dvr_mapped_file, "failed to map file");
+    }
+
+    dvr_mapped_file mapped = {
+        .range = {
+            .base = (u8*)view + (offset - aligned_offset),
+            .size = (usize)size,
+        },
+        .mapping = view,
+        .mapping_size = mapping_size,
+    };
+
+    return DVR_OK(dvr_mapped_file, mapped);
+}
+
+void dvr_unmap_file(dvr_mapped_file* file) {
+    if (file->mapping != NULL) {
+        UnmapViewOfFile(file->mapping);
+    }
+    *file = (dvr_mapped_file){};
+}
+#else
+DVR_RESULT(dvr_mapped_file)
+dvr_map_file(const char* path, u64 offset, u64 size, dvr_file_access access) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return DVR_ERROR(dvr_mapped_file, "failed to open file");
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return DVR_ERROR(dvr_mapped_file, "failed to query file size");
+    }
+    u64 file_size = (u64)file_stat.st_size;
+    if (size == 0) {
+        size = offset < file_size ? file_size - offset : 0;
+    }
+    if (size == 0 || offset + size > file_size) {
+        close(fd);
+        return DVR_ERROR(dvr_mapped_file, "mapped range lies outside of the file");
+    }
+
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+    u64 aligned_offset = offset & ~(page_size - 1);
+    usize mapping_size = (usize)(size + offset - aligned_offset);
+
+    void* mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, fd, (off_t)aligned_offset);
+    // the mapping holds its own reference to the file
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return DVR_ERROR(dvr_mapped_file, "failed to map file");
+    }
+
+    int advice = POSIX_MADV_NORMAL;
+    switch (access) {
+        case DVR_FILE_ACCESS_NORMAL:
+            break;
+        case DVR_FILE_ACCESS_SEQUENTIAL:
+            advice = POSIX_MADV_SEQUENTIAL;
+            break;
+        case DVR_FILE_ACCESS_RANDOM:
+            advice = POSIX_MADV_RANDOM;
+            break;
+        case DVR_FILE_ACCESS_WILLNEED:
+            advice = POSIX_MADV_WILLNEED;
+            break;
+    }
+    // only a hint, failing to apply it doesn't affect the mapping
+    if (advice != POSIX_MADV_NORMAL) {
+        posix_madvise(mapping, mapping_size, advice);
+    }
+
+    dvr_mapped_file mapped = {
+        .range = {
+            .base = (u8*)mapping + (offset - aligned_offset),
+            .size = (usize)size,
+        },
+        .mapping = mapping,
+        .mapping_size = mapping_size,
+    };
+
+    return DVR_OK(dvr_mapped_file, mapped);
+}
+
+void dvr_unmap_file(dvr_mapped_file* file) {
+    if (file->mapping != NULL) {
+        munmap(file->mapping, file->mapping_size);
+    }
+    *file = (dvr_mapped_file){};
+}
+#endif
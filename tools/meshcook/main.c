@@ -0,0 +1,748 @@
+/// dvr_meshcook: offline mesh cooker
+///
+/// Imports a mesh with assimp, flattens every triangle mesh of the scene into one vertex and
+/// index pool, reorders it for the vertex cache, overdraw and vertex fetch, simplifies it into a
+/// chain of LODs, packs the attributes into quantized formats and writes a DVRM file, which
+/// `dvr_load_mesh` copies into buffers without any parsing at runtime.
+
+#include "dvr_mesh.h"
+#include "dvr_meshopt.h"
+#include "dvr_quantize.h"
+#include "dvr_utils.h"
+
+#include <assimp/cimport.h>
+#include <assimp/mesh.h>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MESHCOOK_DEFAULT_LODS 4
+/// Largest error a LOD may add over the previous one, relative to the mesh extent.
+#define MESHCOOK_LOD_MAX_ERROR 0.05f
+
+typedef enum meshcook_layout {
+    /// All attributes in one stream.
+    MESHCOOK_LAYOUT_INTERLEAVED,
+    /// One stream per attribute.
+    MESHCOOK_LAYOUT_SOA,
+} meshcook_layout;
+
+typedef struct meshcook_options {
+    const char* input;
+    const char* output;
+    meshcook_layout layout;
+    bool colors;
+    bool normals;
+    bool index32;
+    bool optimize;
+    bool quantize;
+    /// Including the full detail one.
+    u32 lods;
+} meshcook_options;
+
+/// Tightly packed elements of one vertex attribute.
+typedef struct meshcook_attribute {
+    bool present;
+    VkFormat format;
+    u32 size;
+    u8* data;
+} meshcook_attribute;
+
+typedef struct meshcook_mesh {
+    u32 num_vertices;
+    u32 num_indices;
+    meshcook_attribute attributes[DVR_MESH_ATTRIBUTE_COUNT];
+    /// Relative to the vertex offset of their submesh.
+    u32* indices;
+    u32 num_submeshes;
+    dvr_dvrm_submesh* submeshes;
+    u32 num_lods;
+    dvr_dvrm_lod* lods;
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+    dvr_position_quantization position_quantization;
+} meshcook_mesh;
+
+static usize meshcook_align(usize offset) {
+    return (offset + DVR_DVRM_ALIGNMENT - 1) & ~(usize)(DVR_DVRM_ALIGNMENT - 1);
+}
+
+static void meshcook_bounds_reset(f32 min[3], f32 max[3]) {
+    for (u32 i = 0; i < 3; i++) {
+        min[i] = FLT_MAX;
+        max[i] = -FLT_MAX;
+    }
+}
+
+static void meshcook_bounds_add(f32 min[3], f32 max[3], const f32 p[3]) {
+    for (u32 i = 0; i < 3; i++) {
+        min[i] = p[i] < min[i] ? p[i] : min[i];
+        max[i] = p[i] > max[i] ? p[i] : max[i];
+    }
+}
+
+static void meshcook_init_attribute(meshcook_attribute* attribute, VkFormat format, u32 size) {
+    attribute->present = true;
+    attribute->format = format;
+    attribute->size = size;
+}
+
+static bool meshcook_import(const meshcook_options* options, meshcook_mesh* out) {
+    u32 flags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs |
+                aiProcess_SortByPType;
+    if (options->normals) {
+        flags |= aiProcess_GenSmoothNormals;
+    }
+
+    const struct aiScene* scene = aiImportFile(options->input, flags);
+    if (scene == NULL) {
+        fprintf(stderr, "failed to import %s: %s\n", options->input, aiGetErrorString());
+        return false;
+    }
+
+    // points and lines are split off by SortByPType and dropped
+    bool uvs = false;
+    for (u32 i = 0; i < scene->mNumMeshes; i++) {
+        const struct aiMesh* mesh = scene->mMeshes[i];
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) {
+            continue;
+        }
+        out->num_vertices += mesh->mNumVertices;
+        out->num_indices += mesh->mNumFaces * 3;
+        out->num_submeshes++;
+        uvs |= mesh->mTextureCoords[0] != NULL;
+    }
+    if (out->num_submeshes == 0) {
+        fprintf(stderr, "%s has no triangles\n", options->input);
+        aiReleaseImport(scene);
+        return false;
+    }
+
+    meshcook_attribute* attributes = out->attributes;
+    meshcook_init_attribute(
+        &attributes[DVR_MESH_ATTRIBUTE_POSITION],
+        VK_FORMAT_R32G32B32_SFLOAT,
+        3 * sizeof(f32)
+    );
+    if (options->colors) {
+        meshcook_init_attribute(
+            &attributes[DVR_MESH_ATTRIBUTE_COLOR],
+            VK_FORMAT_R8G8B8A8_UNORM,
+            4 * sizeof(u8)
+        );
+    }
+    if (uvs) {
+        meshcook_init_attribute(
+            &attributes[DVR_MESH_ATTRIBUTE_UV],
+            VK_FORMAT_R32G32_SFLOAT,
+            2 * sizeof(f32)
+        );
+    }
+    if (options->normals) {
+        meshcook_init_attribute(
+            &attributes[DVR_MESH_ATTRIBUTE_NORMAL],
+            VK_FORMAT_R32G32B32_SFLOAT,
+            3 * sizeof(f32)
+        );
+    }
+    for (u32 i = 0; i < DVR_MESH_ATTRIBUTE_COUNT; i++) {
+        if (attributes[i].present) {
+            attributes[i].data = calloc(out->num_vertices, attributes[i].size);
+        }
+    }
+
+    out->indices = malloc(out->num_indices * sizeof(u32));
+    out->submeshes = calloc(out->num_submeshes, sizeof(dvr_dvrm_submesh));
+    meshcook_bounds_reset(out->bounds_min, out->bounds_max);
+
+    u32 vertex_offset = 0;
+    u32 first_index = 0;
+    u32 submesh_index = 0;
+    for (u32 i = 0; i < scene->mNumMeshes; i++) {
+        const struct aiMesh* mesh = scene->mMeshes[i];
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) {
+            continue;
+        }
+
+        dvr_dvrm_submesh* submesh = &out->submeshes[submesh_index++];
+        *submesh = (dvr_dvrm_submesh){
+            .first_index = first_index,
+            .index_count = mesh->mNumFaces * 3,
+            .vertex_offset = vertex_offset,
+            .vertex_count = mesh->mNumVertices,
+        };
+        meshcook_bounds_reset(submesh->bounds_min, submesh->bounds_max);
+
+        for (u32 j = 0; j < mesh->mNumVertices; j++) {
+            usize vertex = vertex_offset + j;
+
+            f32 position[3] = { mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z };
+            memcpy(
+                attributes[DVR_MESH_ATTRIBUTE_POSITION].data + vertex * sizeof(position),
+                position,
+                sizeof(position)
+            );
+            meshcook_bounds_add(submesh->bounds_min, submesh->bounds_max, position);
+
+            if (attributes[DVR_MESH_ATTRIBUTE_COLOR].present) {
+                u8 color[4] = { 255, 255, 255, 255 };
+                if (mesh->mColors[0] != NULL) {
+                    const struct aiColor4D* c = &mesh->mColors[0][j];
+                    f32 channels[4] = { c->r, c->g, c->b, c->a };
+                    for (u32 k = 0; k < 4; k++) {
+                        color[k] = dvr_quantize_unorm8(channels[k]);
+                    }
+                }
+                memcpy(
+                    attributes[DVR_MESH_ATTRIBUTE_COLOR].data + vertex * sizeof(color),
+                    color,
+                    sizeof(color)
+                );
+            }
+
+            if (attributes[DVR_MESH_ATTRIBUTE_UV].present && mesh->mTextureCoords[0] != NULL) {
+                f32 uv[2] = { mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y };
+                memcpy(
+                    attributes[DVR_MESH_ATTRIBUTE_UV].data + vertex * sizeof(uv),
+                    uv,
+                    sizeof(uv)
+                );
+            }
+
+            if (attributes[DVR_MESH_ATTRIBUTE_NORMAL].present && mesh->mNormals != NULL) {
+                f32 normal[3] = { mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z };
+                memcpy(
+                    attributes[DVR_MESH_ATTRIBUTE_NORMAL].data + vertex * sizeof(normal),
+                    normal,
+                    sizeof(normal)
+                );
+            }
+        }
+
+        for (u32 j = 0; j < mesh->mNumFaces; j++) {
+            for (u32 k = 0; k < 3; k++) {
+                out->indices[first_index + j * 3 + k] = mesh->mFaces[j].mIndices[k];
+            }
+        }
+
+        meshcook_bounds_add(out->bounds_min, out->bounds_max, submesh->bounds_min);
+        meshcook_bounds_add(out->bounds_min, out->bounds_max, submesh->bounds_max);
+        vertex_offset += mesh->mNumVertices;
+        first_index += mesh->mNumFaces * 3;
+    }
+
+    aiReleaseImport(scene);
+    return true;
+}
+
+/// Reorder every submesh on its own, vertices no submesh references are dropped.
+static void meshcook_optimize(meshcook_mesh* mesh) {
+    dvr_vertex_cache_stats before = { 0 };
+    dvr_vertex_cache_stats after = { 0 };
+
+    u32* remap = malloc((mesh->num_vertices > 0 ? mesh->num_vertices : 1) * sizeof(u32));
+    u8* optimized[DVR_MESH_ATTRIBUTE_COUNT] = { 0 };
+    for (u32 i = 0; i < DVR_MESH_ATTRIBUTE_COUNT; i++) {
+        if (mesh->attributes[i].present) {
+            optimized[i] = malloc((usize)mesh->num_vertices * mesh->attributes[i].size);
+        }
+    }
+
+    const meshcook_attribute* positions = &mesh->attributes[DVR_MESH_ATTRIBUTE_POSITION];
+    u32 vertex_offset = 0;
+    for (u32 i = 0; i < mesh->num_submeshes; i++) {
+        dvr_dvrm_submesh* submesh = &mesh->submeshes[i];
+        u32* indices = &mesh->indices[submesh->first_index];
+
+        dvr_vertex_cache_stats stats = dvr_analyze_vertex_cache(
+            indices,
+            submesh->index_count,
+            submesh->vertex_count,
+            DVR_VERTEX_CACHE_SIZE
+        );
+        before.vertices_transformed += stats.vertices_transformed;
+
+        dvr_optimize_vertex_cache(indices, indices, submesh->index_count, submesh->vertex_count);
+        dvr_optimize_overdraw(
+            indices,
+            indices,
+            submesh->index_count,
+            (const f32*)(positions->data + (usize)submesh->vertex_offset * positions->size),
+            submesh->vertex_count,
+            positions->size,
+            DVR_OVERDRAW_THRESHOLD
+        );
+
+        u32 used = (u32)dvr_optimize_vertex_fetch_remap(
+            remap,
+            indices,
+            submesh->index_count,
+            submesh->vertex_count
+        );
+        dvr_remap_index_buffer(indices, indices, submesh->index_count, remap);
+        for (u32 j = 0; j < DVR_MESH_ATTRIBUTE_COUNT; j++) {
+            const meshcook_attribute* attribute = &mesh->attributes[j];
+            if (attribute->present) {
+                dvr_remap_vertex_buffer(
+                    optimized[j] + (usize)vertex_offset * attribute->size,
+                    attribute->data + (usize)submesh->vertex_offset * attribute->size,
+                    submesh->vertex_count,
+                    attribute->size,
+                    remap
+                );
+            }
+        }
+
+        stats = dvr_analyze_vertex_cache(
+            indices,
+            submesh->index_count,
+            used,
+            DVR_VERTEX_CACHE_SIZE
+        );
+        after.vertices_transformed += stats.vertices_transformed;
+
+        submesh->vertex_offset = vertex_offset;
+        submesh->vertex_count = used;
+        vertex_offset += used;
+    }
+
+    for (u32 i = 0; i < DVR_MESH_ATTRIBUTE_COUNT; i++) {
+        if (mesh->attributes[i].present) {
+            free(mesh->attributes[i].data);
+            mesh->attributes[i].data = optimized[i];
+        }
+    }
+    free(remap);
+
+    f32 triangles = (f32)(mesh->num_indices / 3);
+    printf(
+        "vertex cache ACMR %.3f -> %.3f, %u of %u vertices used\n",
+        (f64)((f32)before.vertices_transformed / triangles),
+        (f64)((f32)after.vertices_transformed / triangles),
+        vertex_offset,
+        mesh->num_vertices
+    );
+    mesh->num_vertices = vertex_offset;
+}
+
+/// Simplify every submesh into a chain of LODs, each about half of the previous one. The LOD
+/// indices are appended after the full detail indices of every submesh.
+static void meshcook_build_lods(const meshcook_options* options, meshcook_mesh* mesh) {
+    const meshcook_attribute* positions = &mesh->attributes[DVR_MESH_ATTRIBUTE_POSITION];
+    f32 extent = 0.0f;
+    for (u32 i = 0; i < 3; i++) {
+        f32 axis = mesh->bounds_max[i] - mesh->bounds_min[i];
+        extent = axis > extent ? axis : extent;
+    }
+
+    mesh->lods = malloc((usize)mesh->num_submeshes * options->lods * sizeof(dvr_dvrm_lod));
+    for (u32 i = 0; i < mesh->num_submeshes; i++) {
+        dvr_dvrm_submesh* submesh = &mesh->submeshes[i];
+        submesh->first_lod = mesh->num_lods;
+        mesh->lods[mesh->num_lods++] = (dvr_dvrm_lod){
+            .first_index = submesh->first_index,
+            .index_count = submesh->index_count,
+        };
+
+        for (u32 level = 1; level < options->lods; level++) {
+            const dvr_dvrm_lod* source = &mesh->lods[mesh->num_lods - 1];
+            u32* indices = malloc((usize)source->index_count * sizeof(u32));
+            f32 error = 0.0f;
+            u32 index_count = (u32)dvr_simplify(
+                indices,
+                &mesh->indices[source->first_index],
+                source->index_count,
+                (const f32*)(positions->data + (usize)submesh->vertex_offset * positions->size),
+                submesh->vertex_count,
+                positions->size,
+                source->index_count / 6 * 3,
+                MESHCOOK_LOD_MAX_ERROR * extent,
+                &error
+            );
+
+            // a LOD that barely saves anything isn't worth its indices
+            if (index_count == 0 || (u64)index_count * 10 > (u64)source->index_count * 9) {
+                free(indices);
+                break;
+            }
+            if (options->optimize) {
+                dvr_optimize_vertex_cache(indices, indices, index_count, submesh->vertex_count);
+            }
+
+            usize total_size = (usize)(mesh->num_indices + index_count) * sizeof(u32);
+            mesh->indices = realloc(mesh->indices, total_size);
+            memcpy(&mesh->indices[mesh->num_indices], indices, index_count * sizeof(u32));
+            free(indices);
+
+            // errors of the steps add up, which keeps the chain ordered
+            mesh->lods[mesh->num_lods] = (dvr_dvrm_lod){
+                .first_index = mesh->num_indices,
+                .index_count = index_count,
+                .error = source->error + error,
+            };
+            mesh->num_lods++;
+            mesh->num_indices += index_count;
+        }
+
+        submesh->num_lods = mesh->num_lods - submesh->first_lod;
+        const dvr_dvrm_lod* coarsest = &mesh->lods[mesh->num_lods - 1];
+        printf(
+            "submesh %u: %u LODs, %u -> %u triangles, error %g\n",
+            i,
+            submesh->num_lods,
+            submesh->index_count / 3,
+            coarsest->index_count / 3,
+            (f64)coarsest->error
+        );
+    }
+}
+
+static u32 meshcook_vertex_size(const meshcook_mesh* mesh) {
+    u32 size = 0;
+    for (u32 i = 0; i < DVR_MESH_ATTRIBUTE_COUNT; i++) {
+        size += mesh->attributes[i].present ? mesh->attributes[i].size : 0;
+    }
+    return size;
+}
+
+/// Replace the float attributes with their packed formats, colors already are.
+static void meshcook_quantize(meshcook_mesh* mesh) {
+    u32 vertex_size = meshcook_vertex_size(mesh);
+    meshcook_attribute* attributes = mesh->attributes;
+
+    // the model matrix takes the unorm16 positions back to mesh space
+    mesh->position_quantization =
+        dvr_position_quantization_from_bounds(mesh->bounds_min, mesh->bounds_max);
+    meshcook_attribute* positions = &attributes[DVR_MESH_ATTRIBUTE_POSITION];
+    u16* packed_positions = malloc((usize)mesh->num_vertices * 4 * sizeof(u16));
+    for (u32 v = 0; v < mesh->num_vertices; v++) {
+        dvr_quantize_position(
+            &mesh->position_quantization,
+            (const f32*)positions->data + (usize)v * 3,
+            &packed_positions[(usize)v * 4]
+        );
+    }
+    free(positions->data);
+    positions->data = (u8*)packed_positions;
+    meshcook_init_attribute(positions, VK_FORMAT_R16G16B16A16_UNORM, 4 * sizeof(u16));
+
+    meshcook_attribute* uvs = &attributes[DVR_MESH_ATTRIBUTE_UV];
+    if (uvs->present) {
+        // unorm16 is finer than half over [0, 1], tiling UVs need the range of half
+        const f32* data = (const f32*)uvs->data;
+        bool normalized = true;
+        for (usize i = 0; i < (usize)mesh->num_vertices * 2; i++) {
+            normalized &= data[i] >= 0.0f && data[i] <= 1.0f;
+        }
+
+        u16* packed_uvs = malloc((usize)mesh->num_vertices * 2 * sizeof(u16));
+        for (usize i = 0; i < (usize)mesh->num_vertices * 2; i++) {
+            packed_uvs[i] = normalized ? dvr_quantize_unorm16(data[i]) : dvr_quantize_half(data[i]);
+        }
+        free(uvs->data);
+        uvs->data = (u8*)packed_uvs;
+        meshcook_init_attribute(
+            uvs,
+            normalized ? VK_FORMAT_R16G16_UNORM : VK_FORMAT_R16G16_SFLOAT,
+            2 * sizeof(u16)
+        );
+    }
+
+    meshcook_attribute* normals = &attributes[DVR_MESH_ATTRIBUTE_NORMAL];
+    if (normals->present) {
+        i16* packed_normals = malloc((usize)mesh->num_vertices * 2 * sizeof(i16));
+        for (u32 v = 0; v < mesh->num_vertices; v++) {
+            f32 encoded[2];
+            dvr_encode_octahedral((const f32*)normals->data + (usize)v * 3, encoded);
+            packed_normals[(usize)v * 2 + 0] = dvr_quantize_snorm16(encoded[0]);
+            packed_normals[(usize)v * 2 + 1] = dvr_quantize_snorm16(encoded[1]);
+        }
+        free(normals->data);
+        normals->data = (u8*)packed_normals;
+        meshcook_init_attribute(normals, VK_FORMAT_R16G16_SNORM, 2 * sizeof(i16));
+    }
+
+    printf("quantized vertices from %u to %u bytes\n", vertex_size, meshcook_vertex_size(mesh));
+}
+
+static bool meshcook_write_at(
+    FILE* file,
+    usize* written,
+    usize offset,
+    const void* data,
+    usize size
+) {
+    static const u8 zeros[DVR_DVRM_ALIGNMENT] = { 0 };
+    while (*written < offset) {
+        usize padding = offset - *written < sizeof(zeros) ? offset - *written : sizeof(zeros);
+        if (fwrite(zeros, 1, padding, file) != padding) {
+            return false;
+        }
+        *written += padding;
+    }
+
+    *written += size;
+    return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+static bool meshcook_write(const meshcook_options* options, const meshcook_mesh* mesh) {
+    // 16-bit indices whenever every submesh fits, indices are relative to their submesh
+    u32 index_size = 2;
+    for (u32 i = 0; i < mesh->num_submeshes; i++) {
+        if (options->index32 || mesh->submeshes[i].vertex_count > UINT16_MAX + 1) {
+            index_size = 4;
+        }
+    }
+
+    dvr_dvrm_attribute attributes[DVR_MESH_MAX_ATTRIBUTES];
+    dvr_dvrm_stream streams[DVR_MESH_MAX_STREAMS] = { 0 };
+    u32 num_attributes = 0;
+    u32 num_streams = options->layout == MESHCOOK_LAYOUT_INTERLEAVED ? 1 : 0;
+    for (u32 i = 0; i < DVR_MESH_ATTRIBUTE_COUNT; i++) {
+        const meshcook_attribute* attribute = &mesh->attributes[i];
+        if (!attribute->present) {
+            continue;
+        }
+
+        u32 stream = options->layout == MESHCOOK_LAYOUT_INTERLEAVED ? 0 : num_streams++;
+        attributes[num_attributes++] = (dvr_dvrm_attribute){
+            .semantic = i,
+            .format = (u32)attribute->format,
+            .stream = stream,
+            .offset = streams[stream].stride,
+        };
+        streams[stream].stride += attribute->size;
+    }
+
+    dvr_dvrm_header header = {
+        .magic = DVR_DVRM_MAGIC,
+        .version = DVR_DVRM_VERSION,
+        .num_vertices = mesh->num_vertices,
+        .num_indices = mesh->num_indices,
+        .index_size = index_size,
+        .num_attributes = num_attributes,
+        .num_streams = num_streams,
+        .num_submeshes = mesh->num_submeshes,
+    };
+    memcpy(header.bounds_min, mesh->bounds_min, sizeof(header.bounds_min));
+    memcpy(header.bounds_max, mesh->bounds_max, sizeof(header.bounds_max));
+    memcpy(
+        header.position_scale,
+        mesh->position_quantization.scale,
+        sizeof(header.position_scale)
+    );
+    memcpy(
+        header.position_offset,
+        mesh->position_quantization.offset,
+        sizeof(header.position_offset)
+    );
+    header.num_lods = mesh->num_lods;
+    header.attributes_offset = meshcook_align(sizeof(header));
+    header.streams_offset =
+        meshcook_align(header.attributes_offset + num_attributes * sizeof(dvr_dvrm_attribute));
+    header.submeshes_offset =
+        meshcook_align(header.streams_offset + num_streams * sizeof(dvr_dvrm_stream));
+
+    header.lods_offset =
+        meshcook_align(header.submeshes_offset + mesh->num_submeshes * sizeof(dvr_dvrm_submesh));
+
+    usize offset = meshcook_align(header.lods_offset + mesh->num_lods * sizeof(dvr_dvrm_lod));
+    u8* stream_data[DVR_MESH_MAX_STREAMS];
+    for (u32 i = 0; i < num_streams; i++) {
+        streams[i].offset = offset;
+        stream_data[i] = malloc((usize)streams[i].stride * mesh->num_vertices);
+        offset = meshcook_align(offset + (usize)streams[i].stride * mesh->num_vertices);
+    }
+    header.indices_offset = offset;
+
+    // scatter the attributes into their streams
+    for (u32 i = 0; i < num_attributes; i++) {
+        const meshcook_attribute* attribute = &mesh->attributes[attributes[i].semantic];
+        u32 stride = streams[attributes[i].stream].stride;
+        u8* dst = stream_data[attributes[i].stream] + attributes[i].offset;
+        for (u32 v = 0; v < mesh->num_vertices; v++) {
+            memcpy(
+                dst + (usize)v * stride,
+                attribute->data + (usize)v * attribute->size,
+                attribute->size
+            );
+        }
+    }
+
+    u8* indices = malloc((usize)mesh->num_indices * index_size);
+    for (u32 i = 0; i < mesh->num_indices; i++) {
+        if (index_size == 2) {
+            u16 index = (u16)mesh->indices[i];
+            memcpy(indices + i * sizeof(u16), &index, sizeof(index));
+        } else {
+            memcpy(indices + i * sizeof(u32), &mesh->indices[i], sizeof(u32));
+        }
+    }
+
+    bool ok = false;
+    FILE* file = fopen(options->output, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open %s for writing\n", options->output);
+    } else {
+        usize written = 0;
+        ok = meshcook_write_at(file, &written, 0, &header, sizeof(header)) &&
+             meshcook_write_at(
+                 file,
+                 &written,
+                 header.attributes_offset,
+                 attributes,
+                 num_attributes * sizeof(dvr_dvrm_attribute)
+             ) &&
+             meshcook_write_at(
+                 file,
+                 &written,
+                 header.streams_offset,
+                 streams,
+                 num_streams * sizeof(dvr_dvrm_stream)
+             ) &&
+             meshcook_write_at(
+                 file,
+                 &written,
+                 header.submeshes_offset,
+                 mesh->submeshes,
+                 mesh->num_submeshes * sizeof(dvr_dvrm_submesh)
+             ) &&
+             meshcook_write_at(
+                 file,
+                 &written,
+                 header.lods_offset,
+                 mesh->lods,
+                 mesh->num_lods * sizeof(dvr_dvrm_lod)
+             );
+        for (u32 i = 0; ok && i < num_streams; i++) {
+            ok = meshcook_write_at(
+                file,
+                &written,
+                streams[i].offset,
+                stream_data[i],
+                (usize)streams[i].stride * mesh->num_vertices
+            );
+        }
+        ok = ok && meshcook_write_at(
+                       file,
+                       &written,
+                       header.indices_offset,
+                       indices,
+                       (usize)mesh->num_indices * index_size
+                   );
+
+        if (fclose(file) != 0 || !ok) {
+            fprintf(stderr, "failed to write %s\n", options->output);
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        printf(
+            "cooked %u vertices, %u indices (%u bit), %u submeshes, %u streams into %zu bytes\n",
+            mesh->num_vertices,
+            mesh->num_indices,
+            index_size * 8,
+            mesh->num_submeshes,
+            num_streams,
+            offset + (usize)mesh->num_indices * index_size
+        );
+    }
+
+    for (u32 i = 0; i < num_streams; i++) {
+        free(stream_data[i]);
+    }
+    free(indices);
+
+    return ok;
+}
+
+static void meshcook_usage(void) {
+    fprintf(
+        stderr,
+        "usage: dvr_meshcook [--layout interleaved|soa] [--colors] [--normals] [--index32] "
+        "[--no-optimize] [--no-quantize] [--lods <count>] <input> <output>\n"
+    );
+}
+
+int main(int argc, char** argv) {
+    meshcook_options options = {
+        .layout = MESHCOOK_LAYOUT_INTERLEAVED,
+        .optimize = true,
+        .quantize = true,
+        .lods = MESHCOOK_DEFAULT_LODS,
+    };
+
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (strcmp(name, "interleaved") == 0) {
+                options.layout = MESHCOOK_LAYOUT_INTERLEAVED;
+            } else if (strcmp(name, "soa") == 0) {
+                options.layout = MESHCOOK_LAYOUT_SOA;
+            } else {
+                fprintf(stderr, "unknown layout: %s\n", name);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--colors") == 0) {
+            options.colors = true;
+        } else if (strcmp(argv[i], "--normals") == 0) {
+            options.normals = true;
+        } else if (strcmp(argv[i], "--index32") == 0) {
+            options.index32 = true;
+        } else if (strcmp(argv[i], "--no-optimize") == 0) {
+            options.optimize = false;
+        } else if (strcmp(argv[i], "--no-quantize") == 0) {
+            options.quantize = false;
+        } else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+            options.lods = (u32)strtoul(argv[++i], NULL, 10);
+            if (options.lods == 0) {
+                fprintf(stderr, "at least one LOD is needed\n");
+                return 1;
+            }
+        } else if (options.input == NULL) {
+            options.input = argv[i];
+        } else if (options.output == NULL) {
+            options.output = argv[i];
+        } else {
+            meshcook_usage();
+            return 1;
+        }
+    }
+
+    if (options.input == NULL || options.output == NULL) {
+        meshcook_usage();
+        return 1;
+    }
+
+    meshcook_mesh mesh = {
+        .position_quantization = { .scale = { 1.0f, 1.0f, 1.0f } },
+    };
+    if (!meshcook_import(&options, &mesh)) {
+        return 1;
+    }
+
+    if (options.optimize) {
+        meshcook_optimize(&mesh);
+    }
+    // both need the float positions
+    meshcook_build_lods(&options, &mesh);
+    if (options.quantize) {
+        meshcook_quantize(&mesh);
+    }
+
+    bool ok = meshcook_write(&options, &mesh);
+
+    for (u32 i = 0; i < DVR_MESH_ATTRIBUTE_COUNT; i++) {
+        free(mesh.attributes[i].data);
+    }
+    free(mesh.indices);
+    free(mesh.submeshes);
+    free(mesh.lods);
+
+    return ok ? 0 : 1;
+}
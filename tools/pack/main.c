@@ -0,0 +1,327 @@
+/// dvr_pack: asset archive packer
+///
+/// Packs files into a single DVRA archive, see dvr_archive.h for the layout. Entries are named
+/// after the file name of their path, or explicitly with `name=path`.
+
+#include "dvr_archive.h"
+#include "dvr_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_LZ4_HASH_BITS 16
+#define PACK_LZ4_MIN_MATCH 4
+// the format requires the last 5 bytes to be literals and the last match to start at least
+// 12 bytes before the end of the block
+#define PACK_LZ4_LAST_LITERALS 5
+#define PACK_LZ4_MATCH_LIMIT 12
+
+typedef struct pack_entry {
+    const char* name;
+    dvr_range data;
+    u8* stored;
+    usize stored_size;
+    dvr_archive_compression compression;
+    u64 hash;
+    u64 offset;
+    u32 name_offset;
+} pack_entry;
+
+static u32 pack_read32(const u8* p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static u8* pack_lz4_write_length(u8* op, usize length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (u8)length;
+    return op;
+}
+
+static u8* pack_lz4_write_sequence(
+    u8* op,
+    const u8* literals,
+    usize literal_length,
+    usize offset,
+    usize match_length
+) {
+    u8* token = op++;
+    *token = (u8)((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15) {
+        op = pack_lz4_write_length(op, literal_length - 15);
+    }
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    // the final sequence has no match
+    if (match_length == 0) {
+        return op;
+    }
+
+    *op++ = (u8)(offset & 0xFF);
+    *op++ = (u8)(offset >> 8);
+    usize length = match_length - PACK_LZ4_MIN_MATCH;
+    *token |= (u8)(length < 15 ? length : 15);
+    if (length >= 15) {
+        op = pack_lz4_write_length(op, length - 15);
+    }
+    return op;
+}
+
+static usize pack_lz4_bound(usize size) {
+    return size + size / 255 + 16;
+}
+
+/// Greedy LZ4 block compressor with a single hash table probe per position.
+static usize pack_lz4_compress(const u8* src, usize size, u8* dst) {
+    static u32 table[1 << PACK_LZ4_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    u8* op = dst;
+    usize anchor = 0;
+    usize ip = 0;
+    if (size > PACK_LZ4_MATCH_LIMIT) {
+        usize match_start_limit = size - PACK_LZ4_MATCH_LIMIT;
+        usize match_end_limit = size - PACK_LZ4_LAST_LITERALS;
+        while (ip < match_start_limit) {
+            u32 sequence = pack_read32(src + ip);
+            u32 hash = (sequence * 2654435761u) >> (32 - PACK_LZ4_HASH_BITS);
+            usize candidate = table[hash];
+            table[hash] = (u32)ip;
+
+            if (candidate >= ip || ip - candidate > 65535 ||
+                pack_read32(src + candidate) != sequence) {
+                ip++;
+                continue;
+            }
+
+            usize length = PACK_LZ4_MIN_MATCH;
+            while (ip + length < match_end_limit && src[candidate + length] == src[ip + length]) {
+                length++;
+            }
+
+            op = pack_lz4_write_sequence(op, src + anchor, ip - anchor, ip - candidate, length);
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    op = pack_lz4_write_sequence(op, src + anchor, size - anchor, 0, 0);
+    return (usize)(op - dst);
+}
+
+static usize pack_align(usize offset) {
+    return (offset + DVR_ARCHIVE_ALIGNMENT - 1) & ~(usize)(DVR_ARCHIVE_ALIGNMENT - 1);
+}
+
+static bool pack_write_at(FILE* file, usize* written, usize offset, const void* data, usize size) {
+    static const u8 zeros[DVR_ARCHIVE_ALIGNMENT] = { 0 };
+    while (*written < offset) {
+        usize padding = offset - *written < sizeof(zeros) ? offset - *written : sizeof(zeros);
+        if (fwrite(zeros, 1, padding, file) != padding) {
+            return false;
+        }
+        *written += padding;
+    }
+
+    *written += size;
+    return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+static int pack_compare_entries(const void* a, const void* b) {
+    const pack_entry* ea = a;
+    const pack_entry* eb = b;
+    return ea->hash < eb->hash ? -1 : ea->hash > eb->hash;
+}
+
+static const char* pack_file_name(const char* path) {
+    const char* name = path;
+    for (const char* c = path; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') {
+            name = c + 1;
+        }
+    }
+    return name;
+}
+
+static void pack_usage(void) {
+    fprintf(stderr, "usage: dvr_pack [--lz4] <output> <[name=]path>...\n");
+}
+
+int main(int argc, char** argv) {
+    bool lz4 = false;
+    const char* output = NULL;
+    u32 num_entries = 0;
+    pack_entry* entries = calloc((usize)argc, sizeof(pack_entry));
+
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lz4") == 0) {
+            lz4 = true;
+        } else if (output == NULL) {
+            output = argv[i];
+        } else {
+            const char* path = argv[i];
+            const char* name = pack_file_name(path);
+            char* separator = strchr(argv[i], '=');
+            if (separator != NULL) {
+                *separator = '\0';
+                name = argv[i];
+                path = separator + 1;
+            }
+
+            DVR_RESULT(dvr_range) data_res = dvr_read_file(path);
+            if (!data_res.is_ok) {
+                fprintf(stderr, "failed to read %s: %s\n", path, data_res.error.message);
+                return 1;
+            }
+
+            entries[num_entries++] = (pack_entry){
+                .name = name,
+                .data = data_res.ok,
+                .hash = dvr_archive_hash(name, strlen(name)),
+            };
+        }
+    }
+
+    if (output == NULL) {
+        pack_usage();
+        return 1;
+    }
+
+    qsort(entries, num_entries, sizeof(pack_entry), pack_compare_entries);
+    for (u32 i = 1; i < num_entries; i++) {
+        for (u32 j = i; j > 0 && entries[j - 1].hash == entries[i].hash; j--) {
+            if (strcmp(entries[i].name, entries[j - 1].name) == 0) {
+                fprintf(stderr, "duplicate entry: %s\n", entries[i].name);
+                return 1;
+            }
+        }
+    }
+
+    // about one entry per bucket
+    u32 bucket_bits = 0;
+    while (bucket_bits < 24 && (1u << bucket_bits) < num_entries) {
+        bucket_bits++;
+    }
+    u32 num_buckets = (1u << bucket_bits) + 1;
+    u32* buckets = calloc(num_buckets, sizeof(u32));
+    for (u32 bucket = 0, i = 0; bucket < num_buckets; bucket++) {
+        while (i < num_entries && bucket_bits > 0 &&
+               (entries[i].hash >> (64 - bucket_bits)) < bucket) {
+            i++;
+        }
+        buckets[bucket] = bucket_bits > 0 || bucket == 0 ? i : num_entries;
+    }
+
+    dvr_archive_header header = {
+        .magic = DVR_ARCHIVE_MAGIC,
+        .version = DVR_ARCHIVE_VERSION,
+        .num_entries = num_entries,
+        .bucket_bits = bucket_bits,
+        .buckets_offset = sizeof(dvr_archive_header),
+    };
+    header.entries_offset = pack_align(header.buckets_offset + num_buckets * sizeof(u32));
+    header.names_offset = header.entries_offset + num_entries * sizeof(dvr_archive_entry);
+
+    usize names_size = 0;
+    for (u32 i = 0; i < num_entries; i++) {
+        entries[i].name_offset = (u32)names_size;
+        names_size += strlen(entries[i].name);
+    }
+
+    usize offset = pack_align(header.names_offset + names_size);
+    usize raw_size = 0;
+    usize packed_size = 0;
+    for (u32 i = 0; i < num_entries; i++) {
+        pack_entry* entry = &entries[i];
+        entry->stored = entry->data.base;
+        entry->stored_size = entry->data.size;
+
+        // only keep the compressed blob when it saves at least an eighth
+        if (lz4 && entry->data.size > 0 && entry->data.size <= UINT32_MAX) {
+            u8* compressed = malloc(pack_lz4_bound(entry->data.size));
+            usize compressed_size = pack_lz4_compress(entry->data.base, entry->data.size, compressed);
+            if (compressed_size < entry->data.size - entry->data.size / 8) {
+                entry->stored = compressed;
+                entry->stored_size = compressed_size;
+                entry->compression = DVR_ARCHIVE_COMPRESSION_LZ4;
+            } else {
+                free(compressed);
+            }
+        }
+
+        entry->offset = offset;
+        offset = pack_align(offset + entry->stored_size);
+        raw_size += entry->data.size;
+        packed_size += entry->stored_size;
+    }
+
+    FILE* file = fopen(output, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open %s for writing\n", output);
+        return 1;
+    }
+
+    usize written = 0;
+    bool ok = pack_write_at(file, &written, 0, &header, sizeof(header)) &&
+              pack_write_at(
+                  file,
+                  &written,
+                  header.buckets_offset,
+                  buckets,
+                  num_buckets * sizeof(u32)
+              );
+    for (u32 i = 0; ok && i < num_entries; i++) {
+        dvr_archive_entry entry = {
+            .hash = entries[i].hash,
+            .offset = entries[i].offset,
+            .size = entries[i].data.size,
+            .stored_size = entries[i].stored_size,
+            .name_offset = entries[i].name_offset,
+            .name_length = (u32)strlen(entries[i].name),
+            .compression = entries[i].compression,
+        };
+        ok = pack_write_at(
+            file,
+            &written,
+            header.entries_offset + i * sizeof(dvr_archive_entry),
+            &entry,
+            sizeof(entry)
+        );
+    }
+    for (u32 i = 0; ok && i < num_entries; i++) {
+        ok = pack_write_at(
+            file,
+            &written,
+            header.names_offset + entries[i].name_offset,
+            entries[i].name,
+            strlen(entries[i].name)
+        );
+    }
+    for (u32 i = 0; ok && i < num_entries; i++) {
+        ok = pack_write_at(file, &written, entries[i].offset, entries[i].stored, entries[i].stored_size);
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "failed to write %s\n", output);
+        return 1;
+    }
+
+    printf("packed %u entries, %zu bytes into %zu bytes\n", num_entries, raw_size, packed_size);
+
+    for (u32 i = 0; i < num_entries; i++) {
+        if (entries[i].stored != entries[i].data.base) {
+            free(entries[i].stored);
+        }
+        dvr_free_file(entries[i].data);
+    }
+    free(buckets);
+    free(entries);
+
+    return 0;
+}
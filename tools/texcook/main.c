@@ -0,0 +1,459 @@
+/// dvr_texcook: offline texture cooker
+///
+/// Decodes a source image, builds its mip chain, optionally block-compresses every level and
+/// writes a DVRT file, which `dvr_load_texture` uploads without any decoding at runtime.
+
+#include "dvr.h"
+#include "dvr_texture.h"
+#include "dvr_utils.h"
+
+#include <stb/stb_image.h>
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum texcook_encoding {
+    TEXCOOK_ENCODING_RGBA8,
+    TEXCOOK_ENCODING_BC1,
+    TEXCOOK_ENCODING_BC3,
+    TEXCOOK_ENCODING_BC4,
+    TEXCOOK_ENCODING_BC5,
+} texcook_encoding;
+
+typedef struct texcook_options {
+    const char* input;
+    const char* output;
+    texcook_encoding encoding;
+    bool srgb;
+    bool mipmaps;
+} texcook_options;
+
+/// RGBA8 pixels of one mip level.
+typedef struct texcook_image {
+    u32 width;
+    u32 height;
+    u8* pixels;
+} texcook_image;
+
+static f32 g_texcook_srgb_to_linear[256];
+
+static void texcook_init_srgb_table(void) {
+    for (u32 i = 0; i < 256; i++) {
+        f32 v = (f32)i / 255.0f;
+        g_texcook_srgb_to_linear[i] =
+            v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+static u8 texcook_unorm8(f32 v) {
+    return (u8)(dvr_clampf(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static u8 texcook_linear_to_srgb(f32 v) {
+    v = dvr_clampf(v, 0.0f, 1.0f);
+    return texcook_unorm8(v <= 0.0031308f ? v * 12.92f : 1.055f * powf(v, 1.0f / 2.4f) - 0.055f);
+}
+
+/// 2x2 box filter, sRGB color channels are averaged in linear space.
+static texcook_image texcook_downsample(const texcook_image* src, bool srgb) {
+    texcook_image dst = {
+        .width = src->width > 1 ? src->width / 2 : 1,
+        .height = src->height > 1 ? src->height / 2 : 1,
+    };
+    dst.pixels = malloc((usize)dst.width * dst.height * 4);
+
+    for (u32 y = 0; y < dst.height; y++) {
+        u32 sy[2] = { 2 * y, 2 * y + 1 < src->height ? 2 * y + 1 : src->height - 1 };
+        for (u32 x = 0; x < dst.width; x++) {
+            u32 sx[2] = { 2 * x, 2 * x + 1 < src->width ? 2 * x + 1 : src->width - 1 };
+            for (u32 c = 0; c < 4; c++) {
+                bool linearize = srgb && c < 3;
+                f32 sum = 0.0f;
+                for (u32 i = 0; i < 4; i++) {
+                    u8 v = src->pixels[((usize)sy[i / 2] * src->width + sx[i % 2]) * 4 + c];
+                    sum += linearize ? g_texcook_srgb_to_linear[v] : (f32)v / 255.0f;
+                }
+
+                dst.pixels[((usize)y * dst.width + x) * 4 + c] =
+                    linearize ? texcook_linear_to_srgb(sum * 0.25f) : texcook_unorm8(sum * 0.25f);
+            }
+        }
+    }
+
+    return dst;
+}
+
+/// 4x4 block starting at the given block coordinates, edges are clamped.
+static void texcook_fetch_block(const texcook_image* img, u32 bx, u32 by, u8 block[16][4]) {
+    for (u32 py = 0; py < 4; py++) {
+        u32 y = by * 4 + py < img->height ? by * 4 + py : img->height - 1;
+        for (u32 px = 0; px < 4; px++) {
+            u32 x = bx * 4 + px < img->width ? bx * 4 + px : img->width - 1;
+            memcpy(block[py * 4 + px], &img->pixels[((usize)y * img->width + x) * 4], 4);
+        }
+    }
+}
+
+static u16 texcook_pack_565(const f32 color[3]) {
+    u32 r = (u32)(dvr_clampf(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    u32 g = (u32)(dvr_clampf(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    u32 b = (u32)(dvr_clampf(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+static void texcook_unpack_565(u16 packed, f32 color[3]) {
+    u32 r = (packed >> 11) & 31;
+    u32 g = (packed >> 5) & 63;
+    u32 b = packed & 31;
+    color[0] = (f32)((r << 3) | (r >> 2));
+    color[1] = (f32)((g << 2) | (g >> 4));
+    color[2] = (f32)((b << 3) | (b >> 2));
+}
+
+/// BC1 color block in 4 color mode. The endpoints span the block along the principal axis of
+/// its colors, which is found with a few power iterations on the covariance matrix.
+static void texcook_encode_bc1(u8 block[16][4], u8 out[8]) {
+    f32 mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (u32 i = 0; i < 16; i++) {
+        for (u32 c = 0; c < 3; c++) {
+            mean[c] += (f32)block[i][c] / 16.0f;
+        }
+    }
+
+    f32 cov[3][3] = { { 0.0f } };
+    for (u32 i = 0; i < 16; i++) {
+        f32 d[3];
+        for (u32 c = 0; c < 3; c++) {
+            d[c] = (f32)block[i][c] - mean[c];
+        }
+        for (u32 a = 0; a < 3; a++) {
+            for (u32 b = 0; b < 3; b++) {
+                cov[a][b] += d[a] * d[b];
+            }
+        }
+    }
+
+    f32 axis[3] = { 0.57735f, 0.57735f, 0.57735f };
+    for (u32 iteration = 0; iteration < 8; iteration++) {
+        f32 next[3];
+        for (u32 a = 0; a < 3; a++) {
+            next[a] = cov[a][0] * axis[0] + cov[a][1] * axis[1] + cov[a][2] * axis[2];
+        }
+        f32 length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f) {
+            break;
+        }
+        for (u32 a = 0; a < 3; a++) {
+            axis[a] = next[a] / length;
+        }
+    }
+
+    f32 min_t = FLT_MAX;
+    f32 max_t = -FLT_MAX;
+    for (u32 i = 0; i < 16; i++) {
+        f32 t = 0.0f;
+        for (u32 c = 0; c < 3; c++) {
+            t += ((f32)block[i][c] - mean[c]) * axis[c];
+        }
+        min_t = fminf(min_t, t);
+        max_t = fmaxf(max_t, t);
+    }
+
+    f32 endpoints[2][3];
+    for (u32 c = 0; c < 3; c++) {
+        endpoints[0][c] = mean[c] + axis[c] * max_t;
+        endpoints[1][c] = mean[c] + axis[c] * min_t;
+    }
+
+    // c0 > c1 selects the 4 color mode
+    u16 c0 = texcook_pack_565(endpoints[0]);
+    u16 c1 = texcook_pack_565(endpoints[1]);
+    if (c0 < c1) {
+        u16 tmp = c0;
+        c0 = c1;
+        c1 = tmp;
+    }
+
+    f32 palette[4][3];
+    texcook_unpack_565(c0, palette[0]);
+    texcook_unpack_565(c1, palette[1]);
+    for (u32 c = 0; c < 3; c++) {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    // with equal endpoints every index decodes to c0
+    u32 indices = 0;
+    if (c0 != c1) {
+        for (u32 i = 0; i < 16; i++) {
+            u32 best = 0;
+            f32 best_error = FLT_MAX;
+            for (u32 j = 0; j < 4; j++) {
+                f32 error = 0.0f;
+                for (u32 c = 0; c < 3; c++) {
+                    f32 d = (f32)block[i][c] - palette[j][c];
+                    error += d * d;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    best = j;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+
+    out[0] = (u8)(c0 & 0xFF);
+    out[1] = (u8)(c0 >> 8);
+    out[2] = (u8)(c1 & 0xFF);
+    out[3] = (u8)(c1 >> 8);
+    for (u32 i = 0; i < 4; i++) {
+        out[4 + i] = (u8)(indices >> (8 * i));
+    }
+}
+
+/// BC4 block of a single channel in 8 value mode, also the alpha half of BC3 and both halves
+/// of BC5.
+static void texcook_encode_bc4(u8 block[16][4], u32 channel, u8 out[8]) {
+    u32 hi = 0;
+    u32 lo = 255;
+    for (u32 i = 0; i < 16; i++) {
+        hi = block[i][channel] > hi ? block[i][channel] : hi;
+        lo = block[i][channel] < lo ? block[i][channel] : lo;
+    }
+
+    u32 palette[8] = { hi, lo };
+    for (u32 k = 2; k < 8; k++) {
+        palette[k] = ((8 - k) * hi + (k - 1) * lo) / 7;
+    }
+
+    u64 indices = 0;
+    if (hi != lo) {
+        for (u32 i = 0; i < 16; i++) {
+            u32 best = 0;
+            u32 best_error = UINT32_MAX;
+            for (u32 k = 0; k < 8; k++) {
+                u32 v = block[i][channel];
+                u32 error = v > palette[k] ? v - palette[k] : palette[k] - v;
+                if (error < best_error) {
+                    best_error = error;
+                    best = k;
+                }
+            }
+            indices |= (u64)best << (3 * i);
+        }
+    }
+
+    out[0] = (u8)hi;
+    out[1] = (u8)lo;
+    for (u32 i = 0; i < 6; i++) {
+        out[2 + i] = (u8)(indices >> (8 * i));
+    }
+}
+
+static VkFormat texcook_format(texcook_encoding encoding, bool srgb) {
+    switch (encoding) {
+        case TEXCOOK_ENCODING_RGBA8:
+            return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        case TEXCOOK_ENCODING_BC1:
+            return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case TEXCOOK_ENCODING_BC3:
+            return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case TEXCOOK_ENCODING_BC4:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        case TEXCOOK_ENCODING_BC5:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+/// Encoded level data, `size` bytes as reported by `dvr_image_level_size`.
+static u8* texcook_encode_level(const texcook_image* img, texcook_encoding encoding, usize size) {
+    u8* out = malloc(size);
+    if (encoding == TEXCOOK_ENCODING_RGBA8) {
+        memcpy(out, img->pixels, size);
+        return out;
+    }
+
+    u32 blocks_x = (img->width + 3) / 4;
+    u32 blocks_y = (img->height + 3) / 4;
+    usize block_bytes = size / ((usize)blocks_x * blocks_y);
+
+    u8 block[16][4];
+    for (u32 by = 0; by < blocks_y; by++) {
+        for (u32 bx = 0; bx < blocks_x; bx++) {
+            texcook_fetch_block(img, bx, by, block);
+            u8* dst = out + ((usize)by * blocks_x + bx) * block_bytes;
+
+            switch (encoding) {
+                case TEXCOOK_ENCODING_BC1:
+                    texcook_encode_bc1(block, dst);
+                    break;
+                case TEXCOOK_ENCODING_BC3:
+                    texcook_encode_bc4(block, 3, dst);
+                    texcook_encode_bc1(block, dst + 8);
+                    break;
+                case TEXCOOK_ENCODING_BC4:
+                    texcook_encode_bc4(block, 0, dst);
+                    break;
+                case TEXCOOK_ENCODING_BC5:
+                    texcook_encode_bc4(block, 0, dst);
+                    texcook_encode_bc4(block, 1, dst + 8);
+                    break;
+                case TEXCOOK_ENCODING_RGBA8:
+                    break;
+            }
+        }
+    }
+
+    return out;
+}
+
+static usize texcook_align(usize offset) {
+    return (offset + DVR_DVRT_ALIGNMENT - 1) & ~(usize)(DVR_DVRT_ALIGNMENT - 1);
+}
+
+static bool texcook_write_padding(FILE* file, usize from, usize to) {
+    static const u8 zeros[DVR_DVRT_ALIGNMENT] = { 0 };
+    return to - from == 0 || fwrite(zeros, 1, to - from, file) == to - from;
+}
+
+static int texcook_cook(const texcook_options* options) {
+    i32 width, height, channels;
+    u8* pixels = stbi_load(options->input, &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == NULL) {
+        fprintf(stderr, "failed to load %s: %s\n", options->input, stbi_failure_reason());
+        return 1;
+    }
+
+    VkFormat format = texcook_format(options->encoding, options->srgb);
+    u32 mip_levels = 1;
+    if (options->mipmaps) {
+        mip_levels = (u32)log2(fmax(width, height)) + 1;
+        mip_levels = mip_levels < DVR_TEXTURE_MAX_LEVELS ? mip_levels : DVR_TEXTURE_MAX_LEVELS;
+    }
+
+    dvr_dvrt_header header = {
+        .magic = DVR_DVRT_MAGIC,
+        .version = DVR_DVRT_VERSION,
+        .format = (u32)format,
+        .width = (u32)width,
+        .height = (u32)height,
+        .mip_levels = mip_levels,
+    };
+
+    dvr_dvrt_level levels[DVR_TEXTURE_MAX_LEVELS];
+    u8* level_data[DVR_TEXTURE_MAX_LEVELS];
+
+    texcook_image image = { .width = (u32)width, .height = (u32)height, .pixels = pixels };
+    usize offset = texcook_align(sizeof(header) + mip_levels * sizeof(dvr_dvrt_level));
+    for (u32 i = 0; i < mip_levels; i++) {
+        if (i > 0) {
+            texcook_image next = texcook_downsample(&image, options->srgb);
+            if (i > 1) {
+                free(image.pixels);
+            }
+            image = next;
+        }
+
+        usize size = dvr_image_level_size(format, image.width, image.height);
+        levels[i] = (dvr_dvrt_level){ .offset = offset, .size = size };
+        level_data[i] = texcook_encode_level(&image, options->encoding, size);
+        offset = texcook_align(offset + size);
+    }
+    if (mip_levels > 1) {
+        free(image.pixels);
+    }
+    stbi_image_free(pixels);
+
+    int status = 0;
+    FILE* file = fopen(options->output, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "failed to open %s for writing\n", options->output);
+        status = 1;
+    } else {
+        usize written = sizeof(header) + mip_levels * sizeof(dvr_dvrt_level);
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(levels, sizeof(dvr_dvrt_level), mip_levels, file) == mip_levels;
+        for (u32 i = 0; ok && i < mip_levels; i++) {
+            ok = texcook_write_padding(file, written, levels[i].offset) &&
+                 fwrite(level_data[i], 1, levels[i].size, file) == levels[i].size;
+            written = levels[i].offset + levels[i].size;
+        }
+
+        if (fclose(file) != 0 || !ok) {
+            fprintf(stderr, "failed to write %s\n", options->output);
+            status = 1;
+        }
+    }
+
+    for (u32 i = 0; i < mip_levels; i++) {
+        free(level_data[i]);
+    }
+
+    return status;
+}
+
+static void texcook_usage(void) {
+    fprintf(
+        stderr,
+        "usage: dvr_texcook [--format rgba8|bc1|bc3|bc4|bc5] [--srgb] [--no-mips] "
+        "<input> <output>\n"
+    );
+}
+
+int main(int argc, char** argv) {
+    texcook_options options = {
+        .encoding = TEXCOOK_ENCODING_BC1,
+        .mipmaps = true,
+    };
+
+    static const struct {
+        const char* name;
+        texcook_encoding encoding;
+    } encodings[] = {
+        { "rgba8", TEXCOOK_ENCODING_RGBA8 }, { "bc1", TEXCOOK_ENCODING_BC1 },
+        { "bc3", TEXCOOK_ENCODING_BC3 },     { "bc4", TEXCOOK_ENCODING_BC4 },
+        { "bc5", TEXCOOK_ENCODING_BC5 },
+    };
+
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            bool found = false;
+            for (usize j = 0; j < sizeof(encodings) / sizeof(encodings[0]); j++) {
+                if (strcmp(name, encodings[j].name) == 0) {
+                    options.encoding = encodings[j].encoding;
+                    found = true;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "unknown format: %s\n", name);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--srgb") == 0) {
+            options.srgb = true;
+        } else if (strcmp(argv[i], "--no-mips") == 0) {
+            options.mipmaps = false;
+        } else if (options.input == NULL) {
+            options.input = argv[i];
+        } else if (options.output == NULL) {
+            options.output = argv[i];
+        } else {
+            texcook_usage();
+            return 1;
+        }
+    }
+
+    if (options.input == NULL || options.output == NULL) {
+        texcook_usage();
+        return 1;
+    }
+
+    texcook_init_srgb_table();
+    return texcook_cook(&options);
+}